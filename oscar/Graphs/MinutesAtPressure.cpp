@@ -26,12 +26,35 @@ MinutesAtPressure::MinutesAtPressure() :Layer(NoChannel)
     m_minpressure = 3;
     m_maxpressure = 30;
     m_minimum_height = 0;
+    MemoryAccounting::instance().add(this);
 }
 MinutesAtPressure::~MinutesAtPressure()
 {
+    MemoryAccounting::instance().remove(this);
     while (recalculating()) {};
 }
 
+qint64 PressureInfo::memoryUsed() const
+{
+    qint64 bytes = memoryOf(times) + memoryOf(events) + memoryOf(chans);
+    for (const auto & counts : events) {
+        bytes += memoryOf(counts);
+    }
+    return bytes;
+}
+
+void MinutesAtPressure::reportMemory(MemoryReport & report)
+{
+    // The recalculation thread swaps in its results under timelock
+    QMutexLocker lock(&timelock);
+    qint64 bytes = memoryOf(times) + memoryOf(epap_times) + memoryOf(chans) + memoryOf(events) + memoryOf(ahis);
+    for (const auto & values : events) {
+        bytes += memoryOf(values);
+    }
+    bytes += epap.memoryUsed() + ipap.memoryUsed();
+    report.add(QObject::tr("Minutes at pressure"), bytes);
+}
+
 RecalcMAP::~RecalcMAP()
 {
 }
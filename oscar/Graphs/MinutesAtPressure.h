@@ -11,6 +11,7 @@
 
 #include "Graphs/layer.h"
 #include "SleepLib/day.h"
+#include "SleepLib/memoryaccounting.h"
 
 class MinutesAtPressure;
 struct PressureInfo
@@ -41,6 +42,9 @@ struct PressureInfo
     }
     void finishCalcs();
 
+    //! \brief Estimated bytes held by the time and event tables
+    qint64 memoryUsed() const;
+
     ChannelID code;
     qint64 minx, maxx;
     QVector<int> times;
@@ -67,7 +71,7 @@ protected:
     volatile bool m_done;
 };
 
-class MinutesAtPressure:public Layer
+class MinutesAtPressure:public Layer, public MemoryReporter
 {
     friend class RecalcMAP;
 public:
@@ -89,6 +93,9 @@ public:
     bool mouseReleaseEvent(QMouseEvent *event, gGraph *graph);
 
     virtual void recalcFinished();
+
+    //! \brief Reports the pressure tables of the last calculation
+    virtual void reportMemory(MemoryReport & report);
     virtual Layer * Clone() {
         MinutesAtPressure * map = new MinutesAtPressure();
         Layer::CloneInto(map);
@@ -0,0 +1,129 @@
+/* gFrameScheduler Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QDebug>
+
+#include "Graphs/gFrameScheduler.h"
+#include "Graphs/gGraphView.h"
+#include "SleepLib/common.h"
+
+// Display frames are assumed to be 60 per second unless changed
+const int frame_default_rate = 60;
+
+// How long without any requests before a burst of activity is considered over
+const int frame_idle_timeout = 2000;
+
+gFrameScheduler & gFrameScheduler::instance()
+{
+    static gFrameScheduler scheduler;
+    return scheduler;
+}
+
+gFrameScheduler::gFrameScheduler()
+    : m_lastFrame(0), m_interval(1000 / frame_default_rate),
+      m_rendered(0), m_dropped(0), m_boundsDropped(0), m_burstRendered(0), m_burstDropped(0)
+{
+    m_timer.setSingleShot(true);
+    m_timer.setTimerType(Qt::PreciseTimer);
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(nextFrame()));
+
+    m_idle.setSingleShot(true);
+    connect(&m_idle, SIGNAL(timeout()), this, SLOT(idle()));
+
+    m_clock.start();
+    m_lastFrame = -m_interval;
+}
+
+void gFrameScheduler::setFrameRate(int fps)
+{
+    m_interval = qMax(1, 1000 / qBound(1, fps, 1000));
+}
+
+void gFrameScheduler::request(gGraphView * view, bool boundsChanged)
+{
+    if (!view) {
+        return;
+    }
+
+    bool found = false;
+    for (auto & p : m_pending) {
+        if (p.view == view) {
+            // The paint already waiting will show this state too, so this frame is dropped
+            if (boundsChanged && p.boundsChanged) {
+                m_boundsDropped++;
+            }
+            p.boundsChanged |= boundsChanged;
+            m_dropped++;
+            m_burstDropped++;
+            found = true;
+            break;
+        }
+    }
+    if (!found) {
+        Pending p(view);
+        p.boundsChanged = boundsChanged;
+        m_pending.append(p);
+    }
+
+    if (!m_timer.isActive()) {
+        // The first request after a quiet spell is painted straight away, later ones wait for the next frame
+        qint64 wait = m_lastFrame + m_interval - m_clock.elapsed();
+        m_timer.start(int(qMax(qint64(0), wait)));
+    }
+}
+
+void gFrameScheduler::cancel(gGraphView * view)
+{
+    for (int i = 0; i < m_pending.size(); ++i) {
+        if (m_pending.at(i).view == view) {
+            m_pending.removeAt(i);
+            break;
+        }
+    }
+    if (m_pending.isEmpty()) {
+        m_timer.stop();
+    }
+}
+
+void gFrameScheduler::nextFrame()
+{
+    m_lastFrame = m_clock.elapsed();
+    if (m_pending.isEmpty()) {
+        return;
+    }
+
+    // Take the list first, as painting may queue requests for the following frame
+    QList<Pending> pending = m_pending;
+    m_pending.clear();
+
+    for (const auto & p : pending) {
+        p.view->renderFrame();
+    }
+    m_rendered++;
+    m_burstRendered++;
+
+    m_idle.start(frame_idle_timeout);
+}
+
+void gFrameScheduler::idle()
+{
+#ifdef DEBUG_EFFICIENCY
+    if (m_burstDropped > 0) {
+        qDebug() << "Graph frames:" << m_burstRendered << "rendered," << m_burstDropped << "dropped"
+                 << "(" << m_rendered << "rendered," << m_dropped << "dropped since start)";
+    }
+#endif
+    m_burstRendered = 0;
+    m_burstDropped = 0;
+}
+
+void gFrameScheduler::resetStatistics()
+{
+    m_rendered = m_dropped = m_boundsDropped = 0;
+    m_burstRendered = m_burstDropped = 0;
+}
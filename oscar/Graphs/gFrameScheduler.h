@@ -0,0 +1,89 @@
+/* gFrameScheduler Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef GFRAMESCHEDULER_H
+#define GFRAMESCHEDULER_H
+
+#include <QObject>
+#include <QList>
+#include <QTimer>
+#include <QElapsedTimer>
+
+class gGraphView;
+
+/*! \class gFrameScheduler
+    \brief Coalesces redraw requests from every gGraphView into at most one paint per display frame
+
+    Scrolling, zooming and linked bound changes can ask for a redraw many times between two
+    frames, and the Daily view and any popped out graph windows used to each repaint for every
+    one of them. Requests are now queued here instead, and all views waiting on a frame are
+    painted together on the next frame tick, showing only the latest zoom state.
+
+    Requests that were folded into an already pending paint are counted as dropped frames.
+    */
+class gFrameScheduler:public QObject
+{
+    Q_OBJECT
+  public:
+    //! \brief Returns the scheduler shared by all graph views
+    static gFrameScheduler & instance();
+
+    //! \brief Queues a paint of view on the next frame. Pass boundsChanged when this follows a new X range.
+    void request(gGraphView * view, bool boundsChanged = false);
+
+    //! \brief Forgets any paint pending for view, which must be called before it is deleted
+    void cancel(gGraphView * view);
+
+    //! \brief Sets the frame rate paints are limited to
+    void setFrameRate(int fps);
+    inline int frameRate() const { return 1000 / m_interval; }
+
+    //! \brief Number of frame ticks that painted at least one view
+    inline quint64 framesRendered() const { return m_rendered; }
+
+    //! \brief Number of requests that were absorbed by a paint already pending
+    inline quint64 framesDropped() const { return m_dropped; }
+
+    //! \brief Number of X range changes that were replaced before they were ever painted
+    inline quint64 boundsDropped() const { return m_boundsDropped; }
+
+    void resetStatistics();
+
+  protected slots:
+    //! \brief Paints every pending view
+    void nextFrame();
+
+    //! \brief Logs the counts for the burst of activity that just ended
+    void idle();
+
+  protected:
+    gFrameScheduler();
+
+    struct Pending {
+        Pending(gGraphView * v = nullptr) : view(v), boundsChanged(false) {}
+        gGraphView * view;
+        bool boundsChanged;
+    };
+
+    QList<Pending> m_pending;
+    QTimer m_timer;
+    QTimer m_idle;
+    QElapsedTimer m_clock;
+    qint64 m_lastFrame;
+    int m_interval;
+
+    quint64 m_rendered;
+    quint64 m_dropped;
+    quint64 m_boundsDropped;
+
+    // Counts for the current burst, logged when it goes idle
+    quint64 m_burstRendered;
+    quint64 m_burstDropped;
+};
+
+#endif // GFRAMESCHEDULER_H
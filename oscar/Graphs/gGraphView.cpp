@@ -33,16 +33,72 @@
 
 #include "mainwindow.h"
 #include "Graphs/glcommon.h"
+#include "Graphs/gFrameScheduler.h"
 #include "Graphs/gLineChart.h"
 #include "Graphs/gSummaryChart.h"
 #include "Graphs/gSessionTimesChart.h"
 #include "Graphs/gYAxis.h"
 #include "Graphs/gFlagsLine.h"
 #include "SleepLib/profiles.h"
+#include "SleepLib/memoryaccounting.h"
 #include "overview.h"
 
 extern MainWindow *mainwin;
 
+// Pixmaps put in QPixmapCache between checks for the ones it has dropped
+const int text_pixmap_prune_interval = 256;
+
+/*! \class TextPixmapReporter
+    \brief Remembers the text pixmaps put in QPixmapCache, which can't tell how much it holds itself
+
+    Pixmaps the cache has dropped in the meantime are forgotten again every text_pixmap_prune_interval
+    inserts, and whenever a report is made, so this holds no more keys than the cache plus one interval.
+    */
+class TextPixmapReporter:public MemoryReporter
+{
+public:
+    TextPixmapReporter() : m_inserts(0) { MemoryAccounting::instance().add(this); }
+    virtual ~TextPixmapReporter() { MemoryAccounting::instance().remove(this); }
+
+    void inserted(const QString & key, const QPixmap & pm) {
+        m_bytes[key] = qint64(pm.width()) * qint64(pm.height()) * qint64(pm.depth() / 8);
+        if (++m_inserts >= text_pixmap_prune_interval) {
+            prune();
+        }
+    }
+
+    virtual void reportMemory(MemoryReport & report) {
+        qint64 bytes = prune();
+        report.add(QObject::tr("Text pixmap cache"), bytes, m_bytes.size());
+    }
+
+protected:
+    //! \brief Forgets the pixmaps the cache has dropped, returning the bytes of those still in it
+    qint64 prune() {
+        m_inserts = 0;
+        qint64 bytes = 0;
+        QPixmap pm;
+        for (auto it = m_bytes.begin(); it != m_bytes.end(); ) {
+            if (QPixmapCache::find(it.key(), &pm)) {
+                bytes += it.value();
+                ++it;
+            } else {
+                it = m_bytes.erase(it);
+            }
+        }
+        return bytes;
+    }
+
+    QHash<QString, qint64> m_bytes;
+    int m_inserts;
+};
+
+static TextPixmapReporter & textPixmapReporter()
+{
+    static TextPixmapReporter reporter;
+    return reporter;
+}
+
 #include <QApplication>
 
 MyLabel::MyLabel(QWidget * parent)
@@ -582,6 +638,7 @@ void gGraphView::closeEvent(QCloseEvent * event)
 
     timer->stop();
     redrawtimer->stop();
+    gFrameScheduler::instance().cancel(this);
     disconnect(redrawtimer, 0, 0, 0);
     disconnect(timer, 0, 0, 0);
     timer->deleteLater();
@@ -601,6 +658,8 @@ void gGraphView::closeEvent(QCloseEvent * event)
 
 gGraphView::~gGraphView()
 {
+    gFrameScheduler::instance().cancel(this);
+
 #ifndef BROKEN_OPENGL_BUILD
     doneCurrent();
 #endif
@@ -870,6 +929,7 @@ void gGraphView::DrawTextQueCached(QPainter &painter)
             imgpainter.end();
 
             QPixmapCache::insert(hstr, pm);
+            textPixmapReporter().inserted(hstr, pm);
         }
 
         h = pm.height();
@@ -921,6 +981,7 @@ void gGraphView::DrawTextQueCached(QPainter &painter)
             imgpainter.end();
 
             QPixmapCache::insert(hstr, pm);
+            textPixmapReporter().inserted(hstr, pm);
         } else {
             h = pm.height();
             w = pm.width();
@@ -1160,7 +1221,7 @@ void gGraphView::SetXBounds(qint64 minx, qint64 maxx, short group, bool refresh)
     m_minx = minx;  // left and right edges of graph, in msec in epoch
     m_maxx = maxx;
 
-    if (refresh) { timedRedraw(0); }
+    if (refresh) { gFrameScheduler::instance().request(this, true); }
 }
 
 void gGraphView::updateScrollBar()
@@ -3354,16 +3415,17 @@ void gGraphView::refreshTimeout()
 }
 void gGraphView::timedRedraw(int ms)
 {
+    if (ms == 0) {
+        timer->stop();
+        gFrameScheduler::instance().request(this);
+        return;
+    }
 
     if (timer->isActive()) {
-        if (ms == 0) {
+        int m = timer->remainingTime();
+        if (m > ms) {
             timer->stop();
-        } else {
-            int m = timer->remainingTime();
-            if (m > ms) {
-                timer->stop();
-            } else return;
-       }
+        } else return;
     }
     timer->setSingleShot(true);
     timer->start(ms);
@@ -3661,6 +3723,11 @@ void gGraphView::dataChanged()
 
 
 void gGraphView::redraw()
+{
+    gFrameScheduler::instance().request(this);
+}
+
+void gGraphView::renderFrame()
 {
 #ifdef BROKEN_OPENGL_BUILD
     repaint();
@@ -311,6 +311,7 @@ class gGraphView
 #endif
 {
     friend class gGraph;
+    friend class gFrameScheduler;
     Q_OBJECT
   public:
     /*! \fn explicit gGraphView(QWidget *parent = 0,gGraphView * shared=0);
@@ -419,7 +420,7 @@ class gGraphView
     QPoint pointClicked() const { return m_point_clicked; }
     void setPointClicked(QPoint p) { m_point_clicked = p; }
 
-    //! \brief Set a redraw timer for ms milliseconds, clearing any previous redraw timer.
+    //! \brief Set a redraw timer for ms milliseconds, clearing any previous redraw timer. 0 redraws on the next frame.
     void timedRedraw(int ms=0);
 
     gGraph *m_selected_graph;
@@ -563,6 +564,9 @@ class gGraphView
     bool gestureEvent(QGestureEvent * event);
     bool pinchTriggered(QPinchGesture * gesture);
 
+    //! \brief Repaints now, called by gFrameScheduler once per frame
+    void renderFrame();
+
 
     void leaveEvent (QEvent * event) override;
 
@@ -714,7 +718,7 @@ class gGraphView
     //! \brief Simply refreshes the GL view, called when timeout expires.
     void refreshTimeout();
 
-    //! \brief Call UpdateGL unless animation is in progress
+    //! \brief Queues a repaint on the next display frame, shared with every other graph view
     void redraw();
 
     //! \brief Resets all contained graphs to have a uniform height.
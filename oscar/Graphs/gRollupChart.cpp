@@ -0,0 +1,158 @@
+/* gRollupChart Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include "Graphs/gRollupChart.h"
+#include "Graphs/gGraph.h"
+#include "Graphs/gGraphView.h"
+#include "SleepLib/profiles.h"
+#include "SleepLib/appsettings.h"
+
+gRollupChart::gRollupChart(ChannelID code, MachineType machtype)
+    :Layer(code), m_machtype(machtype), m_empty(true)
+{
+    m_layertype = LT_Overview;
+}
+
+gRollupChart::~gRollupChart()
+{
+}
+
+void gRollupChart::SetDay(Day *unused_day)
+{
+    Q_UNUSED(unused_day)
+    Layer::SetDay(nullptr);
+
+    QDate firstday = p_profile->FirstDay(m_machtype);
+    QDate lastday = p_profile->LastDay(m_machtype);
+    m_empty = true;
+
+    if (!firstday.isValid() || !lastday.isValid()) return;
+
+    m_minx = QDateTime(firstday, QTime(0,0,0), Qt::LocalTime).toMSecsSinceEpoch();
+    m_maxx = QDateTime(lastday, QTime(23,59,59), Qt::LocalTime).toMSecsSinceEpoch();
+
+    // Y range comes straight from the session summaries
+    bool first = true;
+    auto it = p_profile->daylist.lowerBound(firstday);
+    auto it_end = p_profile->daylist.upperBound(lastday);
+    for (; it != it_end; ++it) {
+        for (Session * sess : it.value()->getSessions(m_machtype)) {
+            if (!sess->m_min.contains(m_code)) continue;
+            EventDataType mn = sess->Min(m_code);
+            EventDataType mx = sess->Max(m_code);
+            if (first) {
+                m_miny = m_physminy = mn;
+                m_maxy = m_physmaxy = mx;
+                first = false;
+            } else {
+                if (mn < m_miny) m_miny = m_physminy = mn;
+                if (mx > m_maxy) m_maxy = m_physmaxy = mx;
+            }
+        }
+    }
+    m_empty = first;
+}
+
+void gRollupChart::paint(QPainter &painter, gGraph &graph, const QRegion &region)
+{
+    QRectF rect = region.boundingRect();
+    rect.translate(0.0f, 0.001f);
+
+    int left = rect.left();
+    int top = rect.top() + 1;
+    int width = rect.width() - 1;
+    int height = rect.height() - 2;
+
+    painter.setPen(QColor(Qt::black));
+    painter.drawRect(rect);
+
+    if (!m_visible || m_empty || (width <= 0)) {
+        return;
+    }
+
+    qint64 minx = graph.min_x;
+    qint64 maxx = graph.max_x;
+    if (maxx <= minx) {
+        return;
+    }
+
+    EventDataType miny = m_physminy;
+    EventDataType maxy = m_physmaxy;
+    graph.roundY(miny, maxy);
+    if (maxy <= miny) {
+        return;
+    }
+
+    double xmult = double(width) / double(maxx - minx);
+    double ymult = double(height - 3) / double(maxy - miny);
+    double bottom = top + height;
+
+    RollupLevel level = SessionRollup::levelFor((maxx - minx) / width);
+
+    QColor color = schema::channel[m_code].defaultColor();
+    QColor range = color;
+    range.setAlpha(64);
+
+    QVector<QLineF> bands;
+    QVector<QLineF> lines;
+
+    QDate date = QDateTime::fromMSecsSinceEpoch(minx).date().addDays(-1);
+    QDate enddate = QDateTime::fromMSecsSinceEpoch(maxx).date().addDays(1);
+
+    auto it = p_profile->daylist.lowerBound(date);
+    auto it_end = p_profile->daylist.upperBound(enddate);
+    for (; it != it_end; ++it) {
+        for (Session * sess : it.value()->getSessions(m_machtype)) {
+            if ((sess->realLast() < minx) || (sess->realFirst() > maxx)) continue;
+
+            const SessionRollup * r = RollupLoader::instance().rollup(sess);
+            if (!r) continue;
+            const RollupSeries * series = r->series(m_code, level);
+            if (!series) continue;
+
+            bool havelast = false;
+            double lastx = 0, lasty = 0;
+            int size = series->buckets.size();
+            for (int i = 0; i < size; ++i) {
+                const RollupBucket & b = series->buckets.at(i);
+                qint64 t = series->bucketStart(i) + series->interval / 2;
+                if (b.isEmpty() || (t < minx) || (t > maxx)) {
+                    havelast = false;
+                    continue;
+                }
+                double x = left + double(t - minx) * xmult;
+                double y = bottom - double(b.avg() - miny) * ymult;
+
+                bands.append(QLineF(x, bottom - double(b.min - miny) * ymult,
+                                    x, bottom - double(b.max - miny) * ymult));
+                if (havelast) {
+                    lines.append(QLineF(lastx, lasty, x, y));
+                }
+                lastx = x;
+                lasty = y;
+                havelast = true;
+            }
+        }
+    }
+
+    painter.setClipRect(left, top, width, height + 1);
+    painter.setClipping(true);
+    painter.setRenderHint(QPainter::Antialiasing, AppSetting->antiAliasing());
+
+    painter.setPen(QPen(QBrush(range), 1));
+    painter.drawLines(bands);
+    painter.setPen(QPen(QBrush(color), AppSetting->lineThickness()));
+    painter.drawLines(lines);
+
+    painter.setClipping(false);
+
+    graph.renderText(QString("%1 (%2)").arg(schema::channel[m_code].label())
+                     .arg(level == RL_Minute ? QObject::tr("1 min") :
+                          (level == RL_TenMinutes ? QObject::tr("10 min") : QObject::tr("1 hour"))),
+                     left + 4, top - 6);
+}
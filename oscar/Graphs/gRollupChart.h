@@ -0,0 +1,44 @@
+/* gRollupChart Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef GROLLUPCHART_H
+#define GROLLUPCHART_H
+
+#include "Graphs/layer.h"
+#include "SleepLib/rollup.h"
+
+/*! \class gRollupChart
+    \brief Overview trend line for a numeric channel, drawn from the stored session rollups
+
+    Picks the minute, ten minute or hourly rollup depending on how much time each pixel covers,
+    drawing the min-max range as a band with the average on top. Rollups come from RollupLoader,
+    so painting never touches the disk, and sessions show up as their rollups arrive.
+    */
+class gRollupChart : public Layer
+{
+  public:
+    gRollupChart(ChannelID code, MachineType machtype);
+    virtual ~gRollupChart();
+
+    virtual void SetDay(Day *unused_day = nullptr);
+    virtual void paint(QPainter &painter, gGraph &graph, const QRegion &region);
+    virtual bool isEmpty() { return m_empty; }
+
+    virtual Layer * Clone() {
+        gRollupChart * rc = new gRollupChart(m_code, m_machtype);
+        Layer::CloneInto(rc);
+        rc->m_empty = m_empty;
+        return rc;
+    }
+
+  protected:
+    MachineType m_machtype;
+    bool m_empty;
+};
+
+#endif // GROLLUPCHART_H
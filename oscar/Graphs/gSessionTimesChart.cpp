@@ -34,6 +34,7 @@ gSummaryChart::gSummaryChart(QString label, MachineType machtype)
 
     idx_end = 0;
     idx_start = 0;
+    MemoryAccounting::instance().add(this);
 }
 
 gSummaryChart::gSummaryChart(ChannelID code, MachineType machtype)
@@ -54,10 +55,24 @@ gSummaryChart::gSummaryChart(ChannelID code, MachineType machtype)
 
     idx_end = 0;
     idx_start = 0;
+    MemoryAccounting::instance().add(this);
 }
 
 gSummaryChart::~gSummaryChart()
 {
+    MemoryAccounting::instance().remove(this);
+}
+
+void gSummaryChart::reportMemory(MemoryReport & report)
+{
+    qint64 bytes = memoryOf(cache) + memoryOf(dayindex) + memoryOf(daylist) + memoryOf(calcitems);
+    for (const auto & slices : cache) {
+        bytes += memoryOf(slices);
+        for (const auto & slice : slices) {
+            bytes += qint64(slice.name.capacity()) * qint64(sizeof(QChar));
+        }
+    }
+    report.add(QObject::tr("Overview chart caches"), bytes, cache.size());
 }
 
 void gSummaryChart::SetDay(Day *unused_day)
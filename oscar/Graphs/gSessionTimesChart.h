@@ -12,6 +12,7 @@
 
 #include "SleepLib/day.h"
 #include "SleepLib/profiles.h"
+#include "SleepLib/memoryaccounting.h"
 #include "gGraphView.h"
 
 
@@ -155,7 +156,7 @@ struct SummaryChartSlice {
 //    QBrush brush;
 };
 
-class gSummaryChart : public Layer
+class gSummaryChart : public Layer, public MemoryReporter
 {
 public:
     gSummaryChart(QString label, MachineType machtype);
@@ -189,6 +190,9 @@ public:
         cache.clear();
     }
 
+    //! \brief Reports the per-day slice cache and day index
+    virtual void reportMemory(MemoryReport & report);
+
     virtual int addCalc(ChannelID code, SummaryType type, QColor color);
     virtual int addCalc(ChannelID code, SummaryType type);
 
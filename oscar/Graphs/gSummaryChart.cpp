@@ -25,9 +25,22 @@ SummaryChart::SummaryChart(QString label, GraphType type)
     tz_offset = d2.secsTo(d1);
     tz_hours = tz_offset / 3600.0;
     m_layertype = LT_SummaryChart;
+    MemoryAccounting::instance().add(this);
 }
 SummaryChart::~SummaryChart()
 {
+    MemoryAccounting::instance().remove(this);
+}
+void SummaryChart::reportMemory(MemoryReport & report)
+{
+    qint64 bytes = memoryOf(m_values) + memoryOf(m_times) + memoryOf(m_hours) + memoryOf(m_days);
+    for (const auto & values : m_values) {
+        bytes += memoryOf(values);
+    }
+    for (const auto & times : m_times) {
+        bytes += memoryOf(times);
+    }
+    report.add(QObject::tr("Overview chart caches"), bytes, m_days.size());
 }
 void SummaryChart::SetDay(Day * nullday)
 {
@@ -10,6 +10,7 @@
 #define GBARCHART_H
 
 #include <SleepLib/profiles.h>
+#include "SleepLib/memoryaccounting.h"
 #include "gGraphView.h"
 #include "gXAxis.h"
 
@@ -24,7 +25,7 @@ enum GraphType { GT_BAR, GT_LINE, GT_POINTS, GT_SESSIONS };
 /*! \class SummaryChart
     \brief The main overall chart type layer used in Overview page
     */
-class SummaryChart: public Layer
+class SummaryChart: public Layer, public MemoryReporter
 {
   public:
     //! \brief Constructs a SummaryChart with QString label, of GraphType type
@@ -57,6 +58,9 @@ class SummaryChart: public Layer
     //! \brief Returns true if currently selected..
     virtual bool isSelected() { return hl_day >= 0; }
 
+    //! \brief Reports the per-day values calculated by SetDay
+    virtual void reportMemory(MemoryReport & report);
+
 
     //! \brief Sets the MachineType this SummaryChart is interested in
     void setMachineType(MachineType type) { m_machinetype = type; }
@@ -14,6 +14,7 @@
 #include "Graphs/gXAxis.h"
 #include "SleepLib/profiles.h"
 #include "SleepLib/common.h"
+#include "SleepLib/localtime.h"
 #include "Graphs/glcommon.h"
 #include "Graphs/gGraph.h"
 #include "Graphs/gGraphView.h"
@@ -298,8 +299,7 @@ void gXAxis::paint(QPainter &painter, gGraph &w, const QRegion &region)
 
             if (fitmode == 0) {
                 d = (j / 1000);
-                QDateTime dt = QDateTime::fromTime_t(d).toLocalTime();
-                QDate date = dt.date();
+                QDate date = LocalTime::system().date(qint64(d) * 1000L);
                 // SLOW SLOW SLOW!!! On Mac especially, this function is pathetically slow.
                 //dt.toString("MMM dd");
 
@@ -309,11 +309,11 @@ void gXAxis::paint(QPainter &painter, gGraph &w, const QRegion &region)
                 //} else if (fitmode==0) {
                 //            tmpstr=QString("%1 %2:%3").arg(dow[d]).arg(h,2,10,QChar('0')).arg(m,2,10,QChar('0'));
             } else if (fitmode == 1) { // minute
-                tmpstr = QString("%1:%2").arg(h, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0'));
+                LocalTime::formatClock(tmpstr, h, m);
             } else if (fitmode == 2) { // second
-                tmpstr = QString("%1:%2:%3").arg(h, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0'));
+                LocalTime::formatClock(tmpstr, h, m, s);
             } else if (fitmode == 3) { // milli
-                tmpstr = QString("%1:%2:%3:%4").arg(h, 2, 10, QChar('0')).arg(m, 2, 10, QChar('0')).arg(s, 2, 10, QChar('0')).arg(ms, 3, 10, QChar('0'));
+                LocalTime::formatClock(tmpstr, h, m, s, ms);
             }
 
             int tx = px - x / 2.0;
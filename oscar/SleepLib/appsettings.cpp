@@ -45,6 +45,9 @@ AppWideSetting::AppWideSetting(Preferences *pref) : PrefSettings(pref)
     initPref(STR_US_OpenTabAfterImport, 0);
     initPref(STR_US_AutoLaunchImport, false);
     m_cacheSessions = initPref(STR_IS_CacheSessions, false).toBool();
+    initPref(STR_IS_PrewarmNights, 2);
+    initPref(STR_IS_PrewarmMemory, 128);
+    initPref(STR_IS_EventPoolMemory, 64);
     initPref(STR_US_RemoveCardReminder, true);
     initPref(STR_US_DontAskWhenSavingScreenshots, false);
     m_profileName = initPref(STR_GEN_Profile, "").toString();
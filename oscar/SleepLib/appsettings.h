@@ -18,7 +18,7 @@
 
 class Preferences;
 
-enum OverviewLinechartModes { OLC_Bartop, OLC_Lines };
+enum OverviewLinechartModes { OLC_Bartop, OLC_Lines, OLC_Trend };
 
 
 // ApplicationWideSettings Strings
@@ -55,6 +55,9 @@ const QString STR_US_RemoveCardReminder = "RemoveCardReminder";
 const QString STR_US_DontAskWhenSavingScreenshots = "DontAskWhenSavingScreenshots";
 const QString STR_US_ShowPersonalData = "ShowPersonalData";
 const QString STR_IS_CacheSessions = "MemoryHog";
+const QString STR_IS_PrewarmNights = "PrewarmNights";
+const QString STR_IS_PrewarmMemory = "PrewarmMemory";
+const QString STR_IS_EventPoolMemory = "EventPoolMemory";
 
 const QString STR_GEN_AutoOpenLastUsed = "AutoOpenLastUsed";
 const QString STR_GEN_Language = "Language";
@@ -98,6 +101,12 @@ public:
   inline const QString & profileName() const { return m_profileName; }
   bool autoLaunchImport() const { return getPref(STR_US_AutoLaunchImport).toBool(); }
   bool cacheSessions() const { return m_cacheSessions; }
+  //! \brief Number of recent nights to open in the background after a profile loads
+  int prewarmNights() const { return getPref(STR_IS_PrewarmNights).toInt(); }
+  //! \brief Most event data, in MB, the background pre-warming may load
+  int prewarmMemory() const { return getPref(STR_IS_PrewarmMemory).toInt(); }
+  //! \brief Most memory, in MB, kept aside from trashed events for the next ones loaded to reuse
+  int eventPoolMemory() const { return getPref(STR_IS_EventPoolMemory).toInt(); }
   inline bool multithreading() const { return m_multithreading; }
   bool showDebug() const { return m_showDebug; }
   bool showPerformance() const { return m_showPerformance; }
@@ -152,6 +161,9 @@ public:
   void setProfileName(QString name) { setPref(STR_GEN_Profile, m_profileName=name); }
   void setAutoLaunchImport(bool b) { setPref(STR_US_AutoLaunchImport, b); }
   void setCacheSessions(bool c) { setPref(STR_IS_CacheSessions, m_cacheSessions=c); }
+  void setPrewarmNights(int n) { setPref(STR_IS_PrewarmNights, n); }
+  void setPrewarmMemory(int mb) { setPref(STR_IS_PrewarmMemory, mb); }
+  void setEventPoolMemory(int mb) { setPref(STR_IS_EventPoolMemory, mb); }
 // force multithreading to false until proven OK
   void setMultithreading(bool b) { Q_UNUSED(b) setPref(STR_IS_Multithreading, m_multithreading = false); }
   void setShowDebug(bool b) { setPref(STR_US_ShowDebug, m_showDebug=b); }
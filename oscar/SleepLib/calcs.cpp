@@ -903,18 +903,21 @@ void calcRespRate(Session *session, FlowParser *flowparser)
             delete l;
         }
         session->eventlist[CPAP_RespRate].clear();
+        session->setChannelChanged(CPAP_RespRate);
 
         auto & list2 = session->eventlist[CPAP_TidalVolume];
         for (auto & l2 : list2) {
             delete l2;
         }
         session->eventlist[CPAP_TidalVolume].clear();
+        session->setChannelChanged(CPAP_TidalVolume);
 
         auto & list3 = session->eventlist[CPAP_MinuteVent];
         for (auto & l3 : list3) {
             delete l3;
         }
         session->eventlist[CPAP_MinuteVent].clear();
+        session->setChannelChanged(CPAP_MinuteVent);
     }
 
     flowparser->clearFilters();
@@ -1018,6 +1021,7 @@ int calcAHIGraph(Session *session)
     EventList *AHI = new EventList(EVL_Event);
     AHI->setGain(0.02F);
     session->eventlist[CPAP_AHI].push_back(AHI);
+    session->setChannelChanged(CPAP_AHI);
 
     EventList *RDI = nullptr;
 
@@ -1025,6 +1029,7 @@ int calcAHIGraph(Session *session)
         RDI = new EventList(EVL_Event);
         RDI->setGain(0.02F);
         session->eventlist[CPAP_RDI].push_back(RDI);
+        session->setChannelChanged(CPAP_RDI);
     }
 
     EventDataType ahi, rdi;
@@ -1908,6 +1913,7 @@ int calcPulseChange(Session *session)
     }
 
     session->eventlist[OXI_PulseChange].push_back(pc);
+    session->setChannelChanged(OXI_PulseChange);
     session->setMin(OXI_PulseChange, pc->Min());
     session->setMax(OXI_PulseChange, pc->Max());
     session->setCount(OXI_PulseChange, pc->count());
@@ -2052,6 +2058,7 @@ int calcSPO2Drop(Session *session)
     }
 
     session->eventlist[OXI_SPO2Drop].push_back(pc);
+    session->setChannelChanged(OXI_SPO2Drop);
     session->setMin(OXI_SPO2Drop, pc->Min());
     session->setMax(OXI_SPO2Drop, pc->Max());
     session->setCount(OXI_SPO2Drop, pc->count());
@@ -0,0 +1,292 @@
+/* SleepLib Calendar Metadata Cache Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QSet>
+
+#include "calendarcache.h"
+#include "profiles.h"
+#include "day.h"
+
+// Channels counted towards the AHI, with RERAs added for the RDI
+static EventDataType indexEvents(Session * sess, bool rdi)
+{
+    EventDataType c = 0;
+    QList<ChannelID> codes = { CPAP_Hypopnea, CPAP_Obstructive, CPAP_Apnea, CPAP_ClearAirway };
+    if (rdi) {
+        codes.append(CPAP_RERA);
+    }
+    for (const auto code : codes) {
+        if (sess->m_cnt.contains(code)) {
+            c += sess->count(code);
+        }
+    }
+    return c;
+}
+
+void CalendarTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+    for (auto & request : requests) {
+        if (cache->m_cancelled.load() != 0) {
+            break;
+        }
+
+        // Same as Day::calcTotalTime(MT_CPAP), from the gathered or privately loaded summaries
+        QMultiMap<qint64, bool> range;
+        EventDataType events = 0;
+
+        for (auto & s : request.sessions) {
+            if (!s.loaded) {
+                QMutexLocker lock(&s.mach->saveMutex);
+                Session * copy = new Session(s.mach, s.id);
+                if (copy->LoadSummary()) {
+                    s.enabled = copy->enabled();
+                    s.first = copy->realFirst() + s.drift;
+                    s.last = copy->realLast() + s.drift;
+                    s.slices = copy->m_slices;
+                    s.events = indexEvents(copy, rdi);
+                } else {
+                    s.enabled = false;
+                }
+                delete copy;
+            }
+            if (!s.enabled) continue;
+
+            if (s.slices.isEmpty()) {
+                if (s.last > s.first) {
+                    range.insert(s.first, 0);
+                    range.insert(s.last, 1);
+                }
+            } else {
+                for (const auto & slice : s.slices) {
+                    if (slice.status == MaskOn) {
+                        range.insert(slice.start, 0);
+                        range.insert(slice.end, 1);
+                    }
+                }
+            }
+            events += s.events;
+        }
+
+        CalendarDay cd;
+        cd.hours = double(Day::coveredTime(range)) / 3600000.0;
+        if (cd.hours > 0) {
+            cd.ahi = events / cd.hours;
+            cd.band = CalendarCache::bandFor(cd.ahi);
+        }
+        if (cd.hours >= compliance) {
+            cd.flags |= CF_Compliant;
+        }
+        cache->finished(request.date, request.serial, cd);
+    }
+    QMetaObject::invokeMethod(cache, "taskDone", Qt::QueuedConnection);
+}
+
+CalendarCache::CalendarCache(Profile * profile)
+    : m_profile(profile), m_serial(0)
+{
+    // One reader is plenty for a month at a time, and leaves the disk to the GUI
+    m_pool.setMaxThreadCount(1);
+}
+
+CalendarCache::~CalendarCache()
+{
+    clear();
+}
+
+AHIBand CalendarCache::bandFor(EventDataType ahi)
+{
+    if (ahi < 5) return AHI_Normal;
+    if (ahi < 15) return AHI_Mild;
+    if (ahi < 30) return AHI_Moderate;
+    return AHI_Severe;
+}
+
+CalendarDay CalendarCache::compute(QDate date, CalendarRequest & request) const
+{
+    CalendarDay cd;
+
+    auto di = m_profile->daylist.find(date);
+    if (di == m_profile->daylist.end()) {
+        return cd;
+    }
+    Day * day = di.value();
+    cd.flags |= CF_Any;
+
+    if (day->machines.contains(MT_OXIMETER)) cd.flags |= CF_Oximeter;
+    if (day->machines.contains(MT_JOURNAL)) cd.flags |= CF_Journal;
+    if (day->machines.contains(MT_SLEEPSTAGE)) cd.flags |= CF_SleepStage;
+    if (day->machines.contains(MT_POSITION)) cd.flags |= CF_Position;
+
+    if (day->machines.contains(MT_CPAP)) {
+        cd.flags |= CF_CPAP;
+
+        bool rdi = m_profile->general->calculateRDI();
+        request.date = date;
+        for (Session * sess : day->sessions) {
+            if (sess->type() != MT_CPAP) continue;
+
+            CalendarSession s;
+            s.mach = sess->machine();
+            s.id = sess->session();
+            s.drift = sess->first() - sess->realFirst();
+            s.loaded = sess->summaryLoaded();
+            s.enabled = sess->enabled();
+            s.first = sess->first();
+            s.last = sess->last();
+            s.events = 0;
+            if (s.loaded) {
+                s.slices = sess->m_slices;
+                s.events = indexEvents(sess, rdi);
+            }
+            request.sessions.append(s);
+        }
+    }
+    return cd;
+}
+
+const QVector<CalendarDay> & CalendarCache::month(int year, int month)
+{
+    int k = key(year, month);
+    auto it = m_months.find(k);
+
+    if (it == m_months.end()) {
+        Month m;
+        int dom = QDate(year, month, 1).daysInMonth();
+        m.days.resize(dom);
+        m.stale.resize(dom);
+        m.stale.fill(true);
+        m.serials.fill(0, dom);
+        it = m_months.insert(k, m);
+    }
+
+    Month & m = it.value();
+    QList<CalendarRequest> requests;
+
+    for (int i = 0, dom = m.days.size(); i < dom; ++i) {
+        if (!m.stale.testBit(i)) {
+            continue;
+        }
+        CalendarRequest request;
+        CalendarDay cd = compute(QDate(year, month, i + 1), request);
+
+        if (cd.has(CF_CPAP)) {
+            // Keep showing the old CPAP details until the new ones are worked out
+            const CalendarDay & old = m.days.at(i);
+            cd.band = old.band;
+            cd.ahi = old.ahi;
+            cd.hours = old.hours;
+            cd.flags |= (old.flags & CF_Compliant);
+
+            request.serial = ++m_serial;
+            m.serials[i] = request.serial;
+            requests.append(request);
+        } else {
+            m.serials[i] = 0;
+        }
+        m.days[i] = cd;
+        m.stale.clearBit(i);
+    }
+
+    if (!requests.isEmpty()) {
+        m_pool.start(new CalendarTask(this, requests, m_profile->general->calculateRDI(),
+                                      m_profile->cpap->complianceHours()));
+    }
+    return m.days;
+}
+
+CalendarDay CalendarCache::day(QDate date)
+{
+    if (!date.isValid()) {
+        return CalendarDay();
+    }
+    return month(date.year(), date.month()).at(date.day() - 1);
+}
+
+void CalendarCache::invalidate(QDate date)
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "invalidate", Qt::QueuedConnection, Q_ARG(QDate, date));
+        return;
+    }
+    if (!date.isValid()) {
+        return;
+    }
+    auto it = m_months.find(key(date.year(), date.month()));
+    if (it != m_months.end()) {
+        // Any result still on its way is for what the day used to be
+        it.value().stale.setBit(date.day() - 1);
+        it.value().serials[date.day() - 1] = 0;
+    }
+}
+
+void CalendarCache::clear()
+{
+    if (QThread::currentThread() != thread()) {
+        QMetaObject::invokeMethod(this, "clear", Qt::QueuedConnection);
+        return;
+    }
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+    m_cancelled.store(0);
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_results.clear();
+    }
+    m_months.clear();
+}
+
+void CalendarCache::finished(const QDate & date, int serial, const CalendarDay & cd)
+{
+    QMutexLocker lock(&m_mutex);
+    Result result;
+    result.date = date;
+    result.serial = serial;
+    result.cd = cd;
+    m_results.append(result);
+}
+
+void CalendarCache::taskDone()
+{
+    QList<Result> results;
+    {
+        QMutexLocker lock(&m_mutex);
+        results.swap(m_results);
+    }
+
+    QSet<int> updated;
+    for (const auto & result : results) {
+        int k = key(result.date.year(), result.date.month());
+        auto it = m_months.find(k);
+        if (it == m_months.end()) {
+            continue;
+        }
+        Month & m = it.value();
+        int i = result.date.day() - 1;
+        if (m.serials.at(i) != result.serial) {
+            continue;
+        }
+        m.serials[i] = 0;
+
+        CalendarDay & cd = m.days[i];
+        cd.band = result.cd.band;
+        cd.ahi = result.cd.ahi;
+        cd.hours = result.cd.hours;
+        cd.flags = (cd.flags & ~CF_Compliant) | (result.cd.flags & CF_Compliant);
+        updated.insert(k);
+    }
+
+    for (const int k : updated) {
+        emit monthUpdated(k / 12, k % 12 + 1);
+    }
+}
@@ -0,0 +1,183 @@
+/* SleepLib Calendar Metadata Cache Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef CALENDARCACHE_H
+#define CALENDARCACHE_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QBitArray>
+#include <QDate>
+#include <QList>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+#include "SleepLib/session.h"
+
+class Profile;
+class Machine;
+class CalendarCache;
+
+enum CalendarFlag {
+    CF_None = 0x00, CF_Any = 0x01, CF_CPAP = 0x02, CF_Oximeter = 0x04, CF_Journal = 0x08,
+    CF_SleepStage = 0x10, CF_Position = 0x20, CF_Compliant = 0x40
+};
+
+enum AHIBand {
+    AHI_None = 0, AHI_Normal, AHI_Mild, AHI_Moderate, AHI_Severe
+};
+
+/*! \struct CalendarDay
+    \brief What the calendar widgets need to know about one date
+    */
+struct CalendarDay
+{
+    CalendarDay() : flags(CF_None), band(AHI_None), ahi(0), hours(0) {}
+
+    inline bool has(CalendarFlag flag) const { return (flags & flag) != 0; }
+
+    quint8 flags;
+    quint8 band;
+    EventDataType ahi;
+    EventDataType hours;
+};
+
+/*! \struct CalendarSession
+    \brief What a CalendarTask needs to know about one CPAP session, gathered on the GUI thread
+    */
+struct CalendarSession
+{
+    Machine * mach;
+    SessionID id;
+    //! \brief Clock drift applied to the session's times
+    qint64 drift;
+    //! \brief The summary was already loaded, so enabled, slices and events are filled in
+    bool loaded;
+    bool enabled;
+    qint64 first;
+    qint64 last;
+    QVector<SessionSlice> slices;
+    //! \brief Number of events counted towards the AHI (or RDI)
+    EventDataType events;
+};
+
+/*! \struct CalendarRequest
+    \brief The CPAP sessions of one date, to have their hours and AHI worked out
+    */
+struct CalendarRequest
+{
+    QDate date;
+    int serial;
+    QList<CalendarSession> sessions;
+};
+
+/*! \class CalendarTask
+    \brief Works out the CPAP hours, AHI band and compliance of a batch of dates on a background thread
+
+    Summaries that aren't loaded yet are read into private Session copies, so nothing
+    the GUI thread uses is touched.
+    */
+class CalendarTask:public QRunnable
+{
+public:
+    CalendarTask(CalendarCache * cache, const QList<CalendarRequest> & requests, bool rdi, EventDataType compliance)
+        : cache(cache), requests(requests), rdi(rdi), compliance(compliance) {}
+    virtual ~CalendarTask() {}
+    virtual void run();
+
+protected:
+    CalendarCache * cache;
+    QList<CalendarRequest> requests;
+    bool rdi;
+    EventDataType compliance;
+};
+
+/*! \class CalendarCache
+    \brief Per-month calendar metadata, built once from the Profile day list and session summaries
+
+    Months are computed the first time they are asked for, and individual dates are dropped
+    again whenever sessions are added to or removed from them, so paging the Daily and Overview
+    calendars back and forth doesn't go near the day records.
+
+    Which machines have data on a date is known straight away. The CPAP hours, AHI band and
+    compliance need session summaries, so they're worked out by a CalendarTask, keeping the
+    old values until monthUpdated() says the new ones are in.
+
+    The cache itself belongs to the GUI thread. invalidate() and clear() called from any other
+    thread are queued over to it.
+    */
+class CalendarCache:public QObject
+{
+    Q_OBJECT
+    friend class CalendarTask;
+  public:
+    CalendarCache(Profile * profile);
+    virtual ~CalendarCache();
+
+    //! \brief Returns the metadata for every day in month, indexed by day of month - 1
+    const QVector<CalendarDay> & month(int year, int month);
+
+    //! \brief Returns the metadata for a single date
+    CalendarDay day(QDate date);
+
+    static AHIBand bandFor(EventDataType ahi);
+
+  public slots:
+    //! \brief Drops the cached entry for date, so it's recomputed next time it's needed
+    void invalidate(QDate date);
+
+    //! \brief Drops everything, eg after unloading machine data or changing compliance or AHI settings
+    void clear();
+
+  signals:
+    //! \brief The CPAP details of some days in month have been worked out
+    void monthUpdated(int year, int month);
+
+  protected slots:
+    void taskDone();
+
+  protected:
+    //! \brief Works out the machine flags for date, and fills in request if it has CPAP sessions
+    CalendarDay compute(QDate date, CalendarRequest & request) const;
+
+    //! \brief Called from the pool thread with the results of a request
+    void finished(const QDate & date, int serial, const CalendarDay & cd);
+
+    static inline int key(int year, int month) { return year * 12 + (month - 1); }
+
+    struct Month {
+        QVector<CalendarDay> days;
+        QBitArray stale;
+        //! \brief Serial of the request outstanding for each day, or 0
+        QVector<int> serials;
+    };
+
+    struct Result {
+        QDate date;
+        int serial;
+        CalendarDay cd;
+    };
+
+    //! \brief Computed months, keyed by year * 12 + month - 1
+    QHash<int, Month> m_months;
+
+    Profile * m_profile;
+
+    QThreadPool m_pool;
+    QAtomicInt m_cancelled;
+    int m_serial;
+
+    QMutex m_mutex;
+    QList<Result> m_results;
+};
+
+#endif // CALENDARCACHE_H
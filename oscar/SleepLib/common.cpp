@@ -33,6 +33,8 @@
 
 #include "version.h"
 #include "profiles.h"
+#include "progresstracker.h"
+#include "gzipdevice.h"
 #include "mainwindow.h"
 
 extern MainWindow * mainwin;
@@ -442,7 +444,7 @@ void copyPath(QString src, QString dst)
             // while copying.
             // TODO: copyPath should also either hide the abort button
             // or respond to it.
-            QCoreApplication::processEvents();
+            ProgressTracker::pumpEvents();
         }
     }
 }
@@ -858,67 +860,44 @@ void initializeStrings()
     STR_TR_WAvg = QObject::tr("W-Avg");   // Weighted Average
 }
 
-
-
-
-quint32 CRC32(const char * data, quint32 length)
+// Gzip function
+// zlib writes the gzip header and (table driven) CRC32 trailer itself when given windowBits 15+16,
+// and deflateBound lets the whole stream be produced in place with no intermediate copies.
+QByteArray gCompress(const QByteArray& data)
 {
-  quint32 crc32 = 0xffffffff;
-
-  for (quint32 idx=0; idx<length; idx++) {
-
-    quint32 i = (data[idx]) ^ ((crc32) & 0x000000ff);
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
 
-    for(int j=8; j > 0; j--) {
-        if (i & 1) {
-            i = (i >> 1) ^ 0xedb88320;
-        } else {
-            i >>= 1;
-        }
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        qWarning() << "gCompress: deflateInit2 failed";
+        return QByteArray();
     }
 
-    crc32 = ((crc32) >> 8) ^ i;
-  }
+    QByteArray result;
+    result.resize(int(deflateBound(&strm, data.size())));
 
-  return ~crc32;
-}
+    strm.next_in = (Bytef*)(data.constData());
+    strm.avail_in = data.size();
+    strm.next_out = (Bytef*)(result.data());
+    strm.avail_out = result.size();
 
-quint32 crc32buf(const QByteArray& data)
-{
-    return CRC32(data.constData(), data.size());
-}
+    int ret = deflate(&strm, Z_FINISH);
+    if (ret != Z_STREAM_END) {
+        qWarning() << "gCompress: deflate failed with" << ret;
+        deflateEnd(&strm);
+        return QByteArray();
+    }
+    result.resize(int(strm.total_out));
+    deflateEnd(&strm);
 
-// Gzip function
-QByteArray gCompress(const QByteArray& data)
-{
-    QByteArray compressedData = qCompress(data);
-    //  Strip the first six bytes (a 4-byte length put on by qCompress and a 2-byte zlib header)
-    // and the last four bytes (a zlib integrity check).
-    compressedData.remove(0, 6);
-    compressedData.chop(4);
-
-    QByteArray header;
-    QDataStream ds1(&header, QIODevice::WriteOnly);
-    // Prepend a generic 10-byte gzip header (see RFC 1952),
-    ds1 << quint16(0x1f8b)
-        << quint16(0x0800)
-        << quint16(0x0000)
-        << quint16(0x0000)
-        << quint16(0x000b);
-
-    // Append a four-byte CRC-32 of the uncompressed data
-    // Append 4 bytes uncompressed input size modulo 2^32
-    QByteArray footer;
-    QDataStream ds2(&footer, QIODevice::WriteOnly);
-    ds2.setByteOrder(QDataStream::LittleEndian);
-    ds2 << crc32buf(data)
-        << quint32(data.size());
-
-    return header + compressedData + footer;
+    return result;
 }
 
 
-// Pinched from http://stackoverflow.com/questions/2690328/qt-quncompress-gzip-data
+// Inflates a whole gzip (or zlib) buffer. The output is presized from the gzip ISIZE trailer
+// when it is plausible (up to GzipDevice::presize()'s cap), so usually inflate writes straight into the result.
 QByteArray gUncompress(const QByteArray & data)
 {
     if (data.size() <= 4) {
@@ -926,55 +905,61 @@ QByteArray gUncompress(const QByteArray & data)
         return QByteArray();
     }
 
-    QByteArray result;
+    static const int CHUNK_SIZE = 1048576;
+
+    qint64 hint = 0;
+    const unsigned char * ch = (const unsigned char *)data.constData() + data.size() - 4;
+    quint32 isize = ch[0] | (ch[1] << 8) | (ch[2] << 16) | (quint32(ch[3]) << 24);
+    if ((quint8(data.at(0)) == 0x1f) && (quint8(data.at(1)) == 0x8b)) {
+        hint = GzipDevice::presize(isize, data.size());
+    }
+    if (hint == 0) {
+        hint = qMin(qint64(data.size()) * 4, qint64(CHUNK_SIZE));
+    }
 
-    int ret;
     z_stream strm;
-    static const int CHUNK_SIZE = 1048576;
-    char *out = new char [CHUNK_SIZE];
 
     /* allocate inflate state */
     strm.zalloc = Z_NULL;
     strm.zfree = Z_NULL;
     strm.opaque = Z_NULL;
     strm.avail_in = data.size();
-    strm.next_in = (Bytef*)(data.data());
+    strm.next_in = (Bytef*)(data.constData());
 
-    ret = inflateInit2(&strm, 15 +  32); // gzip decoding
+    int ret = inflateInit2(&strm, 15 +  32); // gzip decoding
     if (ret != Z_OK) {
-        delete [] out;
         return QByteArray();
     }
 
+    QByteArray result;
+    result.resize(int(qMax(hint, qint64(64))));
+
     // run inflate()
     do {
-        strm.avail_out = CHUNK_SIZE;
-        strm.next_out = (Bytef*)(out);
+        if (strm.total_out == uLong(result.size())) {
+            result.resize(result.size() + qMax(result.size() / 2, CHUNK_SIZE));
+        }
+        strm.next_out = (Bytef*)(result.data() + strm.total_out);
+        strm.avail_out = uInt(result.size() - strm.total_out);
 
         ret = inflate(&strm, Z_NO_FLUSH);
-        if (ret == Z_STREAM_ERROR) {
-            qWarning() << "ret == Z_STREAM_ERROR in gzUncompress in common.cpp";
-            delete [] out;
-            return QByteArray();
-        }
 
         switch (ret) {
-        case Z_NEED_DICT:
-            ret = Z_DATA_ERROR;
+        case Z_STREAM_ERROR:
+            qWarning() << "ret == Z_STREAM_ERROR in gzUncompress in common.cpp";
             // fall through
+        case Z_NEED_DICT:
         case Z_DATA_ERROR:
         case Z_MEM_ERROR:
-            Q_UNUSED(ret)
             (void)inflateEnd(&strm);
-            delete [] out;
             return QByteArray();
         }
 
-        result.append(out, CHUNK_SIZE - strm.avail_out);
-    } while (strm.avail_out == 0);
+        // Out of input without reaching the end of the stream, keep what we have
+    } while ((ret != Z_STREAM_END) && (strm.avail_in > 0 || strm.avail_out == 0));
 
     // clean up and return
+    result.resize(int(strm.total_out));
     inflateEnd(&strm);
-    delete [] out;
     return result;
 }
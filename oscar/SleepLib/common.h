@@ -55,6 +55,9 @@ QByteArray gUncompress(const QByteArray &data);
 
 const quint16 filetype_summary = 0;
 const quint16 filetype_data = 1;
+const quint16 filetype_rollup = 2;
+const quint16 filetype_journal = 3;
+const quint16 filetype_overlay = 4;
 const quint16 filetype_sessenabled = 5;
 
 enum UnitSystem { US_Undefined, US_Metric, US_English };
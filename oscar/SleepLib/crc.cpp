@@ -0,0 +1,132 @@
+/* SleepLib CRC Functions Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include "crc.h"
+
+// Below this many bytes the table setup of the sliced loop isn't worth it
+static const size_t CRC_SLICE_MIN = 16;
+
+// Lookup tables are built once, on first use. table[0] is the usual byte-wise table, and
+// table[k] advances a byte's contribution past k more bytes of input.
+
+struct CRC16ReflectedTables
+{
+    CRC16ReflectedTables(crc16_t poly) {
+        for (int n = 0; n < 256; ++n) {
+            crc16_t crc = n;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 1) ? ((crc >> 1) ^ poly) : (crc >> 1);
+            }
+            table[0][n] = crc;
+        }
+        for (int n = 0; n < 256; ++n) {
+            for (int k = 1; k < 8; ++k) {
+                crc16_t prev = table[k - 1][n];
+                table[k][n] = (prev >> 8) ^ table[0][prev & 0xff];
+            }
+        }
+    }
+    crc16_t table[8][256];
+};
+
+struct CRC32NormalTables
+{
+    CRC32NormalTables(crc32_t poly) {
+        for (int n = 0; n < 256; ++n) {
+            crc32_t crc = crc32_t(n) << 24;
+            for (int j = 0; j < 8; ++j) {
+                crc = (crc & 0x80000000U) ? ((crc << 1) ^ poly) : (crc << 1);
+            }
+            table[0][n] = crc;
+        }
+        for (int n = 0; n < 256; ++n) {
+            for (int k = 1; k < 8; ++k) {
+                crc32_t prev = table[k - 1][n];
+                table[k][n] = (prev << 8) ^ table[0][prev >> 24];
+            }
+        }
+    }
+    crc32_t table[8][256];
+};
+
+static const CRC16ReflectedTables & crc16Tables()
+{
+    static const CRC16ReflectedTables tables(0x8408); // 0x1021 bit reversed
+    return tables;
+}
+
+static const CRC32NormalTables & crc32Tables()
+{
+    static const CRC32NormalTables tables(0x04c11db7);
+    return tables;
+}
+
+static crc16_t crc16Reflected(const unsigned char * data, size_t data_len, crc16_t crc)
+{
+    const crc16_t (*t)[256] = crc16Tables().table;
+
+    if (data_len >= CRC_SLICE_MIN) {
+        while (data_len >= 8) {
+            crc16_t c = crc ^ (data[0] | (data[1] << 8));
+            crc = t[7][c & 0xff] ^ t[6][c >> 8]
+                ^ t[5][data[2]] ^ t[4][data[3]]
+                ^ t[3][data[4]] ^ t[2][data[5]]
+                ^ t[1][data[6]] ^ t[0][data[7]];
+            data += 8;
+            data_len -= 8;
+        }
+    }
+    while (data_len--) {
+        crc = t[0][(*data++ ^ crc) & 0xff] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+crc16_t CRC16Kermit(const unsigned char * data, size_t data_len, crc16_t crc)
+{
+    return crc16Reflected(data, data_len, crc);
+}
+
+crc16_t CRC16X25(const char * data, size_t data_len)
+{
+    return ~crc16Reflected((const unsigned char *)data, data_len, 0xffff);
+}
+
+crc32_t CRC32MPEG2(const unsigned char * data, size_t data_len, crc32_t crc)
+{
+    const crc32_t (*t)[256] = crc32Tables().table;
+
+    if (data_len >= CRC_SLICE_MIN) {
+        while (data_len >= 8) {
+            crc32_t c = crc ^ ((crc32_t(data[0]) << 24) | (data[1] << 16) | (data[2] << 8) | data[3]);
+            crc = t[7][c >> 24] ^ t[6][(c >> 16) & 0xff]
+                ^ t[5][(c >> 8) & 0xff] ^ t[4][c & 0xff]
+                ^ t[3][data[4]] ^ t[2][data[5]]
+                ^ t[1][data[6]] ^ t[0][data[7]];
+            data += 8;
+            data_len -= 8;
+        }
+    }
+    while (data_len--) {
+        crc = t[0][(*data++ ^ (crc >> 24)) & 0xff] ^ (crc << 8);
+    }
+    return crc;
+}
+
+crc32_t CRC32MPEG2wchar(const unsigned char * data, size_t data_len, crc32_t crc)
+{
+    const crc32_t (*t)[256] = crc32Tables().table;
+
+    // Each input byte is the last of the 4 byte word 00 00 00 xx, so a whole word
+    // is folded in per byte with 4 independent lookups instead of 4 dependent ones.
+    for (size_t i = 0; i < data_len; ++i) {
+        crc32_t c = crc ^ data[i];
+        crc = t[3][c >> 24] ^ t[2][(c >> 16) & 0xff] ^ t[1][(c >> 8) & 0xff] ^ t[0][c & 0xff];
+    }
+    return crc;
+}
@@ -0,0 +1,40 @@
+/* SleepLib CRC Functions Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef CRC_H
+#define CRC_H
+
+#include <QtGlobal>
+#include <cstddef>
+
+typedef quint16 crc16_t;
+typedef quint32 crc32_t;
+
+/*! \file crc.h
+    \brief Slice-by-8 implementations of the CRCs used by the loaders and session files.
+
+    Each function processes 8 input bytes per step through 8 lookup tables, which removes the
+    byte to byte dependency of the classic one table loop. Short inputs, and the tail of long
+    ones, fall back to the single table loop. Results are identical to the byte-wise versions,
+    which tests/crctests.cpp checks.
+    */
+
+//! \brief CRC-16/KERMIT (reflected polynomial 0x1021, no final xor), as used by PRS1 chunks
+crc16_t CRC16Kermit(const unsigned char * data, size_t data_len, crc16_t crc = 0);
+
+//! \brief CRC-16/X-25, bit for bit the same as qChecksum(), as used by session event files
+crc16_t CRC16X25(const char * data, size_t data_len);
+
+//! \brief CRC-32/MPEG-2 (polynomial 0x04C11DB7, not reflected, no final xor)
+crc32_t CRC32MPEG2(const unsigned char * data, size_t data_len, crc32_t crc = 0xffffffffU);
+
+/*! \brief CRC-32/MPEG-2 with every input byte widened to a big-endian 32-bit word,
+    which is what PRS1 file format 3 checksums */
+crc32_t CRC32MPEG2wchar(const unsigned char * data, size_t data_len, crc32_t crc = 0xffffffffU);
+
+#endif // CRC_H
@@ -23,7 +23,12 @@ Day::Day()
     d_summaries_open = false;
     d_events_open = false;
     d_invalidate = true;
-
+    d_bounds_valid = false;
+    d_first = d_last = 0;
+    d_totaltime = -1;
+    d_drift_generation = CPAPSettings::driftGeneration();
+    d_cursor_drift = 0;
+    resetCursor();
 }
 Day::~Day()
 {
@@ -202,19 +207,41 @@ EventDataType Day::countInsideSpan(ChannelID span, ChannelID code)
 
 EventDataType Day::lookupValue(ChannelID code, qint64 time, bool square)
 {
+    // Every graph asks about the same time on each mouse move, so values are worked out once per time
+    if (time != d_cursor_time) {
+        d_cursor_time = time;
+        d_cursor_values.clear();
+        d_cursor_drift = qint64(p_profile->cpap->clockDrift()) * 1000L;
+    }
+    quint64 key = (quint64(code) << 1) | (square ? 1 : 0);
+    auto vi = d_cursor_values.constFind(key);
+    if (vi != d_cursor_values.constEnd()) {
+        return vi.value();
+    }
+
+    EventDataType value = 0;
+
     // Remove drift from CPAP graphs so we get the right value...
-    qint64 clockdrift = qint64(p_profile->cpap->clockDrift()) * 1000L;
     for (auto & sess : sessions) {
         if (sess->enabled()) {
-            qint64 drift = (sess->type() == MT_CPAP?clockdrift:0);
+            qint64 drift = (sess->type() == MT_CPAP?d_cursor_drift:0);
             if ((time-drift > sess->first()) && (time-drift < sess->last())) {
                 if (sess->channelExists(code)) {
-                    return sess->SearchValue(code,time-drift,square);
+                    value = sess->SearchValue(code,time-drift,square,&d_cursor_hints);
+                    break;
                 }
             }
         }
     }
-    return 0;
+    d_cursor_values[key] = value;
+    return value;
+}
+
+void Day::resetCursor()
+{
+    d_cursor_time = std::numeric_limits<qint64>::min();
+    d_cursor_values.clear();
+    d_cursor_hints.clear();
 }
 
 
@@ -674,7 +701,29 @@ EventDataType Day::wavg(ChannelID code)
 // Total session time in milliseconds
 qint64 Day::total_time()
 {
-    qint64 d_totaltime = 0;
+    checkDrift();
+    if (d_totaltime < 0) {
+        d_totaltime = calcTotalTime();
+    }
+    return d_totaltime;
+}
+
+// Total session time in milliseconds, only considering machinetype
+qint64 Day::total_time(MachineType type)
+{
+    checkDrift();
+    auto it = d_machtime.find(type);
+    if (it == d_machtime.end()) {
+        it = d_machtime.insert(type, calcTotalTime(type));
+    }
+    return it.value();
+}
+
+// Total time in milliseconds covered by enabled sessions of type (everything but journals for MT_UNKNOWN),
+// counting overlapping sessions once
+qint64 Day::calcTotalTime(MachineType type)
+{
+    qint64 sum = 0;
     QMultiMap<qint64, bool> range;
     //range.reserve(size()*2);
 
@@ -685,111 +734,48 @@ qint64 Day::total_time()
     for (auto & sess : sessions) {
         int slicesize = sess->m_slices.size();
 
-        if (sess->enabled() && (sess->type() != MT_JOURNAL)) {
-            first = sess->first();
-            last = sess->last();
-
-            if (slicesize == 0) {
-                // This algorithm relies on non zero length, and correctly ordered sessions
-                if (last > first) {
-                    range.insert(first, 0);
-                    range.insert(last, 1);
-                    d_totaltime += sess->length();
-                    if (sess->length() == 0) {
-                        qWarning() << sess->s_session << "0 length session";
-                    }
-                }
-            } else {
-                for (auto & slice : sess->m_slices) {
-                    if (slice.status == MaskOn) {
-                        range.insert(slice.start, 0);
-                        range.insert(slice.end, 1);
-                        d_totaltime += slice.end - slice.start;
-                        if (slice.end - slice.start == 0) {
-                            qWarning() << sess->s_session << "0 length slice";
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    bool b;
-    int nest = 0;
-    qint64 ti = 0;
-    qint64 total = 0;
+        if (!sess->enabled()) { continue; }
+        if ((type == MT_UNKNOWN) ? (sess->type() == MT_JOURNAL) : (sess->type() != type)) { continue; }
 
-    // This is my implementation of a typical "brace counting" algorithm mentioned here:
-    // http://stackoverflow.com/questions/7468948/problem-calculating-overlapping-date-ranges
+        first = sess->first();
+        last = sess->last();
 
-    auto rend = range.end();
-    for (auto rit = range.begin(); rit != rend; ++rit) {
-        b = rit.value();
-
-        if (!b) {
-            if (!ti) {
-                ti = rit.key();
+        if (slicesize == 0) {
+            // This algorithm relies on non zero length, and correctly ordered sessions
+            if (last > first) {
+                range.insert(first, 0);
+                range.insert(last, 1);
+                sum += sess->length();
+                if (sess->length() == 0) {
+                    qWarning() << sess->s_session << "0 length session";
+                }
             }
-
-            nest++;
         } else {
-            if (--nest <= 0) {
-                total += rit.key() - ti;
-                ti = 0;
+            for (auto & slice : sess->m_slices) {
+                if (slice.status == MaskOn) {
+                    range.insert(slice.start, 0);
+                    range.insert(slice.end, 1);
+                    sum += slice.end - slice.start;
+                    if (slice.end - slice.start == 0) {
+                        qWarning() << sess->s_session << "0 length slice";
+                    }
+                }
             }
         }
     }
 
-    if (total != d_totaltime) {
+    qint64 total = coveredTime(range);
+
+    if (total != sum) {
         // They can overlap.. tough.
 //        qDebug() << "Sessions Times overlaps!" << total << d_totaltime;
     }
 
-    return total; //d_totaltime;
+    return total;
 }
 
-// Total session time in milliseconds, only considering machinetype
-qint64 Day::total_time(MachineType type)
+qint64 Day::coveredTime(const QMultiMap<qint64, bool> & range)
 {
-    qint64 d_totaltime = 0;
-    QMultiMap<qint64, bool> range;
-    //range.reserve(size()*2);
-
-    // Remember sessions may overlap..
-
-    qint64 first, last;
-    for (auto & sess : sessions) {
-        int slicesize = sess->m_slices.size();
-
-        if (sess->enabled() && (sess->type() == type)) {
-            first = sess->first();
-            last = sess->last();
-
-            // This algorithm relies on non zero length, and correctly ordered sessions
-            if (slicesize == 0) {
-                if (last > first) {
-                    range.insert(first, 0);
-                    range.insert(last, 1);
-                    d_totaltime += sess->length();
-                    if (sess->length() == 0) {
-                        qWarning() << sess->s_session << "0 length session";
-                    }
-                }
-            } else {
-                for (const auto & slice : sess->m_slices) {
-                    if (slice.status == MaskOn) {
-                        range.insert(slice.start, 0);
-                        range.insert(slice.end, 1);
-                        d_totaltime += slice.end - slice.start;
-                        if (slice.end - slice.start == 0) {
-                            qWarning() << sess->s_session << "0 length slice";
-                        }
-                    }
-                }
-            }
-        }
-    }
-
     bool b;
     int nest = 0;
     qint64 ti = 0;
@@ -815,13 +801,7 @@ qint64 Day::total_time(MachineType type)
             }
         }
     }
-
-    if (total != d_totaltime) {
-        // They can overlap.. tough.
-//        qDebug() << "Sessions Times overlaps!" << total << d_totaltime;
-    }
-
-    return total; //d_totaltime;
+    return total;
 }
 
 ChannelID Day::getPressureChannelID() {
@@ -1223,6 +1203,7 @@ void Day::OpenEvents()
             sess->OpenEvents();
     }
     d_events_open = true;
+    resetCursor();
 }
 
 void Day::OpenSummary()
@@ -1241,6 +1222,7 @@ void Day::CloseEvents()
         sess->TrashEvents();
     }
     d_events_open = false;
+    resetCursor();
 }
 
 QList<ChannelID> Day::getSortedMachineChannels(MachineType type, quint32 chantype)
@@ -1290,92 +1272,87 @@ QList<ChannelID> Day::getSortedMachineChannels(quint32 chantype)
     return channels;
 }
 
-qint64 Day::first(MachineType type)
+void Day::checkDrift()
 {
-    qint64 date = 0;
+    int generation = CPAPSettings::driftGeneration();
+    if (d_drift_generation != generation) {
+        invalidate();
+        d_drift_generation = generation;
+    }
+}
+
+void Day::calcBounds(qint64 & first, qint64 & last, MachineType type)
+{
+    first = last = 0;
     qint64 tmp;
 
     for (auto & sess : sessions) {
-        if ((sess->type() == type) && sess->enabled()) {
-            tmp = sess->first();
-
-            if (!tmp) { continue; }
+        if (!sess->enabled()) { continue; }
+        if ((type == MT_UNKNOWN) ? (sess->type() == MT_JOURNAL) : (sess->type() != type)) { continue; }
 
-            if (!date) {
-                date = tmp;
-            } else {
-                if (tmp < date) { date = tmp; }
-            }
+        tmp = sess->first();
+        if (tmp && (!first || (tmp < first))) {
+            first = tmp;
+        }
+        tmp = sess->last();
+        if (tmp && (!last || (tmp > last))) {
+            last = tmp;
         }
     }
-    return date;
 }
 
-qint64 Day::first()
+qint64 Day::first(MachineType type)
 {
-    qint64 date = 0;
-    qint64 tmp;
+    checkDrift();
+    auto it = d_machbounds.find(type);
+    if (it == d_machbounds.end()) {
+        qint64 first, last;
+        calcBounds(first, last, type);
+        it = d_machbounds.insert(type, QPair<qint64, qint64>(first, last));
+    }
+    return it.value().first;
+}
 
-    for (auto & sess : sessions) {
-        if (sess->type() == MT_JOURNAL) continue;
-        if (sess->enabled()) {
-            tmp = sess->first();
-            if (!tmp) { continue; }
-            if (!date) {
-                date = tmp;
-            } else {
-                if (tmp < date) { date = tmp; }
-            }
-        }
+qint64 Day::first()
+{
+    checkDrift();
+    if (!d_bounds_valid) {
+        calcBounds(d_first, d_last);
+        d_bounds_valid = true;
     }
-    return date;
+    return d_first;
 }
 
 //! \brief Returns the last session time of this day
 qint64 Day::last()
 {
-    qint64 date = 0;
-    qint64 tmp;
-
-    for (auto & sess : sessions) {
-        if (sess->type() == MT_JOURNAL) continue;
-        if (sess->enabled()) {
-            tmp = sess->last();
-            if (!tmp) { continue; }
-            if (!date) {
-                date = tmp;
-            } else {
-                if (tmp > date) { date = tmp; }
-            }
-        }
+    checkDrift();
+    if (!d_bounds_valid) {
+        calcBounds(d_first, d_last);
+        d_bounds_valid = true;
     }
-    return date;
+    return d_last;
 }
 
 qint64 Day::last(MachineType type)
 {
-    qint64 date = 0;
-    qint64 tmp;
-
-    for (auto & sess : sessions) {
-        if ((sess->type() == type) && sess->enabled()) {
-            tmp = sess->last();
-            if (!tmp) { continue; }
-            if (!date) {
-                date = tmp;
-            } else {
-                if (tmp > date) { date = tmp; }
-            }
-        }
+    checkDrift();
+    auto it = d_machbounds.find(type);
+    if (it == d_machbounds.end()) {
+        qint64 first, last;
+        calcBounds(first, last, type);
+        it = d_machbounds.insert(type, QPair<qint64, qint64>(first, last));
     }
-    return date;
+    return it.value().second;
 }
 
 bool Day::removeSession(Session *sess)
 {
     sess->machine()->sessionlist.remove(sess->session());
+    sess->machine()->unindexSession(sess);
     MachineType mt = sess->type();
     bool b = sessions.removeAll(sess) > 0;
+    invalidate();
     if (!searchMachine(mt)) {
         machines.remove(mt);
     }
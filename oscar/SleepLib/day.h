@@ -125,9 +125,14 @@ class Day
     //! \brief Returns the amount of time (in decimal minutes) the Channel spent below the threshold
     EventDataType timeBelowThreshold(ChannelID code, EventDataType threshold);
 
-    //! \brief Returns the value for Channel code at a given time
+    /*! \brief Returns the value for Channel code at a given time.
+        Values are cached until a different time is asked for, and each EventList's search
+        resumes from where the previous lookup left it, so a moving cursor stays cheap. */
     EventDataType lookupValue(ChannelID code, qint64 time, bool square);
 
+    //! \brief Forgets the cursor's cached values and search positions, call when events are loaded or freed
+    void resetCursor();
+
     //! \brief Returns the count of code events inside span flag event durations
     EventDataType countInsideSpan(ChannelID span, ChannelID code);
 
@@ -171,11 +176,13 @@ class Day
 
     //! \brief Return the total time in decimal hours for this day
     EventDataType hours() {
+        checkDrift();
         if (!d_invalidate) return d_hours;
         d_invalidate = false;
         return d_hours = double(total_time()) / 3600000.0;
     }
     EventDataType hours(MachineType type) {
+        checkDrift();
         auto it = d_machhours.find(type);
         if (it == d_machhours.end()) {
             return d_machhours[type] = double(total_time(type)) / 3600000.0;
@@ -244,7 +251,7 @@ class Day
     QString getCPAPModeStr();
     QString getPressureRelief();
     QString getPressureSettings();
-    QString validPressure(float pressure);
+    static QString validPressure(float pressure);
 
     // Some more very much CPAP only related stuff
 
@@ -299,6 +306,9 @@ class Day
     static QString calcMaxLabel(ChannelID code);
     static QString calcPercentileLabel(ChannelID code);
 
+    //! \brief Total time covered by the start (false) and end (true) marks in range, counting overlaps once
+    static qint64 coveredTime(const QMultiMap<qint64, bool> & range);
+
     EventDataType calc(ChannelID code, ChannelCalcType type);
 
     Session * firstSession(MachineType type);
@@ -313,9 +323,15 @@ class Day
     int useCounter() { return d_useCounter; }
 
 
+    //! \brief Drops the cached hours, bounds and total time, call whenever sessions or their times change
     void invalidate() {
+        resetCursor();
         d_invalidate = true;
+        d_bounds_valid = false;
+        d_totaltime = -1;
         d_machhours.clear();
+        d_machbounds.clear();
+        d_machtime.clear();
     }
 
     void updateCPAPCache();
@@ -327,8 +343,28 @@ class Day
 
 
     QHash<ChannelID, QHash<EventDataType, EventDataType> > perc_cache;
-    //qint64 d_first,d_last;
+
+    //! \brief Invalidates the cached times if the clock drift has changed since they were worked out
+    void checkDrift();
+
+    //! \brief Works out the first and last times of enabled sessions, of type or of everything but journals
+    void calcBounds(qint64 & first, qint64 & last, MachineType type = MT_UNKNOWN);
+
+    qint64 calcTotalTime(MachineType type = MT_UNKNOWN);
+
   private:
+    bool d_bounds_valid;
+    qint64 d_first, d_last;
+    qint64 d_totaltime;
+    QHash<MachineType, QPair<qint64, qint64> > d_machbounds;
+    QHash<MachineType, qint64> d_machtime;
+    int d_drift_generation;
+
+    qint64 d_cursor_time;
+    qint64 d_cursor_drift;
+    QHash<quint64, EventDataType> d_cursor_values;
+    QHash<EventList *, int> d_cursor_hints;
+
     bool d_firstsession;
     int d_useCounter;
     bool d_summaries_open;
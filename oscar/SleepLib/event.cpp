@@ -8,6 +8,8 @@
 
 #include <QDebug>
 #include "event.h"
+#include "eventpool.h"
+#include "memoryaccounting.h"
 
 EventList::EventList(EventListType et, EventDataType gain, EventDataType offset, EventDataType min,
                      EventDataType max, double rate, bool second_field)
@@ -44,6 +46,20 @@ void EventList::clear()
 
 }
 
+qint64 EventList::memoryUsed() const
+{
+    return qint64(sizeof(EventList)) + memoryOf(m_data) + memoryOf(m_data2) + memoryOf(m_time);
+}
+
+void EventList::recycle()
+{
+    EventBufferPool & pool = EventBufferPool::instance();
+    pool.release(m_data);
+    pool.release(m_data2);
+    pool.release(m_time);
+    clear();
+}
+
 qint64 EventList::time(quint32 i) const
 {
     if (m_type == EVL_Event) {
@@ -53,6 +69,49 @@ qint64 EventList::time(quint32 i) const
     return m_first + qint64((EventDataType(i) * m_rate));
 }
 
+int EventList::indexAt(qint64 time, int hint) const
+{
+    int cnt = int(m_count);
+    if ((cnt == 0) || (time < this->time(0))) {
+        return -1;
+    }
+    if (m_type == EVL_Waveform) {
+        return qMin(cnt - 1, int((time - m_first) / m_rate));
+    }
+
+    // Widen [lo, hi) from hint in doubling steps until it brackets time, with time(lo) <= time < time(hi)
+    int lo = qBound(0, hint, cnt - 1), hi;
+    int step = 1;
+    if (this->time(lo) <= time) {
+        hi = lo + 1;
+        while ((hi < cnt) && (this->time(hi) <= time)) {
+            lo = hi;
+            hi = lo + step;
+            step <<= 1;
+        }
+        hi = qMin(hi, cnt);
+    } else {
+        hi = lo;
+        lo = hi - 1;
+        while ((lo > 0) && (this->time(lo) > time)) {
+            hi = lo;
+            lo = qMax(0, hi - step);
+            step <<= 1;
+        }
+    }
+
+    // Then binary search inside it
+    while (hi - lo > 1) {
+        int mid = lo + (hi - lo) / 2;
+        if (this->time(mid) <= time) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
 EventDataType EventList::data(quint32 i)
 {
     return EventDataType(m_data[i]) * m_gain;
@@ -163,6 +222,7 @@ void EventList::AddWaveform(qint64 start, qint16 *data, int recs, qint64 duratio
     //realloc buffers.
     int r = m_count;
     m_count += recs;
+    EventBufferPool::instance().reserve(m_data, m_count);
     m_data.resize(m_count);
 
   //  EventStoreType *edata = m_data.data();
@@ -237,6 +297,7 @@ void EventList::AddWaveform(qint64 start, unsigned char *data, int recs, qint64
     //realloc buffers.
     int r = m_count;
     m_count += recs;
+    EventBufferPool::instance().reserve(m_data, m_count);
     m_data.resize(m_count);
 
     EventStoreType *edata = m_data.data();
@@ -305,6 +366,7 @@ void EventList::AddWaveform(qint64 start, char *data, int recs, qint64 duration)
 
     int r = m_count;
     m_count += recs;
+    EventBufferPool::instance().reserve(m_data, m_count);
     m_data.resize(m_count);
 
     EventStoreType *edata = m_data.data();
@@ -37,6 +37,9 @@ class EventList
     //! \brief Wipe the event list so it can be reused
     void clear();
 
+    //! \brief Wipe the event list, handing its storage to the EventBufferPool for other lists to reuse
+    void recycle();
+
     /*! \brief Add an event starting at time, containing data to this event list
       Note, data2 is only used if second_field is specified in the constructor */
     void AddEvent(qint64 time, EventStoreType data);
@@ -45,6 +48,9 @@ class EventList
     void AddWaveform(qint64 start, unsigned char *data, int recs, qint64 duration);
     void AddWaveform(qint64 start, char *data, int recs, qint64 duration);
 
+    //! \brief Estimated bytes held by this EventList and its storage
+    qint64 memoryUsed() const;
+
     //! \brief Returns a count of records contained in this EventList
     inline quint32 count() const { return m_count; }
 
@@ -66,6 +72,10 @@ class EventList
     //! \brief Returns either the timestamp for the i'th event, or calculates the waveform time position i
     qint64 time(quint32 i) const;
 
+    /*! \brief Returns the index of the last event at or before time, or -1 if time is before them all.
+        Gallops outwards from hint, so lookups near the previous one only cost a few comparisons. */
+    int indexAt(qint64 time, int hint = 0) const;
+
     //! \brief Returns true if this EventList uses the second data field
     bool hasSecondField() { return m_second_field; }
 
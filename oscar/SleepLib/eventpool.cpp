@@ -0,0 +1,186 @@
+/* SleepLib Event Buffer Pool Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <algorithm>
+#include <QMutexLocker>
+#include <QtAlgorithms>
+#include <QObject>
+#include <QDebug>
+
+#include "eventpool.h"
+
+// Used until the preferences say otherwise
+const qint64 event_pool_default_budget = 64L * 1048576L;
+
+// A request may be served from its own size class or the next one up, so small requests don't tie up huge buffers
+const int pool_search_classes = 2;
+
+// Size class holding buffers of at least 2^class items, with n > 0
+static inline int floorClass(quint32 n)
+{
+    return 31 - qCountLeadingZeroBits(n);
+}
+
+// Smallest size class whose buffers are all large enough for n items, with n > 1
+static inline int ceilClass(quint32 n)
+{
+    return floorClass(n - 1) + 1;
+}
+
+EventBufferPool & EventBufferPool::instance()
+{
+    static EventBufferPool pool;
+    return pool;
+}
+
+EventBufferPool::EventBufferPool()
+    : m_budget(event_pool_default_budget)
+{
+    MemoryAccounting::instance().add(this);
+}
+
+EventBufferPool::~EventBufferPool()
+{
+    MemoryAccounting::instance().remove(this);
+}
+
+void EventBufferPool::setBudget(qint64 bytes)
+{
+    QMutexLocker lock(&m_mutex);
+    m_budget = qMax(qint64(0), bytes);
+    trim(m_budget);
+}
+
+qint64 EventBufferPool::budget() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_budget;
+}
+
+bool EventBufferPool::reserve(QVector<EventStoreType> & vec, int size)
+{
+    return take(m_data, vec, size);
+}
+
+bool EventBufferPool::reserve(QVector<quint32> & vec, int size)
+{
+    return take(m_time, vec, size);
+}
+
+void EventBufferPool::release(QVector<EventStoreType> & vec)
+{
+    put(m_data, vec);
+}
+
+void EventBufferPool::release(QVector<quint32> & vec)
+{
+    put(m_time, vec);
+}
+
+template <typename T>
+bool EventBufferPool::take(QVector<QVector<T> > * bins, QVector<T> & vec, int size)
+{
+    if ((size < (1 << pool_min_class)) || (vec.capacity() >= size)) {
+        return false;
+    }
+    int first = ceilClass(quint32(size));
+    int last = qMin(first + pool_search_classes - 1, pool_max_class);
+
+    QVector<T> buffer;
+    {
+        QMutexLocker lock(&m_mutex);
+        for (int c = first; c <= last; ++c) {
+            QVector<QVector<T> > & bin = bins[c - pool_min_class];
+            if (!bin.isEmpty()) {
+                buffer = bin.takeLast();
+                break;
+            }
+        }
+        if (buffer.capacity() == 0) {
+            m_stats.misses++;
+            return false;
+        }
+        m_stats.hits++;
+        m_stats.buffers--;
+        m_stats.bytes -= qint64(buffer.capacity()) * qint64(sizeof(T));
+    }
+
+    // Fits without reallocating, as the buffer was emptied when it was released
+    if (!vec.isEmpty()) {
+        buffer.resize(vec.size());
+        std::copy(vec.constBegin(), vec.constEnd(), buffer.begin());
+    }
+    vec.swap(buffer);
+    return true;
+}
+
+template <typename T>
+void EventBufferPool::put(QVector<QVector<T> > * bins, QVector<T> & vec)
+{
+    // Whatever isn't kept is freed when this goes out of scope, after the lock is let go
+    QVector<T> buffer;
+    buffer.swap(vec);
+
+    int capacity = buffer.capacity();
+    if ((capacity < (1 << pool_min_class)) || !buffer.isDetached()) {
+        // Too small to bother with, or still shared with a copy of the EventList
+        return;
+    }
+    // Keeps the capacity
+    buffer.resize(0);
+
+    qint64 bytes = qint64(capacity) * qint64(sizeof(T));
+    QMutexLocker lock(&m_mutex);
+    if (m_stats.bytes + bytes > m_budget) {
+        m_stats.dropped++;
+        return;
+    }
+    bins[qMin(floorClass(quint32(capacity)), pool_max_class) - pool_min_class].append(std::move(buffer));
+
+    m_stats.recycled++;
+    m_stats.buffers++;
+    m_stats.bytes += bytes;
+    m_stats.peakBytes = qMax(m_stats.peakBytes, m_stats.bytes);
+}
+
+void EventBufferPool::trim(qint64 bytes)
+{
+    for (int c = pool_classes - 1; (c >= 0) && (m_stats.bytes > bytes); --c) {
+        while (!m_data[c].isEmpty() && (m_stats.bytes > bytes)) {
+            m_stats.bytes -= qint64(m_data[c].last().capacity()) * qint64(sizeof(EventStoreType));
+            m_stats.buffers--;
+            m_data[c].removeLast();
+        }
+        while (!m_time[c].isEmpty() && (m_stats.bytes > bytes)) {
+            m_stats.bytes -= qint64(m_time[c].last().capacity()) * qint64(sizeof(quint32));
+            m_stats.buffers--;
+            m_time[c].removeLast();
+        }
+    }
+}
+
+void EventBufferPool::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    qDebug() << "Event buffer pool:" << m_stats.hits << "hits," << m_stats.misses << "misses,"
+             << m_stats.recycled << "recycled," << m_stats.dropped << "dropped, peak"
+             << m_stats.peakBytes / 1024 << "KiB";
+    trim(0);
+}
+
+EventBufferPool::Stats EventBufferPool::stats() const
+{
+    QMutexLocker lock(&m_mutex);
+    return m_stats;
+}
+
+void EventBufferPool::reportMemory(MemoryReport & report)
+{
+    Stats now = stats();
+    report.add(QObject::tr("Event buffer pool"), now.bytes, now.buffers);
+}
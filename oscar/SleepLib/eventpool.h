@@ -0,0 +1,89 @@
+/* SleepLib Event Buffer Pool Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef EVENTPOOL_H
+#define EVENTPOOL_H
+
+#include <QMutex>
+#include <QVector>
+
+#include "SleepLib/machine_common.h"
+#include "SleepLib/memoryaccounting.h"
+
+// Buffers hold at least 2^pool_min_class and are binned by capacity up to 2^pool_max_class items
+const int pool_min_class = 10;
+const int pool_max_class = 26;
+const int pool_classes = pool_max_class - pool_min_class + 1;
+
+/*! \class EventBufferPool
+    \brief Keeps the storage of trashed EventLists around so the next sessions loaded can reuse it
+
+    Browsing days back and forth loads and trashes sessions of much the same sizes over and over.
+    Rather than handing their data and time vectors back to the allocator, Session::TrashEvents()
+    returns them here, binned by powers of two of their capacity, and Session::LoadEvents() and
+    EventList::AddWaveform() take a large enough one back out before growing a vector themselves.
+
+    Small vectors aren't pooled, and buffers that would take the pool over its budget are freed
+    as before. All of it is safe to use from the loader and pre-warming threads.
+    */
+class EventBufferPool:public MemoryReporter
+{
+  public:
+    struct Stats {
+        Stats() : hits(0), misses(0), recycled(0), dropped(0), buffers(0), bytes(0), peakBytes(0) {}
+
+        qint64 hits;        //!< Requests served from the pool
+        qint64 misses;      //!< Requests left to the allocator, as no pooled buffer was large enough
+        qint64 recycled;    //!< Buffers returned and kept
+        qint64 dropped;     //!< Buffers returned but freed, as keeping them would exceed the budget
+        int buffers;        //!< Buffers held right now
+        qint64 bytes;       //!< Bytes held right now
+        qint64 peakBytes;   //!< Most bytes held at any one time
+    };
+
+    static EventBufferPool & instance();
+
+    //! \brief Sets the most bytes the pool may hold, freeing the largest buffers if it's already over
+    void setBudget(qint64 bytes);
+    qint64 budget() const;
+
+    /*! \brief Gives vec room for size items from a pooled buffer, keeping what it holds already.
+        Returns false, leaving vec alone, if it already has the room or nothing pooled is large enough */
+    bool reserve(QVector<EventStoreType> & vec, int size);
+    bool reserve(QVector<quint32> & vec, int size);
+
+    //! \brief Takes vec's storage into the pool, leaving vec empty
+    void release(QVector<EventStoreType> & vec);
+    void release(QVector<quint32> & vec);
+
+    //! \brief Frees every pooled buffer
+    void clear();
+
+    Stats stats() const;
+
+    //! \brief Reports the buffers held for reuse
+    virtual void reportMemory(MemoryReport & report);
+
+  protected:
+    EventBufferPool();
+    virtual ~EventBufferPool();
+
+    template <typename T> bool take(QVector<QVector<T> > * bins, QVector<T> & vec, int size);
+    template <typename T> void put(QVector<QVector<T> > * bins, QVector<T> & vec);
+
+    //! \brief Frees pooled buffers, largest first, until the pool fits in bytes. Call with m_mutex held.
+    void trim(qint64 bytes);
+
+    mutable QMutex m_mutex;
+    QVector<QVector<EventStoreType> > m_data[pool_classes];
+    QVector<QVector<quint32> > m_time[pool_classes];
+    qint64 m_budget;
+    Stats m_stats;
+};
+
+#endif // EVENTPOOL_H
@@ -0,0 +1,232 @@
+/* SleepLib Streaming Gzip Device Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QDebug>
+
+#ifdef _MSC_VER
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include "gzipdevice.h"
+
+// Size of the compressed data buffer held while streaming
+static const int GZIP_CHUNK_SIZE = 65536;
+
+// Largest single request handed to zlib, which counts in unsigned ints
+static const qint64 GZIP_MAX_REQUEST = 1 << 30;
+
+// deflate can't do better than about 1032:1, anything larger means the trailer isn't there
+static const qint64 GZIP_MAX_RATIO = 1032;
+
+// EDF and other machine data rarely packs better than this, larger outputs just grow as they go
+static const qint64 GZIP_PRESIZE_RATIO = 16;
+
+GzipDevice::GzipDevice(QIODevice * source, int level, QObject * parent)
+    : QIODevice(parent), m_source(source), m_zs(nullptr), m_level(level),
+      m_ownsSource(false), m_finished(false), m_failed(false)
+{
+}
+
+GzipDevice::~GzipDevice()
+{
+    if (isOpen()) {
+        close();
+    }
+}
+
+qint64 GzipDevice::trailerSize(QIODevice * source)
+{
+    if (!source || source->isSequential() || (source->size() < 18)) {
+        return -1;
+    }
+    qint64 pos = source->pos();
+    unsigned char ch[4];
+
+    if (!source->seek(source->size() - 4) || (source->read((char *)ch, 4) != 4)) {
+        source->seek(pos);
+        return -1;
+    }
+    source->seek(pos);
+    return quint32(ch[0] | (ch[1] << 8) | (ch[2] << 16) | (quint32(ch[3]) << 24));
+}
+
+qint64 GzipDevice::presize(qint64 trailer, qint64 compressed)
+{
+    if ((trailer <= 0) || (compressed <= 0) || (trailer > compressed * GZIP_MAX_RATIO)) {
+        return 0;
+    }
+    return qMin(trailer, compressed * GZIP_PRESIZE_RATIO);
+}
+
+bool GzipDevice::open(OpenMode mode)
+{
+    if (isOpen()) {
+        qWarning() << "GzipDevice::open() called on an open device";
+        return false;
+    }
+    mode &= ~QIODevice::Unbuffered;
+    if ((mode != QIODevice::ReadOnly) && (mode != QIODevice::WriteOnly)) {
+        setErrorString(tr("Gzip streams can only be opened for reading or writing"));
+        return false;
+    }
+
+    if (!m_source->isOpen()) {
+        if (!m_source->open(mode)) {
+            setErrorString(m_source->errorString());
+            return false;
+        }
+        m_ownsSource = true;
+    } else if ((m_source->openMode() & mode) != mode) {
+        setErrorString(tr("Underlying device is not open in a compatible mode"));
+        return false;
+    }
+
+    m_zs = new z_stream;
+    m_zs->zalloc = Z_NULL;
+    m_zs->zfree = Z_NULL;
+    m_zs->opaque = Z_NULL;
+    m_zs->next_in = Z_NULL;
+    m_zs->avail_in = 0;
+
+    int ret;
+    if (mode == QIODevice::ReadOnly) {
+        ret = inflateInit2(m_zs, 15 + 32); // gzip or zlib, auto detected
+    } else {
+        ret = deflateInit2(m_zs, m_level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY); // gzip wrapper
+    }
+    if (ret != Z_OK) {
+        setErrorString(tr("Could not initialise zlib (error %1)").arg(ret));
+        delete m_zs;
+        m_zs = nullptr;
+        if (m_ownsSource) {
+            m_source->close();
+            m_ownsSource = false;
+        }
+        return false;
+    }
+
+    m_buffer.resize(GZIP_CHUNK_SIZE);
+    m_finished = false;
+    m_failed = false;
+    return QIODevice::open(mode | QIODevice::Unbuffered);
+}
+
+void GzipDevice::close()
+{
+    if (!isOpen()) {
+        return;
+    }
+    if (m_zs) {
+        if (openMode() & QIODevice::WriteOnly) {
+            deflateChunk(Z_FINISH);
+            deflateEnd(m_zs);
+        } else {
+            inflateEnd(m_zs);
+        }
+        delete m_zs;
+        m_zs = nullptr;
+    }
+    if (m_ownsSource) {
+        m_source->close();
+        m_ownsSource = false;
+    }
+    m_buffer.clear();
+    QIODevice::close();
+}
+
+bool GzipDevice::atEnd() const
+{
+    return m_finished || !isOpen();
+}
+
+qint64 GzipDevice::readData(char * data, qint64 maxlen)
+{
+    if (m_finished || !m_zs) {
+        return m_failed ? -1 : 0;
+    }
+    maxlen = qMin(maxlen, GZIP_MAX_REQUEST);
+
+    m_zs->next_out = (Bytef *)data;
+    m_zs->avail_out = uInt(maxlen);
+
+    while (m_zs->avail_out > 0) {
+        if (m_zs->avail_in == 0) {
+            qint64 n = m_source->read(m_buffer.data(), m_buffer.size());
+            if (n < 0) {
+                setErrorString(m_source->errorString());
+                m_finished = m_failed = true;
+                break;
+            }
+            if (n == 0) {
+                qWarning() << "GzipDevice: compressed stream is truncated";
+                setErrorString(tr("Compressed stream is truncated"));
+                m_finished = m_failed = true;
+                break;
+            }
+            m_zs->next_in = (Bytef *)m_buffer.data();
+            m_zs->avail_in = uInt(n);
+        }
+
+        int ret = inflate(m_zs, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            m_finished = true;
+            break;
+        }
+        if ((ret != Z_OK) && (ret != Z_BUF_ERROR)) {
+            qWarning() << "GzipDevice: inflate failed with" << ret << (m_zs->msg ? m_zs->msg : "");
+            setErrorString(tr("Corrupt compressed data"));
+            m_finished = m_failed = true;
+            break;
+        }
+    }
+    qint64 produced = maxlen - m_zs->avail_out;
+    return ((produced == 0) && m_failed) ? -1 : produced;
+}
+
+bool GzipDevice::deflateChunk(int flush)
+{
+    int ret;
+    do {
+        m_zs->next_out = (Bytef *)m_buffer.data();
+        m_zs->avail_out = uInt(m_buffer.size());
+
+        ret = deflate(m_zs, flush);
+        if (ret == Z_STREAM_ERROR) {
+            setErrorString(tr("Compression failed"));
+            return false;
+        }
+        qint64 have = m_buffer.size() - m_zs->avail_out;
+        if ((have > 0) && (m_source->write(m_buffer.constData(), have) != have)) {
+            setErrorString(m_source->errorString());
+            return false;
+        }
+    } while ((m_zs->avail_out == 0) || ((flush == Z_FINISH) && (ret != Z_STREAM_END)));
+
+    return true;
+}
+
+qint64 GzipDevice::writeData(const char * data, qint64 len)
+{
+    if (!m_zs) {
+        return -1;
+    }
+    qint64 written = 0;
+    while (written < len) {
+        qint64 part = qMin(len - written, GZIP_MAX_REQUEST);
+        m_zs->next_in = (Bytef *)(data + written);
+        m_zs->avail_in = uInt(part);
+
+        if (!deflateChunk(Z_NO_FLUSH)) {
+            return -1;
+        }
+        written += part;
+    }
+    return written;
+}
@@ -0,0 +1,68 @@
+/* SleepLib Streaming Gzip Device Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef GZIPDEVICE_H
+#define GZIPDEVICE_H
+
+#include <QIODevice>
+#include <QByteArray>
+
+struct z_stream_s;
+
+/*! \class GzipDevice
+    \brief Sequential QIODevice that inflates or deflates a gzip stream on top of another device
+
+    Opened ReadOnly, reading returns the uncompressed contents of the underlying device.
+    A truncated or corrupt stream makes read() return -1 after whatever could be decoded.
+    Opened WriteOnly, everything written is compressed straight into the underlying device,
+    with zlib producing the gzip header and CRC32 trailer as it goes. Only one fixed size
+    buffer of compressed data is held at a time, whatever the size of the stream.
+    */
+class GzipDevice : public QIODevice
+{
+    Q_OBJECT
+  public:
+    //! \brief Creates a device on top of source, which is opened (and closed) as needed
+    GzipDevice(QIODevice * source, int level = -1, QObject * parent = nullptr);
+    virtual ~GzipDevice();
+
+    //! \brief Opens for ReadOnly or WriteOnly access, ReadWrite is not supported
+    virtual bool open(OpenMode mode) override;
+
+    //! \brief Finishes the compressed stream when writing, and releases zlib state
+    virtual void close() override;
+
+    virtual bool isSequential() const override { return true; }
+    virtual bool atEnd() const override;
+
+    /*! \brief Returns the uncompressed size stored in the gzip trailer of a random access source,
+        or -1 if it can't be read. This is modulo 2^32, as per RFC 1952 */
+    static qint64 trailerSize(QIODevice * source);
+
+    /*! \brief Returns how much to presize an output buffer by for compressed bytes of input whose
+        trailer claims trailer bytes, or 0 if the trailer isn't plausible. This is capped at a sane
+        multiple of compressed, so a corrupt or hostile trailer can't cause a huge allocation */
+    static qint64 presize(qint64 trailer, qint64 compressed);
+
+  protected:
+    virtual qint64 readData(char * data, qint64 maxlen) override;
+    virtual qint64 writeData(const char * data, qint64 len) override;
+
+    bool deflateChunk(int flush);
+
+    QIODevice * m_source;
+    z_stream_s * m_zs;
+    QByteArray m_buffer;
+    int m_level;
+    bool m_ownsSource;
+    bool m_finished;
+    //! \brief The stream was truncated or corrupt, so reads report an error once the good data is used up
+    bool m_failed;
+};
+
+#endif // GZIPDEVICE_H
@@ -0,0 +1,181 @@
+/* SleepLib Multiple Source Import Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QEventLoop>
+#include <QDebug>
+
+#include "importcoordinator.h"
+
+// Progress steps given to each source in the combined progress bar
+const int import_source_steps = 100;
+
+void SourceImportTask::run()
+{
+    coordinator->importSource(source);
+    QMetaObject::invokeMethod(coordinator, "sourceDone", Qt::QueuedConnection, Q_ARG(int, source));
+}
+
+ImportCoordinator::ImportCoordinator(QObject * parent)
+    :QObject(parent), m_pending(0), m_foreground(false)
+{
+    connect(&m_timer, SIGNAL(timeout()), this, SLOT(poll()));
+}
+
+ImportCoordinator::~ImportCoordinator()
+{
+    abort();
+    m_pool.waitForDone(-1);
+}
+
+QList<ImportResult> ImportCoordinator::run(const QList<ImportPath> & sources)
+{
+    m_cancelled.store(0);
+    m_completed.store(0);
+    m_sources = sources;
+    m_results.fill(-1, sources.size());
+    m_loaders.clear();
+    m_labels.clear();
+    m_queued.clear();
+    m_finished.clear();
+    m_pending = 0;
+
+    // A loader can only run one import at a time, so its sources stay together and in order
+    QHash<MachineLoader *, QList<int> > groups;
+    for (int i = 0; i < m_sources.size(); ++i) {
+        MachineLoader * loader = m_sources.at(i).loader;
+        if (!loader || m_sources.at(i).path.isEmpty()) {
+            m_completed.ref();
+            continue;
+        }
+        if (!groups.contains(loader)) {
+            m_loaders.append(loader);
+            loader->progress().reset();
+            m_labels[loader] = loader->progress().labelSerial();
+        }
+        groups[loader].append(i);
+    }
+    m_progress.setMax(m_sources.size() * import_source_steps);
+    m_progress.setValue(0);
+    m_timer.start(progress_poll_interval);
+
+    QList<int> foreground;
+    for (MachineLoader * loader : m_loaders) {
+        if (loader->canImportInBackground()) {
+            m_queued[loader] = groups[loader];
+            // Any preferences change before the first worker starts reading them
+            for (int idx : groups[loader]) {
+                loader->prepareImport(m_sources.at(idx).path);
+            }
+        } else {
+            foreground.append(groups[loader]);
+        }
+    }
+    for (MachineLoader * loader : m_loaders) {
+        if (startNext(loader)) {
+            m_pending++;
+        }
+    }
+    qDebug() << "Importing" << m_sources.size() << "sources," << m_pending << "loaders in the background";
+
+    // The foreground loaders let events through as they go, which keeps the polling going
+    m_foreground = true;
+    for (int idx : foreground) {
+        importSource(idx);
+    }
+    m_foreground = false;
+    for (int idx : m_finished) {
+        sourceDone(idx);
+    }
+    m_finished.clear();
+    if (m_pending > 0) {
+        QEventLoop loop;
+        connect(this, SIGNAL(finished()), &loop, SLOT(quit()));
+        loop.exec();
+    }
+    m_timer.stop();
+    poll();
+
+    QList<ImportResult> results;
+    for (int i = 0; i < m_sources.size(); ++i) {
+        results.append(ImportResult(m_sources.at(i), m_results.at(i)));
+    }
+    m_loaders.clear();
+    return results;
+}
+
+void ImportCoordinator::importSource(int idx)
+{
+    const ImportPath & source = m_sources.at(idx);
+    int c = -1;
+    if (m_cancelled.load() == 0) {
+        c = source.loader->Open(source.path);
+        qDebug() << "Finished importing" << source.path << c;
+    }
+    m_results[idx] = c;
+
+    // Clear the loader's counters so they aren't counted again on top of this completed source
+    source.loader->progress().setMax(0);
+    source.loader->progress().setValue(0);
+    m_completed.ref();
+}
+
+void ImportCoordinator::abort()
+{
+    m_cancelled.store(1);
+    for (MachineLoader * loader : m_loaders) {
+        loader->abortImport();
+    }
+}
+
+void ImportCoordinator::poll()
+{
+    int value = m_completed.load() * import_source_steps;
+    for (MachineLoader * loader : m_loaders) {
+        ProgressTracker & tracker = loader->progress();
+        int max = tracker.max();
+        if (max > 0) {
+            value += qMin(tracker.value(), max) * import_source_steps / max;
+        }
+
+        int serial = tracker.labelSerial();
+        if (serial != m_labels.value(loader)) {
+            m_labels[loader] = serial;
+            QString label = tracker.label();
+            if (!label.isEmpty()) {
+                m_progress.setLabel((m_loaders.size() > 1) ? loader->loaderName() + ": " + label : label);
+            }
+        }
+    }
+    m_progress.setValue(qMin(value, m_progress.max()));
+}
+
+bool ImportCoordinator::startNext(MachineLoader * loader)
+{
+    auto it = m_queued.find(loader);
+    if ((it == m_queued.end()) || it.value().isEmpty()) {
+        return false;
+    }
+    m_pool.start(new SourceImportTask(this, it.value().takeFirst()));
+    return true;
+}
+
+void ImportCoordinator::sourceDone(int idx)
+{
+    if (m_foreground) {
+        // Don't change the days under a foreground loader letting events through halfway
+        m_finished.append(idx);
+        return;
+    }
+    MachineLoader * loader = m_sources.at(idx).loader;
+    loader->commitSessions();
+
+    // Once aborted, the rest are skipped by importSource()
+    if (!startNext(loader) && (--m_pending == 0)) {
+        emit finished();
+    }
+}
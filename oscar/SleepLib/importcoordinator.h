@@ -0,0 +1,124 @@
+/* SleepLib Multiple Source Import Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef IMPORTCOORDINATOR_H
+#define IMPORTCOORDINATOR_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include <QTimer>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_loader.h"
+#include "SleepLib/progresstracker.h"
+
+class ImportCoordinator;
+
+/*! \struct ImportResult
+    \brief The outcome of importing one source, sessions being what MachineLoader::Open() returned
+    */
+struct ImportResult
+{
+    ImportResult() : loader(nullptr), sessions(-1) {}
+    ImportResult(const ImportPath & source, int sessions)
+        : path(source.path), loader(source.loader), sessions(sessions) {}
+
+    QString path;
+    MachineLoader * loader;
+    int sessions;
+};
+
+/*! \class SourceImportTask
+    \brief Imports one source on the coordinator's pool
+    */
+class SourceImportTask:public QRunnable
+{
+public:
+    SourceImportTask(ImportCoordinator * coordinator, int source)
+        : coordinator(coordinator), source(source) {}
+    virtual ~SourceImportTask() {}
+    virtual void run();
+
+protected:
+    ImportCoordinator * coordinator;
+    int source;
+};
+
+/*! \class ImportCoordinator
+    \brief Imports several data cards and backup folders at the same time, reporting their combined progress
+
+    Sources are grouped by loader, as a loader holds the state of the import it is running. Each group whose
+    loader can import in the background gets a thread of its own, while the remaining groups are imported on
+    the calling thread in the meantime, the same way they always were.
+
+    The profile and its machines are only changed on the calling thread, which reads them without locking.
+    Background loaders just parse and store their sessions, reading the profile's days under
+    Profile::importMutex, and each source's sessions are added by MachineLoader::commitSessions() through a
+    queued call once it finishes. The next source of that loader is only started after this, so it sees them.
+
+    The loaders' progress trackers are polled on the calling thread and folded into one combined tracker.
+    */
+class ImportCoordinator:public QObject
+{
+    Q_OBJECT
+    friend class SourceImportTask;
+  public:
+    explicit ImportCoordinator(QObject * parent = nullptr);
+    virtual ~ImportCoordinator();
+
+    //! \brief Imports sources and returns once every one has finished, with the results in the same order
+    QList<ImportResult> run(const QList<ImportPath> & sources);
+
+    //! \brief Combined progress of every source, each one counting the same
+    ProgressTracker & progress() { return m_progress; }
+
+  public slots:
+    //! \brief Asks the running loaders to stop, and skips any source not started yet
+    void abort();
+
+  signals:
+    //! \brief The last background group has finished
+    void finished();
+
+  protected slots:
+    //! \brief Folds the loaders' trackers into the combined one
+    void poll();
+
+    //! \brief Adds the sessions of background source idx to the profile, and starts its loader's next source
+    void sourceDone(int idx);
+
+  protected:
+    //! \brief Imports source number idx on whichever thread calls it
+    void importSource(int idx);
+
+    //! \brief Starts the next queued source of a background loader, returning false if there are none left
+    bool startNext(MachineLoader * loader);
+
+    QThreadPool m_pool;
+    QTimer m_timer;
+    QAtomicInt m_cancelled;
+    QAtomicInt m_completed;
+
+    QList<ImportPath> m_sources;
+    QVector<int> m_results;
+    QList<MachineLoader *> m_loaders;
+    QHash<MachineLoader *, int> m_labels;
+    QHash<MachineLoader *, QList<int> > m_queued;
+    ProgressTracker m_progress;
+    int m_pending;
+
+    //! \brief Background sources finished while a foreground loader was running, still to be committed
+    QList<int> m_finished;
+    bool m_foreground;
+};
+
+#endif // IMPORTCOORDINATOR_H
@@ -0,0 +1,233 @@
+/* SleepLib Data Integrity Scanner Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QDir>
+#include <QFile>
+#include <QDataStream>
+#include <QSet>
+#include <QThreadPool>
+#include <QTime>
+#include <QDebug>
+
+#include "integrity.h"
+#include "machine.h"
+#include "session.h"
+#include "progressdialog.h"
+#include "common.h"
+#include "crc.h"
+
+void IntegrityTask::run()
+{
+    scanner->check(index);
+}
+
+IntegrityScanner::IntegrityScanner(Machine * mach)
+    : m_machine(mach)
+{
+}
+
+IntegrityScanner::~IntegrityScanner()
+{
+    // Sessions not handed over by rebuild() still belong to us
+    for (auto & entry : m_entries) {
+        delete entry.session;
+    }
+}
+
+void IntegrityScanner::addFiles(const QString & path, const QString & filter, quint16 filetype)
+{
+    QDir dir(path);
+    const QStringList files = dir.entryList(QStringList() << filter, QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+
+    for (const auto & filename : files) {
+        bool ok;
+        SessionID id = filename.section(".", 0, -2).toLong(&ok, 16);
+        if (!ok) {
+            continue;
+        }
+        Entry entry;
+        entry.filename = path + filename;
+        entry.id = id;
+        entry.filetype = filetype;
+        m_entries.append(entry);
+    }
+}
+
+void IntegrityScanner::scan(bool events, ProgressDialog * progress)
+{
+    for (auto & entry : m_entries) {
+        delete entry.session;
+    }
+    m_entries.clear();
+    m_issues.clear();
+    m_progress.reset();
+
+    addFiles(m_machine->getSummariesPath(), "*.000", filetype_summary);
+    if (events) {
+        addFiles(m_machine->getEventsPath(), "*.001", filetype_data);
+        addFiles(m_machine->getEventsPath(), "*.003", filetype_overlay);
+    }
+    int size = m_entries.size();
+
+    QTime time;
+    time.start();
+
+    m_progress.setMax(size);
+    if (progress) {
+        progress->track(&m_progress);
+    }
+
+    // A pool of our own, so waiting on it doesn't also wait on unrelated background work
+    QThreadPool pool;
+    for (int i = 0; i < size; ++i) {
+        pool.start(new IntegrityTask(this, i));
+    }
+    while (!pool.waitForDone(progress ? progress_poll_interval : -1)) {
+        ProgressTracker::pumpEvents();
+    }
+    if (progress) {
+        progress->track(nullptr);
+    }
+
+    // Cross check the files against each other now they've all been read
+    QSet<SessionID> summaries, eventfiles;
+    for (const auto & entry : m_entries) {
+        if (entry.ok && (entry.filetype == filetype_summary)) {
+            summaries.insert(entry.id);
+        } else if (entry.filetype == filetype_data) {
+            eventfiles.insert(entry.id);
+        }
+    }
+
+    for (const auto & entry : m_entries) {
+        if (!entry.ok) {
+            m_issues.append(IntegrityIssue(IntegrityIssue::Corrupt, entry.filename, entry.reason));
+        } else if ((entry.filetype != filetype_summary) && !summaries.contains(entry.id)) {
+            m_issues.append(IntegrityIssue(IntegrityIssue::Orphaned, entry.filename, QObject::tr("No valid summary")));
+        } else if (events && (entry.filetype == filetype_summary) && !eventfiles.contains(entry.id)
+                   && !entry.session->summaryOnly() && !entry.session->m_availableChannels.isEmpty()) {
+            m_issues.append(IntegrityIssue(IntegrityIssue::MissingEvents, entry.filename, QObject::tr("Events file missing")));
+        }
+    }
+
+    qDebug() << "Checked" << size << m_machine->loaderName() << m_machine->serial() << "files in"
+             << time.elapsed() << "ms, found" << m_issues.size() << "problems";
+    for (const auto & issue : m_issues) {
+        qWarning() << "Integrity:" << issue.filename << issue.reason;
+    }
+}
+
+void IntegrityScanner::check(int index)
+{
+    Entry & entry = m_entries[index];
+
+    if (entry.filetype == filetype_summary) {
+        // The upgrade path in LoadSummary may write the file back, which is fine from any thread
+        Session * sess = new Session(m_machine, entry.id);
+        if (sess->LoadSummary()) {
+            entry.session = sess;
+            entry.ok = true;
+        } else {
+            entry.reason = QObject::tr("Unreadable summary");
+            delete sess;
+        }
+    } else {
+        entry.ok = checkEvents(entry.filename, entry.filetype, &entry.reason);
+    }
+    m_progress.advance();
+}
+
+bool IntegrityScanner::rebuild()
+{
+    QList<Session *> loaded;
+    for (auto & entry : m_entries) {
+        if (entry.session) {
+            loaded.append(entry.session);
+            entry.session = nullptr;
+        }
+    }
+
+    m_machine->AddSessions(loaded);
+    return m_machine->SaveSummaryCache();
+}
+
+QStringList IntegrityScanner::report() const
+{
+    QStringList lines;
+    for (const auto & issue : m_issues) {
+        QString kind;
+        switch (issue.kind) {
+        case IntegrityIssue::Corrupt:
+            kind = QObject::tr("Corrupt");
+            break;
+        case IntegrityIssue::Orphaned:
+            kind = QObject::tr("Orphaned");
+            break;
+        case IntegrityIssue::MissingEvents:
+            kind = QObject::tr("Incomplete");
+            break;
+        }
+        lines.append(QString("%1: %2 (%3)").arg(kind).arg(QDir::toNativeSeparators(issue.filename)).arg(issue.reason));
+    }
+    return lines;
+}
+
+bool IntegrityScanner::checkEvents(const QString & filename, quint16 filetype, QString * reason)
+{
+    QString error;
+    bool ok = false;
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        error = file.errorString();
+    } else {
+        QDataStream in(&file);
+        in.setVersion(QDataStream::Qt_4_6);
+        in.setByteOrder(QDataStream::LittleEndian);
+
+        quint32 magicnum, machid, sessid;
+        quint16 version, type, compmethod = 0, machtype, crc16 = 0;
+        qint64 first, last;
+        qint32 datasize = 0;
+
+        in >> magicnum >> version >> type >> machid >> sessid >> first >> last;
+        if (version >= 10) {
+            in >> compmethod >> machtype >> datasize >> crc16;
+        }
+
+        if (in.status() != QDataStream::Ok) {
+            error = QObject::tr("Truncated header");
+        } else if (magicnum != magic) {
+            error = QObject::tr("Wrong magic number");
+        } else if (type != filetype) {
+            error = QObject::tr("Wrong file type");
+        } else if (version < 6) {
+            error = QObject::tr("Unsupported version %1").arg(version);
+        } else if (version < 10) {
+            // No size or checksum to check in these
+            ok = true;
+        } else {
+            QByteArray data = file.readAll();
+            if (compmethod > 0) {
+                data = qUncompress(data);
+            }
+            if (data.size() != datasize) {
+                error = QObject::tr("Wrong data size");
+            } else if ((compmethod > 0) && (CRC16X25(data.constData(), data.size()) != crc16)) {
+                error = QObject::tr("Checksum mismatch");
+            } else {
+                ok = true;
+            }
+        }
+    }
+
+    if (reason) {
+        *reason = error;
+    }
+    return ok;
+}
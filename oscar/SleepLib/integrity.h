@@ -0,0 +1,117 @@
+/* SleepLib Data Integrity Scanner Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef INTEGRITY_H
+#define INTEGRITY_H
+
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QRunnable>
+
+#include "SleepLib/machine_common.h"
+#include "SleepLib/progresstracker.h"
+
+class Machine;
+class Session;
+class ProgressDialog;
+
+/*! \struct IntegrityIssue
+    \brief A problem found with one of a Machine's data files
+    */
+struct IntegrityIssue
+{
+    enum Kind {
+        Corrupt,        //!< Unreadable header, wrong size or failed checksum
+        Orphaned,       //!< Events or overlay file with no summary to go with it
+        MissingEvents   //!< Summary says there are events, but the events file is gone
+    };
+
+    IntegrityIssue(Kind kind = Corrupt, const QString & filename = QString(), const QString & reason = QString())
+        : kind(kind), filename(filename), reason(reason) {}
+
+    Kind kind;
+    QString filename;
+    QString reason;
+};
+
+class IntegrityScanner;
+
+/*! \class IntegrityTask
+    \brief Checks one data file for an IntegrityScanner on the thread pool
+    */
+class IntegrityTask:public QRunnable
+{
+public:
+    IntegrityTask(IntegrityScanner * scanner, int index): scanner(scanner), index(index) {}
+    virtual ~IntegrityTask() {}
+    virtual void run();
+
+protected:
+    IntegrityScanner * scanner;
+    int index;
+};
+
+/*! \class IntegrityScanner
+    \brief Validates a Machine's summary, events and overlay files on all cores
+
+    Summaries are checked by loading them into fresh Sessions, exactly as the summary index
+    rebuild does, so the same scan can hand its valid Sessions straight to rebuild().
+    Events files are checked for magic number, file type, version, uncompressed size and CRC
+    without building any EventLists.
+    */
+class IntegrityScanner
+{
+    friend class IntegrityTask;
+  public:
+    explicit IntegrityScanner(Machine * mach);
+    virtual ~IntegrityScanner();
+
+    /*! \brief Checks every summary file, and every events and overlay file as well if events is set.
+        Blocks until done, with progress (if any) polling how far it has got. */
+    void scan(bool events, ProgressDialog * progress = nullptr);
+
+    /*! \brief Adds the sessions with valid summaries to the machine and rewrites its summary index.
+        Call after scan(). */
+    bool rebuild();
+
+    const QList<IntegrityIssue> & issues() const { return m_issues; }
+    int filesChecked() const { return m_entries.size(); }
+
+    //! \brief Returns a one line description of each issue found
+    QStringList report() const;
+
+    //! \brief Validates the header, size and checksum of an events or overlay file
+    static bool checkEvents(const QString & filename, quint16 filetype, QString * reason = nullptr);
+
+  protected:
+    struct Entry {
+        Entry() : id(0), filetype(0), session(nullptr), ok(false) {}
+        QString filename;
+        SessionID id;
+        quint16 filetype;
+        Session * session;
+        bool ok;
+        QString reason;
+    };
+
+    //! \brief Adds an entry for each file in path matching filter
+    void addFiles(const QString & path, const QString & filter, quint16 filetype);
+
+    //! \brief Called from the thread pool, only touches its own entry
+    void check(int index);
+
+    Machine * m_machine;
+    QVector<Entry> m_entries;
+    QList<IntegrityIssue> m_issues;
+
+    //! \brief Counts the files checked, advanced by the pool threads
+    ProgressTracker m_progress;
+};
+
+#endif // INTEGRITY_H
@@ -0,0 +1,362 @@
+/* SleepLib Latest Nights Summary Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "latestnights.h"
+#include "profiles.h"
+#include "machine.h"
+#include "session.h"
+#include "day.h"
+
+const quint16 latestnights_version = 2;
+
+void LatestNights::clear()
+{
+    valid = false;
+    cpapDate = oxiDate = QDate();
+    dayCount = sessionCount = enabledCount = 0;
+    complianceHours = percentile = 0;
+    rdi = false;
+
+    hasCPAP = false;
+    machineName.clear();
+    pixmapPath.clear();
+    hours = ahi = ahiAverage = leak = leakAverage = 0;
+    mode = 0;
+    pressure = epap = 0;
+    pressureUnits.clear();
+    epapUnits.clear();
+    leakUnits.clear();
+}
+
+QString LatestNights::fileName()
+{
+    return p_profile->Get("{" + STR_GEN_DataFolder + "}/LatestNights.cache");
+}
+
+void LatestNights::sign(Profile * profile)
+{
+    cpapDate = profile->LastDay(MT_CPAP);
+    oxiDate = profile->LastDay(MT_OXIMETER);
+    dayCount = profile->daylist.size();
+
+    // Toggling a session changes the figures without adding or removing any days
+    sessionCount = enabledCount = 0;
+    if (cpapDate.isValid()) {
+        auto it = profile->daylist.lowerBound(cpapDate.addDays(-averageDays));
+        auto it_end = profile->daylist.upperBound(cpapDate);
+        for (; it != it_end; ++it) {
+            for (Session * sess : it.value()->getSessions(MT_CPAP, true)) {
+                ++sessionCount;
+                if (sess->enabled()) {
+                    ++enabledCount;
+                }
+            }
+        }
+    }
+
+    complianceHours = profile->cpap->complianceHours();
+    percentile = profile->general->prefCalcPercentile();
+    rdi = profile->general->calculateRDI();
+}
+
+bool LatestNights::matches(Profile * profile) const
+{
+    if (!valid) {
+        return false;
+    }
+    LatestNights current;
+    current.sign(profile);
+
+    return (current.cpapDate == cpapDate) && (current.oxiDate == oxiDate)
+        && (current.dayCount == dayCount) && (current.sessionCount == sessionCount)
+        && (current.enabledCount == enabledCount)
+        && qFuzzyCompare(1 + current.complianceHours, 1 + complianceHours)
+        && qFuzzyCompare(1 + current.percentile, 1 + percentile)
+        && (current.rdi == rdi);
+}
+
+void LatestNights::calculate(const QMap<QDate, Day *> & days)
+{
+    Day * day = days.value(cpapDate, nullptr);
+
+    if (hasCPAP && day) {
+        hours = day->hours(MT_CPAP);
+
+        QDate starttime = cpapDate.addDays(-averageDays);
+        QDate endtime = cpapDate.addDays(-1);
+
+        ahi = (day->count(CPAP_Obstructive) + day->count(CPAP_Hypopnea) + day->count(CPAP_ClearAirway) + day->count(CPAP_Apnea)) / hours;
+
+        // Same as calcAHI() and Profile::calcWavg(), over the days with enabled CPAP sessions
+        double events = 0, ahihours = 0, leaksum = 0, leakhours = 0;
+        for (auto it = days.lowerBound(starttime), it_end = days.upperBound(endtime); it != it_end; ++it) {
+            Day * d = it.value();
+            if (!d->hasEnabledSessions(MT_CPAP)) {
+                continue;
+            }
+            events += d->count(CPAP_Obstructive) + d->count(CPAP_Hypopnea) + d->count(CPAP_ClearAirway) + d->count(CPAP_Apnea);
+            if (rdi) {
+                events += d->count(CPAP_RERA);
+            }
+            ahihours += d->hours(MT_CPAP);
+
+            if (!d->summaryOnly() || d->hasData(CPAP_Leak, ST_WAVG)) {
+                EventDataType h = d->hours();
+                leaksum += d->wavg(CPAP_Leak) * h;
+                leakhours += h;
+            }
+        }
+        ahiAverage = (ahihours > 0) ? (events / ahihours) : 0;
+
+        CPAPMode cpapmode = (CPAPMode)(int)day->settings_max(CPAP_Mode);
+        ChannelID pressChanID = day->getPressureChannelID();     // Get channel id for pressure that we should report
+        double perc = percentile;
+        mode = cpapmode;
+
+        // When CPAP_PressureSet and CPAP_IPAPSet have data (used for percentiles, etc.)
+        // CPAP_Pressure and CPAP_IPAP are their corresponding settings channels.
+        ChannelID pressSettingChanID;
+        if (pressChanID == CPAP_PressureSet) {
+            pressSettingChanID = CPAP_Pressure;
+        } else if (pressChanID == CPAP_IPAPSet) {
+            pressSettingChanID = CPAP_IPAP;
+        } else {
+            pressSettingChanID = pressChanID;
+        }
+
+        ChannelID epapDataChanID = CPAP_EPAP;
+        if (day->channelHasData(CPAP_EPAPSet)) {
+            epapDataChanID = CPAP_EPAPSet;
+        }
+
+        if (pressChanID == NoChannel) {
+            qWarning() << "Unable to find pressure channel for welcome summary!";
+        }
+        pressureUnits = schema::channel[pressChanID].units();
+        epapUnits = schema::channel[epapDataChanID].units();
+
+        if (cpapmode == MODE_CPAP) {
+            pressSettingChanID = CPAP_Pressure;  // DreamStation ventilators report EPAP/IPAP data, but the setting is Pressure
+            pressure = day->settings_max(pressSettingChanID);
+            qDebug() << pressSettingChanID << pressure;
+        } else if (cpapmode == MODE_APAP) {
+            pressure = day->percentile(pressChanID, perc/100.0);
+        } else if (cpapmode == MODE_BILEVEL_FIXED) {
+            epap = day->settings_min(CPAP_EPAP);
+            pressure = day->settings_max(CPAP_IPAP);
+            pressureUnits = schema::channel[CPAP_IPAP].units();
+        } else if (cpapmode == MODE_BILEVEL_AUTO_FIXED_PS) {
+            pressure = day->percentile(pressChanID, perc/100.0);
+            epap = day->percentile(epapDataChanID, perc/100.0);
+        } else if (cpapmode == MODE_ASV || cpapmode == MODE_AVAPS){
+            pressure = day->percentile(pressChanID, perc/100.0);
+            epap = qRound(day->settings_wavg(CPAP_EPAP));
+        } else if (cpapmode == MODE_ASV_VARIABLE_EPAP || cpapmode == MODE_BILEVEL_AUTO_VARIABLE_PS){
+            pressure = day->percentile(pressChanID, perc/100.0);
+            epap = day->percentile(epapDataChanID, perc/100.0);
+        }
+
+        leak = day->wavg(CPAP_Leak);
+        leakAverage = (leakhours > 0) ? (leaksum / leakhours) : 0;
+        leakUnits = schema::channel[CPAP_Leak].units();
+    }
+    valid = true;
+}
+
+bool LatestNights::save(const QString & filename) const
+{
+    // Written aside and renamed over, so a crash mid-write can't leave a half written cache behind
+    QSaveFile file(filename);
+    if (!file.open(QFile::WriteOnly)) {
+        qWarning() << "Could not open" << filename << "for writing, error code" << file.error() << file.errorString();
+        return false;
+    }
+    QDataStream out(&file);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out.setVersion(QDataStream::Qt_5_0);
+
+    out << magic;
+    out << latestnights_version;
+
+    out << cpapDate << oxiDate << dayCount << sessionCount << enabledCount << complianceHours << percentile << rdi;
+    out << hasCPAP << machineName << pixmapPath;
+    out << hours << ahi << ahiAverage << leak << leakAverage;
+    out << mode << pressure << epap << pressureUnits << epapUnits << leakUnits;
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+    }
+    return file.commit();
+}
+
+bool LatestNights::load(const QString & filename)
+{
+    clear();
+
+    QFile file(filename);
+    if (!file.open(QFile::ReadOnly)) {
+        return false;
+    }
+    QDataStream in(&file);
+    in.setByteOrder(QDataStream::LittleEndian);
+    in.setVersion(QDataStream::Qt_5_0);
+
+    quint32 mag32;
+    quint16 version;
+    in >> mag32;
+    in >> version;
+    if ((mag32 != magic) || (version != latestnights_version)) {
+        return false;
+    }
+
+    in >> cpapDate >> oxiDate >> dayCount >> sessionCount >> enabledCount >> complianceHours >> percentile >> rdi;
+    in >> hasCPAP >> machineName >> pixmapPath;
+    in >> hours >> ahi >> ahiAverage >> leak >> leakAverage;
+    in >> mode >> pressure >> epap >> pressureUnits >> epapUnits >> leakUnits;
+
+    if (in.status() != QDataStream::Ok) {
+        qDebug() << "Truncated latest nights cache" << filename;
+        clear();
+        return false;
+    }
+    valid = true;
+    return true;
+}
+
+Day * LatestNightsTask::loadDay(const NightSessions & sessions)
+{
+    Day * day = nullptr;
+    for (const auto & s : sessions) {
+        QMutexLocker lock(&s.first->saveMutex);
+        Session * copy = new Session(s.first, s.second);
+        if (!copy->LoadSummary() || (copy->first() == 0)) {
+            delete copy;
+            continue;
+        }
+        if (!day) {
+            day = new Day();
+        }
+        day->addSession(copy); // the Day deletes its sessions
+    }
+    return day;
+}
+
+void LatestNightsTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+    QMap<QDate, Day *> days;
+    for (auto it = nights.constBegin(), it_end = nights.constEnd(); it != it_end; ++it) {
+        if (calc->m_cancelled.load() != 0) {
+            break;
+        }
+        Day * day = loadDay(it.value());
+        if (day) {
+            days.insert(it.key(), day);
+        }
+    }
+
+    if (calc->m_cancelled.load() == 0) {
+        LatestNights result = signature;
+        result.calculate(days);
+        calc->finished(serial, result);
+    }
+    qDeleteAll(days);
+    QMetaObject::invokeMethod(calc, "taskDone", Qt::QueuedConnection);
+}
+
+LatestNightsCalculator::LatestNightsCalculator()
+    : m_serial(0)
+{
+    // Only the newest calculation matters, so there's no point in running two at once
+    m_pool.setMaxThreadCount(1);
+}
+
+LatestNightsCalculator::~LatestNightsCalculator()
+{
+    clear();
+}
+
+void LatestNightsCalculator::start(Profile * profile)
+{
+    LatestNights signature;
+    signature.sign(profile);
+
+    QMap<QDate, NightSessions> nights;
+    if (signature.cpapDate.isValid()) {
+        auto it = profile->daylist.lowerBound(signature.cpapDate.addDays(-LatestNights::averageDays));
+        auto it_end = profile->daylist.upperBound(signature.cpapDate);
+        for (; it != it_end; ++it) {
+            NightSessions & sessions = nights[it.key()];
+            for (Session * sess : it.value()->sessions) {
+                if (sess->type() != MT_JOURNAL) {
+                    sessions.append(qMakePair(sess->machine(), sess->session()));
+                }
+            }
+        }
+
+        Day * day = profile->FindDay(signature.cpapDate, MT_CPAP);
+        Machine * cpap = day ? day->machine(MT_CPAP) : nullptr;
+        if (cpap != nullptr) {
+            signature.hasCPAP = true;
+            signature.machineName = cpap->brand()+" "+cpap->model();
+            signature.pixmapPath = cpap->getPixmapPath();
+        }
+    }
+
+    // Anything still waiting to run is already out of date
+    m_pool.clear();
+    m_pool.start(new LatestNightsTask(this, signature, nights, ++m_serial));
+}
+
+void LatestNightsCalculator::clear()
+{
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+    m_cancelled.store(0);
+
+    {
+        QMutexLocker lock(&m_mutex);
+        m_results.clear();
+    }
+    ++m_serial;
+}
+
+void LatestNightsCalculator::finished(int serial, const LatestNights & result)
+{
+    QMutexLocker lock(&m_mutex);
+    m_results.append(qMakePair(serial, result));
+}
+
+void LatestNightsCalculator::taskDone()
+{
+    QList<QPair<int, LatestNights> > results;
+    {
+        QMutexLocker lock(&m_mutex);
+        results.swap(m_results);
+    }
+
+    bool updated = false;
+    for (const auto & result : results) {
+        if (result.first == m_serial) {
+            m_result = result.second;
+            updated = true;
+        }
+    }
+    if (updated) {
+        emit calculated();
+    }
+}
@@ -0,0 +1,162 @@
+/* SleepLib Latest Nights Summary Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef LATESTNIGHTS_H
+#define LATESTNIGHTS_H
+
+#include <QObject>
+#include <QDate>
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+
+class Profile;
+class Machine;
+class Day;
+class LatestNightsCalculator;
+
+/*! \struct LatestNights
+    \brief The figures shown on the Welcome page, persisted in the profile data folder
+
+    Working these out means opening the last CPAP day and a week of summaries, so they are
+    stored with a signature of the profile state they were calculated from. As long as the
+    signature still matches, the Welcome page can be painted straight from the cache file.
+    */
+struct LatestNights
+{
+    LatestNights() { clear(); }
+
+    static const int averageDays = 7;
+
+    void clear();
+
+    inline bool isValid() const { return valid; }
+
+    //! \brief Fills in the signature fields from the current state of profile
+    void sign(Profile * profile);
+
+    //! \brief Returns true if this record was calculated from profile as it is now
+    bool matches(Profile * profile) const;
+
+    //! \brief Works out the figures from days, which hold the last CPAP date and the averageDays before it
+    void calculate(const QMap<QDate, Day *> & days);
+
+    bool load(const QString & filename);
+    bool save(const QString & filename) const;
+
+    //! \brief Location of the cache file for the current profile
+    static QString fileName();
+
+    bool valid;
+
+    // Signature
+    QDate cpapDate;
+    QDate oxiDate;
+    qint32 dayCount;
+    //! \brief CPAP sessions, and how many of them are enabled, over the days the figures cover
+    qint32 sessionCount;
+    qint32 enabledCount;
+    EventDataType complianceHours;
+    EventDataType percentile;
+    bool rdi;
+
+    // Last CPAP night
+    bool hasCPAP;
+    QString machineName;
+    QString pixmapPath;
+    EventDataType hours;
+    EventDataType ahi;
+    EventDataType ahiAverage;
+    EventDataType leak;
+    EventDataType leakAverage;
+    qint32 mode;
+    EventDataType pressure;
+    EventDataType epap;
+    QString pressureUnits;
+    QString epapUnits;
+    QString leakUnits;
+};
+
+//! \brief The sessions of one date, gathered on the GUI thread
+typedef QList<QPair<Machine *, SessionID> > NightSessions;
+
+/*! \class LatestNightsTask
+    \brief Works out the Welcome page figures on a background thread
+
+    The summaries are read into private Session copies, gathered into Days of the task's own,
+    so nothing the GUI thread uses is touched.
+    */
+class LatestNightsTask:public QRunnable
+{
+public:
+    LatestNightsTask(LatestNightsCalculator * calc, const LatestNights & signature, const QMap<QDate, NightSessions> & nights, int serial)
+        : calc(calc), signature(signature), nights(nights), serial(serial) {}
+    virtual ~LatestNightsTask() {}
+    virtual void run();
+
+protected:
+    //! \brief Returns a private Day made of copies of sessions, or nullptr if none of them could be read
+    Day * loadDay(const NightSessions & sessions);
+
+    LatestNightsCalculator * calc;
+    LatestNights signature;
+    QMap<QDate, NightSessions> nights;
+    int serial;
+};
+
+/*! \class LatestNightsCalculator
+    \brief Runs the LatestNightsTask for the Welcome page, and hands the figures back on the GUI thread
+
+    Only the newest calculation counts, so starting another one makes any still under way irrelevant.
+    */
+class LatestNightsCalculator:public QObject
+{
+    Q_OBJECT
+    friend class LatestNightsTask;
+  public:
+    LatestNightsCalculator();
+    virtual ~LatestNightsCalculator();
+
+    //! \brief Starts working out the figures for profile as it is now
+    void start(Profile * profile);
+
+    //! \brief Cancels any calculation under way, eg before the profile's machines are unloaded
+    void clear();
+
+    //! \brief The figures announced by the last calculated()
+    inline const LatestNights & result() const { return m_result; }
+
+  signals:
+    //! \brief result() holds the figures of the newest calculation
+    void calculated();
+
+  protected slots:
+    void taskDone();
+
+  protected:
+    //! \brief Called from the pool thread with the figures of a calculation
+    void finished(int serial, const LatestNights & result);
+
+    QThreadPool m_pool;
+    QAtomicInt m_cancelled;
+    int m_serial;
+
+    QMutex m_mutex;
+    QList<QPair<int, LatestNights> > m_results;
+
+    LatestNights m_result;
+};
+
+#endif // LATESTNIGHTS_H
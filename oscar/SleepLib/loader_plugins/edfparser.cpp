@@ -12,6 +12,7 @@
 #include <QDebug>
 #include <QFile>
 #include <QMutexLocker>
+#include <limits>
 #ifdef _MSC_VER
 #include <QtZlib/zlib.h>
 #else
@@ -19,6 +20,7 @@
 #endif
 
 #include "edfparser.h"
+#include "SleepLib/gzipdevice.h"
 
 //EDFSignal::~EDFSignal()
 //{
@@ -38,6 +40,7 @@ EDFInfo::EDFInfo()
 
     int EDFInfo::TZ_offset = QTimeZone::systemTimeZone().offsetFromUtc(QDateTime::currentDateTime());
     QTimeZone EDFInfo::localNoDST = QTimeZone(TZ_offset);
+    LocalTime EDFInfo::localNoDSTTable = LocalTime(TZ_offset);
 
 EDFInfo::~EDFInfo()
 {
@@ -58,6 +61,28 @@ EDFInfo::~EDFInfo()
 //    	delete  a;
 }
 
+// Inflates a whole .gz file straight into a buffer presized from its gzip trailer
+static QByteArray readGzipFile(QFile & fi)
+{
+    QByteArray data;
+    qint64 size = GzipDevice::presize(GzipDevice::trailerSize(&fi), fi.size());
+
+    GzipDevice gz(&fi);
+    if (!gz.open(QFile::ReadOnly)) {
+        return data;
+    }
+    // The presize is capped, so a lying trailer can't make us allocate gigabytes up front
+    if ((size > 0) && (size < std::numeric_limits<int>::max())) {
+        data.resize(int(size));
+        qint64 n = gz.read(data.data(), size);
+        data.resize(int(qMax(n, qint64(0))));
+    }
+    // ISIZE is modulo 2^32, and might be missing, so pick up anything left over
+    data.append(gz.readAll());
+    gz.close();
+    return data;
+}
+
 bool EDFInfo::Open(const QString & name)
 {
     if (hdrPtr != nullptr) {
@@ -72,7 +97,7 @@ bool EDFInfo::Open(const QString & name)
 //    fileData = new QByteArray();
 #ifndef DUMPSTR
     if (name.endsWith(STR_ext_gz)) {
-        fileData = gUncompress(fi.readAll()); // Open and decompress file
+        fileData = readGzipFile(fi); // Open and decompress file
     } else {
         fileData = fi.readAll(); // Open and read uncompressed file
     }
@@ -93,14 +118,23 @@ bool EDFInfo::Open(const QString & name)
 QDateTime EDFInfo::getStartDT( QString dateTimeStr )
 {
 //  edfHdr.startdate_orig = QDateTime::fromString(QString::fromLatin1(hdrPtr->datetime, 16), "dd.MM.yyHH.mm.ss");
-//  QString dateTimeStr;    // , dateStr, timeStr;
+//  Parsed by hand, as QDate/QTime::fromString were a noticeable part of scanning a large SD card.
+//  Two digit years are 19yy, the same as fromString, and callers move them on a century.
+    int day = LocalTime::parseDigits(dateTimeStr, 0, 2);
+    int month = LocalTime::parseDigits(dateTimeStr, 3, 2);
+    int year = LocalTime::parseDigits(dateTimeStr, 6, 2);
+    int hour = LocalTime::parseDigits(dateTimeStr, 8, 2);
+    int minute = LocalTime::parseDigits(dateTimeStr, 11, 2);
+    int second = LocalTime::parseDigits(dateTimeStr, 14, 2);
+
     QDate qDate;
     QTime qTime;
-//  dateTimeStr = QString::fromLatin1(hdrPtr->datetime, 16);
-//    dateStr = dateTimeStr.left(8);
-//    timeStr = dateTimeStr.right(8);
-    qDate = QDate::fromString(dateTimeStr.left(8), "dd.MM.yy");
-    qTime = QTime::fromString(dateTimeStr.right(8), "HH.mm.ss");
+    if ((day >= 0) && (month >= 0) && (year >= 0)) {
+        qDate = QDate(1900 + year, month, day);
+    }
+    if ((hour >= 0) && (minute >= 0) && (second >= 0)) {
+        qTime = QTime(hour, minute, second);
+    }
     return QDateTime(qDate, qTime, localNoDST);
 }
 
@@ -298,7 +332,11 @@ EDFHeaderQT * EDFInfo::GetHeader( const QString & name)
 //    fileData = new QByteArray();
 #ifndef DUMPSTR
     if (name.endsWith(STR_ext_gz)) {
-        fileData = gUncompress(fi.read(sizeof(EDFHeaderRaw))); // Open and decompress file
+        GzipDevice gz(&fi);
+        if (gz.open(QFile::ReadOnly)) {
+            fileData = gz.read(sizeof(EDFHeaderRaw)); // Decompress just the header
+            gz.close();
+        }
     } else {
         fileData = fi.read(sizeof(EDFHeaderRaw)); // Open and read uncompressed file
     }
@@ -18,6 +18,7 @@
 #include <QTimeZone>
 
 #include "SleepLib/common.h"
+#include "SleepLib/localtime.h"
 
 const QString STR_ext_EDF = "edf";
 const QString STR_ext_gz = ".gz";
@@ -146,6 +147,7 @@ class EDFInfo
 
     static int  TZ_offset;
     static QTimeZone localNoDST;
+    static LocalTime localNoDSTTable;                               //! \brief localNoDST as a LocalTime, for converting many timestamps
 
     QString filename;								//!	\brief For debug and error messages
 
@@ -192,7 +192,7 @@ int FPIconLoader::OpenMachine(Machine *mach, const QString & path)
 
     QString filename, fpath;
 
-    emit setProgressValue(0);
+    m_progress.setValue(0);
 
     QStringList summary, log, flw, det;
     Sessions.clear();
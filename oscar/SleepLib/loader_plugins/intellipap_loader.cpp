@@ -240,7 +240,7 @@ int IntellipapLoader::OpenDV5(const QString & path)
     }
 
     if (!info.serial.isEmpty()) {
-        mach = p_profile->CreateMachine(info);
+        mach = createMachine(info);
     }
 
     if (!mach) {
@@ -583,7 +583,7 @@ int IntellipapLoader::OpenDV5(const QString & path)
     }
 
     finishAddingSessions();
-    mach->Save();
+    saveMachine(mach);
 
 
     delete [] m_buffer;
@@ -2342,18 +2342,16 @@ bool load6EventData () {
 // Finalize data and add to database
 ////////////////////////////////////////////////////////////////////////////////////////
 
-int addSessions() {
+int addSessions(MachineLoader * loader) {
 
     for (auto si=SessionData.begin(), end=SessionData.end(); si != end; ++si) {
         Session * sess = si.value().sess;
 
         if (sess) {
-            if ( ! mach->AddSession(sess) ) {
-                qWarning() << "Session" << sess->session() << "was not addded";
-            }
+            // Added to the machine by finishAddingSessions(), on the GUI thread
+            loader->addSession(sess);
 #ifdef DEBUG6
-            else
-                qDebug() << "Added session" << sess->session()  << QDateTime::fromTime_t(sess->session()).toString("MM/dd/yyyy hh:mm:ss");;
+            qDebug() << "Added session" << sess->session()  << QDateTime::fromTime_t(sess->session()).toString("MM/dd/yyyy hh:mm:ss");;
 #endif
 
             // Update indexes, process waveform and perform flagging
@@ -2445,8 +2443,7 @@ bool backup6 (const QString & path)  {
 
 bool init6Environment (const QString & path) {
 
-    // Create Machine database record if it doesn't exist already
-    mach = p_profile->CreateMachine(info);
+    // The Machine database record is created by OpenDV6
     if (mach == nullptr) {
         qWarning() << "Could not create DV6 Machine data structure";
         return false;
@@ -2486,7 +2483,8 @@ int IntellipapLoader::OpenDV6(const QString & path)
     if (!load6VersionInfo(card_path))
         return -1;
 
-    // 3. Initialize rest of the DV6 loader environment
+    // 3. Create Machine database record if it doesn't exist already, and initialize rest of the DV6 loader environment
+    mach = createMachine(info);
     if (!init6Environment (path))
         return -1;
 
@@ -2524,7 +2522,9 @@ int IntellipapLoader::OpenDV6(const QString & path)
         return -1;
 
     // Finalize input
-    return addSessions();
+    int c = addSessions(this);
+    finishAddingSessions();
+    return c;
 }
 
 int IntellipapLoader::Open(const QString & dirpath)
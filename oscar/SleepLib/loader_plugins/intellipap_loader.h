@@ -56,6 +56,9 @@ class IntellipapLoader : public CPAPLoader
 
     //! \brief Scans path for Intellipap data signature, and Loads any new data
     virtual int Open(const QString & path);
+
+    virtual bool canImportInBackground() { return true; }
+
     //! \brief Scans path for Intellipap DV5 data signature, and Loads any new data
     virtual int OpenDV5(const QString & path);
     //! \brief Scans path for Intellipap DV6 data signature, and Loads any new data
@@ -21,6 +21,7 @@
 #include "prs1_loader.h"
 #include "SleepLib/session.h"
 #include "SleepLib/calcs.h"
+#include "SleepLib/crc.h"
 
 
 // Disable this to cut excess debug messages
@@ -45,149 +46,10 @@ const int PRS1_HTYPE_INTERVAL=1;
 //********************************************************************************************
 
 
-// CRC-16/KERMIT, polynomial: 0x11021, bit reverse algorithm
-// Table generated by crcmod (crc-kermit)
-
-typedef quint16 crc16_t;
-static crc16_t CRC16(unsigned char * data, size_t data_len, crc16_t crc=0)
-{
-    static const crc16_t table[256] = {
-    0x0000U, 0x1189U, 0x2312U, 0x329bU, 0x4624U, 0x57adU, 0x6536U, 0x74bfU,
-    0x8c48U, 0x9dc1U, 0xaf5aU, 0xbed3U, 0xca6cU, 0xdbe5U, 0xe97eU, 0xf8f7U,
-    0x1081U, 0x0108U, 0x3393U, 0x221aU, 0x56a5U, 0x472cU, 0x75b7U, 0x643eU,
-    0x9cc9U, 0x8d40U, 0xbfdbU, 0xae52U, 0xdaedU, 0xcb64U, 0xf9ffU, 0xe876U,
-    0x2102U, 0x308bU, 0x0210U, 0x1399U, 0x6726U, 0x76afU, 0x4434U, 0x55bdU,
-    0xad4aU, 0xbcc3U, 0x8e58U, 0x9fd1U, 0xeb6eU, 0xfae7U, 0xc87cU, 0xd9f5U,
-    0x3183U, 0x200aU, 0x1291U, 0x0318U, 0x77a7U, 0x662eU, 0x54b5U, 0x453cU,
-    0xbdcbU, 0xac42U, 0x9ed9U, 0x8f50U, 0xfbefU, 0xea66U, 0xd8fdU, 0xc974U,
-    0x4204U, 0x538dU, 0x6116U, 0x709fU, 0x0420U, 0x15a9U, 0x2732U, 0x36bbU,
-    0xce4cU, 0xdfc5U, 0xed5eU, 0xfcd7U, 0x8868U, 0x99e1U, 0xab7aU, 0xbaf3U,
-    0x5285U, 0x430cU, 0x7197U, 0x601eU, 0x14a1U, 0x0528U, 0x37b3U, 0x263aU,
-    0xdecdU, 0xcf44U, 0xfddfU, 0xec56U, 0x98e9U, 0x8960U, 0xbbfbU, 0xaa72U,
-    0x6306U, 0x728fU, 0x4014U, 0x519dU, 0x2522U, 0x34abU, 0x0630U, 0x17b9U,
-    0xef4eU, 0xfec7U, 0xcc5cU, 0xddd5U, 0xa96aU, 0xb8e3U, 0x8a78U, 0x9bf1U,
-    0x7387U, 0x620eU, 0x5095U, 0x411cU, 0x35a3U, 0x242aU, 0x16b1U, 0x0738U,
-    0xffcfU, 0xee46U, 0xdcddU, 0xcd54U, 0xb9ebU, 0xa862U, 0x9af9U, 0x8b70U,
-    0x8408U, 0x9581U, 0xa71aU, 0xb693U, 0xc22cU, 0xd3a5U, 0xe13eU, 0xf0b7U,
-    0x0840U, 0x19c9U, 0x2b52U, 0x3adbU, 0x4e64U, 0x5fedU, 0x6d76U, 0x7cffU,
-    0x9489U, 0x8500U, 0xb79bU, 0xa612U, 0xd2adU, 0xc324U, 0xf1bfU, 0xe036U,
-    0x18c1U, 0x0948U, 0x3bd3U, 0x2a5aU, 0x5ee5U, 0x4f6cU, 0x7df7U, 0x6c7eU,
-    0xa50aU, 0xb483U, 0x8618U, 0x9791U, 0xe32eU, 0xf2a7U, 0xc03cU, 0xd1b5U,
-    0x2942U, 0x38cbU, 0x0a50U, 0x1bd9U, 0x6f66U, 0x7eefU, 0x4c74U, 0x5dfdU,
-    0xb58bU, 0xa402U, 0x9699U, 0x8710U, 0xf3afU, 0xe226U, 0xd0bdU, 0xc134U,
-    0x39c3U, 0x284aU, 0x1ad1U, 0x0b58U, 0x7fe7U, 0x6e6eU, 0x5cf5U, 0x4d7cU,
-    0xc60cU, 0xd785U, 0xe51eU, 0xf497U, 0x8028U, 0x91a1U, 0xa33aU, 0xb2b3U,
-    0x4a44U, 0x5bcdU, 0x6956U, 0x78dfU, 0x0c60U, 0x1de9U, 0x2f72U, 0x3efbU,
-    0xd68dU, 0xc704U, 0xf59fU, 0xe416U, 0x90a9U, 0x8120U, 0xb3bbU, 0xa232U,
-    0x5ac5U, 0x4b4cU, 0x79d7U, 0x685eU, 0x1ce1U, 0x0d68U, 0x3ff3U, 0x2e7aU,
-    0xe70eU, 0xf687U, 0xc41cU, 0xd595U, 0xa12aU, 0xb0a3U, 0x8238U, 0x93b1U,
-    0x6b46U, 0x7acfU, 0x4854U, 0x59ddU, 0x2d62U, 0x3cebU, 0x0e70U, 0x1ff9U,
-    0xf78fU, 0xe606U, 0xd49dU, 0xc514U, 0xb1abU, 0xa022U, 0x92b9U, 0x8330U,
-    0x7bc7U, 0x6a4eU, 0x58d5U, 0x495cU, 0x3de3U, 0x2c6aU, 0x1ef1U, 0x0f78U,
-    };
-
-    for (size_t i=0; i < data_len; i++) {
-        crc = table[(*data ^ (unsigned char)crc) & 0xFF] ^ (crc >> 8);
-        data++;
-    }
-    return crc;
-}
-
-
-// CRC-32/MPEG-2, polynomial: 0x104C11DB7
-// Table generated by crcmod (crc-32-mpeg)
-
-typedef quint32 crc32_t;
-static crc32_t CRC32(const unsigned char *data, size_t data_len, crc32_t crc=0xffffffffU)
-{
-    static const crc32_t table[256] = {
-    0x00000000U, 0x04c11db7U, 0x09823b6eU, 0x0d4326d9U,
-    0x130476dcU, 0x17c56b6bU, 0x1a864db2U, 0x1e475005U,
-    0x2608edb8U, 0x22c9f00fU, 0x2f8ad6d6U, 0x2b4bcb61U,
-    0x350c9b64U, 0x31cd86d3U, 0x3c8ea00aU, 0x384fbdbdU,
-    0x4c11db70U, 0x48d0c6c7U, 0x4593e01eU, 0x4152fda9U,
-    0x5f15adacU, 0x5bd4b01bU, 0x569796c2U, 0x52568b75U,
-    0x6a1936c8U, 0x6ed82b7fU, 0x639b0da6U, 0x675a1011U,
-    0x791d4014U, 0x7ddc5da3U, 0x709f7b7aU, 0x745e66cdU,
-    0x9823b6e0U, 0x9ce2ab57U, 0x91a18d8eU, 0x95609039U,
-    0x8b27c03cU, 0x8fe6dd8bU, 0x82a5fb52U, 0x8664e6e5U,
-    0xbe2b5b58U, 0xbaea46efU, 0xb7a96036U, 0xb3687d81U,
-    0xad2f2d84U, 0xa9ee3033U, 0xa4ad16eaU, 0xa06c0b5dU,
-    0xd4326d90U, 0xd0f37027U, 0xddb056feU, 0xd9714b49U,
-    0xc7361b4cU, 0xc3f706fbU, 0xceb42022U, 0xca753d95U,
-    0xf23a8028U, 0xf6fb9d9fU, 0xfbb8bb46U, 0xff79a6f1U,
-    0xe13ef6f4U, 0xe5ffeb43U, 0xe8bccd9aU, 0xec7dd02dU,
-    0x34867077U, 0x30476dc0U, 0x3d044b19U, 0x39c556aeU,
-    0x278206abU, 0x23431b1cU, 0x2e003dc5U, 0x2ac12072U,
-    0x128e9dcfU, 0x164f8078U, 0x1b0ca6a1U, 0x1fcdbb16U,
-    0x018aeb13U, 0x054bf6a4U, 0x0808d07dU, 0x0cc9cdcaU,
-    0x7897ab07U, 0x7c56b6b0U, 0x71159069U, 0x75d48ddeU,
-    0x6b93dddbU, 0x6f52c06cU, 0x6211e6b5U, 0x66d0fb02U,
-    0x5e9f46bfU, 0x5a5e5b08U, 0x571d7dd1U, 0x53dc6066U,
-    0x4d9b3063U, 0x495a2dd4U, 0x44190b0dU, 0x40d816baU,
-    0xaca5c697U, 0xa864db20U, 0xa527fdf9U, 0xa1e6e04eU,
-    0xbfa1b04bU, 0xbb60adfcU, 0xb6238b25U, 0xb2e29692U,
-    0x8aad2b2fU, 0x8e6c3698U, 0x832f1041U, 0x87ee0df6U,
-    0x99a95df3U, 0x9d684044U, 0x902b669dU, 0x94ea7b2aU,
-    0xe0b41de7U, 0xe4750050U, 0xe9362689U, 0xedf73b3eU,
-    0xf3b06b3bU, 0xf771768cU, 0xfa325055U, 0xfef34de2U,
-    0xc6bcf05fU, 0xc27dede8U, 0xcf3ecb31U, 0xcbffd686U,
-    0xd5b88683U, 0xd1799b34U, 0xdc3abdedU, 0xd8fba05aU,
-    0x690ce0eeU, 0x6dcdfd59U, 0x608edb80U, 0x644fc637U,
-    0x7a089632U, 0x7ec98b85U, 0x738aad5cU, 0x774bb0ebU,
-    0x4f040d56U, 0x4bc510e1U, 0x46863638U, 0x42472b8fU,
-    0x5c007b8aU, 0x58c1663dU, 0x558240e4U, 0x51435d53U,
-    0x251d3b9eU, 0x21dc2629U, 0x2c9f00f0U, 0x285e1d47U,
-    0x36194d42U, 0x32d850f5U, 0x3f9b762cU, 0x3b5a6b9bU,
-    0x0315d626U, 0x07d4cb91U, 0x0a97ed48U, 0x0e56f0ffU,
-    0x1011a0faU, 0x14d0bd4dU, 0x19939b94U, 0x1d528623U,
-    0xf12f560eU, 0xf5ee4bb9U, 0xf8ad6d60U, 0xfc6c70d7U,
-    0xe22b20d2U, 0xe6ea3d65U, 0xeba91bbcU, 0xef68060bU,
-    0xd727bbb6U, 0xd3e6a601U, 0xdea580d8U, 0xda649d6fU,
-    0xc423cd6aU, 0xc0e2d0ddU, 0xcda1f604U, 0xc960ebb3U,
-    0xbd3e8d7eU, 0xb9ff90c9U, 0xb4bcb610U, 0xb07daba7U,
-    0xae3afba2U, 0xaafbe615U, 0xa7b8c0ccU, 0xa379dd7bU,
-    0x9b3660c6U, 0x9ff77d71U, 0x92b45ba8U, 0x9675461fU,
-    0x8832161aU, 0x8cf30badU, 0x81b02d74U, 0x857130c3U,
-    0x5d8a9099U, 0x594b8d2eU, 0x5408abf7U, 0x50c9b640U,
-    0x4e8ee645U, 0x4a4ffbf2U, 0x470cdd2bU, 0x43cdc09cU,
-    0x7b827d21U, 0x7f436096U, 0x7200464fU, 0x76c15bf8U,
-    0x68860bfdU, 0x6c47164aU, 0x61043093U, 0x65c52d24U,
-    0x119b4be9U, 0x155a565eU, 0x18197087U, 0x1cd86d30U,
-    0x029f3d35U, 0x065e2082U, 0x0b1d065bU, 0x0fdc1becU,
-    0x3793a651U, 0x3352bbe6U, 0x3e119d3fU, 0x3ad08088U,
-    0x2497d08dU, 0x2056cd3aU, 0x2d15ebe3U, 0x29d4f654U,
-    0xc5a92679U, 0xc1683bceU, 0xcc2b1d17U, 0xc8ea00a0U,
-    0xd6ad50a5U, 0xd26c4d12U, 0xdf2f6bcbU, 0xdbee767cU,
-    0xe3a1cbc1U, 0xe760d676U, 0xea23f0afU, 0xeee2ed18U,
-    0xf0a5bd1dU, 0xf464a0aaU, 0xf9278673U, 0xfde69bc4U,
-    0x89b8fd09U, 0x8d79e0beU, 0x803ac667U, 0x84fbdbd0U,
-    0x9abc8bd5U, 0x9e7d9662U, 0x933eb0bbU, 0x97ffad0cU,
-    0xafb010b1U, 0xab710d06U, 0xa6322bdfU, 0xa2f33668U,
-    0xbcb4666dU, 0xb8757bdaU, 0xb5365d03U, 0xb1f740b4U,
-    };
-    
-    for (size_t i=0; i < data_len; i++) {
-        crc = table[(*data ^ (unsigned char)(crc >> 24)) & 0xFF] ^ (crc << 8);
-        data++;
-    }
-    return crc;
-}
-
-
-// Strangely, the PRS1 CRC32 appears to consider every byte a 32-bit wchar_t.
-// Nothing like trying a bunch of encodings and CRC32 variants on PROP.TXT files
-// until you find a winner.
-
-static crc32_t CRC32wchar(const unsigned char *data, size_t data_len, crc32_t crc=0xffffffffU)
-{
-    for (size_t i=0; i < data_len; i++) {
-        static unsigned char wch[4] = { 0, 0, 0, 0 };
-        wch[3] = *data++;
-        crc = CRC32(wch, 4, crc);
-    }
-    return crc;
-}
+// PRS1 chunks are checked with CRC-16/KERMIT, or for file format 3 with a CRC-32/MPEG-2
+// that strangely considers every byte a 32-bit wchar_t. Nothing like trying a bunch of
+// encodings and CRC32 variants on PROP.TXT files until you find a winner.
+// See SleepLib/crc.h for the implementations.
 
 
 static QString ts(qint64 msecs)
@@ -693,10 +555,10 @@ int PRS1Loader::OpenMachine(const QString & path)
     }
     m_abort = false;
 
-    emit updateMessage(QObject::tr("Getting Ready..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Getting Ready..."));
+    ProgressTracker::pumpEvents();
 
-    emit setProgressValue(0);
+    m_progress.setValue(0);
 
     QStringList paths;
     QString propertyfile;
@@ -708,8 +570,8 @@ int PRS1Loader::OpenMachine(const QString & path)
         return -1;
     }
 
-    emit updateMessage(QObject::tr("Backing Up Files..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Backing Up Files..."));
+    ProgressTracker::pumpEvents();
 
     QString backupPath = m->getBackupPath() + path.section("/", -2);
 
@@ -717,21 +579,21 @@ int PRS1Loader::OpenMachine(const QString & path)
         copyPath(path, backupPath);
     }
 
-    emit updateMessage(QObject::tr("Scanning Files..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Scanning Files..."));
+    ProgressTracker::pumpEvents();
 
     // Walk through the files and create an import task for each logical session.
     ScanFiles(paths, sessionid_base, m);
 
     int tasks = countTasks();
 
-    emit updateMessage(QObject::tr("Importing Sessions..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Importing Sessions..."));
+    ProgressTracker::pumpEvents();
 
     runTasks(AppSetting->multithreading());
 
-    emit updateMessage(QObject::tr("Finishing up..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Finishing up..."));
+    ProgressTracker::pumpEvents();
 
     finishAddingSessions();
 
@@ -801,7 +663,7 @@ Machine* PRS1Loader::CreateMachineFromProperties(QString propertyfile)
     if (true) {
         if (s_PRS1ModelInfo.IsBrick(info.modelnumber) && p_profile->cpap->brickWarning()) {
 #ifndef UNITTEST_MODE
-            QApplication::processEvents();
+            ProgressTracker::pumpEvents();
             QMessageBox::information(QApplication::activeWindow(),
                                      QObject::tr("Non Data Capable Machine"),
                                      QString(QObject::tr("Your Philips Respironics CPAP machine (Model %1) is unfortunately not a data capable model.")+"\n\n"+
@@ -921,7 +783,7 @@ void PRS1Loader::ScanFiles(const QStringList & paths, int sessionid_base, Machin
         // Scan for individual session files
         for (int i = 0; i < flist.size(); i++) {
 #ifndef UNITTEST_MODE
-            QCoreApplication::processEvents();
+            ProgressTracker::pumpEvents();
 #endif
             if (isAborted()) {
                 qDebug() << "received abort signal";
@@ -1860,6 +1722,12 @@ QMap<QString,QString> _PRS1ParsedEventContents(PRS1ParsedEvent* e)
     return e->contents();
 }
 
+void _PRS1ClearParsedEvents(PRS1DataChunk* chunk)
+{
+    qDeleteAll(chunk->m_parsedData);
+    chunk->m_parsedData.clear();
+}
+
 //********************************************************************************************
 
 
@@ -1887,42 +1755,103 @@ void PRS1DataChunk::AddEvent(PRS1ParsedEvent* const event)
 }
 
 
-static const QVector<PRS1ParsedEventType> ParsedEventsF5V3 = {
-    PRS1EPAPSetEvent::TYPE,
-    PRS1TimedBreathEvent::TYPE,
-    PRS1IPAPAverageEvent::TYPE,
-    PRS1IPAPLowEvent::TYPE,
-    PRS1IPAPHighEvent::TYPE,
-    PRS1TotalLeakEvent::TYPE,
-    PRS1RespiratoryRateEvent::TYPE,
-    PRS1PatientTriggeredBreathsEvent::TYPE,
-    PRS1MinuteVentilationEvent::TYPE,
-    PRS1TidalVolumeEvent::TYPE,
-    PRS1SnoreEvent::TYPE,
-    PRS1EPAPAverageEvent::TYPE,
-    PRS1LeakEvent::TYPE,
-    PRS1PressurePulseEvent::TYPE,
-    PRS1ObstructiveApneaEvent::TYPE,
-    PRS1ClearAirwayEvent::TYPE,
-    PRS1HypopneaEvent::TYPE,
-    PRS1FlowLimitationEvent::TYPE,
-    PRS1VibratorySnoreEvent::TYPE,
-    PRS1PeriodicBreathingEvent::TYPE,
-    PRS1LargeLeakEvent::TYPE,
+//********************************************************************************************
+// Table-driven event decoding
+//
+// The fileversion 3 (DreamStation generation) event formats all share the same record structure:
+// a one-byte event code, a 16-bit time delta, then a fixed layout of fields whose size is given
+// by the chunk's hblock. Rather than hand-writing a switch for each family/version, each one is
+// described by a table indexed by event code, listing the fields of that record and the parsed
+// event each becomes, and a single loop decodes them all.
+//
+// The event constructors are reached through prs1EventFactory<T> instantiations, so the loop
+// never has to know which event classes a family uses. Anything a table can't express (events
+// that depend on earlier ones, or records without a timestamp) is marked PRS1_FIELD_CUSTOM and
+// handed to the family's custom decoder.
+
+enum PRS1EventFieldKind {
+    PRS1_FIELD_END = 0,         // no more fields in this record
+    PRS1_FIELD_VALUE,           // event at t with the byte at offset as its value or duration
+    PRS1_FIELD_ELAPSED,         // instantaneous flag that occurred (byte at offset) seconds before t
+    PRS1_FIELD_LONG_DURATION,   // event lasting 2 * (16-bit word at offset), ending (the byte after it) seconds before t
+    PRS1_FIELD_FLAG,            // instantaneous flag at t with no data
+    PRS1_FIELD_BOUNDARY,        // end of a statistics interval
+    PRS1_FIELD_RAW,             // the entire record, as PRS1UnknownDataEvent
+    PRS1_FIELD_CUSTOM,          // handled by the format's custom decoder
 };
 
-// Outer loop based on ParseSummaryF5V3 along with hint as to event codes from old ParseEventsF5V3,
-// except this actually does something with the data.
-bool PRS1DataChunk::ParseEventsF5V3(void)
+typedef PRS1ParsedEvent* (*PRS1EventFactory)(int start, int value, float gain);
+
+template <class T>
+static PRS1ParsedEvent* prs1EventFactory(int start, int value, float /*gain*/)
 {
-    if (this->family != 5 || this->familyVersion != 3) {
-        qWarning() << "ParseEventsF5V3 called with family" << this->family << "familyVersion" << this->familyVersion;
+    return new T(start, value);
+}
+
+template <class T>
+static PRS1ParsedEvent* prs1PressureEventFactory(int start, int value, float gain)
+{
+    return new T(start, value, gain);
+}
+
+struct PRS1EventField
+{
+    PRS1EventFieldKind kind;
+    quint8 offset;              // relative to the end of the timestamp
+    PRS1EventFactory make;
+    float gain;
+};
+
+// Enough for the largest statistics record, plus its boundary and terminator
+const int prs1_max_event_fields = 14;
+
+struct PRS1EventLayout
+{
+    quint8 minimum_size;        // smallest hblock size that still holds every field below
+    bool timestamped;           // whether the record starts with a 16-bit time delta
+    PRS1EventField fields[prs1_max_event_fields];
+};
+
+// State carried between records by custom decoders
+struct PRS1EventState
+{
+    PRS1EventState() : is_bilevel(false) {}
+    bool is_bilevel;
+};
+
+typedef void (PRS1DataChunk::*PRS1CustomEventDecoder)(int code, int t, const unsigned char* data, int size, PRS1EventState & state);
+
+struct PRS1EventFormat
+{
+    int family;
+    int familyVersion;
+    const char* name;
+    const PRS1EventLayout* layouts;   // indexed by event code
+    int ncodes;
+    PRS1CustomEventDecoder custom;
+};
+
+// Field descriptions for the layout tables below
+#define EV_VALUE(T, OFS)            { PRS1_FIELD_VALUE, OFS, &prs1EventFactory<T>, 1.0F }
+#define EV_PRESSURE(T, OFS, GAIN)   { PRS1_FIELD_VALUE, OFS, &prs1PressureEventFactory<T>, GAIN }
+#define EV_ELAPSED(T, OFS)          { PRS1_FIELD_ELAPSED, OFS, &prs1EventFactory<T>, 1.0F }
+#define EV_LONG_DURATION(T, OFS)    { PRS1_FIELD_LONG_DURATION, OFS, &prs1EventFactory<T>, 1.0F }
+#define EV_FLAG(T)                  { PRS1_FIELD_FLAG, 0, &prs1EventFactory<T>, 1.0F }
+#define EV_BOUNDARY                 { PRS1_FIELD_BOUNDARY, 0, nullptr, 1.0F }
+#define EV_RAW                      { PRS1_FIELD_RAW, 0, nullptr, 1.0F }
+#define EV_CUSTOM                   { PRS1_FIELD_CUSTOM, 0, nullptr, 1.0F }
+// An event code that's never been seen, which gets logged and kept as raw data
+#define EV_UNKNOWN(SIZE)            { SIZE, true, { } }
+
+
+bool PRS1DataChunk::ParseEventsTable(const PRS1EventFormat & format)
+{
+    if (this->family != format.family || this->familyVersion != format.familyVersion) {
+        qWarning() << "ParseEvents" << format.name << "called with family" << this->family << "familyVersion" << this->familyVersion;
         return false;
     }
     const unsigned char * data = (unsigned char *)this->m_data.constData();
     int chunk_size = this->m_data.size();
-    static const int minimum_sizes[] = { 2, 3, 3, 0xd, 3, 3, 3, 4, 3, 2, 5, 5, 3, 3, 3, 3 };
-    static const int ncodes = sizeof(minimum_sizes) / sizeof(int);
 
     if (chunk_size < 1) {
         // This does occasionally happen.
@@ -1930,13 +1859,12 @@ bool PRS1DataChunk::ParseEventsF5V3(void)
         return false;
     }
 
-    // F5V3 uses a gain of 0.125 rather than 0.1 to allow for a maximum value of 30 cmH2O
-    static const float GAIN = 0.125;  // TODO: this should be parameterized somewhere more logical
     bool ok = true;
     int pos = 0, startpos;
     int code, size;
     int t = 0;
     int elapsed, duration;
+    PRS1EventState state;
     do {
         code = data[pos++];
         if (!this->hblock.contains(code)) {
@@ -1945,10 +1873,12 @@ bool PRS1DataChunk::ParseEventsF5V3(void)
             break;
         }
         size = this->hblock[code];
-        if (code < ncodes) {
-            // make sure the handlers below don't go past the end of the buffer
-            if (size < minimum_sizes[code]) {
-                qWarning() << this->sessionid << "event" << code << "too small" << size << "<" << minimum_sizes[code];
+        const PRS1EventLayout* layout = nullptr;
+        if (code < format.ncodes) {
+            layout = &format.layouts[code];
+            // make sure the fields below don't go past the end of the buffer
+            if (size < layout->minimum_size) {
+                qWarning() << this->sessionid << "event" << code << "too small" << size << "<" << layout->minimum_size;
                 ok = false;
                 break;
             }
@@ -1959,109 +1889,47 @@ bool PRS1DataChunk::ParseEventsF5V3(void)
             break;
         }
         startpos = pos;
-        t += data[pos] | (data[pos+1] << 8);
-        pos += 2;
+        if (layout == nullptr || layout->timestamped) {
+            t += data[pos] | (data[pos+1] << 8);
+            pos += 2;
+        }
 
-        switch (code) {
-            case 1:  // Pressure adjustment
-                this->AddEvent(new PRS1EPAPSetEvent(t, data[pos++], GAIN));
-                this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));  // TODO: what is this?
-                break;
-            case 2:  // Timed Breath
-                // TB events have a duration in 0.1s, based on the review of pressure waveforms.
-                // TODO: Ideally the starting time here would be adjusted here, but PRS1ParsedEvents
-                // currently assume integer seconds rather than ms, so that's done at import.
-                duration = data[pos];
-                this->AddEvent(new PRS1TimedBreathEvent(t, duration));
-                break;
-            case 3:  // Statistics
-                // These appear every 2 minutes, so presumably summarize the preceding period.
-                this->AddEvent(new PRS1IPAPAverageEvent(t, data[pos+0], GAIN));        // 00=IPAP
-                this->AddEvent(new PRS1IPAPLowEvent(t, data[pos+1], GAIN));            // 01=IAP Low
-                this->AddEvent(new PRS1IPAPHighEvent(t, data[pos+2], GAIN));           // 02=IAP High
-                this->AddEvent(new PRS1TotalLeakEvent(t, data[pos+3]));                // 03=Total leak (average?)
-                this->AddEvent(new PRS1RespiratoryRateEvent(t, data[pos+4]));          // 04=Breaths Per Minute (average?)
-                this->AddEvent(new PRS1PatientTriggeredBreathsEvent(t, data[pos+5]));  // 05=Patient Triggered Breaths (average?)
-                this->AddEvent(new PRS1MinuteVentilationEvent(t, data[pos+6]));        // 06=Minute Ventilation (average?)
-                this->AddEvent(new PRS1TidalVolumeEvent(t, data[pos+7]));              // 07=Tidal Volume (average?)
-                this->AddEvent(new PRS1SnoreEvent(t, data[pos+8]));                    // 08=Snore count  // TODO: not a VS on official waveform, but appears in flags and contributes to overall VS index
-                this->AddEvent(new PRS1EPAPAverageEvent(t, data[pos+9], GAIN));        // 09=EPAP average
-                this->AddEvent(new PRS1LeakEvent(t, data[pos+0xa]));                   // 0A=Leak (average?)
-                this->AddEvent(new PRS1IntervalBoundaryEvent(t));
-                break;
-            case 0x04:  // Pressure Pulse
-                duration = data[pos];  // TODO: is this a duration?
-                this->AddEvent(new PRS1PressurePulseEvent(t, duration));
-                break;
-            case 0x05:  // Obstructive Apnea
-                // OA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ObstructiveApneaEvent(t - elapsed, 0));
-                break;
-            case 0x06:  // Clear Airway Apnea
-                // CA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ClearAirwayEvent(t - elapsed, 0));
-                break;
-            case 0x07:  // Hypopnea
-                // TODO: How is this hypopnea different from events 0xd and 0xe?
-                // TODO: What is the first byte?
-                //data[pos+0];  // unknown first byte?
-                elapsed = data[pos+1];  // based on sample waveform, the hypopnea is over after this
-                this->AddEvent(new PRS1HypopneaEvent(t - elapsed, 0));
-                break;
-            case 0x08:  // Flow Limitation
-                // TODO: We should revisit whether this is elapsed or duration once (if)
-                // we start calculating flow limitations ourselves. Flow limitations aren't
-                // as obvious as OA/CA when looking at a waveform.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1FlowLimitationEvent(t - elapsed, 0));
-                break;
-            case 0x09:  // Vibratory Snore
-                // VS events are instantaneous flags with no duration, drawn on the official waveform.
-                // The current thinking is that these are the snores that cause a change in auto-titrating
-                // pressure. The snoring statistic above seems to be a total count. It's unclear whether
-                // the trigger for pressure change is severity or count or something else.
-                // no data bytes
-                this->AddEvent(new PRS1VibratorySnoreEvent(t, 0));
-                break;
-            case 0x0a:  // Periodic Breathing
-                // PB events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1PeriodicBreathingEvent(t - elapsed - duration, duration));
-                break;
-            case 0x0b:  // Large Leak
-                // LL events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1LargeLeakEvent(t - elapsed - duration, duration));
-                break;
-            case 0x0d:  // Hypopnea
-                // TODO: Why does this hypopnea have a different event code?
-                // fall through
-            case 0x0e:  // Hypopnea
-                // TODO: We should revisit whether this is elapsed or duration once (if)
-                // we start calculating hypopneas ourselves. Their official definition
-                // is 40% reduction in flow lasting at least 10s.
-                duration = data[pos];
-                this->AddEvent(new PRS1HypopneaEvent(t - duration, 0));
-                break;
-            case 0x0f:
-                // TODO: some other pressure adjustment?
-                // Appears near the beginning and end of a session when Opti-Start is on, at least once in middle
-                //CHECK_VALUES(data[pos], 0x20, 0x28);
-                this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
-                break;
-            default:
-                DUMP_EVENT();
-                UNEXPECTED_VALUE(code, "known event code");
-                this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
-                break;
+        if (layout == nullptr || layout->fields[0].kind == PRS1_FIELD_END) {
+            DUMP_EVENT();
+            UNEXPECTED_VALUE(code, "known event code");
+            this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
+        } else {
+            for (const PRS1EventField* field = layout->fields; field->kind != PRS1_FIELD_END; field++) {
+                const unsigned char* fdata = data + pos + field->offset;
+                switch (field->kind) {
+                    case PRS1_FIELD_VALUE:
+                        this->AddEvent(field->make(t, fdata[0], field->gain));
+                        break;
+                    case PRS1_FIELD_ELAPSED:
+                        this->AddEvent(field->make(t - fdata[0], 0, field->gain));
+                        break;
+                    case PRS1_FIELD_LONG_DURATION:
+                        duration = 2 * (fdata[0] | (fdata[1] << 8));
+                        elapsed = fdata[2];
+                        this->AddEvent(field->make(t - elapsed - duration, duration, field->gain));
+                        break;
+                    case PRS1_FIELD_FLAG:
+                        this->AddEvent(field->make(t, 0, field->gain));
+                        break;
+                    case PRS1_FIELD_BOUNDARY:
+                        this->AddEvent(new PRS1IntervalBoundaryEvent(t));
+                        break;
+                    case PRS1_FIELD_RAW:
+                        this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
+                        break;
+                    case PRS1_FIELD_CUSTOM:
+                        (this->*format.custom)(code, t, data + pos, size - (pos - startpos), state);
+                        break;
+                    default:
+                        qWarning() << "ParseEvents" << format.name << "bad field kind" << field->kind << "for event" << code;
+                        break;
+                }
+            }
         }
         pos = startpos + size;
     } while (ok && pos < chunk_size);
@@ -2072,6 +1940,130 @@ bool PRS1DataChunk::ParseEventsF5V3(void)
 }
 
 
+static const QVector<PRS1ParsedEventType> ParsedEventsF5V3 = {
+    PRS1EPAPSetEvent::TYPE,
+    PRS1TimedBreathEvent::TYPE,
+    PRS1IPAPAverageEvent::TYPE,
+    PRS1IPAPLowEvent::TYPE,
+    PRS1IPAPHighEvent::TYPE,
+    PRS1TotalLeakEvent::TYPE,
+    PRS1RespiratoryRateEvent::TYPE,
+    PRS1PatientTriggeredBreathsEvent::TYPE,
+    PRS1MinuteVentilationEvent::TYPE,
+    PRS1TidalVolumeEvent::TYPE,
+    PRS1SnoreEvent::TYPE,
+    PRS1EPAPAverageEvent::TYPE,
+    PRS1LeakEvent::TYPE,
+    PRS1PressurePulseEvent::TYPE,
+    PRS1ObstructiveApneaEvent::TYPE,
+    PRS1ClearAirwayEvent::TYPE,
+    PRS1HypopneaEvent::TYPE,
+    PRS1FlowLimitationEvent::TYPE,
+    PRS1VibratorySnoreEvent::TYPE,
+    PRS1PeriodicBreathingEvent::TYPE,
+    PRS1LargeLeakEvent::TYPE,
+};
+
+// F5V3 uses a gain of 0.125 rather than 0.1 to allow for a maximum value of 30 cmH2O
+static constexpr float GAIN_F5V3 = 0.125;  // TODO: this should be parameterized somewhere more logical
+
+// Based on ParseSummaryF5V3 along with hint as to event codes from old ParseEventsF5V3.
+static const PRS1EventLayout EventLayoutF5V3[] = {
+    EV_UNKNOWN(2),  // 0x00
+    { 3, true, {  // 0x01: Pressure adjustment
+        EV_PRESSURE(PRS1EPAPSetEvent, 0, GAIN_F5V3),
+        EV_RAW,  // TODO: what is this?
+    } },
+    { 3, true, {  // 0x02: Timed Breath
+        // TB events have a duration in 0.1s, based on the review of pressure waveforms.
+        // TODO: Ideally the starting time here would be adjusted here, but PRS1ParsedEvents
+        // currently assume integer seconds rather than ms, so that's done at import.
+        EV_VALUE(PRS1TimedBreathEvent, 0),
+    } },
+    { 0xd, true, {  // 0x03: Statistics
+        // These appear every 2 minutes, so presumably summarize the preceding period.
+        EV_PRESSURE(PRS1IPAPAverageEvent, 0, GAIN_F5V3),    // 00=IPAP
+        EV_PRESSURE(PRS1IPAPLowEvent, 1, GAIN_F5V3),        // 01=IAP Low
+        EV_PRESSURE(PRS1IPAPHighEvent, 2, GAIN_F5V3),       // 02=IAP High
+        EV_VALUE(PRS1TotalLeakEvent, 3),                    // 03=Total leak (average?)
+        EV_VALUE(PRS1RespiratoryRateEvent, 4),              // 04=Breaths Per Minute (average?)
+        EV_VALUE(PRS1PatientTriggeredBreathsEvent, 5),      // 05=Patient Triggered Breaths (average?)
+        EV_VALUE(PRS1MinuteVentilationEvent, 6),            // 06=Minute Ventilation (average?)
+        EV_VALUE(PRS1TidalVolumeEvent, 7),                  // 07=Tidal Volume (average?)
+        EV_VALUE(PRS1SnoreEvent, 8),                        // 08=Snore count  // TODO: not a VS on official waveform, but appears in flags and contributes to overall VS index
+        EV_PRESSURE(PRS1EPAPAverageEvent, 9, GAIN_F5V3),    // 09=EPAP average
+        EV_VALUE(PRS1LeakEvent, 0xa),                       // 0A=Leak (average?)
+        EV_BOUNDARY,
+    } },
+    { 3, true, {  // 0x04: Pressure Pulse
+        EV_VALUE(PRS1PressurePulseEvent, 0),  // TODO: is this a duration?
+    } },
+    { 3, true, {  // 0x05: Obstructive Apnea
+        // OA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ObstructiveApneaEvent, 0),
+    } },
+    { 3, true, {  // 0x06: Clear Airway Apnea
+        // CA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ClearAirwayEvent, 0),
+    } },
+    { 4, true, {  // 0x07: Hypopnea
+        // TODO: How is this hypopnea different from events 0xd and 0xe?
+        // TODO: What is the first byte?
+        EV_ELAPSED(PRS1HypopneaEvent, 1),  // based on sample waveform, the hypopnea is over after this
+    } },
+    { 3, true, {  // 0x08: Flow Limitation
+        // TODO: We should revisit whether this is elapsed or duration once (if)
+        // we start calculating flow limitations ourselves. Flow limitations aren't
+        // as obvious as OA/CA when looking at a waveform.
+        EV_ELAPSED(PRS1FlowLimitationEvent, 0),
+    } },
+    { 2, true, {  // 0x09: Vibratory Snore
+        // VS events are instantaneous flags with no duration, drawn on the official waveform.
+        // The current thinking is that these are the snores that cause a change in auto-titrating
+        // pressure. The snoring statistic above seems to be a total count. It's unclear whether
+        // the trigger for pressure change is severity or count or something else.
+        EV_FLAG(PRS1VibratorySnoreEvent),
+    } },
+    { 5, true, {  // 0x0a: Periodic Breathing
+        // PB events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1PeriodicBreathingEvent, 0),
+    } },
+    { 5, true, {  // 0x0b: Large Leak
+        // LL events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1LargeLeakEvent, 0),
+    } },
+    EV_UNKNOWN(3),  // 0x0c
+    { 3, true, {  // 0x0d: Hypopnea
+        // TODO: Why does this hypopnea have a different event code?
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 3, true, {  // 0x0e: Hypopnea
+        // TODO: We should revisit whether this is elapsed or duration once (if)
+        // we start calculating hypopneas ourselves. Their official definition
+        // is 40% reduction in flow lasting at least 10s.
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 3, true, {  // 0x0f
+        // TODO: some other pressure adjustment?
+        // Appears near the beginning and end of a session when Opti-Start is on, at least once in middle
+        EV_RAW,
+    } },
+};
+
+static const PRS1EventFormat EventFormatF5V3 = {
+    5, 3, "F5V3", EventLayoutF5V3, sizeof(EventLayoutF5V3) / sizeof(PRS1EventLayout), nullptr
+};
+
+bool PRS1DataChunk::ParseEventsF5V3(void)
+{
+    return this->ParseEventsTable(EventFormatF5V3);
+}
+
+
 static const QVector<PRS1ParsedEventType> ParsedEventsF5V0 = {
     PRS1EPAPSetEvent::TYPE,
     PRS1TimedBreathEvent::TYPE,
@@ -3204,156 +3196,94 @@ static const QVector<PRS1ParsedEventType> ParsedEventsF3V6 = {
     // No FL?
 };
 
+// F3V6 uses a gain of 0.125 rather than 0.1 to allow for a maximum value of 30 cmH2O
+static constexpr float GAIN_F3V6 = 0.125;  // TODO: this should be parameterized somewhere more logical
+
+// Based on EventLayoutF5V3, updated for F3V6
+static const PRS1EventLayout EventLayoutF3V6[] = {
+    EV_UNKNOWN(2),  // 0x00?
+    { 3, true, {  // 0x01: Timed Breath
+        // TB events have a duration in 0.1s, based on the review of pressure waveforms.
+        // TODO: Ideally the starting time here would be adjusted here, but PRS1ParsedEvents
+        // currently assume integer seconds rather than ms, so that's done at import.
+        // TODO: make sure F3 import logic matches F5 in adjusting TB start time
+        EV_VALUE(PRS1TimedBreathEvent, 0),
+    } },
+    { 0xe, true, {  // 0x02: Statistics
+        // These appear every 2 minutes, so presumably summarize the preceding period.
+        // 00=???  TODO
+        EV_PRESSURE(PRS1IPAPAverageEvent, 2, GAIN_F3V6),    // 02=IPAP
+        EV_PRESSURE(PRS1EPAPAverageEvent, 1, GAIN_F3V6),    // 01=EPAP, needs to be added second to calculate PS
+        EV_VALUE(PRS1TotalLeakEvent, 3),                    // 03=Total leak (average?)
+        EV_VALUE(PRS1RespiratoryRateEvent, 4),              // 04=Breaths Per Minute (average?)
+        EV_VALUE(PRS1PatientTriggeredBreathsEvent, 5),      // 05=Patient Triggered Breaths (average?)
+        EV_VALUE(PRS1MinuteVentilationEvent, 6),            // 06=Minute Ventilation (average?)
+        EV_VALUE(PRS1TidalVolumeEvent, 7),                  // 07=Tidal Volume (average?)
+        EV_VALUE(PRS1Test2Event, 8),                        // 08=Flow???
+        EV_VALUE(PRS1Test1Event, 9),                        // 09=TMV???
+        EV_VALUE(PRS1SnoreEvent, 0xa),                      // 0A=Snore count  // TODO: not a VS on official waveform, but appears in flags and contributes to overall VS index
+        EV_VALUE(PRS1LeakEvent, 0xb),                       // 0B=Leak (average?)
+        EV_BOUNDARY,
+    } },
+    { 3, true, {  // 0x03: Pressure Pulse
+        EV_VALUE(PRS1PressurePulseEvent, 0),  // TODO: is this a duration?
+    } },
+    { 3, true, {  // 0x04: Obstructive Apnea
+        // OA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ObstructiveApneaEvent, 0),
+    } },
+    { 3, true, {  // 0x05: Clear Airway Apnea
+        // CA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ClearAirwayEvent, 0),
+    } },
+    { 4, true, {  // 0x06: Hypopnea
+        // TODO: How is this hypopnea different from events 0xd and 0xe?
+        // TODO: What is the first byte?
+        EV_ELAPSED(PRS1HypopneaEvent, 1),  // based on sample waveform, the hypopnea is over after this
+    } },
+    { 5, true, {  // 0x07: Periodic Breathing
+        // PB events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1PeriodicBreathingEvent, 0),
+    } },
+    { 3, true, {  // 0x08: RERA
+        EV_ELAPSED(PRS1RERAEvent, 0),  // based on sample waveform, the RERA is over after this
+    } },
+    { 5, true, {  // 0x09: Large Leak
+        // LL events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1LargeLeakEvent, 0),
+    } },
+    { 3, true, {  // 0x0a: Hypopnea
+        // TODO: Why does this hypopnea have a different event code?
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 3, true, {  // 0x0b: Hypopnea
+        // TODO: We should revisit whether this is elapsed or duration once (if)
+        // we start calculating hypopneas ourselves. Their official definition
+        // is 40% reduction in flow lasting at least 10s.
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 2, true, {  // 0x0c: Apnea Alarm
+        EV_FLAG(PRS1ApneaAlarmEvent),  // no additional data
+    } },
+    { 2, true, {  // 0x0d: Low MV Alarm
+        EV_FLAG(PRS1LowMinuteVentilationAlarmEvent),  // no additional data
+    } },
+    EV_UNKNOWN(2),  // 0x0e?
+    EV_UNKNOWN(2),  // 0x0f?
+};
+
+static const PRS1EventFormat EventFormatF3V6 = {
+    3, 6, "F3V6", EventLayoutF3V6, sizeof(EventLayoutF3V6) / sizeof(PRS1EventLayout), nullptr
+};
+
 // 1030X, 11030X series
-// based on ParseEventsF5V3, updated for F3V6
 bool PRS1DataChunk::ParseEventsF3V6(void)
 {
-    if (this->family != 3 || this->familyVersion != 6) {
-        qWarning() << "ParseEventsF3V6 called with family" << this->family << "familyVersion" << this->familyVersion;
-        return false;
-    }
-    const unsigned char * data = (unsigned char *)this->m_data.constData();
-    int chunk_size = this->m_data.size();
-    static const int minimum_sizes[] = { 2, 3, 0xe, 3, 3, 3, 4, 5, 3, 5, 3, 3, 2, 2, 2, 2 };
-    static const int ncodes = sizeof(minimum_sizes) / sizeof(int);
-
-    if (chunk_size < 1) {
-        // This does occasionally happen.
-        qDebug() << this->sessionid << "Empty event data";
-        return false;
-    }
-
-    // F3V6 uses a gain of 0.125 rather than 0.1 to allow for a maximum value of 30 cmH2O
-    static const float GAIN = 0.125;  // TODO: this should be parameterized somewhere more logical
-    bool ok = true;
-    int pos = 0, startpos;
-    int code, size;
-    int t = 0;
-    int elapsed, duration;
-    do {
-        code = data[pos++];
-        if (!this->hblock.contains(code)) {
-            qWarning() << this->sessionid << "missing hblock entry for event" << code;
-            ok = false;
-            break;
-        }
-        size = this->hblock[code];
-        if (code < ncodes) {
-            // make sure the handlers below don't go past the end of the buffer
-            if (size < minimum_sizes[code]) {
-                qWarning() << this->sessionid << "event" << code << "too small" << size << "<" << minimum_sizes[code];
-                ok = false;
-                break;
-            }
-        } // else if it's past ncodes, we'll log its information below (rather than handle it)
-        if (pos + size > chunk_size) {
-            qWarning() << this->sessionid << "event" << code << "@" << pos << "longer than remaining chunk";
-            ok = false;
-            break;
-        }
-        startpos = pos;
-        t += data[pos] | (data[pos+1] << 8);
-        pos += 2;
-
-        switch (code) {
-            // case 0x00?
-            case 1:  // Timed Breath
-                // TB events have a duration in 0.1s, based on the review of pressure waveforms.
-                // TODO: Ideally the starting time here would be adjusted here, but PRS1ParsedEvents
-                // currently assume integer seconds rather than ms, so that's done at import.
-                duration = data[pos];
-                // TODO: make sure F3 import logic matches F5 in adjusting TB start time
-                this->AddEvent(new PRS1TimedBreathEvent(t, duration));
-                break;
-            case 2:  // Statistics
-                // These appear every 2 minutes, so presumably summarize the preceding period.
-                //data[pos+0];  // TODO: 0 = ???
-                this->AddEvent(new PRS1IPAPAverageEvent(t, data[pos+2], GAIN));        // 02=IPAP
-                this->AddEvent(new PRS1EPAPAverageEvent(t, data[pos+1], GAIN));        // 01=EPAP, needs to be added second to calculate PS
-                this->AddEvent(new PRS1TotalLeakEvent(t, data[pos+3]));                // 03=Total leak (average?)
-                this->AddEvent(new PRS1RespiratoryRateEvent(t, data[pos+4]));          // 04=Breaths Per Minute (average?)
-                this->AddEvent(new PRS1PatientTriggeredBreathsEvent(t, data[pos+5]));  // 05=Patient Triggered Breaths (average?)
-                this->AddEvent(new PRS1MinuteVentilationEvent(t, data[pos+6]));        // 06=Minute Ventilation (average?)
-                this->AddEvent(new PRS1TidalVolumeEvent(t, data[pos+7]));              // 07=Tidal Volume (average?)
-                this->AddEvent(new PRS1Test2Event(t, data[pos+8]));                    // 08=Flow???
-                this->AddEvent(new PRS1Test1Event(t, data[pos+9]));                    // 09=TMV???
-                this->AddEvent(new PRS1SnoreEvent(t, data[pos+0xa]));                  // 0A=Snore count  // TODO: not a VS on official waveform, but appears in flags and contributes to overall VS index
-                this->AddEvent(new PRS1LeakEvent(t, data[pos+0xb]));                   // 0B=Leak (average?)
-                this->AddEvent(new PRS1IntervalBoundaryEvent(t));
-                break;
-            case 0x03:  // Pressure Pulse
-                duration = data[pos];  // TODO: is this a duration?
-                this->AddEvent(new PRS1PressurePulseEvent(t, duration));
-                break;
-            case 0x04:  // Obstructive Apnea
-                // OA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ObstructiveApneaEvent(t - elapsed, 0));
-                break;
-            case 0x05:  // Clear Airway Apnea
-                // CA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ClearAirwayEvent(t - elapsed, 0));
-                break;
-            case 0x06:  // Hypopnea
-                // TODO: How is this hypopnea different from events 0xd and 0xe?
-                // TODO: What is the first byte?
-                //data[pos+0];  // unknown first byte?
-                elapsed = data[pos+1];  // based on sample waveform, the hypopnea is over after this
-                this->AddEvent(new PRS1HypopneaEvent(t - elapsed, 0));
-                break;
-            case 0x07:  // Periodic Breathing
-                // PB events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1PeriodicBreathingEvent(t - elapsed - duration, duration));
-                break;
-            case 0x08:  // RERA
-                elapsed = data[pos];  // based on sample waveform, the RERA is over after this
-                this->AddEvent(new PRS1RERAEvent(t - elapsed, 0));
-                break;
-            case 0x09:  // Large Leak
-                // LL events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1LargeLeakEvent(t - elapsed - duration, duration));
-                break;
-            case 0x0a:  // Hypopnea
-                // TODO: Why does this hypopnea have a different event code?
-                // fall through
-            case 0x0b:  // Hypopnea
-                // TODO: We should revisit whether this is elapsed or duration once (if)
-                // we start calculating hypopneas ourselves. Their official definition
-                // is 40% reduction in flow lasting at least 10s.
-                duration = data[pos];
-                this->AddEvent(new PRS1HypopneaEvent(t - duration, 0));
-                break;
-            case 0x0c:  // Apnea Alarm
-                // no additional data
-                this->AddEvent(new PRS1ApneaAlarmEvent(t, 0));
-                break;
-            case 0x0d:  // Low MV Alarm
-                // no additional data
-                this->AddEvent(new PRS1LowMinuteVentilationAlarmEvent(t, 0));
-                break;
-            // case 0x0e?
-            // case 0x0f?
-            default:
-                DUMP_EVENT();
-                UNEXPECTED_VALUE(code, "known event code");
-                this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
-                break;
-        }
-        pos = startpos + size;
-    } while (ok && pos < chunk_size);
-
-    this->duration = t;
-
-    return ok;
+    return this->ParseEventsTable(EventFormatF3V6);
 }
 
 
@@ -3992,208 +3922,163 @@ static const QVector<PRS1ParsedEventType> ParsedEventsF0V6 = {
 
 // DreamStation family 0 CPAP/APAP machines (400X-700X, 400G-502G)
 // Originally derived from F5V3 parsing + (incomplete) F0V234 parsing + sample data
-bool PRS1DataChunk::ParseEventsF0V6()
-{
-    if (this->family != 0 || this->familyVersion != 6) {
-        qWarning() << "ParseEventsF0V6 called with family" << this->family << "familyVersion" << this->familyVersion;
-        return false;
-    }
-    const unsigned char * data = (unsigned char *)this->m_data.constData();
-    int chunk_size = this->m_data.size();
-    static const int minimum_sizes[] = { 2, 3, 4, 3, 3, 3, 3, 3, 3, 2, 3, 4, 3, 2, 5, 5, 5, 5, 4, 3, 3, 3 };
-    static const int ncodes = sizeof(minimum_sizes) / sizeof(int);
-
-    if (chunk_size < 1) {
-        // This does occasionally happen.
-        qDebug() << this->sessionid << "Empty event data";
-        return false;
-    }
+static const PRS1EventLayout EventLayoutF0V6[] = {
+    EV_UNKNOWN(2),  // 0x00: never seen
+    { 3, true, {  // 0x01: Pressure adjustment
+        // Matches pressure setting, both initial and when ramp button pressed.
+        // Based on waveform reports, it looks like the pressure graph is drawn by
+        // interpolating between these pressure adjustments, by 0.5 cmH2O spaced evenly between
+        // adjustments. E.g. 6 at 28:11 and 7.3 at 29:05 results in the following dots:
+        // 6 at 28:11, 6.5 around 28:30, 7.0 around 28:50, 7(.3) at 29:05. That holds until
+        // subsequent "adjustment" of 7.3 at 30:09 followed by 8.0 at 30:19.
+        EV_PRESSURE(PRS1PressureSetEvent, 0, PRS1PressureEvent::GAIN),
+    } },
+    { 4, true, {  // 0x02: Pressure adjustment (bi-level)
+        // See notes above on interpolation.
+        EV_PRESSURE(PRS1IPAPSetEvent, 1, PRS1PressureEvent::GAIN),
+        EV_PRESSURE(PRS1EPAPSetEvent, 0, PRS1PressureEvent::GAIN),  // EPAP needs to be added second to calculate PS
+        EV_CUSTOM,  // switches the statistics below to bi-level
+    } },
+    { 3, true, {  // 0x03: Auto-CPAP starting pressure
+        // Most of the time this occurs, it's at the start and end of a session with
+        // the same pressure at both. Occasionally an additional event shows up in the
+        // middle of a session, and then the pressure at the end matches that.
+        // In these cases, the new pressure corresponds to the next night's starting
+        // pressure for auto-CPAP. It does not appear to have any effect on the current
+        // night's pressure, unless there's a substantial gap between sessions, in
+        // which case the next session may use the new starting pressure.
+        // TODO: What does this mean in bi-level mode?
+        // See F0V4 event 3 for comparison. TODO: See if there's an Opti-Start label on F0V6 reports.
+        EV_PRESSURE(PRS1AutoPressureSetEvent, 0, PRS1PressureEvent::GAIN),
+    } },
+    { 3, true, {  // 0x04: Pressure Pulse
+        EV_VALUE(PRS1PressurePulseEvent, 0),  // TODO: is this a duration?
+    } },
+    { 3, true, {  // 0x05: RERA
+        EV_ELAPSED(PRS1RERAEvent, 0),  // based on sample waveform, the RERA is over after this
+    } },
+    { 3, true, {  // 0x06: Obstructive Apnea
+        // OA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ObstructiveApneaEvent, 0),
+    } },
+    { 3, true, {  // 0x07: Clear Airway Apnea
+        // CA events are instantaneous flags with no duration: reviewing waveforms
+        // shows that the time elapsed between the flag and reporting often includes
+        // non-apnea breathing.
+        EV_ELAPSED(PRS1ClearAirwayEvent, 0),
+    } },
+    EV_UNKNOWN(3),  // 0x08: never seen
+    EV_UNKNOWN(2),  // 0x09: never seen
+    { 3, true, {  // 0x0a: Hypopnea
+        // TODO: Why does this hypopnea have a different event code?
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 4, true, {  // 0x0b: Hypopnea
+        // TODO: How is this hypopnea different from events 0xa, 0x14 and 0x15?
+        // TODO: What is the first byte?
+        EV_ELAPSED(PRS1HypopneaEvent, 1),  // based on sample waveform, the hypopnea is over after this
+    } },
+    { 3, true, {  // 0x0c: Flow Limitation
+        // TODO: We should revisit whether this is elapsed or duration once (if)
+        // we start calculating flow limitations ourselves. Flow limitations aren't
+        // as obvious as OA/CA when looking at a waveform.
+        EV_ELAPSED(PRS1FlowLimitationEvent, 0),
+    } },
+    { 2, true, {  // 0x0d: Vibratory Snore
+        // VS events are instantaneous flags with no duration, drawn on the official waveform.
+        // The current thinking is that these are the snores that cause a change in auto-titrating
+        // pressure. The snoring statistics below seem to be a total count. It's unclear whether
+        // the trigger for pressure change is severity or count or something else.
+        EV_FLAG(PRS1VibratorySnoreEvent),
+    } },
+    { 5, true, {  // 0x0e: Variable Breathing?
+        EV_CUSTOM,  // like a long duration event, but with its elapsed time checked
+    } },
+    { 5, true, {  // 0x0f: Periodic Breathing
+        // PB events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1PeriodicBreathingEvent, 0),
+    } },
+    { 5, true, {  // 0x10: Large Leak
+        // LL events are reported some time after they conclude, and they do have a reported duration.
+        EV_LONG_DURATION(PRS1LargeLeakEvent, 0),
+    } },
+    { 5, true, {  // 0x11: Statistics
+        EV_VALUE(PRS1TotalLeakEvent, 0),
+        EV_VALUE(PRS1SnoreEvent, 1),
+        EV_CUSTOM,  // average pressure, whose meaning depends on whether this is bi-level
+        EV_BOUNDARY,
+    } },
+    { 4, false, {  // 0x12: Snore count per pressure, the one event with no timestamp
+        EV_CUSTOM,
+    } },
+    EV_UNKNOWN(3),  // 0x13: never seen
+    { 3, true, {  // 0x14: Hypopnea, new to F0V6
+        // TODO: Why does this hypopnea have a different event code?
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+    { 3, true, {  // 0x15: Hypopnea, new to F0V6
+        // TODO: We should revisit whether this is elapsed or duration once (if)
+        // we start calculating hypopneas ourselves. Their official definition
+        // is 40% reduction in flow lasting at least 10s.
+        EV_ELAPSED(PRS1HypopneaEvent, 0),
+    } },
+};
 
-    bool ok = true;
-    int pos = 0, startpos;
-    int code, size;
-    int t = 0;
+void PRS1DataChunk::ParseEventCustomF0V6(int code, int t, const unsigned char* data, int /*size*/, PRS1EventState & state)
+{
     int elapsed, duration, value;
-    bool is_bilevel = false;
-    do {
-        code = data[pos++];
-        if (!this->hblock.contains(code)) {
-            qWarning() << this->sessionid << "missing hblock entry for event" << code;
-            ok = false;
+    switch (code) {
+        case 0x02:  // Pressure adjustment (bi-level)
+            state.is_bilevel = true;
             break;
-        }
-        size = this->hblock[code];
-        if (code < ncodes) {
-            // make sure the handlers below don't go past the end of the buffer
-            if (size < minimum_sizes[code]) {
-                qWarning() << this->sessionid << "event" << code << "too small" << size << "<" << minimum_sizes[code];
-                ok = false;
-                break;
+        case 0x0e:  // Variable Breathing?
+            duration = 2 * (data[0] | (data[1] << 8));
+            elapsed = data[2];  // this is always 60 seconds unless it's at the end, so it seems like elapsed
+            CHECK_VALUES(elapsed, 60, 0);
+            this->AddEvent(new PRS1VariableBreathingEvent(t - elapsed - duration, duration));
+            break;
+        case 0x11:  // Statistics
+            value = data[2];
+            if (state.is_bilevel) {
+                // For bi-level modes, this appears to be the time-weighted average of EPAP and IPAP actually provided.
+                this->AddEvent(new PRS1PressureAverageEvent(t, value));
+            } else {
+                // For single-pressure modes, this appears to be the average effective "EPAP" provided by Flex.
+                //
+                // Sample data shows this value around 10.3 cmH2O for a prescribed pressure of 12.0 (C-Flex+ 3).
+                // That's too low for an average pressure over time, but could easily be an average commanded EPAP.
+                // When flex mode is off, this is exactly the current CPAP set point.
+                this->AddEvent(new PRS1FlexPressureAverageEvent(t, value));
             }
-        } // else if it's past ncodes, we'll log its information below (rather than handle it)
-        if (pos + size > chunk_size) {
-            qWarning() << this->sessionid << "event" << code << "@" << pos << "longer than remaining chunk";
-            ok = false;
             break;
-        }
-        startpos = pos;
-        if (code != 0x12) {  // This one event has no timestamp
-            t += data[pos] | (data[pos+1] << 8);
-            pos += 2;
-        }
-
-        switch (code) {
-            //case 0x00:  // never seen
-            case 0x01:  // Pressure adjustment
-                // Matches pressure setting, both initial and when ramp button pressed.
-                // Based on waveform reports, it looks like the pressure graph is drawn by
-                // interpolating between these pressure adjustments, by 0.5 cmH2O spaced evenly between
-                // adjustments. E.g. 6 at 28:11 and 7.3 at 29:05 results in the following dots:
-                // 6 at 28:11, 6.5 around 28:30, 7.0 around 28:50, 7(.3) at 29:05. That holds until
-                // subsequent "adjustment" of 7.3 at 30:09 followed by 8.0 at 30:19.
-                this->AddEvent(new PRS1PressureSetEvent(t, data[pos]));
-                break;
-            case 0x02:  // Pressure adjustment (bi-level)
-                // See notes above on interpolation.
-                this->AddEvent(new PRS1IPAPSetEvent(t, data[pos+1]));
-                this->AddEvent(new PRS1EPAPSetEvent(t, data[pos]));  // EPAP needs to be added second to calculate PS
-                is_bilevel = true;
-                break;
-            case 0x03:  // Auto-CPAP starting pressure
-                // Most of the time this occurs, it's at the start and end of a session with
-                // the same pressure at both. Occasionally an additional event shows up in the
-                // middle of a session, and then the pressure at the end matches that.
-                // In these cases, the new pressure corresponds to the next night's starting
-                // pressure for auto-CPAP. It does not appear to have any effect on the current
-                // night's pressure, unless there's a substantial gap between sessions, in
-                // which case the next session may use the new starting pressure.
-                //CHECK_VALUE(data[pos], 40);
-                // TODO: What does this mean in bi-level mode?
-                // See F0V4 event 3 for comparison. TODO: See if there's an Opti-Start label on F0V6 reports.
-                this->AddEvent(new PRS1AutoPressureSetEvent(t, data[pos]));
-                break;
-            case 0x04:  // Pressure Pulse
-                duration = data[pos];  // TODO: is this a duration?
-                this->AddEvent(new PRS1PressurePulseEvent(t, duration));
-                break;
-            case 0x05:  // RERA
-                elapsed = data[pos];  // based on sample waveform, the RERA is over after this
-                this->AddEvent(new PRS1RERAEvent(t - elapsed, 0));
-                break;
-            case 0x06:  // Obstructive Apnea
-                // OA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ObstructiveApneaEvent(t - elapsed, 0));
-                break;
-            case 0x07:  // Clear Airway Apnea
-                // CA events are instantaneous flags with no duration: reviewing waveforms
-                // shows that the time elapsed between the flag and reporting often includes
-                // non-apnea breathing.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1ClearAirwayEvent(t - elapsed, 0));
-                break;
-            //case 0x08:  // never seen
-            //case 0x09:  // never seen
-            //case 0x0a:  // Hypopnea, see 0x15
-            case 0x0b:  // Hypopnea
-                // TODO: How is this hypopnea different from events 0xa, 0x14 and 0x15?
-                // TODO: What is the first byte?
-                //data[pos+0];  // unknown first byte?
-                elapsed = data[pos+1];  // based on sample waveform, the hypopnea is over after this
-                this->AddEvent(new PRS1HypopneaEvent(t - elapsed, 0));
-                break;
-            case 0x0c:  // Flow Limitation
-                // TODO: We should revisit whether this is elapsed or duration once (if)
-                // we start calculating flow limitations ourselves. Flow limitations aren't
-                // as obvious as OA/CA when looking at a waveform.
-                elapsed = data[pos];
-                this->AddEvent(new PRS1FlowLimitationEvent(t - elapsed, 0));
-                break;
-            case 0x0d:  // Vibratory Snore
-                // VS events are instantaneous flags with no duration, drawn on the official waveform.
-                // The current thinking is that these are the snores that cause a change in auto-titrating
-                // pressure. The snoring statistics below seem to be a total count. It's unclear whether
-                // the trigger for pressure change is severity or count or something else.
-                // no data bytes
-                this->AddEvent(new PRS1VibratorySnoreEvent(t, 0));
-                break;
-            case 0x0e:  // Variable Breathing?
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];  // this is always 60 seconds unless it's at the end, so it seems like elapsed
-                CHECK_VALUES(elapsed, 60, 0);
-                this->AddEvent(new PRS1VariableBreathingEvent(t - elapsed - duration, duration));
-                break;
-            case 0x0f:  // Periodic Breathing
-                // PB events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1PeriodicBreathingEvent(t - elapsed - duration, duration));
-                break;
-            case 0x10:  // Large Leak
-                // LL events are reported some time after they conclude, and they do have a reported duration.
-                duration = 2 * (data[pos] | (data[pos+1] << 8));
-                elapsed = data[pos+2];
-                this->AddEvent(new PRS1LargeLeakEvent(t - elapsed - duration, duration));
-                break;
-            case 0x11:  // Statistics
-                this->AddEvent(new PRS1TotalLeakEvent(t, data[pos]));
-                this->AddEvent(new PRS1SnoreEvent(t, data[pos+1]));
-
-                value = data[pos+2];
-                if (is_bilevel) {
-                    // For bi-level modes, this appears to be the time-weighted average of EPAP and IPAP actually provided.
-                    this->AddEvent(new PRS1PressureAverageEvent(t, value));
-                } else {
-                    // For single-pressure modes, this appears to be the average effective "EPAP" provided by Flex.
-                    //
-                    // Sample data shows this value around 10.3 cmH2O for a prescribed pressure of 12.0 (C-Flex+ 3).
-                    // That's too low for an average pressure over time, but could easily be an average commanded EPAP.
-                    // When flex mode is off, this is exactly the current CPAP set point.
-                    this->AddEvent(new PRS1FlexPressureAverageEvent(t, value));
-                }
-                this->AddEvent(new PRS1IntervalBoundaryEvent(t));
-                break;
-            case 0x12:  // Snore count per pressure
-                // Some sessions (with lots of ramps) have multiple of these, each with a
-                // different pressure. The total snore count across all of them matches the
-                // total found in the stats event.
-                if (data[pos] != 0) {
-                    CHECK_VALUES(data[pos], 1, 2);  // 0 = CPAP pressure, 1 = bi-level EPAP, 2 = bi-level IPAP
-                }
-                //CHECK_VALUE(data[pos+1], 0x78);  // pressure
-                //CHECK_VALUE(data[pos+2], 1);  // 16-bit snore count
-                //CHECK_VALUE(data[pos+3], 0);
-                value = (data[pos+2] | (data[pos+3] << 8));
-                this->AddEvent(new PRS1SnoresAtPressureEvent(t, data[pos], data[pos+1], value));
-                break;
-            //case 0x13:  // never seen
-            case 0x0a:  // Hypopnea
-                // TODO: Why does this hypopnea have a different event code?
-                // fall through
-            case 0x14:  // Hypopnea, new to F0V6
-                // TODO: Why does this hypopnea have a different event code?
-                // fall through
-            case 0x15:  // Hypopnea, new to F0V6
-                // TODO: We should revisit whether this is elapsed or duration once (if)
-                // we start calculating hypopneas ourselves. Their official definition
-                // is 40% reduction in flow lasting at least 10s.
-                duration = data[pos];
-                this->AddEvent(new PRS1HypopneaEvent(t - duration, 0));
-                break;
-            default:
-                DUMP_EVENT();
-                UNEXPECTED_VALUE(code, "known event code");
-                this->AddEvent(new PRS1UnknownDataEvent(m_data, startpos-1, size+1));
-                break;
-        }
-        pos = startpos + size;
-    } while (ok && pos < chunk_size);
+        case 0x12:  // Snore count per pressure
+            // Some sessions (with lots of ramps) have multiple of these, each with a
+            // different pressure. The total snore count across all of them matches the
+            // total found in the stats event.
+            if (data[0] != 0) {
+                CHECK_VALUES(data[0], 1, 2);  // 0 = CPAP pressure, 1 = bi-level EPAP, 2 = bi-level IPAP
+            }
+            //CHECK_VALUE(data[1], 0x78);  // pressure
+            //CHECK_VALUE(data[2], 1);  // 16-bit snore count
+            //CHECK_VALUE(data[3], 0);
+            value = (data[2] | (data[3] << 8));
+            this->AddEvent(new PRS1SnoresAtPressureEvent(t, data[0], data[1], value));
+            break;
+        default:
+            qWarning() << this->sessionid << "ParseEventCustomF0V6 called for event" << code;
+            break;
+    }
+}
 
-    this->duration = t;
+static const PRS1EventFormat EventFormatF0V6 = {
+    0, 6, "F0V6", EventLayoutF0V6, sizeof(EventLayoutF0V6) / sizeof(PRS1EventLayout), &PRS1DataChunk::ParseEventCustomF0V6
+};
 
-    return ok;
+bool PRS1DataChunk::ParseEventsF0V6()
+{
+    return this->ParseEventsTable(EventFormatF0V6);
 }
 
 
@@ -9274,13 +9159,13 @@ bool PRS1DataChunk::ReadData(QFile & f)
             if (!ExtractStoredCrc(4)) {
                 break;
             }
-            this->calcCrc = CRC32wchar((unsigned char *)this->m_data.data(), this->m_data.size());
+            this->calcCrc = CRC32MPEG2wchar((unsigned char *)this->m_data.data(), this->m_data.size());
         } else {
             // The last 2 bytes contain a CRC16 checksum of the data.
             if (!ExtractStoredCrc(2)) {
                 break;
             }
-            this->calcCrc = CRC16((unsigned char *)this->m_data.data(), this->m_data.size());
+            this->calcCrc = CRC16Kermit((unsigned char *)this->m_data.data(), this->m_data.size());
         }
         
         ok = true;
@@ -222,6 +222,12 @@ public:
     //! \brief Parse a single data chunk from a .002 file containing event data for a family 5 ASV family version 3 machine
     bool ParseEventsF5V3(void);
 
+    //! \brief Parse a single data chunk from a .002 file whose record layouts are described by the given table
+    bool ParseEventsTable(const struct PRS1EventFormat & format);
+
+    //! \brief Decode the parts of DreamStation family 0 events that depend on earlier events or don't fit a layout table
+    void ParseEventCustomF0V6(int code, int t, const unsigned char* data, int size, struct PRS1EventState & state);
+
 protected:
     class PRS1Loader* loader;
     
@@ -266,6 +272,7 @@ protected:
 #if UNITTEST_MODE
 QString _PRS1ParsedEventName(PRS1ParsedEvent* e);
 QMap<QString,QString> _PRS1ParsedEventContents(PRS1ParsedEvent* e);
+void _PRS1ClearParsedEvents(PRS1DataChunk* chunk);
 #endif
 
 
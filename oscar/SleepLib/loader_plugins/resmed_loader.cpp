@@ -20,6 +20,7 @@
 
 #include "SleepLib/session.h"
 #include "SleepLib/calcs.h"
+#include "SleepLib/localtime.h"
 
 #include "SleepLib/loader_plugins/resmed_loader.h"
 #include "SleepLib/loader_plugins/resmed_EDFinfo.h"
@@ -244,6 +245,14 @@ MachineInfo ResmedLoader::PeekInfo(const QString & path)
     return info;
 }
 
+void ResmedLoader::prepareImport(const QString & path)
+{
+    MachineInfo info = PeekInfo(path);
+    if ( ! info.serial.isEmpty() && ! p_profile->lookupMachine(info.serial, info.loadername) ) {
+        p_profile->forceResmedPrefs();
+    }
+}
+
 long event_cnt = 0;
 
 bool parseIdentTGT( QString path, MachineInfo * info, QHash<QString, QString> & idmap );        // forward
@@ -349,9 +358,17 @@ int ResmedLoader::Open(const QString & dirpath)
     QDate firstImportDay = QDate().fromString("2010-01-01", "yyyy-MM-dd");     // Before Series 8 machines (I think)
 
     Machine *mach = p_profile->lookupMachine(info.serial, info.loadername);
-    if ( mach ) {       // we have seen this machine
+    if ( ! mach && ! importingInBackground() ) {
+        // prepareImport() has already done this for a background import
+        p_profile->forceResmedPrefs();
+    }
+    bool seen = (mach != nullptr);
+
+    // Creates the machine or updates its info, and copies the idmap into its properties (overwriting any old values)
+    mach = createMachine( info, idmap );
+
+    if ( seen ) {       // we have seen this machine
         qDebug() << "We have seen this machime";
-        mach->setInfo( info );                      // update info
         QDate lastDate = mach->LastDay();           // use the last day for this machine
         firstImportDay = lastDate;                  // re-import the last day, to  pick up partial days
         QDate purgeDate = mach->purgeDate();
@@ -362,8 +379,6 @@ int ResmedLoader::Open(const QString & dirpath)
 //      firstImportDay = lastDate.addDays(1);       // start the day after until we  figure out the purge
     } else {            // Starting from new beginnings - new or purged
         qDebug() << "New machine or just purged";
-        p_profile->forceResmedPrefs();
-        mach = p_profile->CreateMachine( info );
     }
     QDateTime ignoreBefore = p_profile->session->ignoreOlderSessionsDate();
     bool ignoreOldSessions = p_profile->session->ignoreOlderSessions();
@@ -388,13 +403,6 @@ int ResmedLoader::Open(const QString & dirpath)
         create_backups = false;
     }
 
-    ///////////////////////////////////////////////////////////////////////////////////
-    // Copy the idmap into machine objects properties, (overwriting any old values)
-    ///////////////////////////////////////////////////////////////////////////////////
-    for (auto i=idmap.begin(), idend=idmap.end(); i != idend; i++) {
-        mach->properties[i.key()] = i.value();
-    }
-
     ///////////////////////////////////////////////////////////////////////////////////
     // Create the backup folder structure for storing a copy of everything in..
     // (Unless we are importing from this backup folder)
@@ -439,8 +447,8 @@ int ResmedLoader::Open(const QString & dirpath)
 
     resdayList.clear();
 
-    emit updateMessage(QObject::tr("Locating STR.edf File(s)..."));
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Locating STR.edf File(s)..."));
+    ProgressTracker::pumpEvents();
 
     // List all STR.edf backups and tag on latest for processing
 
@@ -600,8 +608,8 @@ int ResmedLoader::Open(const QString & dirpath)
     if (impfile.exists())
         impfile.remove();
 
-    emit updateMessage(QObject::tr("Cataloguing EDF Files..."));
-    QApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Cataloguing EDF Files..."));
+    ProgressTracker::pumpEvents();
 
     if (isAborted())
         return 0;
@@ -619,8 +627,8 @@ int ResmedLoader::Open(const QString & dirpath)
     // Now at this point we have resdayList populated with processable summary and EDF files data
     // that can be processed in threads..
 
-    emit updateMessage(QObject::tr("Queueing Import Tasks..."));
-    QApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Queueing Import Tasks..."));
+    ProgressTracker::pumpEvents();
 
     for (auto rdi=resdayList.begin(), rend=resdayList.end(); rdi != rend; rdi++) {
         if (isAborted())
@@ -635,7 +643,7 @@ int ResmedLoader::Open(const QString & dirpath)
     }
 
     sessionCount = 0;
-    emit updateMessage(QObject::tr("Importing Sessions..."));
+    m_progress.setLabel(QObject::tr("Importing Sessions..."));
 
     // Walk down the resDay list
     qDebug() << "About to call runTasks()";
@@ -648,8 +656,8 @@ int ResmedLoader::Open(const QString & dirpath)
     // Now look for any new summary data that can be extracted from STR.edf records
     ////////////////////////////////////////////////////////////////////////////////////
 
-    emit updateMessage(QObject::tr("Finishing Up..."));
-    QApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Finishing Up..."));
+    ProgressTracker::pumpEvents();
 
     qDebug() << "About to call finishAddingSessions()";
     finishAddingSessions();
@@ -697,7 +705,7 @@ int ResmedLoader::Open(const QString & dirpath)
     qDebug() << "Total Events " << event_cnt;
     qDebug() << "Total new Sessions " << num_new_sessions;
 
-    mach->clearPurgeDate();
+    clearPurgeDate(mach);
 
     return num_new_sessions;
 }   // end Open()
@@ -727,6 +735,7 @@ ResMedEDFInfo * fetchSTRandVerify( QString filename, QString serialNumber)
 void StoreSettings(Session * sess, STRRecord & R);  // forward
 void ResmedLoader::checkSummaryDay( ResMedDay & resday, QDate date, Machine * mach )
 {
+    QMutexLocker lock(&p_profile->importMutex);
     Day * day = p_profile->FindDay(date, MT_CPAP);
     bool reimporting = false;
 #ifdef STR_DEBUG
@@ -900,9 +909,8 @@ int ResmedLoader::ScanFiles(Machine * mach, const QString & datalog_path, QDate
 #ifdef DEBUG_EFFICIENCY
     time.start();
 #endif
-    QString datestr;
-    QDateTime datetime;
     QDate date;
+    QTime filetime;
     int totalfiles = EDFfiles.size();
     qDebug() << "Scanning " << totalfiles << " EDF files";
 
@@ -911,9 +919,9 @@ int ResmedLoader::ScanFiles(Machine * mach, const QString & datalog_path, QDate
     if (pbarFreq < 1) // stop a divide by zero
         pbarFreq = 1;
 
-    emit setProgressValue(0);
-    emit setProgressMax(totalfiles);
-    QCoreApplication::processEvents();
+    m_progress.setValue(0);
+    m_progress.setMax(totalfiles);
+    ProgressTracker::pumpEvents();
 
     qDebug() << "Starting EDF duration scan pass";
     for (int i=0; i < totalfiles; ++i) {
@@ -924,8 +932,8 @@ int ResmedLoader::ScanFiles(Machine * mach, const QString & datalog_path, QDate
 
         // Update progress bar
         if ((i % pbarFreq) == 0) {
-            emit setProgressValue(i);
-            QCoreApplication::processEvents();
+            m_progress.setValue(i);
+            ProgressTracker::pumpEvents();
         }
 
         // Forget about it if it can't be read.
@@ -942,12 +950,15 @@ int ResmedLoader::ScanFiles(Machine * mach, const QString & datalog_path, QDate
 
         filename = fi.fileName();
 
-        datestr = filename.section("_", 0, 1);
-        datetime = QDateTime().fromString(datestr,"yyyyMMdd_HHmmss");
-        date = datetime.date();
+        // Filenames start with "yyyyMMdd_HHmmss", read directly as QDateTime::fromString is slow
+        date = LocalTime::parseDate(filename, 0);
+        filetime = (filename.size() > 8) && (filename.at(8) == QChar('_')) ? LocalTime::parseTime(filename, 9) : QTime();
+        if (!filetime.isValid()) {
+            date = QDate();
+        }
         // ResMed splits days at noon and now so do we, so all times before noon
         // go to the previous day
-        if (datetime.time().hour() < 12) {
+        if (filetime.hour() < 12) {
             date = date.addDays(-1);
         }
 
@@ -1115,9 +1126,9 @@ bool ResmedLoader::ProcessSTRfiles(Machine *mach, QMap<QDate, STRFile> & STRmap,
 #endif
     }
 
-    emit updateMessage(QObject::tr("Parsing STR.edf records..."));
-    emit setProgressMax(totalRecs);
-    QCoreApplication::processEvents();
+    m_progress.setLabel(QObject::tr("Parsing STR.edf records..."));
+    m_progress.setMax(totalRecs);
+    ProgressTracker::pumpEvents();
 
     int currentRec = 0;
 
@@ -1165,8 +1176,8 @@ bool ResmedLoader::ProcessSTRfiles(Machine *mach, QMap<QDate, STRFile> & STRmap,
 
         // For each data record, representing 1 day each
         for (int rec = 0; rec < size; ++rec, date = date.addDays(1)) {
-            emit setProgressValue(++currentRec);
-            QCoreApplication::processEvents();
+            m_progress.setValue(++currentRec);
+            ProgressTracker::pumpEvents();
 
             if (date < firstImport) {
 #ifdef SESSION_DEBUG
@@ -1815,6 +1826,18 @@ EDFType lookupEDFType(const QString & filename)
 }
 
 
+// Returns the start time a "yyyyMMdd_HHmmss" file name prefix gives in seconds, read without DST like the EDF
+// headers are, or quint32(-1) like QDateTime::toTime_t() does if it isn't a valid time
+static quint32 fileNameTime(const QString & datestr)
+{
+    QDate date = LocalTime::parseDate(datestr, 0);
+    QTime time = LocalTime::parseTime(datestr, datestr.size() - 6);
+    if (!date.isValid() || !time.isValid()) {
+        return quint32(-1);
+    }
+    return quint32(EDFInfo::localNoDSTTable.toUtc(date, time) / 1000L);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // Looks inside an EDF or EDF.gz and grabs the start and duration
 ///////////////////////////////////////////////////////////////////////////////
@@ -1918,11 +1941,7 @@ EDFduration getEDFDuration(const QString & filename)
     quint32 end = start + rec_duration * num_records;
 
     QString filedate = filename.section("/",-1).section("_",0,1);
-//  QDateTime dt2 = QDateTime::fromString(filedate, "yyyyMMdd_hhmmss");
-    d2 = QDate::fromString( filedate.left(8), "yyyyMMdd");
-    QTime t2 = QTime::fromString( filedate.right(6), "hhmmss");
-    QDateTime dt2 = QDateTime( d2, t2, EDFInfo::localNoDST );
-    quint32 st2 = dt2.toTime_t();
+    quint32 st2 = fileNameTime(filedate);
 
     start = qMin(st2, start);	// They should be the same, usually
 
@@ -2232,12 +2251,7 @@ void ResDayTask::run()
         EDFType type = lookupEDFType(filename);
 
         QString datestr = filename.section("_", 0, 1);
-//      QDateTime filetime = QDateTime().fromString(datestr,"yyyyMMdd_HHmmss");
-        QDate d2 = QDate::fromString( datestr.left(8), "yyyyMMdd");
-        QTime t2 = QTime::fromString( datestr.right(6), "hhmmss");
-        QDateTime filetime = QDateTime( d2, t2, EDFInfo::localNoDST );
-
-        quint32 filetime_t = filetime.toTime_t();
+        quint32 filetime_t = fileNameTime(datestr);
         if (type == EDF_EVE) {      // skip the EVE and CSL files, b/c they often cover all sessions
             EVElist[filetime_t] = filename;
             continue;
@@ -2424,9 +2438,21 @@ void ResDayTask::run()
             bool foundprev = false;
             loader->sessionMutex.lock();
 
+            // Sessions from earlier in this import are only added to their days once it is finished
+            for (auto nit = loader->new_sessions.lowerBound(sess->session()); nit != loader->new_sessions.begin(); ) {
+                --nit;
+                Session * chksess = nit.value();
+                if (chksess->machine() == mach) {
+                    sess->settings = chksess->settings;
+                    foundprev = true;
+                    break;
+                }
+            }
+            p_profile->importMutex.lock();
+
             auto it=p_profile->daylist.find(resday->date); // should exist already to be here
             auto begin = p_profile->daylist.begin();
-            while (it!=begin) {
+            while (!foundprev && (it!=begin)) {
                 --it;
                 Day * day = it.value();
                 bool hasmachine = day && day->hasMachine(mach);
@@ -2443,6 +2469,7 @@ void ResDayTask::run()
                     break;
                 }
             }
+            p_profile->importMutex.unlock();
             loader->sessionMutex.unlock();
             sess->setNoSettings(true);
 
@@ -2484,13 +2511,12 @@ void ResmedLoader::SaveSession(ResmedLoader* loader, Session* sess)
 {
     Machine* mach = sess->machine();
 
-    loader->sessionMutex.lock();         // AddSession definitely ain't threadsafe.
+    loader->sessionMutex.lock();
     if ( ! sess->Store(mach->getDataPath()) ) {
         qWarning() << "Failed to store session" << sess->session();
     }
-    if ( ! mach->AddSession(sess) ) {
-        qWarning() << "Session" << sess->session() << "was not addded";
-    } 
+    // Added to the machine by finishAddingSessions(), on the GUI thread
+    loader->new_sessions[sess->session()] = sess;
     loader->sessionCount++;
     loader->sessionMutex.unlock();
 }
@@ -82,6 +82,11 @@ class ResmedLoader : public CPAPLoader
     //! \brief Scans for ResMed SD folder structure signature, and loads any new data if found
     virtual int Open(const QString &);
 
+    virtual bool canImportInBackground() { return true; }
+
+    //! \brief Sets the ResMed preferences up ahead of importing a machine new to the profile
+    virtual void prepareImport(const QString & path);
+
     //! \brief Returns the version number of this ResMed loader
     virtual int Version() { return resmed_data_version; }
 
@@ -129,7 +129,7 @@ int WeinmannLoader::Open(const QString & dirpath)
 
     MachineInfo info = newInfo();
     info.serial = "141819";
-    Machine * mach = p_profile->CreateMachine(info);
+    Machine * mach = createMachine(info);
 
 
     int WeekComplianceOffset = index["WeekComplianceOffset"];
@@ -465,7 +465,7 @@ int WeinmannLoader::Open(const QString & dirpath)
         }
 
         sess->UpdateSummaries();
-        mach->AddSession(sess);
+        addSession(sess);
     }
     delete [] data;
     delete [] st;
@@ -473,7 +473,8 @@ int WeinmannLoader::Open(const QString & dirpath)
     delete [] mv;
     delete [] ev;
 
-    mach->Save();
+    finishAddingSessions();
+    saveMachine(mach);
 
     return 1;
 
@@ -97,6 +97,8 @@ class WeinmannLoader : public CPAPLoader
     //! \brief Scans path for Weinmann data signature, and Loads any new data
     virtual int Open(const QString & path);
 
+    virtual bool canImportInBackground() { return true; }
+
     //! \brief Returns SleepLib database version of this Weinmann loader
     virtual int Version() { return weinmann_data_version; }
 
@@ -0,0 +1,164 @@
+/* SleepLib Local Time Conversion Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <algorithm>
+#include <limits>
+#include <QDateTime>
+
+#include "localtime.h"
+
+const qint64 msecs_per_day = 86400000L;
+
+// Julian day number of 1970-01-01
+const qint64 epoch_julian_day = 2440588;
+
+LocalTime::LocalTime(const QTimeZone & zone, int firstYear, int lastYear)
+{
+    QDateTime from(QDate(firstYear, 1, 1), QTime(0, 0), Qt::UTC);
+    QDateTime to(QDate(lastYear, 12, 31), QTime(23, 59, 59), Qt::UTC);
+
+    m_at.append(std::numeric_limits<qint64>::min());
+    m_offset.append(zone.offsetFromUtc(from) * 1000);
+
+    if (zone.hasTransitions()) {
+        for (const auto & t : zone.transitions(from, to)) {
+            int offset = t.offsetFromUtc * 1000;
+            if (offset != m_offset.last()) {
+                m_at.append(t.atUtc.toMSecsSinceEpoch());
+                m_offset.append(offset);
+            }
+        }
+    }
+}
+
+LocalTime::LocalTime(int offsetSecs)
+{
+    m_at.append(std::numeric_limits<qint64>::min());
+    m_offset.append(offsetSecs * 1000);
+}
+
+const LocalTime & LocalTime::system()
+{
+    static const LocalTime table(QTimeZone::systemTimeZone());
+    return table;
+}
+
+int LocalTime::offsetAt(qint64 utc) const
+{
+    if (m_at.size() == 1) {
+        return m_offset.at(0);
+    }
+    // The last transition at or before utc
+    int idx = int(std::upper_bound(m_at.constBegin(), m_at.constEnd(), utc) - m_at.constBegin()) - 1;
+    return m_offset.at(idx);
+}
+
+qint64 LocalTime::toUtc(qint64 local) const
+{
+    // Offsets before and after any change near local, trying the earlier first
+    qint64 guess = local - offsetAt(local - msecs_per_day);
+    if (toLocal(guess) == local) {
+        return guess;
+    }
+    guess = local - offsetAt(local + msecs_per_day);
+    if (toLocal(guess) == local) {
+        return guess;
+    }
+    // local falls in a gap where clocks went forward, so it is read with the offset from before the gap
+    return local - offsetAt(local - msecs_per_day);
+}
+
+qint64 LocalTime::wallClock(const QDate & date, const QTime & time)
+{
+    return (date.toJulianDay() - epoch_julian_day) * msecs_per_day + time.msecsSinceStartOfDay();
+}
+
+QDate LocalTime::wallDate(qint64 wall)
+{
+    qint64 days = wall / msecs_per_day;
+    if ((wall % msecs_per_day) < 0) {
+        days--;
+    }
+    return QDate::fromJulianDay(days + epoch_julian_day);
+}
+
+QTime LocalTime::wallTime(qint64 wall)
+{
+    qint64 ms = wall % msecs_per_day;
+    if (ms < 0) {
+        ms += msecs_per_day;
+    }
+    return QTime::fromMSecsSinceStartOfDay(int(ms));
+}
+
+int LocalTime::parseDigits(const QString & text, int pos, int count)
+{
+    if ((pos < 0) || (pos + count > text.size())) {
+        return -1;
+    }
+    const QChar * c = text.constData() + pos;
+    int value = 0;
+    for (int i = 0; i < count; ++i) {
+        ushort u = c[i].unicode();
+        if ((u < '0') || (u > '9')) {
+            return -1;
+        }
+        value = value * 10 + (u - '0');
+    }
+    return value;
+}
+
+QDate LocalTime::parseDate(const QString & text, int pos)
+{
+    int y = parseDigits(text, pos, 4);
+    int m = parseDigits(text, pos + 4, 2);
+    int d = parseDigits(text, pos + 6, 2);
+    if ((y < 0) || (m < 0) || (d < 0)) {
+        return QDate();
+    }
+    return QDate(y, m, d); // invalid if out of range
+}
+
+QTime LocalTime::parseTime(const QString & text, int pos)
+{
+    int h = parseDigits(text, pos, 2);
+    int m = parseDigits(text, pos + 2, 2);
+    int s = parseDigits(text, pos + 4, 2);
+    if ((h < 0) || (m < 0) || (s < 0)) {
+        return QTime();
+    }
+    return QTime(h, m, s);
+}
+
+static inline QChar * putDigits(QChar * c, int value, int count)
+{
+    for (int i = count - 1; i >= 0; --i) {
+        c[i] = QChar('0' + (value % 10));
+        value /= 10;
+    }
+    return c + count;
+}
+
+void LocalTime::formatClock(QString & out, int h, int m, int s, int ms)
+{
+    int len = 5 + ((s >= 0) ? 3 : 0) + ((s >= 0) && (ms >= 0) ? 4 : 0);
+    out.resize(len);
+
+    QChar * c = out.data();
+    c = putDigits(c, h, 2);
+    *c++ = QChar(':');
+    c = putDigits(c, m, 2);
+    if (s >= 0) {
+        *c++ = QChar(':');
+        c = putDigits(c, s, 2);
+        if (ms >= 0) {
+            *c++ = QChar(':');
+            putDigits(c, ms, 3);
+        }
+    }
+}
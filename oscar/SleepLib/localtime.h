@@ -0,0 +1,78 @@
+/* SleepLib Local Time Conversion Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef LOCALTIME_H
+#define LOCALTIME_H
+
+#include <QDate>
+#include <QTime>
+#include <QString>
+#include <QTimeZone>
+#include <QVector>
+
+/*! \class LocalTime
+    \brief Converts between UTC and local wall clock time from a precomputed table of UTC offsets
+
+    QDateTime looks the time zone up again on every conversion, which shows up when it's done for
+    every EDF file, session or axis tick. This works out every offset transition of a zone once, so
+    a conversion is a binary search and some arithmetic, and the same table can be shared read-only
+    between threads.
+
+    "Wall clock" values are milliseconds since 1970-01-01 00:00 on the local calendar, with no time
+    zone attached, which is also what the static date and time helpers take and return.
+    */
+class LocalTime
+{
+  public:
+    //! \brief Builds the offset table for zone, covering transitions between firstYear and lastYear
+    explicit LocalTime(const QTimeZone & zone, int firstYear = 1970, int lastYear = 2100);
+
+    //! \brief A zone that is always offsetSecs ahead of UTC, like the ones EDF files are written in
+    explicit LocalTime(int offsetSecs);
+
+    //! \brief The system time zone, which is what QDateTime's Qt::LocalTime uses
+    static const LocalTime & system();
+
+    //! \brief Returns the UTC offset in milliseconds in effect at utc
+    int offsetAt(qint64 utc) const;
+
+    inline qint64 toLocal(qint64 utc) const { return utc + offsetAt(utc); }
+
+    //! \brief Returns the UTC time of the wall clock time local, taking the earlier one when clocks go back
+    qint64 toUtc(qint64 local) const;
+
+    inline qint64 toUtc(const QDate & date, const QTime & time) const { return toUtc(wallClock(date, time)); }
+    inline QDate date(qint64 utc) const { return wallDate(toLocal(utc)); }
+    inline QTime time(qint64 utc) const { return wallTime(toLocal(utc)); }
+
+    //! \brief Number of offset changes in the table
+    inline int transitions() const { return m_at.size() - 1; }
+
+    static qint64 wallClock(const QDate & date, const QTime & time);
+    static QDate wallDate(qint64 wall);
+    static QTime wallTime(qint64 wall);
+
+    //! \brief Reads count decimal digits from text at pos, returning -1 if there aren't that many
+    static int parseDigits(const QString & text, int pos, int count);
+
+    //! \brief Parses "yyyyMMdd" at pos in text, returning an invalid date if it doesn't fit
+    static QDate parseDate(const QString & text, int pos = 0);
+
+    //! \brief Parses "HHmmss" at pos in text, returning an invalid time if it doesn't fit
+    static QTime parseTime(const QString & text, int pos = 0);
+
+    /*! \brief Writes "HH:mm", "HH:mm:ss" or "HH:mm:ss:zzz" into out, leaving out seconds or milliseconds when negative.
+        out keeps its buffer, so formatting into the same string again doesn't allocate */
+    static void formatClock(QString & out, int h, int m, int s = -1, int ms = -1);
+
+  protected:
+    QVector<qint64> m_at;   // UTC time each offset starts, the first one covering everything before
+    QVector<int> m_offset;  // offset in milliseconds
+};
+
+#endif // LOCALTIME_H
@@ -14,6 +14,7 @@
 #include <QObject>
 #include <QThreadPool>
 #include <QFile>
+#include <QSaveFile>
 #include <QDataStream>
 #include <QDomDocument>
 #include <QDomElement>
@@ -26,6 +27,7 @@
 #include "mainwindow.h"
 
 #include "progressdialog.h"
+#include "integrity.h"
 
 #include <time.h>
 
@@ -34,6 +36,7 @@
 #include <algorithm>
 #include "SleepLib/schema.h"
 #include "SleepLib/day.h"
+#include "SleepLib/localtime.h"
 #include "mainwindow.h"
 
 extern MainWindow * mainwin;
@@ -75,6 +78,18 @@ void SaveTask::run()
     sess->TrashEvents();
 }
 
+void CompactTask::run()
+{
+    // The summary is needed too, as the events file header carries the session times
+    mach->saveMutex.lock();
+    Session * copy = new Session(mach, id);
+    if (!copy->LoadSummary() || !copy->CompactEvents()) {
+        qWarning() << "Could not compact events overlay of session" << id;
+    }
+    delete copy;
+    mach->saveMutex.unlock();
+}
+
 void LoadTask::run()
 {
     sess->LoadSummary();
@@ -254,10 +269,11 @@ QDate Machine::pickDate(qint64 first)
     QTime split_time = profile->session->daySplitTime();
     int combine_sessions = profile->session->combineCloseSessions();
 
-    QDateTime d2 = QDateTime::fromTime_t(first / 1000);
+    // Whole seconds, as fromTime_t used to give, looked up in the cached local time table
+    qint64 wall = LocalTime::system().toLocal((first / 1000L) * 1000L);
 
-    QDate date = d2.date();
-    QTime time = d2.time();
+    QDate date = LocalTime::wallDate(wall);
+    QTime time = LocalTime::wallTime(wall);
 
     int closest_session = 0;
 
@@ -267,8 +283,7 @@ QDate Machine::pickDate(qint64 first)
         QMap<QDate, Day *>::iterator dit = day.find(date.addDays(-1)); // Check Day Before
 
         if (dit != day.end()) {
-            QDateTime lt = QDateTime::fromTime_t(dit.value()->last() / 1000L);
-            closest_session = lt.secsTo(d2) / 60;
+            closest_session = ((first / 1000L) - (dit.value()->last() / 1000L)) / 60;
 
             if (closest_session < combine_sessions) {
                 date = date.addDays(-1);
@@ -289,6 +304,9 @@ bool Machine::AddSession(Session *s)
         qCritical() << "AddSession() called without a valid profile";
         return false;
     }
+    // Days are shared between machines, which may be importing at the same time
+    QMutexLocker lock(&profile->importMutex);
+
     if (sessionlist.contains(s->session())) {
         qCritical() << "Machine::AddSession called with duplicate session" << s->session()
                     << "["+QDateTime::fromTime_t(s->session()).toString("MMM dd, yyyy hh:mm:ss")+"]"
@@ -332,19 +350,23 @@ bool Machine::AddSession(Session *s)
 
     int ignore_sessions = profile->session->ignoreShortSessions();
 
-    qint64 session_length = s->last() - s->first();
+    qint64 first = s->first();
+    qint64 last = s->last();
+
+    qint64 session_length = last - first;
     session_length /= 60000L;
 
     sessionlist[s->session()] = s; // To make sure it get's saved later even if it's not wanted.
 
     //int drift=profile->cpap->clockDrift();
 
-    QDateTime d2 = QDateTime::fromTime_t(s->first() / 1000);
+    // Whole seconds, as fromTime_t used to give, looked up in the cached local time table
+    qint64 wall = LocalTime::system().toLocal((first / 1000L) * 1000L);
 
-    QDate date = d2.date();
-    QTime time = d2.time();
+    QDate date = LocalTime::wallDate(wall);
+    QTime time = LocalTime::wallTime(wall);
 
-    QMap<QDate, Day *>::iterator dit, nextday;
+    QMap<QDate, Day *>::iterator dit;
 
     bool combine_next_day = false;
     int closest_session = 0;
@@ -352,14 +374,15 @@ bool Machine::AddSession(Session *s)
 
     // Multithreaded import screws this up. :(
 
+    // Combining goes by the neighbouring Day's enabled sessions, whichever machine they're from,
+    // while the sessions pulled forward from the next day come from this machine's session index.
     if (time < split_time) {
         date = date.addDays(-1);
     } else if (combine_sessions > 0) {
         dit = day.find(date.addDays(-1)); // Check Day Before
 
         if (dit != day.end()) {
-            QDateTime lt = QDateTime::fromTime_t(dit.value()->last() / 1000);
-            closest_session = lt.secsTo(d2) / 60;
+            closest_session = ((first / 1000L) - (dit.value()->last() / 1000L)) / 60;
 
             if (closest_session < combine_sessions) {
                 date = date.addDays(-1);
@@ -371,11 +394,10 @@ bool Machine::AddSession(Session *s)
                 }
             }
         } else {
-            nextday = day.find(date.addDays(1)); // Check Day Afterwards
+            dit = day.find(date.addDays(1)); // Check Day Afterwards
 
-            if (nextday != day.end()) {
-                QDateTime lt = QDateTime::fromTime_t(nextday.value()->first() / 1000);
-                closest_session = d2.secsTo(lt) / 60;
+            if (dit != day.end()) {
+                closest_session = ((dit.value()->first() / 1000L) - (first / 1000L)) / 60;
 
                 if (closest_session < combine_sessions) {
                     // add todays here. pull all tomorrows records to this date.
@@ -388,7 +410,8 @@ bool Machine::AddSession(Session *s)
     if (session_length < ignore_sessions) {
         // keep the session to save importing it again, but don't add it to the day record this time
         qDebug() << s->session() << "Ignoring short session <" << ignore_sessions
-            << "["+QDateTime::fromMSecsSinceEpoch(s->first()).toString("MMM dd, yyyy hh:mm:ss")+"]";
+            << "["+QDateTime::fromMSecsSinceEpoch(first).toString("MMM dd, yyyy hh:mm:ss")+"]";
+        m_sessionIndex.insert(s);
         return true;
     }
 
@@ -411,35 +434,44 @@ bool Machine::AddSession(Session *s)
     dd = dit.value();
 
     dd->addSession(s);
+    m_sessionIndex.insert(s, date);
+    profile->calendar.invalidate(date);
 
     if (combine_next_day) {
-        for (QList<Session *>::iterator i = nextday.value()->begin(); i != nextday.value()->end(); i++) {
+        const QList<Session *> nextsessions = m_sessionIndex.sessionsOn(date.addDays(1));
+        for (Session * sess : nextsessions) {
             // i may need to do something here
-            if (locksessions && (*i)->summaryOnly()) continue; // can't move summary only sessions..
-            unlinkSession(*i);
+            if (locksessions && sess->summaryOnly()) continue; // can't move summary only sessions..
+            unlinkSession(sess);
             // Add it back
 
-            sessionlist[(*i)->session()] = *i;
+            sessionlist[sess->session()] = sess;
 
-            dd->addSession(*i);
+            dd->addSession(sess);
+            m_sessionIndex.insert(sess, date);
         }
+    }
 
-//        QMap<QDate, QList<Day *> >::iterator nd = profile->daylist.find(date.addDays(1));
-//        if (nd != profile->daylist.end()) {
-//            profile->unlinkDay(nd.key(), nd.value());
-//        }
+    return true;
+}
 
-//        QList<Day *>::iterator iend = nd.value().end();
-//        for (QList<Day *>::iterator i = nd.value()->begin(); i != iend; ++i) {
-//            if (*i == nextday.value()) {
-//                nd.value().erase(i);
-//            }
-//        }
+bool Machine::AddSessions(QList<Session *> sessions)
+{
+    // Adding in start order means a session can only ever combine with the day before it,
+    // so nothing gets pulled back out of an already built day.
+    std::sort(sessions.begin(), sessions.end(), [](Session * a, Session * b) {
+        return a->realFirst() < b->realFirst();
+    });
 
-//        day.erase(nextday);
-    }
+    sessionlist.reserve(sessionlist.size() + sessions.size());
 
-    return true;
+    bool result = true;
+    for (Session * sess : sessions) {
+        if ( ! AddSession(sess)) {
+            result = false;
+        }
+    }
+    return result;
 }
 
 bool Machine::unlinkDay(Day * d)
@@ -469,6 +501,9 @@ bool Machine::unlinkSession(Session * sess)
     // Remove the object from the machine object's session list
     bool b=sessionlist.remove(sess->session());
 
+    QDate indexed = m_sessionIndex.date(sess);
+    m_sessionIndex.remove(sess);
+
     QList<QDate> dates;
 
     QList<Day *> days;
@@ -476,12 +511,19 @@ bool Machine::unlinkSession(Session * sess)
 
     Day * d;
 
-    // Doing this in case of accidental double linkages
-    for (it = day.begin(); it != day.end(); ++it) {
-        d = it.value();
-        if (it.value()->sessions.contains(sess)) {
-            days.push_back(d);
-            dates.push_back(it.key());
+    // The session index knows which day it was put in..
+    it = day.find(indexed);
+    if ((it != day.end()) && it.value()->sessions.contains(sess)) {
+        days.push_back(it.value());
+        dates.push_back(it.key());
+    } else {
+        // ..but do it the slow way in case of accidental double linkages
+        for (it = day.begin(); it != day.end(); ++it) {
+            d = it.value();
+            if (it.value()->sessions.contains(sess)) {
+                days.push_back(d);
+                dates.push_back(it.key());
+            }
         }
     }
 
@@ -489,6 +531,8 @@ bool Machine::unlinkSession(Session * sess)
         d = days.at(i);
         if (d->sessions.removeAll(sess)) {
             b=true;
+            d->invalidate();
+            profile->calendar.invalidate(dates[i]);
             if (!d->searchMachine(mt)) {
                 d->machines.remove(mt);
                 day.remove(dates[i]);
@@ -533,6 +577,8 @@ bool Machine::Purge(int secret)
     QFile sumfile(getDataPath()+"/Summaries.xml.gz");
     sumfile.remove();
 
+    journal().clear();
+
     QFile sessinfofile(getDataPath()+"/Sessions.info");
     sessinfofile.remove();
 
@@ -557,6 +603,8 @@ bool Machine::Purge(int secret)
     for (auto & d : days) {
         d->removeMachine(this);
     }
+    m_sessionIndex.clear();
+    profile->calendar.clear();
 
     // Remove EVERYTHING under Events folder..
     QString eventspath = getEventsPath();
@@ -624,6 +672,12 @@ const QString Machine::getDataPath()
                  + (info.serial.isEmpty() ? hexid() : info.serial) + "/";
     return m_dataPath;
 }
+SessionJournal & Machine::journal()
+{
+    m_journal.setFileName(getDataPath() + SessionJournal::fileName);
+    return m_journal;
+}
+
 const QString Machine::getSummariesPath()
 {
     return getDataPath() + "Summaries/";
@@ -632,6 +686,10 @@ const QString Machine::getEventsPath()
 {
     return getDataPath() + "Events/";
 }
+const QString Machine::getRollupsPath()
+{
+    return getDataPath() + "Rollups/";
+}
 const QString Machine::getBackupPath()
 {
     qDebug() << "Backup Path is " + getDataPath() + "Backup/";
@@ -687,18 +745,12 @@ bool Machine::Load(ProgressDialog *progress)
     }
     progress->setMessage(QObject::tr("Loading %1 data for %2...").arg(info.brand).arg(profile->user->userName()));
 
-    if (loader()) {
-        mainwin->connect(loader(), SIGNAL(updateMessage(QString)), progress, SLOT(setMessage(QString)));
-        mainwin->connect(loader(), SIGNAL(setProgressMax(int)),   progress, SLOT(setProgressMax(int)));
-        mainwin->connect(loader(), SIGNAL(setProgressValue(int)), progress, SLOT(setProgressValue(int)));
-    }
-
     if ( ! LoadSummary(progress)) {
         qDebug() << "Recreating the Summary index XML file";
         // No XML index file, so assume upgrading, or it simply just got screwed up or deleted...
         progress->setMessage(QObject::tr("Scanning Files"));
         progress->setProgressValue(0);
-        QApplication::processEvents();
+        ProgressTracker::pumpEvents();
 
         QTime time;
         time.start();
@@ -731,81 +783,42 @@ bool Machine::Load(ProgressDialog *progress)
         filelist = dir.entryList();
         size = filelist.size();
         progress->setMessage(QObject::tr("Migrating Summary File Location"));
-        progress->setProgressMax(size);
-        QApplication::processEvents();
+        ProgressTracker tracker;
+        tracker.setMax(size);
+        progress->track(&tracker);
+        ProgressTracker::pumpEvents();
         if (size > 0) {
             if (!dir.exists(eventpath)) dir.mkpath(eventpath);
             for (int i=0; i< size; i++) {
-                if ((i % 20) == 0) { // This is slow.. :-/
-                    progress->setProgressValue(i);
-
-                    QApplication::processEvents();
-                }
+                tracker.setValue(i);
+                ProgressTracker::pumpEvents();
 
                 QString filename = filelist.at(i);
                 QFile::rename(path+filename, eventpath+filename);
             }
         }
+        progress->track(nullptr);
 
         ///////////////////////////////////////////////////////////////////////
         // Now read summary files from correct location and load them
         ///////////////////////////////////////////////////////////////////////
-        dir.setPath(summarypath);
-        filters.clear();
-        filters << "*.000";
-        dir.setNameFilters(filters);
-        filelist = dir.entryList();
-        size = filelist.size();
-
         progress->setMessage("Reading summary files");
         qDebug() << "Reading summary files (.000)";
-        progress->setProgressValue(0);
-        QApplication::processEvents();
-
-        QString sesstr;
-        SessionID sessid;
-        bool ok;
-
-        for (int i=0; i < size; i++) {
-
-            if ((i % 20) == 0) { // This is slow.. :-/
-                progress->setProgressValue(i);
-                QApplication::processEvents();
-            }
-
-            QString filename = filelist.at(i);
-            sesstr = filename.section(".", 0, -2);
-            sessid = sesstr.toLong(&ok, 16);
-
-            if (!ok) { continue; }
+        ProgressTracker::pumpEvents();
 
-            Session *sess = new Session(this, sessid);
+        // Read on every core, with unreadable summaries logged rather than silently dropped
+        IntegrityScanner scanner(this);
+        scanner.scan(false, progress);
+        scanner.rebuild();
 
-            // Forced to load it, because know nothing about this session..
-            if (sess->LoadSummary()) {
-                AddSession(sess);
-            } else {
-                qWarning() << "Error loading summary file" << filename;
-                delete sess;
-            }
-        }
-
-        SaveSummaryCache();
         qDebug() << "Loaded" << info.model.toLocal8Bit().data() << "data in" << time.elapsed() << "ms";
-        progress->setProgressValue(size);
     }
     progress->setMessage("Loading Session Info");
     qDebug() << "Loading Session Info";
-    QApplication::processEvents();
+    ProgressTracker::pumpEvents();
 
     loadSessionInfo();
 
-    if (loader()) {
-        mainwin->disconnect(loader(), SIGNAL(updateMessage(QString)), progress, SLOT(setMessage(QString)));
-        mainwin->disconnect(loader(), SIGNAL(setProgressMax(int)),   progress, SLOT(setProgressMax(int)));
-        mainwin->disconnect(loader(), SIGNAL(setProgressValue(int)), progress, SLOT(setProgressValue(int)));
-    }
-
     return true;
 }
 
@@ -813,6 +826,8 @@ bool Machine::SaveSession(Session *sess)
 {
     QString path = getDataPath();
 
+    // Background upgrades and compactions rewrite the same files under this lock
+    QMutexLocker lock(&saveMutex);
     if (sess->IsChanged() && sess->first() != 0) {
         sess->Store(path);
     }
@@ -901,7 +916,7 @@ bool Machine::LoadSummary(ProgressDialog * progress)
     QFile file(filename);
     qDebug() << "Loading" << filename.toLocal8Bit().data();
     progress->setMessage(QObject::tr("Loading Summaries.xml.gz"));
-    QApplication::processEvents();
+    ProgressTracker::pumpEvents();
 
     if (!file.open(QIODevice::ReadOnly)) {
 //        qWarning() << "Could not open" << filename;
@@ -944,13 +959,14 @@ bool Machine::LoadSummary(ProgressDialog * progress)
     int size = sessionlist.size();
 
     QMap<qint64, Session *>  sess_order;
+    QHash<SessionID, Session *> sess_ids;
 
-    progress->setProgressMax(size);
+    ProgressTracker tracker;
+    tracker.setMax(size);
+    progress->track(&tracker);
     for (int s=0; s < size; ++s) {
-        if ((s % 20) == 0) {
-            progress->setProgressValue(s);
-            QApplication::processEvents();
-        }
+        tracker.setValue(s);
+        ProgressTracker::pumpEvents();
         node = sessionlist.at(s);
         QDomElement e = node.toElement();
         SessionID sessid = e.attribute("id", "0").toLong(&s_ok);
@@ -959,15 +975,16 @@ bool Machine::LoadSummary(ProgressDialog * progress)
         bool enabled = e.attribute("enabled", "1").toInt() == 1;
         bool events = e.attribute("events", "1").toInt() == 1;
         if (s_ok) {
-            Session * sess = new Session(this, sessid);
-            sess->really_set_first(first);
-            sess->really_set_last(last);
-            sess->setEnabled(enabled);
-            sess->setSummaryOnly(!events);
+            SessionJournal::Record rec;
+            rec.id = sessid;
+            rec.first = first;
+            rec.last = last;
+            rec.enabled = enabled;
+            rec.summaryOnly = !events;
 
             if (e.hasChildNodes()) {
-                QList<ChannelID> available_channels;
-                QList<ChannelID> available_settings;
+                QList<ChannelID> & available_channels = rec.channels;
+                QList<ChannelID> & available_settings = rec.settings;
 
                 QDomElement chans = e.firstChildElement("channels");
                 if (chans.isElement()) {
@@ -980,7 +997,6 @@ bool Machine::LoadSummary(ProgressDialog * progress)
                         available_channels.append(code);
                     }
                 }
-                sess->m_availableChannels = available_channels;
 
                 QDomElement sete = e.firstChildElement("settings");
                 if (sete.isElement()) {
@@ -992,14 +1008,40 @@ bool Machine::LoadSummary(ProgressDialog * progress)
                         available_settings.append(code);
                     }
                 }
-                sess->m_availableSettings = available_settings;
             }
 
+            Session * sess = rec.toSession(this);
             sess_order[first] = sess;
+            sess_ids[sessid] = sess;
+        }
+    }
+
+    // Sessions stored after the index was last saved, eg. by an import interrupted by a crash
+    const QList<SessionJournal::Record> replay = journal().records();
+    const QString summaries = getSummariesPath();
+    for (const auto & rec : replay) {
+        // Skip sessions deleted again before the index was saved
+        if (!QFile::exists(summaries + QString().sprintf("%08lx.000", rec.id))) {
+            continue;
         }
+        // A later record for the same session supersedes the indexed one
+        Session * old = sess_ids.value(rec.id, nullptr);
+        if (old) {
+            if (sess_order.value(old->realFirst()) == old) {
+                sess_order.remove(old->realFirst());
+            }
+            delete old;
+        }
+        Session * sess = rec.toSession(this);
+        sess_order[rec.first] = sess;
+        sess_ids[rec.id] = sess;
+    }
+    if (!replay.isEmpty()) {
+        qDebug() << "Replayed" << replay.size() << "journaled sessions for" << info.loadername << info.serial;
     }
     QMap<qint64, Session *>::iterator it_end = sess_order.end();
     QMap<qint64, Session *>::iterator it;
+    this->sessionlist.reserve(this->sessionlist.size() + sess_order.size());
     bool loadSummaries = profile->session->preloadSummaries();
     qDebug() << "PreloadSummaries is" << (loadSummaries ? "true" : "false");
     qDebug() << "Queue task loader is" << (loader() ? "" : "not ") << "available";
@@ -1034,15 +1076,21 @@ bool Machine::LoadSummary(ProgressDialog * progress)
     }
     progress->setMessage(QObject::tr("Loading Summary Data"));
     qDebug() << "Loading Summary Data";
-    QApplication::processEvents();
+    ProgressTracker::pumpEvents();
 
     if (loader()) {
+        progress->track(&loader()->progress());
         loader()->runTasks();
     } else {
         runTasks();
     }
+    progress->track(nullptr);
     progress->setProgressValue(sess_order.size());
-    QApplication::processEvents();
+    ProgressTracker::pumpEvents();
+
+    if (!replay.isEmpty()) {
+        SaveSummaryCache();
+    }
 
     qDebug() << "Loaded" << info.model.toLocal8Bit().data() << "data in" << time.elapsed() << "ms";
 
@@ -1080,17 +1128,10 @@ bool Machine::SaveSummaryCache()
         el.setAttribute("enabled", sess->enabled() ? "1" : "0");
         el.setAttribute("events", sess->summaryOnly() ? "0" : "1");
 
-        QHash<ChannelID, QVector<EventList *> >::iterator ev;
-        QHash<ChannelID, QVector<EventList *> >::iterator ev_end = sess->eventlist.end();
+        SessionJournal::Record rec = SessionJournal::Record::fromSession(sess);
         QStringList chanlist;
-        for (ev = sess->eventlist.begin(); ev != ev_end; ++ev) {
-            chanlist.append(QString::number(ev.key(), 16));
-        }
-        if (chanlist.size() == 0) {
-            for (int i=0; i<sess->m_availableChannels.size(); i++) {
-                ChannelID code = sess->m_availableChannels.at(i);
-                chanlist.append(QString::number(code, 16));
-            }
+        for (ChannelID code : rec.channels) {
+            chanlist.append(QString::number(code, 16));
         }
 
         QDomElement chans = doc.createElement("channels");
@@ -1098,10 +1139,8 @@ bool Machine::SaveSummaryCache()
         el.appendChild(chans);
 
         chanlist.clear();
-        QHash<ChannelID, QVariant>::iterator si;
-        QHash<ChannelID, QVariant>::iterator set_end = sess->settings.end();
-        for (si = sess->settings.begin(); si != set_end; ++si) {
-            chanlist.append(QString::number(si.key(), 16));
+        for (ChannelID code : rec.settings) {
+            chanlist.append(QString::number(code, 16));
         }
         QDomElement settings = doc.createElement("settings");
         settings.appendChild(doc.createTextNode(chanlist.join(",")));
@@ -1118,13 +1157,21 @@ bool Machine::SaveSummaryCache()
 
     QByteArray data = gCompress(xmltext.toUtf8());
 
-    QFile file(filename + ".gz");
+    QSaveFile file(filename + ".gz");
 
     if (!file.open(QFile::WriteOnly)) {
         qWarning() << "Couldn't open summary cache" << filename << "for writing, error code" << file.error() << file.errorString();
+        return false;
     }
     file.write(data);
 
+    // The old index stays in place until the new one is complete, and the journal until both are
+    if (!file.commit()) {
+        qWarning() << "Couldn't commit summary cache" << filename << "error code" << file.error() << file.errorString();
+        return false;
+    }
+    journal().clear();
+
     return true;
 }
 
@@ -1155,9 +1202,36 @@ bool Machine::Save()
 
     runTasks();
 
+    compactOverlays();
+
     return true;
 }
 
+// Overlays keep recent edits cheap, but each one costs an extra read whenever its session is opened
+const int overlay_compact_days = 7;
+
+void Machine::compactOverlays()
+{
+    QDir dir(getEventsPath());
+    const QFileInfoList overlays = dir.entryInfoList(QStringList() << "*.003", QDir::Files);
+    QDateTime stale = QDateTime::currentDateTime().addDays(-overlay_compact_days);
+
+    for (const auto & fi : overlays) {
+        if (fi.lastModified() > stale) {
+            continue;
+        }
+        bool ok;
+        SessionID id = fi.baseName().toUInt(&ok, 16);
+        Session * sess = ok ? sessionlist.value(id, nullptr) : nullptr;
+
+        // Leave sessions that are open alone, they'll be stored again soon enough
+        if (sess && !sess->eventsLoaded()) {
+            queTask(new CompactTask(id, this));
+        }
+    }
+    runTasks();
+}
+
 void Machine::updateChannels(Session * sess)
 {
     int size = sess->m_availableChannels.size();
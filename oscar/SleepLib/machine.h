@@ -31,6 +31,8 @@
 #include "SleepLib/session.h"
 #include "SleepLib/schema.h"
 #include "SleepLib/day.h"
+#include "SleepLib/sessionindex.h"
+#include "SleepLib/sessionjournal.h"
 
 
 class Day;
@@ -92,6 +94,23 @@ protected:
     Machine * mach;
 };
 
+/*! \class CompactTask
+    \brief Folds a session's events overlay back into its events file, through a private copy of the Session
+
+    Only the session id is kept, so the Session the GUI thread uses is never touched off it.
+    */
+class CompactTask:public ImportTask
+{
+public:
+    CompactTask(SessionID id, Machine * m): id(id), mach(m) {}
+    virtual ~CompactTask() {}
+    virtual void run();
+
+protected:
+    SessionID id;
+    Machine * mach;
+};
+
 class MachineLoader;    // forward
 
 /*! \class Machine
@@ -116,8 +135,12 @@ class Machine
 
     bool LoadSummary(ProgressDialog *progress);
 
-    //! \brief Save all Sessions where changed bit is set.
+    //! \brief Save all Sessions where changed bit is set, then compact any stale events overlays.
     bool Save();
+
+    /*! \brief Folds events overlays untouched for a while back into their events files.
+        GUI thread only, as it checks which sessions are open */
+    void compactOverlays();
     bool SaveSummaryCache();
 
     //! \brief Save individual session
@@ -145,14 +168,27 @@ class Machine
     //! \brief Adds the session to this machine object, and the Master Profile list. (used during load)
     bool AddSession(Session *s);
 
+    //! \brief Bulk version of AddSession, adds sessions in start order. Returns false if any were rejected.
+    bool AddSessions(QList<Session *> sessions);
+
+    //! \brief Returns the index of which days this machine's sessions were assigned to
+    const SessionIndex & sessionIndex() const { return m_sessionIndex; }
+
+    //! \brief Drops sess from the session index, for when it's removed from its Day directly
+    inline bool unindexSession(Session * sess) { return m_sessionIndex.remove(sess); }
+
     //! \brief Find the date this session belongs in, according to profile settings
     QDate pickDate(qint64 start);
 
     const QString getDataPath();
     const QString getEventsPath();
+    const QString getRollupsPath();
     const QString getSummariesPath();
     const QString getBackupPath();
 
+    //! \brief Returns the write-ahead journal of sessions stored since the summary index was last saved
+    SessionJournal & journal();
+
     qint64 diskSpaceSummaries();
     qint64 diskSpaceEvents();
     qint64 diskSpaceBackups();
@@ -291,6 +327,12 @@ class Machine
     QHash<ChannelID, bool> m_availableChannels;
     QHash<ChannelID, bool> m_availableSettings;
 
+    //! \brief The days sessions were assigned to
+    SessionIndex m_sessionIndex;
+
+    //! \brief Sessions stored but not yet committed to Summaries.xml.gz
+    SessionJournal m_journal;
+
     QString m_summaryPath;
     QString m_eventsPath;
     QString m_dataPath;
@@ -13,6 +13,7 @@
 #include <QThreadPool>
 
 #include "machine_loader.h"
+#include "gzipdevice.h"
 
 // GLOBALS:
 bool genpixmapinit = false;
@@ -31,6 +32,7 @@ MachineLoader::MachineLoader() :QObject(nullptr)
     m_abort = false;
     m_type = MT_UNKNOWN;
     m_status = NEUTRAL;
+    m_pendingMachine = nullptr;
 }
 
 MachineLoader::~MachineLoader()
@@ -56,16 +58,87 @@ void MachineLoader::addSession(Session * sess)
 }
 
 void MachineLoader::finishAddingSessions()
+{
+    // Days and machines are only changed on the GUI thread, which reads them without locking
+    if (importingInBackground()) {
+        return;
+    }
+    addPendingSessions();
+}
+
+void MachineLoader::addPendingSessions()
 {
     // Using a map specifically so they are inserted in order.
+    QMap<Machine *, QList<Session *> > bymachine;
     for (auto it=new_sessions.begin(), end=new_sessions.end(); it != end; ++it) {
         Session * sess = it.value();
-        Machine * mach = sess->machine();
-        mach->AddSession(sess);
+        bymachine[sess->machine()].append(sess);
+    }
+    for (auto it=bymachine.begin(), end=bymachine.end(); it != end; ++it) {
+        it.key()->AddSessions(it.value());
     }
     new_sessions.clear();
 }
 
+void MachineLoader::commitSessions()
+{
+    addPendingSessions();
+
+    for (Machine * mach : m_unsaved) {
+        mach->Save();
+    }
+    m_unsaved.clear();
+
+    for (Machine * mach : m_purged) {
+        mach->clearPurgeDate();
+    }
+    m_purged.clear();
+}
+
+Machine * MachineLoader::createMachine(const MachineInfo & info, const QHash<QString, QString> & properties)
+{
+    // Only one Open() runs at a time per loader, so the pending fields are this call's alone
+    m_pendingInfo = info;
+    m_pendingProperties = properties;
+    if (importingInBackground()) {
+        QMetaObject::invokeMethod(this, "createPendingMachine", Qt::BlockingQueuedConnection);
+    } else {
+        createPendingMachine();
+    }
+    Machine * mach = m_pendingMachine;
+    m_pendingMachine = nullptr;
+    m_pendingProperties.clear();
+    return mach;
+}
+
+void MachineLoader::createPendingMachine()
+{
+    m_pendingMachine = p_profile->CreateMachine(m_pendingInfo);
+    if (m_pendingMachine) {
+        for (auto it = m_pendingProperties.begin(), end = m_pendingProperties.end(); it != end; ++it) {
+            m_pendingMachine->properties[it.key()] = it.value();
+        }
+    }
+}
+
+void MachineLoader::saveMachine(Machine * mach)
+{
+    if (importingInBackground()) {
+        m_unsaved.insert(mach);
+    } else {
+        mach->Save();
+    }
+}
+
+void MachineLoader::clearPurgeDate(Machine * mach)
+{
+    if (importingInBackground()) {
+        m_purged.insert(mach);
+    } else {
+        mach->clearPurgeDate();
+    }
+}
+
 QPixmap & MachineLoader::getPixmap(QString series)
 {
     QHash<QString, QPixmap>::iterator it = m_pixmaps.find(series);
@@ -96,7 +169,7 @@ void MachineLoader::runTasks(bool threaded)
     qDebug() << "MachineLoader::runTasks MLtasklist size is" << m_totalMLtasks;
     if (m_totalMLtasks == 0) 
         return;
-    emit setProgressMax(m_totalMLtasks);
+    m_progress.setMax(m_totalMLtasks);
     m_currentMLtask=0;
 
     threaded=AppSetting->multithreading();
@@ -108,8 +181,8 @@ void MachineLoader::runTasks(bool threaded)
 
             // update progress bar
             m_currentMLtask++;
-            emit setProgressValue(m_currentMLtask);
-            QApplication::processEvents();
+            m_progress.setValue(m_currentMLtask);
+            ProgressTracker::pumpEvents();
 
             delete task;
         }
@@ -128,8 +201,8 @@ void MachineLoader::runTasks(bool threaded)
                     task = m_MLtasklist[0];
 
                     // update progress bar
-                    emit setProgressValue(++m_currentMLtask);
-                    QApplication::processEvents();
+                    m_progress.setValue(++m_currentMLtask);
+                    ProgressTracker::pumpEvents();
                 } else {
                     // job list finished
                     break;
@@ -219,6 +292,21 @@ QList<ChannelID> CPAPLoader::eventFlags(Day * day)
     return list;
 }
 
+// Streams everything from in to out a chunk at a time, returns false on a read or write error
+static bool copyDevice(QIODevice & in, QIODevice & out)
+{
+    static const int CHUNK_SIZE = 1048576;
+    QByteArray buffer(CHUNK_SIZE, Qt::Uninitialized);
+
+    qint64 n;
+    while ((n = in.read(buffer.data(), buffer.size())) > 0) {
+        if (out.write(buffer.constData(), n) != n) {
+            return false;
+        }
+    }
+    return n == 0;
+}
+
 bool uncompressFile(QString infile, QString outfile)
 {
     if (!infile.endsWith(".gz",Qt::CaseInsensitive)) {
@@ -231,38 +319,30 @@ bool uncompressFile(QString infile, QString outfile)
         return false;
     }
 
-    // Get file length from inside gzip file
     QFile fi(infile);
-
-    if (!fi.open(QFile::ReadOnly) || !fi.seek(fi.size() - 4)) {
+    GzipDevice gz(&fi);
+    if (!gz.open(QFile::ReadOnly)) {
+        qWarning() << "uncompressFile() Couldn't open" << infile << gz.errorString();
         return false;
     }
 
-    unsigned char ch[4];
-    fi.read((char *)ch, 4);
-    quint32 datasize = ch[0] | (ch [1] << 8) | (ch[2] << 16) | (ch[3] << 24);
-
-    // Open gzip file for reading
-    gzFile f = gzopen(infile.toLatin1(), "rb");
-    if (!f) {
+    QFile out(outfile);
+    if (!out.open(QFile::WriteOnly)) {
+        qWarning() << "uncompressFile() Couldn't open" << outfile << "for writing" << out.errorString();
+        gz.close();
         return false;
     }
-
-
-    // Decompressed header and data block
-    char * buffer = new char [datasize];
-    gzread(f, buffer, datasize);
-    gzclose(f);
-
-    QFile out(outfile);
-    if (out.open(QFile::WriteOnly)) {
-        out.write(buffer, datasize);
-        out.close();
+    bool ok = copyDevice(gz, out);
+    out.close();
+    gz.close();
+
+    if (!ok) {
+        // Don't leave a short file behind to be mistaken for the real thing
+        qWarning() << "uncompressFile() failed to uncompress" << infile << gz.errorString() << out.errorString();
+        out.remove();
+        return false;
     }
-
-    delete [] buffer;
     return true;
-
 }
 
 bool compressFile(QString infile, QString outfile)
@@ -284,35 +364,24 @@ bool compressFile(QString infile, QString outfile)
         return false;
     }
 
-    qint64 size = f.size();
-
     if (!f.open(QFile::ReadOnly)) {
         qDebug() << "compressFile() Couldn't open" << infile;
         return false;
     }
 
-    char *buf = new char [size];
-
-    if (!f.read(buf, size)) {
-        delete [] buf;
-        qDebug() << "compressFile() Couldn't read all of" << infile;
-        return false;
-    }
-
-    f.close();
-
-    gzFile gz = gzopen(outfile.toLatin1(), "wb");
-
-    //gzbuffer(gz,65536*2);
-    if (!gz) {
+    QFile out(outfile);
+    GzipDevice gz(&out);
+    if (!gz.open(QFile::WriteOnly)) {
         qDebug() << "compressFile() Couldn't open" << outfile << "for writing";
-        delete [] buf;
         return false;
     }
 
-    gzwrite(gz, buf, size);
-    gzclose(gz);
-    delete [] buf;
-    return true;
+    bool ok = copyDevice(f, gz);
+    if (!ok) {
+        qDebug() << "compressFile() Couldn't read all of" << infile;
+    }
+    gz.close();
+    f.close();
+    return ok;
 }
 
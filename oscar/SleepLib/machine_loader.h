@@ -13,10 +13,13 @@
 #include <QMutex>
 #include <QRunnable>
 #include <QPixmap>
+#include <QSet>
+#include <QThread>
 
 
 #include "profiles.h"
 #include "machine.h"
+#include "progresstracker.h"
 #ifdef _MSC_VER
 #include "QtZlib/zlib.h"
 #else
@@ -56,6 +59,20 @@ class MachineLoader: public QObject
     //! \brief Override this to scan path and detect new machine data
     virtual int Open(const QString & path) = 0;
 
+    /*! \brief Override to return true if Open() never touches the GUI, so ImportCoordinator can run it on a worker thread.
+        Such loaders must hold p_profile->importMutex whenever they look through the profile's days themselves, and
+        only change the profile and its machines through createMachine(), addSession(), finishAddingSessions(),
+        saveMachine() and clearPurgeDate(), which leave the changes to the GUI thread */
+    virtual bool canImportInBackground() { return false; }
+
+    /*! \brief Called on the GUI thread before Open(path) is run on a worker, for any preferences the import
+        has to change, as those can't be written while the GUI and other imports are reading them */
+    virtual void prepareImport(const QString & path) { Q_UNUSED(path); }
+
+    /*! \brief Adds the sessions a background Open() collected to their machines, then saves and clears the
+        purge dates of the machines it asked to. GUI thread only, called by ImportCoordinator once Open() returns */
+    void commitSessions();
+
     //! \brief Override to returns the Version number of this MachineLoader
     virtual int Version() = 0;
 
@@ -86,6 +103,9 @@ class MachineLoader: public QObject
 
     inline int countTasks() { return m_MLtasklist.size(); }
 
+    //! \brief Import progress, updated from whichever thread runs Open() and polled by the GUI
+    inline ProgressTracker & progress() { return m_progress; }
+
     inline bool isAborted() { return m_abort; }
     inline void abort() { m_abort = true; }
 
@@ -96,14 +116,25 @@ public slots:
 
 signals:
     void updateProgress(int cnt, int total);
-    void setProgressMax(int max);
-    void setProgressValue(int val);
-    void updateMessage(QString);
     void machineUnsupported(Machine *);
 
 protected:
+    //! \brief True while Open() runs on an ImportCoordinator worker, rather than on the GUI thread
+    inline bool importingInBackground() const { return QThread::currentThread() != thread(); }
+
+    //! \brief Adds the sessions collected by addSession() to their machines, or leaves that to commitSessions() on a worker
     void finishAddingSessions();
 
+    /*! \brief Profile::CreateMachine, which also updates the info and properties of a machine already there.
+        On a worker this waits for the GUI thread to do it, as the GUI reads the machine list without locking */
+    Machine * createMachine(const MachineInfo & info, const QHash<QString, QString> & properties = QHash<QString, QString>());
+
+    //! \brief Machine::Save(), left to commitSessions() on a worker
+    void saveMachine(Machine * mach);
+
+    //! \brief Machine::clearPurgeDate(), left to commitSessions() on a worker
+    void clearPurgeDate(Machine * mach);
+
     static QPixmap * genericCPAPPixmap;
 
     int m_currentMLtask;
@@ -111,16 +142,32 @@ protected:
 
     bool m_abort;
 
+    ProgressTracker m_progress;
+
     DeviceStatus m_status;
     MachineType m_type;
     QString m_class;
 
     QMap<SessionID, Session *> new_sessions;
 
+    QSet<Machine *> m_unsaved;
+    QSet<Machine *> m_purged;
+
     QHash<QString, QPixmap> m_pixmaps;
     QHash<QString, QString> m_pixmap_paths;
 
+  private slots:
+    //! \brief Does createMachine()'s work on the GUI thread
+    void createPendingMachine();
+
   private:
+    //! \brief Adds the sessions collected by addSession() to their machines
+    void addPendingSessions();
+
+    MachineInfo m_pendingInfo;
+    QHash<QString, QString> m_pendingProperties;
+    Machine * m_pendingMachine;
+
     QList<ImportTask *> m_MLtasklist;
 };
 
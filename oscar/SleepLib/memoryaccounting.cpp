@@ -0,0 +1,74 @@
+/* SleepLib Memory Accounting Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "memoryaccounting.h"
+
+void MemoryReport::add(const QString & category, qint64 bytes, qint64 items)
+{
+    for (auto & usage : m_usage) {
+        if (usage.category == category) {
+            usage.bytes += bytes;
+            usage.items += items;
+            return;
+        }
+    }
+    m_usage.append(MemoryUsage(category, bytes, items));
+}
+
+qint64 MemoryReport::totalBytes() const
+{
+    qint64 total = 0;
+    for (const auto & usage : m_usage) {
+        total += usage.bytes;
+    }
+    return total;
+}
+
+MemoryAccounting & MemoryAccounting::instance()
+{
+    static MemoryAccounting accounting;
+    return accounting;
+}
+
+void MemoryAccounting::add(MemoryReporter * reporter)
+{
+    QMutexLocker lock(&m_mutex);
+    if (!m_reporters.contains(reporter)) {
+        m_reporters.append(reporter);
+    }
+}
+
+void MemoryAccounting::remove(MemoryReporter * reporter)
+{
+    QMutexLocker lock(&m_mutex);
+    m_reporters.removeAll(reporter);
+}
+
+MemoryReport MemoryAccounting::report()
+{
+    MemoryReport report;
+    QMutexLocker lock(&m_mutex);
+    for (MemoryReporter * reporter : m_reporters) {
+        reporter->reportMemory(report);
+    }
+    return report;
+}
+
+void MemoryAccounting::dump()
+{
+    MemoryReport memory = report();
+    qDebug() << "Memory use by category (estimated):";
+    for (const auto & usage : memory.usage()) {
+        qDebug().noquote() << QString("  %1: %2 KiB in %3 items").arg(usage.category)
+                              .arg(usage.bytes / 1024).arg(usage.items);
+    }
+    qDebug().noquote() << QString("  Total: %1 KiB").arg(memory.totalBytes() / 1024);
+}
@@ -0,0 +1,123 @@
+/* SleepLib Memory Accounting Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef MEMORYACCOUNTING_H
+#define MEMORYACCOUNTING_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+#include <QVector>
+
+/*! \struct MemoryUsage
+    \brief Bytes held by one category of data, summed over every object reporting it
+    */
+struct MemoryUsage
+{
+    MemoryUsage() : bytes(0), items(0) {}
+    MemoryUsage(const QString & category, qint64 bytes, qint64 items)
+        : category(category), bytes(bytes), items(items) {}
+
+    QString category;
+    qint64 bytes;
+    qint64 items;   //!< Sessions, cached days, buffers etc, depending on the category
+};
+
+/*! \class MemoryReport
+    \brief What each MemoryReporter holds, collected by MemoryAccounting::report()
+    */
+class MemoryReport
+{
+  public:
+    //! \brief Adds bytes and items to category, which is created the first time it is seen
+    void add(const QString & category, qint64 bytes, qint64 items = 1);
+
+    //! \brief Every category, in the order first reported
+    const QList<MemoryUsage> & usage() const { return m_usage; }
+
+    qint64 totalBytes() const;
+
+  protected:
+    QList<MemoryUsage> m_usage;
+};
+
+/*! \class MemoryReporter
+    \brief Anything holding a noticeable amount of memory, which it adds up on request
+    */
+class MemoryReporter
+{
+  public:
+    virtual ~MemoryReporter() {}
+
+    //! \brief Adds what this object holds right now to report. Only called on the GUI thread.
+    virtual void reportMemory(MemoryReport & report) = 0;
+};
+
+/*! \class MemoryAccounting
+    \brief The registry every MemoryReporter adds itself to while it exists
+
+    Nothing is counted as it happens. Instead, reporters walk their own data whenever a report is
+    asked for, so keeping the figures costs nothing while the user isn't looking at them. The
+    figures are estimates: container sizes are worked out from their capacity and Qt's per-item
+    overhead rather than measured from the allocator.
+    */
+class MemoryAccounting
+{
+  public:
+    static MemoryAccounting & instance();
+
+    void add(MemoryReporter * reporter);
+    void remove(MemoryReporter * reporter);
+
+    //! \brief Asks every reporter what it holds right now
+    MemoryReport report();
+
+    //! \brief Writes a report to the debug log
+    void dump();
+
+  protected:
+    MemoryAccounting() {}
+
+    QMutex m_mutex;
+    QList<MemoryReporter *> m_reporters;
+};
+
+// Estimated footprints of Qt containers of plain values, not counting anything their items point to
+
+template <typename T>
+inline qint64 memoryOf(const QVector<T> & vec)
+{
+    return qint64(vec.capacity()) * qint64(sizeof(T));
+}
+
+template <typename T>
+inline qint64 memoryOf(const QList<T> & list)
+{
+    // Items larger than a pointer are allocated one by one
+    qint64 item = (sizeof(T) > sizeof(void *)) ? qint64(sizeof(T) + sizeof(void *)) : qint64(sizeof(void *));
+    return qint64(list.size()) * item;
+}
+
+template <typename K, typename V>
+inline qint64 memoryOf(const QHash<K, V> & hash)
+{
+    // Each node holds the next pointer and hash value besides the key and value, plus one bucket pointer per slot
+    return qint64(hash.size()) * qint64(sizeof(void *) + sizeof(uint) + sizeof(K) + sizeof(V))
+           + qint64(hash.capacity()) * qint64(sizeof(void *));
+}
+
+template <typename K, typename V>
+inline qint64 memoryOf(const QMap<K, V> & map)
+{
+    // Red-black tree nodes hold a parent (with the colour packed in) and two child pointers
+    return qint64(map.size()) * qint64(3 * sizeof(void *) + sizeof(K) + sizeof(V));
+}
+
+#endif // MEMORYACCOUNTING_H
@@ -0,0 +1,209 @@
+/* SleepLib Background Events Migration Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "migration.h"
+#include "profiles.h"
+#include "machine.h"
+#include "session.h"
+#include "day.h"
+
+// Machine property holding the events file version all of its sessions are known to be at
+const QString STR_PROP_EventsVersion = "EventsVersion";
+
+MigrationTask::MigrationTask(EventMigrator * migrator, Session * sess, bool force)
+    : migrator(migrator), mach(sess->machine()), id(sess->session()), filename(sess->eventFile()),
+      stores(sess->storeCount()), force(force)
+{
+}
+
+void MigrationTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+
+    if (migrator->m_cancelled.load() != 0) {
+        migrator->finished(mach, id, stores, EventMigrator::Skipped);
+    } else if (!force && Session::isEventFileCurrent(filename)) {
+        migrator->finished(mach, id, stores, EventMigrator::Current);
+    } else {
+        qDebug() << "Upgrading Events file" << filename << "to version" << Session::eventsVersion();
+
+        // The summary has to be read too, as the upgrade stores both
+        mach->saveMutex.lock();
+        Session * copy = new Session(mach, id);
+        bool ok = copy->LoadSummary() && copy->UpgradeEvents();
+        delete copy;
+        mach->saveMutex.unlock();
+
+        migrator->finished(mach, id, stores, ok ? EventMigrator::Migrated : EventMigrator::Failed);
+    }
+    QMetaObject::invokeMethod(migrator, "taskDone", Qt::QueuedConnection);
+}
+
+EventMigrator::EventMigrator(QObject * parent)
+    :QObject(parent), m_migrated(0)
+{
+    // Leave most of the cores and the disk to whatever the user is doing
+    m_pool.setMaxThreadCount(qMax(1, QThread::idealThreadCount() / 2));
+}
+
+EventMigrator::~EventMigrator()
+{
+    cancel();
+}
+
+void EventMigrator::start()
+{
+    cancel();
+    if (!p_profile) {
+        return;
+    }
+
+    m_cancelled.store(0);
+    m_migrated = 0;
+
+    QList<Session *> sessions;
+    for (Machine * mach : p_profile->GetMachines()) {
+        if ((mach->type() == MT_JOURNAL) || (mach->properties.value(STR_PROP_EventsVersion).toInt() >= Session::eventsVersion())) {
+            continue;
+        }
+        int count = 0;
+        for (Session * sess : mach->sessionlist) {
+            // Sessions already open or with unsaved changes are left to be stored as they are
+            if (sess->summaryOnly() || sess->eventsLoaded() || sess->IsChanged()) {
+                m_incomplete.insert(mach);
+                continue;
+            }
+            sessions.append(sess);
+            count++;
+        }
+        m_outstanding[mach] = count;
+    }
+
+    qDebug() << "Checking" << sessions.size() << "events files for upgrades";
+    for (Session * sess : sessions) {
+        m_pool.start(new MigrationTask(this, sess));
+    }
+    if (sessions.isEmpty()) {
+        taskDone();
+    }
+}
+
+void EventMigrator::cancel()
+{
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    QMutexLocker lock(&m_mutex);
+    m_results.clear();
+    m_outstanding.clear();
+    m_incomplete.clear();
+}
+
+void EventMigrator::finished(Machine * mach, SessionID id, int stores, Outcome outcome)
+{
+    QMutexLocker lock(&m_mutex);
+    Result result;
+    result.mach = mach;
+    result.id = id;
+    result.stores = stores;
+    result.outcome = outcome;
+    m_results.append(result);
+}
+
+bool EventMigrator::refreshSession(Machine * mach, SessionID id, int stores)
+{
+    Session * sess = mach->sessionlist.value(id, nullptr);
+    if (!sess) {
+        return true;
+    }
+    if (sess->IsChanged()) {
+        // Store the edits now, so the upgrade below starts from them
+        mach->SaveSession(sess);
+    }
+    if (sess->storeCount() != stores) {
+        // Its old summary went over the upgraded one, so upgrade it again from what was stored
+        m_pool.start(new MigrationTask(this, sess, true));
+        return false;
+    }
+    if (sess->IsChanged()) {
+        return true; // couldn't be stored, so keep what the GUI has
+    }
+    if (!sess->ReloadSummary()) {
+        qWarning() << "Could not reload upgraded summary of session" << id;
+    }
+
+    Day * day = p_profile->findSessionDay(sess);
+    if (day) {
+        day->invalidate();
+    }
+    return true;
+}
+
+void EventMigrator::taskDone()
+{
+    QList<Result> results;
+    {
+        QMutexLocker lock(&m_mutex);
+        results.swap(m_results);
+    }
+
+    // The profile may have been closed or the machine purged since the task was queued
+    QList<Machine *> machines = p_profile ? p_profile->GetMachines() : QList<Machine *>();
+
+    for (const auto & result : results) {
+        Machine * mach = result.mach;
+        if (!machines.contains(mach) || !m_outstanding.contains(mach)) {
+            continue;
+        }
+        switch (result.outcome) {
+        case Migrated:
+            if (!refreshSession(mach, result.id, result.stores)) {
+                continue; // still outstanding
+            }
+            m_migrated++;
+            break;
+        case Failed:
+        case Skipped:
+            m_incomplete.insert(mach);
+            break;
+        case Current:
+            break;
+        }
+        m_outstanding[mach]--;
+    }
+
+    bool store = false;
+    for (auto it = m_outstanding.begin(); it != m_outstanding.end(); ) {
+        if (it.value() > 0) {
+            ++it;
+            continue;
+        }
+        Machine * mach = it.key();
+        if (!m_incomplete.contains(mach) && machines.contains(mach)) {
+            mach->properties[STR_PROP_EventsVersion] = QString::number(Session::eventsVersion());
+            store = true;
+        }
+        it = m_outstanding.erase(it);
+    }
+    if (store) {
+        p_profile->StoreMachines();
+    }
+
+    if (m_outstanding.isEmpty() && (m_cancelled.load() == 0)) {
+        if (m_migrated > 0) {
+            qDebug() << "Upgraded" << m_migrated << "events files";
+        }
+        m_cancelled.store(1); // nothing left to do
+        emit migrationDone(m_migrated);
+    }
+}
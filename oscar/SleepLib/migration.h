@@ -0,0 +1,114 @@
+/* SleepLib Background Events Migration Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef MIGRATION_H
+#define MIGRATION_H
+
+#include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+
+class Machine;
+class Session;
+class EventMigrator;
+
+/*! \class MigrationTask
+    \brief Checks one session's events file, upgrading it through a private Session copy if it is outdated
+
+    A forced task upgrades the files again even if they are current, for sessions the GUI stored
+    while their first upgrade was running.
+    */
+class MigrationTask:public QRunnable
+{
+public:
+    MigrationTask(EventMigrator * migrator, Session * sess, bool force = false);
+    virtual ~MigrationTask() {}
+    virtual void run();
+
+protected:
+    EventMigrator * migrator;
+    Machine * mach;
+    SessionID id;
+    QString filename;
+    int stores;
+    bool force;
+};
+
+/*! \class EventMigrator
+    \brief Upgrades events files written by older versions of OSCAR in the background after a profile loads
+
+    Session::LoadEvents reads outdated files as they are instead of rewriting them on the spot,
+    so opening an old night doesn't wait for its summary to be recalculated and its events
+    recompressed. This does that work instead, a few files at a time at the lowest priority.
+
+    Each upgrade holds the machine's saveMutex, so it can't interleave with a save or overlay
+    compaction of the same files. Once every session of a machine is known to be current this is
+    recorded in its properties, so later profile loads don't check its files again.
+
+    An upgraded session whose GUI copy was stored in the meantime, or has unsaved changes, has
+    its files written with the old summary again, so it is saved and upgraded once more before
+    its summary is reloaded.
+    */
+class EventMigrator:public QObject
+{
+    Q_OBJECT
+    friend class MigrationTask;
+  public:
+    explicit EventMigrator(QObject * parent = nullptr);
+    virtual ~EventMigrator();
+
+    //! \brief Queues a check of every session of the current profile not already known to be current
+    void start();
+
+    //! \brief Drops any outstanding work and waits for the files being upgraded to finish
+    void cancel();
+
+    //! \brief Number of events files upgraded so far
+    int migrated() const { return m_migrated; }
+
+  signals:
+    //! \brief Every queued session has been checked
+    void migrationDone(int migrated);
+
+  protected slots:
+    void taskDone();
+
+  protected:
+    enum Outcome { Current, Migrated, Failed, Skipped };
+
+    struct Result {
+        Machine * mach;
+        SessionID id;
+        int stores;
+        Outcome outcome;
+    };
+
+    //! \brief Called from the pool thread once a session has been dealt with
+    void finished(Machine * mach, SessionID id, int stores, Outcome outcome);
+
+    /*! \brief Puts the refreshed summary of a migrated session back into the one the GUI uses.
+        Returns false if the session was stored since stores was taken, and had its upgrade queued again */
+    bool refreshSession(Machine * mach, SessionID id, int stores);
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QList<Result> m_results;
+    QAtomicInt m_cancelled;
+    QHash<Machine *, int> m_outstanding;
+    QSet<Machine *> m_incomplete;
+    int m_migrated;
+};
+
+#endif // MIGRATION_H
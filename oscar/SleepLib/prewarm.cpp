@@ -0,0 +1,156 @@
+/* SleepLib Recent Nights Pre-warming Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QThread>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "prewarm.h"
+#include "profiles.h"
+#include "machine.h"
+#include "session.h"
+#include "day.h"
+
+PrewarmTask::PrewarmTask(NightPrewarmer * prewarmer, Session * sess)
+    : prewarmer(prewarmer), mach(sess->machine()), id(sess->session()), filename(sess->eventFile())
+{
+}
+
+void PrewarmTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    Session * copy = nullptr;
+
+    if (prewarmer->m_cancelled.load() == 0) {
+        copy = new Session(mach, id);
+        if (!copy->LoadEvents(filename)) {
+            delete copy;
+            copy = nullptr;
+        }
+    }
+    prewarmer->finished(mach, id, copy);
+    QMetaObject::invokeMethod(prewarmer, "taskDone", Qt::QueuedConnection);
+}
+
+NightPrewarmer::NightPrewarmer(QObject * parent)
+    :QObject(parent), m_budget(0), m_used(0)
+{
+    // One reader is enough to stay ahead of the user, and leaves the disk and cores to the GUI
+    m_pool.setMaxThreadCount(1);
+}
+
+NightPrewarmer::~NightPrewarmer()
+{
+    cancel();
+}
+
+void NightPrewarmer::start(int nights, qint64 budget)
+{
+    cancel();
+    if (!p_profile || (nights <= 0) || (budget <= 0)) {
+        return;
+    }
+
+    m_cancelled.store(0);
+    m_budget = budget;
+    m_used = 0;
+
+    // Most recent first, so the night Daily opens on is ready soonest
+    QList<Session *> sessions;
+    int found = 0;
+    auto it = p_profile->daylist.end();
+    while ((it != p_profile->daylist.begin()) && (found < nights)) {
+        --it;
+        bool used = false;
+        for (Session * sess : it.value()->sessions) {
+            if ((sess->type() == MT_JOURNAL) || sess->summaryOnly() || sess->eventsLoaded()) {
+                continue;
+            }
+            sessions.append(sess);
+            used = true;
+        }
+        if (used) {
+            found++;
+        }
+    }
+
+    qDebug() << "Pre-warming" << sessions.size() << "sessions from the last" << found << "nights";
+    for (Session * sess : sessions) {
+        m_pool.start(new PrewarmTask(this, sess));
+    }
+}
+
+void NightPrewarmer::cancel()
+{
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    QMutexLocker lock(&m_mutex);
+    for (auto & result : m_results) {
+        delete result.copy;
+    }
+    m_results.clear();
+}
+
+void NightPrewarmer::finished(Machine * mach, SessionID id, Session * copy)
+{
+    QMutexLocker lock(&m_mutex);
+    Result result;
+    result.mach = mach;
+    result.id = id;
+    result.copy = copy;
+    m_results.append(result);
+}
+
+qint64 NightPrewarmer::footprint(Session * sess)
+{
+    qint64 bytes = 0;
+    for (const auto & lists : sess->eventlist) {
+        for (const auto & el : lists) {
+            int width = el->hasSecondField() ? 4 : 2;
+            if (el->type() != EVL_Waveform) {
+                width += 4;
+            }
+            bytes += qint64(el->count()) * width;
+        }
+    }
+    return bytes;
+}
+
+void NightPrewarmer::taskDone()
+{
+    QList<Result> results;
+    {
+        QMutexLocker lock(&m_mutex);
+        results.swap(m_results);
+    }
+
+    for (auto & result : results) {
+        Session * copy = result.copy;
+        if (!copy) {
+            continue;
+        }
+
+        // The profile may have been closed or the machine purged since the task was queued
+        Session * sess = nullptr;
+        if (p_profile && p_profile->GetMachines().contains(result.mach)) {
+            sess = result.mach->sessionlist.value(result.id, nullptr);
+        }
+
+        qint64 bytes = footprint(copy);
+        if (sess && (m_cancelled.load() == 0) && (m_used + bytes <= m_budget) && sess->adoptEvents(copy)) {
+            m_used += bytes;
+        } else if (m_used + bytes > m_budget) {
+            qDebug() << "Pre-warming stopped at" << m_used << "bytes";
+            m_cancelled.store(1);
+            m_pool.clear();
+        }
+        delete copy;
+    }
+}
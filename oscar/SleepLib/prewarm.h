@@ -0,0 +1,91 @@
+/* SleepLib Recent Nights Pre-warming Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef PREWARM_H
+#define PREWARM_H
+
+#include <QObject>
+#include <QList>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+
+class Machine;
+class Session;
+class NightPrewarmer;
+
+/*! \class PrewarmTask
+    \brief Reads one session's events into a private copy of the Session on a background thread
+    */
+class PrewarmTask:public QRunnable
+{
+public:
+    PrewarmTask(NightPrewarmer * prewarmer, Session * sess);
+    virtual ~PrewarmTask() {}
+    virtual void run();
+
+protected:
+    NightPrewarmer * prewarmer;
+    Machine * mach;
+    SessionID id;
+    QString filename;
+};
+
+/*! \class NightPrewarmer
+    \brief Opens the events of the most recent nights in the background after a profile loads
+
+    Events are read into private Session copies on a single low priority thread, so nothing the
+    GUI thread touches is modified in the background. Each copy is handed over on the GUI thread,
+    and only if the real Session still hasn't loaded its own events by then. Reading stops once
+    the loaded events exceed the memory budget.
+    */
+class NightPrewarmer:public QObject
+{
+    Q_OBJECT
+    friend class PrewarmTask;
+  public:
+    explicit NightPrewarmer(QObject * parent = nullptr);
+    virtual ~NightPrewarmer();
+
+    //! \brief Starts reading the events of the last nights days with data, using at most budget bytes
+    void start(int nights, qint64 budget);
+
+    //! \brief Drops any outstanding work and waits for the current read to finish
+    void cancel();
+
+    //! \brief Bytes of event data handed over so far
+    qint64 used() const { return m_used; }
+
+    //! \brief Estimated bytes held by the EventLists of sess
+    static qint64 footprint(Session * sess);
+
+  protected slots:
+    void taskDone();
+
+  protected:
+    struct Result {
+        Machine * mach;
+        SessionID id;
+        Session * copy;
+    };
+
+    //! \brief Called from the pool thread with a loaded copy, or nullptr if loading failed
+    void finished(Machine * mach, SessionID id, Session * copy);
+
+    QThreadPool m_pool;
+    QMutex m_mutex;
+    QList<Result> m_results;
+    QAtomicInt m_cancelled;
+    qint64 m_budget;
+    qint64 m_used;
+};
+
+#endif // PREWARM_H
@@ -36,8 +36,12 @@ Preferences *p_pref;
 Preferences *p_layout;
 Profile *p_profile;
 
+int CPAPSettings::s_drift_generation = 0;
+
 Profile::Profile(QString path, bool open)
-  : is_first_day(true),
+  : calendar(this),
+    importMutex(QMutex::Recursive),
+    is_first_day(true),
      m_opened(false)
 {
     p_name = STR_GEN_Profile;
@@ -86,14 +90,20 @@ Profile::Profile(QString path, bool open)
         OpenMachines();
         m_opened=true;
     }
+    MemoryAccounting::instance().add(this);
 }
 
 Profile::~Profile()
 {
+    MemoryAccounting::instance().remove(this);
+
     if (m_opened) {
         removeLock();
     }
 
+    // Calendar tasks hold on to the machines
+    calendar.clear();
+
     // delete machine objects...
     for (auto & mach : m_machlist) {
         delete mach;
@@ -365,6 +375,29 @@ qint64 Profile::diskSpace()
     return (diskSpaceSummaries()+diskSpaceEvents()+diskSpaceBackups());
 }
 
+void Profile::reportMemory(MemoryReport & report)
+{
+    qint64 sessions = 0, summaries = 0, loaded = 0, events = 0;
+    for (Machine * mach : m_machlist) {
+        for (Session * sess : mach->sessionlist) {
+            sessions++;
+            summaries += sess->summaryMemoryUsed();
+            if (sess->eventsLoaded()) {
+                loaded++;
+                events += sess->eventMemoryUsed();
+            }
+        }
+    }
+    report.add(QObject::tr("Session summaries"), summaries, sessions);
+    report.add(QObject::tr("Session events"), events, loaded);
+
+    qint64 days = memoryOf(daylist);
+    for (Day * day : daylist) {
+        days += qint64(sizeof(Day)) + memoryOf(day->sessions) + memoryOf(day->machines);
+    }
+    report.add(QObject::tr("Days"), days, daylist.size());
+}
+
 void Profile::forceResmedPrefs()
 {
         session->setBackupCardData(true);
@@ -630,6 +663,7 @@ void Profile::UnloadMachineData()
         delete day;
     }
     daylist.clear();
+    calendar.clear();
 
     removeLock();
 }
@@ -683,6 +717,7 @@ void Profile::removeMachine(Machine * mach)
 
 Machine * Profile::lookupMachine(QString serial, QString loadername)
 {
+    QMutexLocker lock(&importMutex);
     auto mlit = MachineList.find(loadername);
     if (mlit != MachineList.end()) {
         auto mit = mlit.value().find(serial);
@@ -696,6 +731,7 @@ Machine * Profile::lookupMachine(QString serial, QString loadername)
 
 Machine * Profile::CreateMachine(MachineInfo info, MachineID id)
 {
+    QMutexLocker lock(&importMutex);
     Machine *m = nullptr;
 
     auto mlit = MachineList.find(info.loadername);
@@ -783,6 +819,7 @@ Day *Profile::addDay(QDate date)
     }
     Day * day = dit.value();
     day->setDate(date);
+    calendar.invalidate(date);
 
     if (is_first_day) {
         m_first = m_last = date;
@@ -988,6 +1025,7 @@ bool Profile::unlinkDay(Day * day)
     // Find the key...
     for (auto it = daylist.begin(), it_end = daylist.end(); it != it_end; ++it) {
         if (it.value() == day) {
+            calendar.invalidate(it.key());
             daylist.erase(it);
             return true;
         }
@@ -13,12 +13,15 @@
 #include <QString>
 #include <QCryptographicHash>
 #include <QThread>
+#include <QMutex>
 
 #include "progressdialog.h"
 #include "machine.h"
 #include "machine_loader.h"
+#include "calendarcache.h"
 #include "preferences.h"
 #include "common.h"
+#include "memoryaccounting.h"
 
 class Machine;
 
@@ -40,7 +43,7 @@ class SessionSettings;
   \date 28/04/11
   \brief The User profile system, containing all information for a user, and an index into all Machine data
  */
-class Profile : public Preferences
+class Profile : public Preferences, public MemoryReporter
 {
   public:
     //! \brief Constructor.. Does not open profile in UI, but loads it from disk by default
@@ -57,6 +60,9 @@ class Profile : public Preferences
     qint64 diskSpaceBackups();
     qint64 diskSpace();
 
+    //! \brief Reports the memory held by the days and sessions of every machine
+    virtual void reportMemory(MemoryReport & report);
+
     //! \brief Force some preferences for ResMed machines
     virtual void forceResmedPrefs();
 
@@ -215,6 +221,14 @@ class Profile : public Preferences
     //! \brief QMap of day records (iterates in order).
     QMap<QDate, Day *> daylist;
 
+    //! \brief Per-month calendar metadata derived from daylist
+    CalendarCache calendar;
+
+    /*! \brief Guards daylist and the machine lists while several imports run at once. They are only changed
+        on the GUI thread, so it's held there while changing them and by background loaders while reading them.
+        Recursive, as loaders holding it may end up adding sessions themselves */
+    QMutex importMutex;
+
     void removeMachine(Machine *);
     Machine * lookupMachine(QString serial, QString loadername);
     Machine * CreateMachine(MachineInfo info, MachineID id = 0);
@@ -560,6 +574,7 @@ class CPAPSettings : public PrefSettings
         m_4cmH2OLeaks = initPref(STR_CS_4cmH2OLeaks, 20.167).toDouble();
         m_20cmH2OLeaks = initPref(STR_CS_20cmH2OLeaks, 48.333).toDouble();
         m_clock_drift = initPref(STR_CS_ClockDrift, (int)0).toInt();
+        ++s_drift_generation;
     }
 
     //Getters
@@ -584,6 +599,10 @@ class CPAPSettings : public PrefSettings
     inline bool AHIReset() const { return m_ahiReset; }
     inline bool userEventFlagging() const { return m_userEventFlagging; }
     inline int clockDrift() const { return m_clock_drift; }
+
+    /*! \brief Changes whenever any profile's clock drift is loaded or changed.
+        Sessions and Days cache their drift adjusted times against this. */
+    static inline int driftGeneration() { return s_drift_generation; }
     inline EventDataType leakRedline() const { return m_leakRedLine; }
     inline bool showLeakRedline() const { return m_showLeakRedline; }
     inline bool resyncFromUserFlagging() const { return m_resyncFromUserFlagging; }
@@ -615,7 +634,12 @@ class CPAPSettings : public PrefSettings
     void setUserEventFlagging(bool flagging) { setPref(STR_CS_UserEventFlagging, m_userEventFlagging=flagging); }
     void setUserEventDuplicates(bool dup) { setPref(STR_CS_UserEventDuplicates, m_userEventDuplicates=dup); }
     void setMaskDescription(QString description) { setPref(STR_CS_MaskDescription, description); }
-    void setClockDrift(int seconds) { setPref(STR_CS_ClockDrift, m_clock_drift = seconds); }
+    void setClockDrift(int seconds) {
+        if (seconds != m_clock_drift) {
+            ++s_drift_generation;
+        }
+        setPref(STR_CS_ClockDrift, m_clock_drift = seconds);
+    }
     void setLeakRedline(EventDataType value) { setPref(STR_CS_LeakRedline, m_leakRedLine=value); }
     void setShowLeakRedline(bool b) { setPref(STR_CS_ShowLeakRedline, m_showLeakRedline=b); }
     void setResyncFromUserFlagging(bool b) { setPref(STR_CS_ResyncFromUserFlagging, m_resyncFromUserFlagging=b); }
@@ -636,6 +660,8 @@ class CPAPSettings : public PrefSettings
 
     EventDataType m_userEventRestriction1, m_userEventRestriction2, m_userEventDuration1, m_userEventDuration2;
 
+  protected:
+    static int s_drift_generation;
 };
 
 /*! \class ImportSettings
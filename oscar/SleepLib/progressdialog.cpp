@@ -27,6 +27,10 @@ ProgressDialog::ProgressDialog(QWidget * parent):
     abortButton = nullptr;
     setWindowModality(Qt::ApplicationModal);
 
+    tracker = nullptr;
+    trackerMax = trackerValue = trackerLabel = -1;
+    connect(&pollTimer, SIGNAL(timeout()), this, SLOT(pollTracker()));
+
 }
 
 ProgressDialog::~ProgressDialog()
@@ -47,6 +51,45 @@ void ProgressDialog::setProgressValue(int val)
 }
 
 
+void ProgressDialog::track(ProgressTracker * t)
+{
+    tracker = t;
+    trackerMax = trackerValue = trackerLabel = -1;
+    if (tracker) {
+        pollTracker();
+        pollTimer.start(progress_poll_interval);
+    } else {
+        pollTimer.stop();
+    }
+}
+
+void ProgressDialog::pollTracker()
+{
+    if (!tracker) {
+        return;
+    }
+    // Only touch the widgets when something changed, as each change repaints them.
+    // A tracker without a maximum hasn't started counting, so the bar is left as it is.
+    int max = tracker->max();
+    if (max > 0) {
+        if (max != trackerMax) {
+            progress->setMaximum(trackerMax = max);
+        }
+        int value = tracker->value();
+        if (value != trackerValue) {
+            progress->setValue(trackerValue = value);
+        }
+    }
+    int label = tracker->labelSerial();
+    if (label != trackerLabel) {
+        trackerLabel = label;
+        QString msg = tracker->label();
+        if (!msg.isEmpty()) {
+            statusMsg->setText(msg);
+        }
+    }
+}
+
 void ProgressDialog::setMessage(QString msg) {
     statusMsg->setText(msg);
 }
@@ -15,6 +15,9 @@
 #include <QLabel>
 #include <QProgressBar>
 #include <QPushButton>
+#include <QTimer>
+
+#include "SleepLib/progresstracker.h"
 
 class ProgressDialog:public QDialog {
 Q_OBJECT
@@ -25,6 +28,10 @@ public:
     void addAbortButton();
 
     void setPixmap(QPixmap &pixmap) { imglabel->setPixmap(pixmap); }
+
+    //! \brief Shows the progress of tracker, polled at a fixed rate, until another tracker or nullptr is given
+    void track(ProgressTracker * tracker);
+
     QProgressBar * progress;
 public slots:
     void setMessage(QString msg);
@@ -35,6 +42,8 @@ public slots:
 
 signals:
     void abortClicked();
+protected slots:
+    void pollTracker();
 protected:
     QLabel * statusMsg;
     QHBoxLayout *hlayout;
@@ -42,6 +51,12 @@ protected:
     QVBoxLayout * vlayout;
     QPushButton * abortButton;
 
+    QTimer pollTimer;
+    ProgressTracker * tracker;
+    int trackerMax;
+    int trackerValue;
+    int trackerLabel;
+
 };
 
 #endif // PROGRESSDIALOG_H
@@ -0,0 +1,48 @@
+/* SleepLib Progress Tracker Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QMutexLocker>
+#include <QThread>
+
+#include "progresstracker.h"
+
+void ProgressTracker::setLabel(const QString & label)
+{
+    QMutexLocker lock(&m_labelMutex);
+    m_label = label;
+    m_labelSerial.ref();
+}
+
+void ProgressTracker::reset()
+{
+    m_max.store(0);
+    m_value.store(0);
+    setLabel(QString());
+}
+
+QString ProgressTracker::label() const
+{
+    QMutexLocker lock(&m_labelMutex);
+    return m_label;
+}
+
+void ProgressTracker::pumpEvents()
+{
+    QCoreApplication * app = QCoreApplication::instance();
+    if (!app || (QThread::currentThread() != app->thread())) {
+        return;
+    }
+    static QElapsedTimer last;
+    if (last.isValid() && (last.elapsed() < progress_poll_interval)) {
+        return;
+    }
+    QCoreApplication::processEvents();
+    last.start();
+}
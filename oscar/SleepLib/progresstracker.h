@@ -0,0 +1,59 @@
+/* SleepLib Progress Tracker Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef PROGRESSTRACKER_H
+#define PROGRESSTRACKER_H
+
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+
+// How often a display polls the trackers it shows, in milliseconds
+const int progress_poll_interval = 40;
+
+/*! \class ProgressTracker
+    \brief The progress of a long running job, written by the job and read by whatever displays it
+
+    The counters are atomics and the phase label is only locked when it changes, so a job can update
+    them for every item, from any thread, at next to no cost. Nothing is signalled: a ProgressDialog
+    polls the tracker at a fixed rate instead, so a busy job never floods the GUI with repaints.
+    */
+class ProgressTracker
+{
+  public:
+    ProgressTracker() {}
+
+    inline void setMax(int max) { m_max.store(max); }
+    inline void setValue(int value) { m_value.store(value); }
+    inline void advance(int count = 1) { m_value.fetchAndAddRelaxed(count); }
+    void setLabel(const QString & label);
+
+    //! \brief Clears the counters and label, ready for the next job
+    void reset();
+
+    inline int max() const { return m_max.load(); }
+    inline int value() const { return m_value.load(); }
+    QString label() const;
+
+    //! \brief Changes every time the label does, so pollers can skip an unchanged label without locking
+    inline int labelSerial() const { return m_labelSerial.load(); }
+
+    /*! \brief Lets the GUI catch up while a job runs on the GUI thread, at most once per poll interval.
+        Does nothing on any other thread, as the GUI keeps running by itself there */
+    static void pumpEvents();
+
+  protected:
+    QAtomicInt m_max;
+    QAtomicInt m_value;
+    QAtomicInt m_labelSerial;
+
+    mutable QMutex m_labelMutex;
+    QString m_label;
+};
+
+#endif // PROGRESSTRACKER_H
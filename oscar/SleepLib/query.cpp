@@ -0,0 +1,541 @@
+/* SleepLib Cross-night Query Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QRegularExpression>
+#include <QThread>
+#include <algorithm>
+
+#include "query.h"
+#include "profiles.h"
+#include "day.h"
+#include "session.h"
+#include "schema.h"
+
+static const struct {
+    const char * name;
+    QueryFunc func;
+} queryFuncNames[] = {
+    { "cnt", QF_Count }, { "count", QF_Count }, { "cph", QF_CPH }, { "sph", QF_SPH },
+    { "sum", QF_Sum }, { "avg", QF_Avg }, { "wavg", QF_WAvg }, { "min", QF_Min },
+    { "max", QF_Max }, { "median", QF_Median }, { "p90", QF_P90 }, { "p95", QF_P95 },
+    { "hours", QF_Hours },
+};
+
+static bool parseOp(const QString & tok, QueryOp & op)
+{
+    if (tok == "<") op = QO_Less;
+    else if (tok == "<=") op = QO_LessEqual;
+    else if (tok == ">") op = QO_Greater;
+    else if (tok == ">=") op = QO_GreaterEqual;
+    else if ((tok == "=") || (tok == "==")) op = QO_Equal;
+    else if (tok == "!=") op = QO_NotEqual;
+    else return false;
+    return true;
+}
+
+static QString opString(QueryOp op)
+{
+    switch (op) {
+    case QO_Less: return "<";
+    case QO_LessEqual: return "<=";
+    case QO_Greater: return ">";
+    case QO_GreaterEqual: return ">=";
+    case QO_Equal: return "=";
+    case QO_NotEqual: return "!=";
+    }
+    return QString();
+}
+
+static bool lookupChannel(const QString & name, ChannelID & code)
+{
+    schema::Channel & chan = schema::channel[name];
+    if (chan.isNull()) {
+        return false;
+    }
+    code = chan.id();
+    return true;
+}
+
+QString DayQuery::funcName(QueryFunc func)
+{
+    for (const auto & f : queryFuncNames) {
+        if (f.func == func) return f.name;
+    }
+    return QString();
+}
+
+bool DayQuery::compare(EventDataType a, QueryOp op, EventDataType b)
+{
+    switch (op) {
+    case QO_Less: return a < b;
+    case QO_LessEqual: return a <= b;
+    case QO_Greater: return a > b;
+    case QO_GreaterEqual: return a >= b;
+    case QO_Equal: return qFuzzyCompare(1.0F + a, 1.0F + b);
+    case QO_NotEqual: return !qFuzzyCompare(1.0F + a, 1.0F + b);
+    }
+    return false;
+}
+
+bool DayQuery::parse(const QString & text, QString * error)
+{
+    m_conditions.clear();
+
+    static const QRegularExpression tokenizer(
+        "\\s*(<=|>=|!=|==|<|>|=|\\(|\\)|[A-Za-z_][A-Za-z0-9_.]*|[-+]?[0-9]*\\.?[0-9]+)");
+    QStringList tokens;
+    int pos = 0;
+    while (pos < text.length()) {
+        QRegularExpressionMatch m = tokenizer.match(text, pos, QRegularExpression::NormalMatch,
+                                                    QRegularExpression::AnchoredMatchOption);
+        if (!m.hasMatch()) {
+            if (text.mid(pos).trimmed().isEmpty()) break;
+            if (error) *error = QObject::tr("Unexpected text at \"%1\"").arg(text.mid(pos).trimmed());
+            return false;
+        }
+        tokens.append(m.captured(1));
+        pos = m.capturedEnd(0);
+    }
+
+    int i = 0;
+    auto next = [&]() -> QString { return (i < tokens.size()) ? tokens.at(i++) : QString(); };
+    auto peek = [&]() -> QString { return (i < tokens.size()) ? tokens.at(i) : QString(); };
+    auto number = [&](EventDataType & val) -> bool {
+        bool ok;
+        val = next().toFloat(&ok);
+        return ok;
+    };
+
+    while (i < tokens.size()) {
+        QueryCondition cond;
+        QString tok = next();
+        bool isfunc = false;
+
+        for (const auto & f : queryFuncNames) {
+            if (tok.compare(f.name, Qt::CaseInsensitive) == 0) {
+                cond.func = f.func;
+                isfunc = true;
+                break;
+            }
+        }
+
+        if (isfunc && (cond.func == QF_Hours)) {
+            // hours takes no channel
+        } else if (isfunc) {
+            if (next() != "(") {
+                if (error) *error = QObject::tr("Expected \"(\" after %1").arg(tok);
+                return false;
+            }
+            QString name = next();
+            if (!lookupChannel(name, cond.code)) {
+                if (error) *error = QObject::tr("Unknown channel \"%1\"").arg(name);
+                return false;
+            }
+            if (next() != ")") {
+                if (error) *error = QObject::tr("Expected \")\" after %1").arg(name);
+                return false;
+            }
+        } else if (lookupChannel(tok, cond.code)) {
+            cond.func = QF_Avg;
+        } else {
+            if (error) *error = QObject::tr("Unknown channel or function \"%1\"").arg(tok);
+            return false;
+        }
+
+        tok = next();
+        if (!parseOp(tok, cond.op)) {
+            if (error) *error = QObject::tr("Expected a comparison, found \"%1\"").arg(tok);
+            return false;
+        }
+        if (!number(cond.value)) {
+            if (error) *error = QObject::tr("Expected a number after %1").arg(tok);
+            return false;
+        }
+
+        if (peek().compare("while", Qt::CaseInsensitive) == 0) {
+            next();
+            if (cond.func == QF_Hours) {
+                if (error) *error = QObject::tr("\"while\" can't be used with hours");
+                return false;
+            }
+            QString name = next();
+            if (!lookupChannel(name, cond.whileCode)) {
+                if (error) *error = QObject::tr("Unknown channel \"%1\"").arg(name);
+                return false;
+            }
+            tok = next();
+            if (!parseOp(tok, cond.whileOp)) {
+                if (error) *error = QObject::tr("Expected a comparison, found \"%1\"").arg(tok);
+                return false;
+            }
+            // Only thresholds give a time for cph and sph to be measured over
+            if ((cond.whileOp == QO_Equal) || (cond.whileOp == QO_NotEqual)) {
+                if (error) *error = QObject::tr("\"while\" needs one of <, <=, > or >=");
+                return false;
+            }
+            if (!number(cond.whileValue)) {
+                if (error) *error = QObject::tr("Expected a number after %1").arg(tok);
+                return false;
+            }
+        }
+
+        m_conditions.append(cond);
+
+        if (i < tokens.size()) {
+            tok = next();
+            if (tok.compare("and", Qt::CaseInsensitive) != 0) {
+                if (error) *error = QObject::tr("Expected \"and\", found \"%1\"").arg(tok);
+                return false;
+            }
+        }
+    }
+
+    if (m_conditions.isEmpty()) {
+        if (error) *error = QObject::tr("Empty query");
+        return false;
+    }
+    return true;
+}
+
+EventDataType DayQuery::summaryValue(Day * day, const QueryCondition & cond)
+{
+    switch (cond.func) {
+    case QF_Count: return day->count(cond.code);
+    case QF_CPH: return day->cph(cond.code);
+    case QF_SPH: return day->sph(cond.code);
+    case QF_Sum: return day->sum(cond.code);
+    case QF_Avg: return day->avg(cond.code);
+    case QF_WAvg: return day->wavg(cond.code);
+    case QF_Min: return day->Min(cond.code);
+    case QF_Max: return day->Max(cond.code);
+    case QF_Median: return day->percentile(cond.code, 0.5F);
+    case QF_P90: return day->percentile(cond.code, 0.9F);
+    case QF_P95: return day->percentile(cond.code, 0.95F);
+    case QF_Hours: return day->hours();
+    }
+    return 0;
+}
+
+static bool channelAvailable(Day * day, ChannelID code)
+{
+    for (auto & sess : day->sessions) {
+        if (sess->channelExists(code)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool DayQuery::matchSummary(Day * day) const
+{
+    for (const auto & cond : m_conditions) {
+        if (cond.func == QF_Hours) {
+            if (!compare(day->hours(), cond.op, cond.value)) return false;
+            continue;
+        }
+        if (!day->hasEnabledSessions(schema::channel[cond.code].machtype())) {
+            return false;
+        }
+
+        if (!cond.needsEvents()) {
+            if (!compare(summaryValue(day, cond), cond.op, cond.value)) return false;
+            continue;
+        }
+
+        // Cheap upper bounds before anything gets opened
+        if (!channelAvailable(day, cond.code) || !channelAvailable(day, cond.whileCode)) {
+            return false;
+        }
+        switch (cond.whileOp) {
+        case QO_Greater:
+        case QO_GreaterEqual:
+            if (!compare(day->Max(cond.whileCode), cond.whileOp, cond.whileValue)) return false;
+            break;
+        case QO_Less:
+        case QO_LessEqual:
+            if (!compare(day->Min(cond.whileCode), cond.whileOp, cond.whileValue)) return false;
+            break;
+        default:
+            break;
+        }
+        if ((cond.func == QF_Count) && ((cond.op == QO_Greater) || (cond.op == QO_GreaterEqual))) {
+            if (!compare(day->count(cond.code), cond.op, cond.value)) return false;
+        }
+    }
+    return true;
+}
+
+EventDataType DayQuery::eventValue(const QList<Session *> & sessions, const QueryCondition & cond)
+{
+    double minutes = 0, sum = 0, duration = 0;
+    int count = 0;
+    EventDataType min = 0, max = 0;
+    QVector<EventDataType> values;
+    bool wantvalues = (cond.func == QF_Median) || (cond.func == QF_P90) || (cond.func == QF_P95);
+
+    for (auto & sess : sessions) {
+        if (!sess->enabled() || !sess->channelExists(cond.code)) {
+            continue;
+        }
+        bool loaded = sess->eventsLoaded();
+        sess->OpenEvents();
+
+        switch (cond.whileOp) {
+        case QO_Greater:
+        case QO_GreaterEqual:
+            minutes += sess->timeAboveThreshold(cond.whileCode, cond.whileValue);
+            break;
+        case QO_Less:
+        case QO_LessEqual:
+            minutes += sess->timeBelowThreshold(cond.whileCode, cond.whileValue);
+            break;
+        default: // parse() doesn't allow = or != here
+            break;
+        }
+
+        auto it = sess->eventlist.find(cond.code);
+        if (it != sess->eventlist.end()) {
+            for (EventList * el : it.value()) {
+                quint32 size = el->count();
+                for (quint32 j = 0; j < size; ++j) {
+                    qint64 time = el->time(j);
+                    EventDataType v = sess->SearchValue(cond.whileCode, time, true);
+                    if (!compare(v, cond.whileOp, cond.whileValue)) {
+                        continue;
+                    }
+                    EventDataType data = el->data(j);
+                    if (count == 0) {
+                        min = max = data;
+                    } else {
+                        if (data < min) min = data;
+                        if (data > max) max = data;
+                    }
+                    ++count;
+                    sum += data;
+                    if (el->type() == EVL_Event) duration += data;
+                    if (wantvalues) values.append(data);
+                }
+            }
+        }
+
+        if (!loaded) {
+            sess->TrashEvents();
+        }
+    }
+
+    switch (cond.func) {
+    case QF_Count: return count;
+    case QF_CPH: return (minutes > 0) ? (count * 60.0 / minutes) : 0;
+    case QF_SPH: return (minutes > 0) ? (100.0 / minutes) * (duration / 60.0) : 0;
+    case QF_Sum: return sum;
+    case QF_Avg:
+    case QF_WAvg: return (count > 0) ? (sum / count) : 0;
+    case QF_Min: return min;
+    case QF_Max: return max;
+    case QF_Hours: return minutes / 60.0;
+    case QF_Median:
+    case QF_P90:
+    case QF_P95: {
+        if (values.isEmpty()) return 0;
+        float p = (cond.func == QF_Median) ? 0.5F : ((cond.func == QF_P90) ? 0.9F : 0.95F);
+        int idx = qMin(int(values.size() * p), values.size() - 1);
+        std::nth_element(values.begin(), values.begin() + idx, values.end());
+        return values[idx];
+    }
+    }
+    return 0;
+}
+
+bool DayQuery::matchEvents(Day * day, QList<EventDataType> & values) const
+{
+    values.clear();
+    for (const auto & cond : m_conditions) {
+        EventDataType val = cond.needsEvents() ? eventValue(day->sessions, cond) : summaryValue(day, cond);
+        if (!compare(val, cond.op, cond.value)) {
+            return false;
+        }
+        values.append(val);
+    }
+    return true;
+}
+
+bool DayQuery::matchLoaded(const QList<Session *> & sessions, QList<EventDataType> & values) const
+{
+    for (int i = 0; i < m_conditions.size() && i < values.size(); ++i) {
+        const QueryCondition & cond = m_conditions.at(i);
+        if (!cond.needsEvents()) {
+            continue;   // already checked by matchSummary
+        }
+        values[i] = eventValue(sessions, cond);
+        if (!compare(values.at(i), cond.op, cond.value)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+QList<EventDataType> DayQuery::summaryValues(Day * day) const
+{
+    QList<EventDataType> values;
+    for (const auto & cond : m_conditions) {
+        values.append(cond.needsEvents() ? 0 : summaryValue(day, cond));
+    }
+    return values;
+}
+
+void QueryTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowPriority);
+    bool matched = false;
+    QString description;
+    QList<Session *> copies;
+
+    for (const auto & source : sources) {
+        if (engine->m_cancelled.load() != 0) {
+            break;
+        }
+        Session * copy = new Session(source.mach, source.id);
+        if (copy->LoadEvents(source.filename) && copy->OpenEvents()) {
+            copy->m_slices = source.slices;     // so hours() matches the real session
+            copies.append(copy);
+        } else {
+            delete copy;
+        }
+    }
+
+    if ((engine->m_cancelled.load() == 0) && engine->m_query.matchLoaded(copies, values)) {
+        matched = true;
+        description = engine->describe(values);
+    }
+    qDeleteAll(copies);
+
+    QMetaObject::invokeMethod(engine, "taskDone", Qt::QueuedConnection, Q_ARG(int, generation),
+                              Q_ARG(QDate, date), Q_ARG(bool, matched), Q_ARG(QString, description));
+}
+
+QueryEngine::QueryEngine(QObject * parent)
+    :QObject(parent), m_generation(0), m_matches(0), m_total(0), m_done(0), m_running(false)
+{
+    m_pool.setMaxThreadCount(QThread::idealThreadCount());
+}
+
+QueryEngine::~QueryEngine()
+{
+    cancel();
+}
+
+bool QueryEngine::start(const DayQuery & query, QDate start, QDate end)
+{
+    cancel();
+    if (query.isEmpty() || !p_profile) {
+        return false;
+    }
+
+    m_query = query;
+    m_cancelled.store(0);
+    m_matches = 0;
+    m_total = m_done = 0;
+    m_running = true;
+
+    QList<QueryTask *> tasks;
+    QList<EventDataType> values;
+
+    auto it = p_profile->daylist.lowerBound(start);
+    auto it_end = p_profile->daylist.upperBound(end);
+    for (; it != it_end; ++it) {
+        Day * day = it.value();
+        if (!m_query.matchSummary(day)) {
+            continue;
+        }
+        if (m_query.needsEvents()) {
+            QList<QuerySource> sources;
+            for (Session * sess : day->sessions) {
+                if (!sess->enabled() || sess->summaryOnly() || (sess->type() == MT_JOURNAL)) {
+                    continue;
+                }
+                QuerySource source;
+                source.mach = sess->machine();
+                source.id = sess->session();
+                source.filename = sess->eventFile();
+                source.slices = sess->m_slices;
+                sources.append(source);
+            }
+            tasks.append(new QueryTask(this, m_generation, it.key(), sources, m_query.summaryValues(day)));
+        } else if (m_query.matchEvents(day, values)) {
+            ++m_matches;
+            emit dayMatched(day->date(), describe(values));
+        }
+    }
+
+    m_total = tasks.size();
+    emit progress(0, m_total);
+    if (m_total == 0) {
+        m_running = false;
+        emit finished(m_matches);
+        return true;
+    }
+
+    qDebug() << "Query has" << m_total << "candidate days needing event data";
+    for (QueryTask * task : tasks) {
+        m_pool.start(task);
+    }
+    return true;
+}
+
+void QueryEngine::cancel()
+{
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+
+    // Anything the finished tasks already queued belongs to the old query
+    ++m_generation;
+    if (m_running) {
+        m_running = false;
+        emit finished(m_matches);
+    }
+}
+
+void QueryEngine::taskDone(int generation, QDate date, bool matched, QString description)
+{
+    if (!m_running || (generation != m_generation)) {
+        return;
+    }
+    if (matched) {
+        ++m_matches;
+        emit dayMatched(date, description);
+    }
+    ++m_done;
+    emit progress(m_done, m_total);
+    if (m_done >= m_total) {
+        m_running = false;
+        emit finished(m_matches);
+    }
+}
+
+QString QueryEngine::describe(const QList<EventDataType> & values) const
+{
+    QStringList parts;
+    const QList<QueryCondition> & conds = m_query.conditions();
+    for (int i = 0; i < conds.size() && i < values.size(); ++i) {
+        const QueryCondition & cond = conds.at(i);
+        QString part;
+        if (cond.func == QF_Hours) {
+            part = QString("hours=%1").arg(values.at(i), 0, 'f', 2);
+        } else {
+            part = QString("%1(%2)=%3").arg(DayQuery::funcName(cond.func))
+                    .arg(schema::channel[cond.code].code()).arg(values.at(i), 0, 'f', 2);
+        }
+        if (cond.needsEvents()) {
+            part += QString(" while %1%2%3").arg(schema::channel[cond.whileCode].code())
+                    .arg(opString(cond.whileOp)).arg(cond.whileValue);
+        }
+        parts.append(part);
+    }
+    return parts.join(", ");
+}
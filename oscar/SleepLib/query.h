@@ -0,0 +1,205 @@
+/* SleepLib Cross-night Query Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef QUERY_H
+#define QUERY_H
+
+#include <QObject>
+#include <QDate>
+#include <QList>
+#include <QString>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+#include "SleepLib/session.h"
+
+class Day;
+class Machine;
+
+enum QueryFunc {
+    QF_Count, QF_CPH, QF_SPH, QF_Sum, QF_Avg, QF_WAvg, QF_Min, QF_Max,
+    QF_Median, QF_P90, QF_P95, QF_Hours
+};
+
+enum QueryOp {
+    QO_Less, QO_LessEqual, QO_Greater, QO_GreaterEqual, QO_Equal, QO_NotEqual
+};
+
+/*! \struct QueryCondition
+    \brief A single comparison, eg "cph(ClearAirway) > 5 while Pressure > 12"
+
+    When whileCode is set, only the events of code that happen while the whileCode channel
+    satisfies the whileOp comparison are counted, which needs the session events to be opened.
+    */
+struct QueryCondition
+{
+    QueryCondition() : func(QF_Avg), code(NoChannel), op(QO_Greater), value(0),
+        whileCode(NoChannel), whileOp(QO_Greater), whileValue(0) {}
+
+    inline bool needsEvents() const { return whileCode != NoChannel; }
+
+    QueryFunc func;
+    ChannelID code;
+    QueryOp op;
+    EventDataType value;
+
+    ChannelID whileCode;
+    QueryOp whileOp;
+    EventDataType whileValue;
+};
+
+/*! \class DayQuery
+    \brief A parsed filter expression made of conditions joined by "and"
+
+    Expression syntax:
+      condition [and condition...]
+      condition := func(Channel) op number [while Channel op number]
+                 | Channel op number          (same as avg(Channel))
+                 | hours op number
+      func      := cnt, cph, sph, sum, avg, wavg, min, max, median, p90, p95
+      op        := <, <=, >, >=, =, !=
+                   (only <, <=, > and >= after "while")
+
+    Channels are referred to by their schema code, eg "ClearAirway" or "Pressure".
+    */
+class DayQuery
+{
+  public:
+    DayQuery() {}
+
+    //! \brief Parses text into this query, returning false and setting error on failure
+    bool parse(const QString & text, QString * error = nullptr);
+
+    inline bool isEmpty() const { return m_conditions.isEmpty(); }
+    inline bool needsEvents() const {
+        for (const auto & c : m_conditions) if (c.needsEvents()) return true;
+        return false;
+    }
+    const QList<QueryCondition> & conditions() const { return m_conditions; }
+
+    /*! \brief Evaluates everything that can be answered from the session summaries.
+        Returns false if day can't possibly match. Conditions needing events are only checked
+        against summary upper bounds, so a true result means day is a candidate */
+    bool matchSummary(Day * day) const;
+
+    /*! \brief Full evaluation, opening events where needed.
+        Fills values with the value of each condition. GUI thread only, as it opens and
+        trashes the events of day's sessions */
+    bool matchEvents(Day * day, QList<EventDataType> & values) const;
+
+    /*! \brief Evaluates the conditions needing events against sessions, which must have their events loaded.
+        On entry values holds the value of each condition answered from the summaries, as
+        filled in by summaryValues(), and the event condition values are filled in here.
+        Safe on any thread, as long as nothing else is using sessions */
+    bool matchLoaded(const QList<Session *> & sessions, QList<EventDataType> & values) const;
+
+    //! \brief Values of the summary conditions for day, with 0 in place of those needing events
+    QList<EventDataType> summaryValues(Day * day) const;
+
+    //! \brief Returns the value of a summary only condition for day
+    static EventDataType summaryValue(Day * day, const QueryCondition & cond);
+
+    static bool compare(EventDataType a, QueryOp op, EventDataType b);
+
+    static QString funcName(QueryFunc func);
+
+  protected:
+    static EventDataType eventValue(const QList<Session *> & sessions, const QueryCondition & cond);
+
+    QList<QueryCondition> m_conditions;
+};
+
+class QueryEngine;
+
+/*! \struct QuerySource
+    \brief What a QueryTask needs to read one session's events, gathered on the GUI thread
+    */
+struct QuerySource
+{
+    Machine * mach;
+    SessionID id;
+    QString filename;
+    QVector<SessionSlice> slices;
+};
+
+/*! \class QueryTask
+    \brief Evaluates a DayQuery against one candidate day on the thread pool
+
+    Like the night pre-warmer, the task reads the day's events into private Session copies,
+    so the real Sessions the GUI thread loads and trashes are never touched off it.
+    */
+class QueryTask:public QRunnable
+{
+public:
+    QueryTask(QueryEngine * engine, int generation, QDate date, const QList<QuerySource> & sources,
+              const QList<EventDataType> & values)
+        : engine(engine), generation(generation), date(date), sources(sources), values(values) {}
+    virtual ~QueryTask() {}
+    virtual void run();
+
+protected:
+    QueryEngine * engine;
+    int generation;
+    QDate date;
+    QList<QuerySource> sources;
+    QList<EventDataType> values;
+};
+
+/*! \class QueryEngine
+    \brief Runs a DayQuery over a date range of the current profile
+
+    The summary pass runs on the calling thread, as it only touches cached session summaries.
+    Candidate days needing event data are then handed to a low priority thread pool, and
+    each match is reported through dayMatched() as soon as it is found.
+
+    Tasks report back through queued taskDone() calls tagged with the generation of the
+    query they belong to, so calls still queued from a cancelled query are ignored.
+    */
+class QueryEngine:public QObject
+{
+    Q_OBJECT
+    friend class QueryTask;
+  public:
+    explicit QueryEngine(QObject * parent = nullptr);
+    virtual ~QueryEngine();
+
+    //! \brief Starts evaluating query between start and end (inclusive)
+    bool start(const DayQuery & query, QDate start, QDate end);
+
+    //! \brief Stops any outstanding work and waits for it to finish
+    void cancel();
+
+    inline bool isRunning() const { return m_running; }
+
+    const DayQuery & query() const { return m_query; }
+
+  signals:
+    void dayMatched(QDate date, QString description);
+    void progress(int done, int total);
+    void finished(int matches);
+
+  protected slots:
+    void taskDone(int generation, QDate date, bool matched, QString description);
+
+  protected:
+    //! \brief Describes the values a matching day was found with, for dayMatched()
+    QString describe(const QList<EventDataType> & values) const;
+
+    DayQuery m_query;
+    QThreadPool m_pool;
+    QAtomicInt m_cancelled;
+    int m_generation;
+    int m_matches;
+    int m_total;
+    int m_done;
+    bool m_running;
+};
+
+#endif // QUERY_H
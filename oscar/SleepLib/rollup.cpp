@@ -0,0 +1,390 @@
+/* SleepLib Session Rollup Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDir>
+#include <QSaveFile>
+#include <QThread>
+#include <QMutexLocker>
+#include <QDataStream>
+#include <QDebug>
+
+#include "rollup.h"
+#include "session.h"
+#include "machine.h"
+#include "schema.h"
+#include "common.h"
+
+const quint16 rollup_version = 1;
+
+// Guard against broken timestamps blowing up the minute buckets
+const qint64 rollup_max_span = 48L * 3600000L;
+
+// Roughly 64MB worth of loaded rollup files
+const int rollup_cache_size = 64 * 1024 * 1024;
+
+bool SessionRollup::wantsRollup(ChannelID code)
+{
+    schema::ChanType type = schema::channel[code].type();
+    return (type == schema::WAVEFORM) || (type == schema::DATA);
+}
+
+RollupLevel SessionRollup::levelFor(qint64 span)
+{
+    for (int i = 0; i < RL_Levels; ++i) {
+        if (rollup_interval[i] >= span) {
+            return RollupLevel(i);
+        }
+    }
+    return RollupLevel(RL_Levels - 1);
+}
+
+QString SessionRollup::fileName(Session * sess)
+{
+    return sess->machine()->getRollupsPath() + QString().sprintf("%08lx.002", sess->session());
+}
+
+void SessionRollup::build(Session * sess)
+{
+    m_series.clear();
+    m_session = sess->session();
+
+    for (auto it = sess->eventlist.begin(), end = sess->eventlist.end(); it != end; ++it) {
+        ChannelID code = it.key();
+        if (!wantsRollup(code)) {
+            continue;
+        }
+
+        RollupSeries minutes;
+        minutes.interval = rollup_interval[RL_Minute];
+        minutes.first = (sess->realFirst() / minutes.interval) * minutes.interval;
+        qint64 span = qBound(qint64(0), sess->realLast() - minutes.first, rollup_max_span);
+        minutes.buckets.resize(int(span / minutes.interval) + 1);
+
+        bool empty = true;
+        for (EventList * el : it.value()) {
+            quint32 size = el->count();
+            for (quint32 j = 0; j < size; ++j) {
+                qint64 offset = el->time(j) - minutes.first;
+                if ((offset < 0) || (offset > rollup_max_span)) {
+                    continue;
+                }
+                int idx = int(offset / minutes.interval);
+                if (idx >= minutes.buckets.size()) {
+                    minutes.buckets.resize(idx + 1);
+                }
+                minutes.buckets[idx].add(el->data(j));
+                empty = false;
+            }
+        }
+        if (empty) {
+            continue;
+        }
+
+        QVector<RollupSeries> levels(RL_Levels);
+        levels[RL_Minute] = minutes;
+
+        // Each coarser level is merged from the minute buckets rather than the raw data
+        for (int l = RL_TenMinutes; l < RL_Levels; ++l) {
+            RollupSeries & series = levels[l];
+            series.interval = rollup_interval[l];
+            series.first = (minutes.first / series.interval) * series.interval;
+            qint64 last = minutes.bucketStart(minutes.buckets.size() - 1);
+            series.buckets.resize(int((last - series.first) / series.interval) + 1);
+
+            for (int i = 0; i < minutes.buckets.size(); ++i) {
+                int idx = int((minutes.bucketStart(i) - series.first) / series.interval);
+                series.buckets[idx].merge(minutes.buckets.at(i));
+            }
+        }
+        m_series[code] = levels;
+    }
+}
+
+const RollupSeries * SessionRollup::series(ChannelID code, RollupLevel level) const
+{
+    auto it = m_series.constFind(code);
+    if ((it == m_series.constEnd()) || (level >= it.value().size())) {
+        return nullptr;
+    }
+    return &it.value().at(level);
+}
+
+bool SessionRollup::save(const QString & filename) const
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not open rollup" << filename << "for writing, error code" << file.error() << file.errorString();
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << (quint32)magic;
+    out << (quint16)rollup_version;
+    out << (quint16)filetype_rollup;
+    out << (quint32)m_session;
+    out << (quint16)m_series.size();
+
+    for (auto it = m_series.constBegin(), end = m_series.constEnd(); it != end; ++it) {
+        out << (quint32)it.key();
+        const QVector<RollupSeries> & levels = it.value();
+        out << (quint16)levels.size();
+        for (const auto & series : levels) {
+            out << series.first;
+            out << series.interval;
+            out << (quint32)series.buckets.size();
+            for (const auto & b : series.buckets) {
+                out << b.min << b.max << b.sum << b.count;
+            }
+        }
+    }
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+    }
+    return file.commit();
+}
+
+bool SessionRollup::load(const QString & filename)
+{
+    m_series.clear();
+
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 t32, code, count;
+    quint16 version, type, nchannels, nlevels;
+
+    in >> t32;
+    if (t32 != magic) {
+        qDebug() << "Wrong magic number in" << filename;
+        return false;
+    }
+    in >> version;
+    in >> type;
+    if ((version != rollup_version) || (type != filetype_rollup)) {
+        qDebug() << "Outdated or unknown rollup file" << filename;
+        return false;
+    }
+    in >> t32;
+    m_session = t32;
+
+    in >> nchannels;
+    for (int c = 0; c < nchannels; ++c) {
+        in >> code;
+        in >> nlevels;
+        QVector<RollupSeries> levels(nlevels);
+        for (auto & series : levels) {
+            in >> series.first;
+            in >> series.interval;
+            in >> count;
+            if (in.status() != QDataStream::Ok) {
+                break;
+            }
+            series.buckets.resize(count);
+            for (auto & b : series.buckets) {
+                in >> b.min >> b.max >> b.sum >> b.count;
+            }
+        }
+        if (in.status() != QDataStream::Ok) {
+            qWarning() << "Truncated rollup file" << filename;
+            m_series.clear();
+            return false;
+        }
+        m_series[code] = levels;
+    }
+    return true;
+}
+
+RollupTask::RollupTask(RollupLoader * loader, Session * sess)
+    : loader(loader), mach(sess->machine()), id(sess->session()),
+      filename(SessionRollup::fileName(sess)), eventfile(sess->eventFile()),
+      canBuild((sess->type() != MT_JOURNAL) && !sess->summaryOnly())
+{
+}
+
+SessionRollup * RollupTask::build()
+{
+    // Hold saveMutex so this can't interleave with the session being stored again
+    QMutexLocker lock(&mach->saveMutex);
+
+    Session * copy = new Session(mach, id);
+    if (!copy->LoadEvents(eventfile)) {
+        delete copy;
+        return nullptr;
+    }
+    SessionRollup * rollup = new SessionRollup;
+    rollup->build(copy);
+    delete copy;
+
+    if (rollup->isEmpty()) {
+        delete rollup;
+        return nullptr;
+    }
+    QDir().mkpath(QFileInfo(filename).path());
+    if (!rollup->save(filename)) {
+        qWarning() << "Could not store rollup for session" << id;
+    }
+    return rollup;
+}
+
+void RollupTask::run()
+{
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    SessionRollup * rollup = nullptr;
+    int cost = 1;
+
+    if (loader->m_cancelled.load() == 0) {
+        rollup = new SessionRollup;
+        if (!rollup->load(filename)) {
+            delete rollup;
+            rollup = nullptr;
+            if (canBuild && (loader->m_cancelled.load() == 0)) {
+                rollup = build();
+            }
+        }
+        if (rollup) {
+            cost = qMax(int(QFileInfo(filename).size()), 1);
+        }
+    }
+    loader->finished(RollupLoader::Key(mach, id), rollup, cost);
+    QMetaObject::invokeMethod(loader, "taskDone", Qt::QueuedConnection);
+}
+
+RollupLoader & RollupLoader::instance()
+{
+    static RollupLoader loader;
+    return loader;
+}
+
+RollupLoader::RollupLoader()
+{
+    // One reader keeps up with painting, and leaves the disk and cores to the GUI
+    m_pool.setMaxThreadCount(1);
+    m_cache.setMaxCost(rollup_cache_size);
+
+    // Sessions stored by importers may be the first to ask for us, but our slots belong on the GUI thread
+    if (QCoreApplication::instance()) {
+        moveToThread(QCoreApplication::instance()->thread());
+    }
+}
+
+RollupLoader::~RollupLoader()
+{
+    clear();
+}
+
+const SessionRollup * RollupLoader::rollup(Session * sess)
+{
+    Key key(sess->machine(), sess->session());
+    SessionRollup * r = m_cache.object(key);
+    if (r || m_pending.contains(key) || m_missing.contains(key)) {
+        return r;
+    }
+    m_pending.insert(key);
+    m_pool.start(new RollupTask(this, sess));
+    return nullptr;
+}
+
+void RollupLoader::clear()
+{
+    m_cancelled.store(1);
+    m_pool.clear();
+    m_pool.waitForDone();
+    m_cancelled.store(0);
+
+    {
+        QMutexLocker lock(&m_mutex);
+        for (auto & result : m_results) {
+            delete result.rollup;
+        }
+        m_results.clear();
+        m_stale.clear();
+    }
+    m_cache.clear();
+    m_pending.clear();
+    m_missing.clear();
+    m_discard.clear();
+}
+
+void RollupLoader::invalidate(Machine * mach, SessionID id)
+{
+    {
+        QMutexLocker lock(&m_mutex);
+        m_stale.insert(Key(mach, id));
+    }
+    QMetaObject::invokeMethod(this, "dropStale", Qt::QueuedConnection);
+}
+
+void RollupLoader::dropStale()
+{
+    QSet<Key> stale;
+    {
+        QMutexLocker lock(&m_mutex);
+        stale.swap(m_stale);
+    }
+    if (stale.isEmpty()) {
+        return;
+    }
+    for (const Key & key : stale) {
+        m_cache.remove(key);
+        m_missing.remove(key);
+        if (m_pending.contains(key)) {
+            // It may have read the old file, so ask again once it's back
+            m_discard.insert(key);
+        }
+    }
+    emit rollupsLoaded();
+}
+
+void RollupLoader::finished(const Key & key, SessionRollup * rollup, int cost)
+{
+    QMutexLocker lock(&m_mutex);
+    Result result;
+    result.key = key;
+    result.rollup = rollup;
+    result.cost = cost;
+    m_results.append(result);
+}
+
+void RollupLoader::taskDone()
+{
+    QList<Result> results;
+    {
+        QMutexLocker lock(&m_mutex);
+        results.swap(m_results);
+    }
+
+    bool loaded = false;
+    for (auto & result : results) {
+        m_pending.remove(result.key);
+        if (m_discard.remove(result.key)) {
+            delete result.rollup;
+            continue;
+        }
+        if (result.rollup) {
+            m_cache.insert(result.key, result.rollup, result.cost);
+            loaded = true;
+        } else {
+            m_missing.insert(result.key);
+        }
+    }
+    if (loaded) {
+        emit rollupsLoaded();
+    }
+}
@@ -0,0 +1,217 @@
+/* SleepLib Session Rollup Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef ROLLUP_H
+#define ROLLUP_H
+
+#include <QObject>
+#include <QHash>
+#include <QVector>
+#include <QString>
+#include <QPair>
+#include <QSet>
+#include <QCache>
+#include <QMutex>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QAtomicInt>
+
+#include "SleepLib/machine_common.h"
+
+class Session;
+class Machine;
+class RollupLoader;
+
+/*! \enum RollupLevel
+    \brief The resolutions rollups are kept at
+    */
+enum RollupLevel { RL_Minute = 0, RL_TenMinutes, RL_Hour, RL_Levels };
+
+//! \brief Width in milliseconds of a bucket at each RollupLevel
+const qint64 rollup_interval[RL_Levels] = { 60000L, 600000L, 3600000L };
+
+/*! \struct RollupBucket
+    \brief min/avg/max of one channel across one bucket of time
+    */
+struct RollupBucket
+{
+    RollupBucket() : min(0), max(0), sum(0), count(0) {}
+
+    inline EventDataType avg() const { return count ? EventDataType(sum / count) : 0; }
+    inline bool isEmpty() const { return count == 0; }
+
+    void add(EventDataType value) {
+        if (count == 0) {
+            min = max = value;
+        } else {
+            if (value < min) min = value;
+            if (value > max) max = value;
+        }
+        sum += value;
+        ++count;
+    }
+
+    void merge(const RollupBucket & other) {
+        if (other.count == 0) return;
+        if (count == 0) {
+            min = other.min;
+            max = other.max;
+        } else {
+            if (other.min < min) min = other.min;
+            if (other.max > max) max = other.max;
+        }
+        sum += other.sum;
+        count += other.count;
+    }
+
+    EventDataType min;
+    EventDataType max;
+    double sum;
+    quint32 count;
+};
+
+/*! \struct RollupSeries
+    \brief Consecutive buckets of one channel at one RollupLevel, bucket i starts at first + i * interval
+    */
+struct RollupSeries
+{
+    RollupSeries() : first(0), interval(0) {}
+
+    inline qint64 bucketStart(int i) const { return first + i * interval; }
+
+    qint64 first;
+    qint64 interval;
+    QVector<RollupBucket> buckets;
+};
+
+/*! \class SessionRollup
+    \brief Downsampled min/avg/max data for a session's numeric channels at several resolutions
+
+    Built from the EventLists while they are loaded during import, and stored in the machine's
+    Rollups folder so long range charts can be drawn without opening any event files.
+    */
+class SessionRollup
+{
+  public:
+    SessionRollup() : m_session(0) {}
+
+    //! \brief Builds the rollups from sess's loaded EventLists
+    void build(Session * sess);
+
+    //! \brief Returns the series for code at level, or nullptr if there isn't one
+    const RollupSeries * series(ChannelID code, RollupLevel level) const;
+
+    QList<ChannelID> channels() const { return m_series.keys(); }
+    inline bool isEmpty() const { return m_series.isEmpty(); }
+
+    bool save(const QString & filename) const;
+    bool load(const QString & filename);
+
+    //! \brief Returns the rollup filename used for sess
+    static QString fileName(Session * sess);
+
+    //! \brief Picks the finest level whose buckets are at least span milliseconds wide
+    static RollupLevel levelFor(qint64 span);
+
+    //! \brief Returns true if code is the kind of channel that gets rolled up
+    static bool wantsRollup(ChannelID code);
+
+  protected:
+    SessionID m_session;
+    QHash<ChannelID, QVector<RollupSeries> > m_series;
+};
+
+/*! \class RollupTask
+    \brief Reads one session's rollup file, building and storing it from a private copy of the events if it's missing
+    */
+class RollupTask:public QRunnable
+{
+public:
+    RollupTask(RollupLoader * loader, Session * sess);
+    virtual ~RollupTask() {}
+    virtual void run();
+
+protected:
+    //! \brief Builds the rollup from the session's events file, and stores it for next time
+    SessionRollup * build();
+
+    RollupLoader * loader;
+    Machine * mach;
+    SessionID id;
+    QString filename;
+    QString eventfile;
+    bool canBuild;
+};
+
+/*! \class RollupLoader
+    \brief Holds the session rollups the Overview trend charts draw from, reading them off the GUI thread
+
+    Charts ask for a session's rollups while painting, and get nothing back until they've been
+    read on a low priority thread, after which rollupsLoaded() asks for a repaint. Sessions imported
+    before rollups existed have theirs built from their events file the first time they're asked for.
+
+    Apart from the tasks themselves and invalidate(), everything here runs on the GUI thread.
+    */
+class RollupLoader:public QObject
+{
+    Q_OBJECT
+    friend class RollupTask;
+  public:
+    static RollupLoader & instance();
+
+    //! \brief Returns sess's rollups if they're loaded, otherwise queues them up and returns nullptr
+    const SessionRollup * rollup(Session * sess);
+
+    //! \brief Drops all loaded rollups and outstanding work, for when sessions have been reloaded or replaced
+    void clear();
+
+    //! \brief Forgets one session's rollups after its events were rewritten, so they're read again. Safe from any thread.
+    void invalidate(Machine * mach, SessionID id);
+
+  signals:
+    //! \brief More rollups are ready to be drawn
+    void rollupsLoaded();
+
+  protected slots:
+    void taskDone();
+
+    //! \brief Drops the rollups invalidate() was told about, on the GUI thread
+    void dropStale();
+
+  protected:
+    typedef QPair<Machine *, SessionID> Key;
+
+    struct Result {
+        Key key;
+        SessionRollup * rollup;
+        int cost;
+    };
+
+    RollupLoader();
+    virtual ~RollupLoader();
+
+    //! \brief Called from the pool thread with the loaded rollup, or nullptr if there isn't one
+    void finished(const Key & key, SessionRollup * rollup, int cost);
+
+    QThreadPool m_pool;
+    QAtomicInt m_cancelled;
+
+    QMutex m_mutex;
+    QList<Result> m_results;
+    QSet<Key> m_stale;
+
+    //! \brief Loaded rollups, costed by their file size
+    QCache<Key, SessionRollup> m_cache;
+    QSet<Key> m_pending;
+    QSet<Key> m_missing;
+
+    //! \brief Keys whose task was already under way when they went stale, so its result is thrown away
+    QSet<Key> m_discard;
+};
+
+#endif // ROLLUP_H
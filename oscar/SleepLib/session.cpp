@@ -12,6 +12,7 @@
 #include "version.h"
 #include <cmath>
 #include <QDir>
+#include <QSaveFile>
 #include <QDebug>
 #include <QMessageBox>
 #include <QMetaType>
@@ -20,6 +21,10 @@
 
 #include "SleepLib/calcs.h"
 #include "SleepLib/profiles.h"
+#include "SleepLib/rollup.h"
+#include "SleepLib/crc.h"
+#include "SleepLib/eventpool.h"
+#include "SleepLib/memoryaccounting.h"
 
 using namespace std;
 
@@ -42,10 +47,13 @@ Session::Session(Machine *m, SessionID session)
     s_changed = false;
     s_events_loaded = false;
     s_summary_loaded = false;
+    s_storecount = 0;
     _first_session = true;
     s_enabled = true;
 
     s_first = s_last = 0;
+    s_drift = 0;
+    s_drift_generation = -1;
     s_evchecksum_checked = false;
 
     s_noSettings = s_summaryOnly = false;
@@ -75,10 +83,7 @@ void Session::TrashEvents()
         j_end=i.value().end();
         for (j = i.value().begin(); j != j_end; ++j) {
             EventList * ev = *j;
-            ev->clear();
-            ev->m_data.squeeze();
-            ev->m_data2.squeeze();
-            ev->m_time.squeeze();
+            ev->recycle();
             delete ev;
         }
     }
@@ -86,6 +91,63 @@ void Session::TrashEvents()
     s_events_loaded = false;
     eventlist.clear();
     eventlist.squeeze();
+
+    s_storedChannels.clear();
+    s_dirtyChannels.clear();
+    s_overlayChannels.clear();
+}
+
+bool Session::adoptEvents(Session * other)
+{
+    if (s_events_loaded || !eventlist.isEmpty() || (other->s_session != s_session)) {
+        return false;
+    }
+
+    eventlist.swap(other->eventlist);
+    s_first = other->s_first; // LoadEvents takes these from the events file too
+    s_last = other->s_last;
+    s_overlayChannels = other->s_overlayChannels;
+    s_evchecksum_checked = other->s_evchecksum_checked;
+    markEventsStored();
+    s_events_loaded = true;
+
+    other->s_events_loaded = false;
+    other->s_storedChannels.clear();
+    other->s_overlayChannels.clear();
+    return true;
+}
+
+qint64 Session::eventMemoryUsed()
+{
+    qint64 bytes = memoryOf(eventlist);
+    for (const auto & lists : eventlist) {
+        bytes += memoryOf(lists);
+        for (const auto & el : lists) {
+            bytes += el->memoryUsed();
+        }
+    }
+    return bytes;
+}
+
+qint64 Session::summaryMemoryUsed()
+{
+    qint64 bytes = qint64(sizeof(Session));
+    bytes += memoryOf(settings) + memoryOf(m_cnt) + memoryOf(m_sum) + memoryOf(m_avg) + memoryOf(m_wavg);
+    bytes += memoryOf(m_min) + memoryOf(m_max) + memoryOf(m_physmin) + memoryOf(m_physmax);
+    bytes += memoryOf(m_cph) + memoryOf(m_sph) + memoryOf(m_firstchan) + memoryOf(m_lastchan) + memoryOf(m_gain);
+    bytes += memoryOf(m_lowerThreshold) + memoryOf(m_timeBelowTheshold);
+    bytes += memoryOf(m_upperThreshold) + memoryOf(m_timeAboveTheshold);
+    bytes += memoryOf(m_availableChannels) + memoryOf(m_availableSettings) + memoryOf(m_slices);
+
+    bytes += memoryOf(m_valuesummary);
+    for (const auto & values : m_valuesummary) {
+        bytes += memoryOf(values);
+    }
+    bytes += memoryOf(m_timesummary);
+    for (const auto & times : m_timesummary) {
+        bytes += memoryOf(times);
+    }
+    return bytes;
 }
 
 void Session::setEnabled(bool b)
@@ -144,6 +206,8 @@ bool Session::Destroy()
     if ( ! dir.remove(eventfile)) {
         qWarning() << "Could not delete" << eventfile;
     }
+    dir.remove(overlayFile()); // only there if edited since the last compaction
+    dir.remove(SessionRollup::fileName(this)); // may not exist for older imports
 
     return s_machine->unlinkSession(this);
 }
@@ -163,9 +227,14 @@ bool Session::Store(QString path)
 
     a = StoreSummary(); // if actually has events
 
+    // Record it in the journal until the machine next commits its summary index
+    if (a) {
+        s_machine->journal().append(this);
+    }
+
     //qDebug() << " Summary done";
     if (eventlist.size() > 0) {
-        StoreEvents();
+        StoreEvents(); // rebuilds the rollups too
     } else { // who cares..
         //qDebug() << "Trying to save empty events file";
     }
@@ -173,6 +242,7 @@ bool Session::Store(QString path)
     //qDebug() << " Events done";
     s_changed = false;
     s_events_loaded = true;
+    s_storecount++;
 
     //} else {
     //    qDebug() << "Session::Store() No event data saved" << s_session;
@@ -181,6 +251,27 @@ bool Session::Store(QString path)
     return a;
 }
 
+bool Session::StoreRollup()
+{
+    SessionRollup rollup;
+    rollup.build(this);
+
+    // Whatever the trend charts had for this session came from the old events
+    RollupLoader::instance().invalidate(s_machine, s_session);
+
+    if (rollup.isEmpty()) {
+        QFile::remove(SessionRollup::fileName(this));
+        return false;
+    }
+
+    QString path = s_machine->getRollupsPath();
+    QDir dir(path);
+    if ( ! dir.exists()) {
+        dir.mkpath(path);
+    }
+    return rollup.save(SessionRollup::fileName(this));
+}
+
 //QDataStream & operator<<(QDataStream & out, const Session & session)
 //{
 //    session.StoreSummaryData(out);
@@ -311,7 +402,7 @@ bool Session::StoreSummary()
 
     QString filename = s_machine->getSummariesPath() + QString().sprintf("%08lx.000", s_session);
 
-    QFile file(filename);
+    QSaveFile file(filename);
     if (!file.open(QIODevice::WriteOnly)) {
         QDir dir;
         dir.mkpath(s_machine->getSummariesPath());
@@ -376,7 +467,11 @@ bool Session::StoreSummary()
 
     out << m_slices;
 
-    file.close();
+    // Replaces the old summary in one rename, so a crash mid-write never leaves it truncated
+    if (!file.commit()) {
+        qWarning() << "Could not commit summary" << filename << "error code" << file.error() << file.errorString();
+        return false;
+    }
     return true;
 }
 
@@ -642,6 +737,11 @@ bool Session::LoadSummary()
         }
     }
 
+    if (in.status() != QDataStream::Ok) {
+        qWarning() << "Truncated summary file" << filename;
+        return false;
+    }
+
     // not really a good idea to do this... should flag and do a reindex
     if (upgrade || (version < summary_version)) {
 
@@ -660,65 +760,214 @@ bool Session::LoadSummary()
     return true;
 }
 
+bool Session::ReloadSummary()
+{
+    // Older summary versions merge into these rather than replacing them
+    settings.clear();
+    m_cnt.clear();
+    m_sum.clear();
+    m_avg.clear();
+    m_wavg.clear();
+    m_min.clear();
+    m_max.clear();
+    m_physmin.clear();
+    m_physmax.clear();
+    m_cph.clear();
+    m_sph.clear();
+    m_firstchan.clear();
+    m_lastchan.clear();
+    m_valuesummary.clear();
+    m_timesummary.clear();
+    m_gain.clear();
+    m_availableChannels.clear();
+    m_timeAboveTheshold.clear();
+    m_upperThreshold.clear();
+    m_timeBelowTheshold.clear();
+    m_lowerThreshold.clear();
+    m_slices.clear();
+
+    s_summary_loaded = false;
+    return LoadSummary();
+}
+
 const quint16 compress_method = 1;
 
+// Edits touching more than 1/overlay_max_share of a session's samples rewrite the whole events file instead
+const int overlay_max_share = 4;
+
+QString Session::overlayFile() const
+{
+    return s_machine->getEventsPath()+QString().sprintf("%08lx.003", s_session);
+}
+
+void Session::setChannelChanged(ChannelID code)
+{
+    s_dirtyChannels.insert(code);
+}
+
+void Session::markEventsStored()
+{
+    s_storedChannels = QSet<ChannelID>::fromList(eventlist.keys());
+    s_dirtyChannels.clear();
+}
+
 bool Session::StoreEvents()
 {
     QString path = s_machine->getEventsPath();
     QDir dir;
     dir.mkpath(path);
-    QString filename = path+QString().sprintf("%08lx.001", s_session);
 
-    QFile file(filename);
-    if (!file.open(QIODevice::WriteOnly)) {
-        qWarning() << "Could not open events file" << filename << "for writing, error code" << file.error() << file.errorString();
+    // When the events came from disk, only channels edited since then need writing
+    if (!s_storedChannels.isEmpty() && QFile::exists(eventFile())) {
+        QSet<ChannelID> changed = s_overlayChannels + s_dirtyChannels;
+        if (changed.isEmpty()) {
+            return true;
+        }
+
+        qint64 total = 0, edited = 0;
+        for (auto it = eventlist.begin(), end = eventlist.end(); it != end; ++it) {
+            for (const auto & el : it.value()) {
+                total += el->count();
+                if (changed.contains(it.key())) {
+                    edited += el->count();
+                }
+            }
+        }
+        if (edited * overlay_max_share <= total) {
+            if (!StoreOverlay(changed)) {
+                return false;
+            }
+            StoreRollup();
+            return true;
+        }
+    }
+
+    QByteArray databytes;
+    QDataStream out(&databytes, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_4_6);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    writeEventData(out, eventlist.keys());
+
+    if (!writeEventFile(eventFile(), filetype_data, databytes)) {
         return false;
     }
 
-    QByteArray headerbytes;
-    QDataStream header(&headerbytes, QIODevice::WriteOnly);
+    // Everything is in the events file now
+    QFile::remove(overlayFile());
+    s_overlayChannels.clear();
+    markEventsStored();
+    StoreRollup();
+    return true;
+}
+
+bool Session::CompactEvents()
+{
+    if (!QFile::exists(overlayFile())) {
+        return true;
+    }
+    bool loaded = s_events_loaded;
+    if (!OpenEvents()) {
+        return false;
+    }
+    s_storedChannels.clear(); // forces a full rewrite
+    bool ok = StoreEvents();
+    if (!loaded) {
+        TrashEvents();
+    }
+    return ok;
+}
+
+bool Session::UpgradeEvents()
+{
+    bool loaded = s_events_loaded;
+    if (!OpenEvents()) {
+        return false;
+    }
+    UpdateSummaries();
+    s_storedChannels.clear(); // forces a full rewrite
+    bool ok = Store(s_machine->getDataPath());
+    if (!loaded) {
+        TrashEvents();
+    }
+    return ok;
+}
+
+bool Session::isEventFileCurrent(const QString & filename)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return true; // nothing there to upgrade
+    }
+
+    QDataStream header(file.read(8));
     header.setVersion(QDataStream::Qt_4_6);
     header.setByteOrder(QDataStream::LittleEndian);
 
-    header << (quint32)magic;      // New Magic Number
-    header << (quint16)events_version; // File Version
-    header << (quint16)filetype_data;  // File type 1 == Event
-    header << (quint32)s_machine->id();// Machine Type
-    header << (quint32)s_session;      // This session's ID
-    header << s_first;
-    header << s_last;
-
-    quint16 compress = 0;
+    quint32 magicnum;
+    quint16 version, type;
+    header >> magicnum >> version >> type;
 
-    if (p_profile->session->compressSessionData()) {
-        compress = compress_method;
+    // Files too old to read, or not events files at all, are left for the integrity check
+    if ((header.status() != QDataStream::Ok) || (magicnum != magic) || (type != filetype_data) || (version < 6)) {
+        return true;
     }
+    return version >= events_version;
+}
 
-    header << (quint16)compress;
+quint16 Session::eventsVersion()
+{
+    return events_version;
+}
 
-    header << (quint16)s_machine->type();// Machine Type
+bool Session::StoreOverlay(const QSet<ChannelID> & changed)
+{
+    QList<ChannelID> present, removed;
+    for (ChannelID code : changed) {
+        if (eventlist.contains(code)) {
+            present.append(code);
+        } else if (s_storedChannels.contains(code) || s_overlayChannels.contains(code)) {
+            removed.append(code);
+        }
+    }
 
     QByteArray databytes;
     QDataStream out(&databytes, QIODevice::WriteOnly);
     out.setVersion(QDataStream::Qt_4_6);
     out.setByteOrder(QDataStream::LittleEndian);
 
-    out << (qint16)eventlist.size(); // Number of event categories
+    writeEventData(out, present);
 
-    QHash<ChannelID, QVector<EventList *> >::iterator i;
-    QHash<ChannelID, QVector<EventList *> >::iterator i_end=eventlist.end();
+    // Channels destroyed since the events file was written
+    out << (qint16)removed.size();
+    for (ChannelID code : removed) {
+        out << code;
+    }
+
+    if (!writeEventFile(overlayFile(), filetype_overlay, databytes)) {
+        return false;
+    }
+    s_overlayChannels = changed;
+    markEventsStored();
+    return true;
+}
+
+void Session::writeEventData(QDataStream & out, const QList<ChannelID> & codes)
+{
+    out << (qint16)codes.size(); // Number of event categories
 
     qint16 ev_size;
 
-    for (i = eventlist.begin(); i != i_end; i++) {
-        ev_size=i.value().size();
+    for (ChannelID code : codes) {
+        const QVector<EventList *> & lists = eventlist[code];
+        ev_size=lists.size();
 
-        out << i.key(); // ChannelID
+        out << code; // ChannelID
         out << (qint16)ev_size;
 
 
         for (int j = 0; j < ev_size; j++) {
-            EventList &e = *i.value()[j];
+            EventList &e = *lists[j];
             out << e.first();
             out << e.last();
             out << (qint32)e.count();
@@ -737,11 +986,12 @@ bool Session::StoreEvents()
             }
         }
     }
-    for (i = eventlist.begin(); i != i_end; i++) {
-        ev_size=i.value().size();
+    for (ChannelID code : codes) {
+        const QVector<EventList *> & lists = eventlist[code];
+        ev_size=lists.size();
 
         for (int j = 0; j < ev_size; j++) {
-            EventList &e = *i.value()[j];
+            EventList &e = *lists[j];
             // ****** This is assuming little endian ******
 
             // Store the raw event list data in EventStoreType (16bit short)
@@ -774,6 +1024,38 @@ bool Session::StoreEvents()
             }
         }
     }
+}
+
+bool Session::writeEventFile(const QString & filename, quint16 filetype, const QByteArray & databytes)
+{
+    QSaveFile file(filename);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Could not open events file" << filename << "for writing, error code" << file.error() << file.errorString();
+        return false;
+    }
+
+    QByteArray headerbytes;
+    QDataStream header(&headerbytes, QIODevice::WriteOnly);
+    header.setVersion(QDataStream::Qt_4_6);
+    header.setByteOrder(QDataStream::LittleEndian);
+
+    header << (quint32)magic;      // New Magic Number
+    header << (quint16)events_version; // File Version
+    header << (quint16)filetype;       // File type 1 == Event, 4 == Overlay
+    header << (quint32)s_machine->id();// Machine Type
+    header << (quint32)s_session;      // This session's ID
+    header << s_first;
+    header << s_last;
+
+    quint16 compress = 0;
+
+    if (p_profile->session->compressSessionData()) {
+        compress = compress_method;
+    }
+
+    header << (quint16)compress;
+
+    header << (quint16)s_machine->type();// Machine Type
 
     qint32 datasize = databytes.size();
 
@@ -781,8 +1063,8 @@ bool Session::StoreEvents()
     quint16 chk = 0;
 
     if (compress) {
-        // This checksum is hideously slow.. only using during compression, and not sure I should at all :-/
-        chk = qChecksum(databytes.data(), databytes.size());
+        // Same value as qChecksum, which was hideously slow here
+        chk = CRC16X25(databytes.constData(), databytes.size());
     }
 
     header << datasize;
@@ -798,15 +1080,90 @@ bool Session::StoreEvents()
 
     file.write(headerbytes);
     file.write(data);
-    file.close();
+    if (!file.commit()) {
+        qWarning() << "Could not commit events file" << filename << "error code" << file.error() << file.errorString();
+        return false;
+    }
     return true;
 }
 
 bool Session::LoadEvents(QString filename)
+{
+    QByteArray databytes;
+    quint16 version;
+
+    s_overlayChannels.clear();
+
+    if (!readEventFile(filename, filetype_data, databytes, version)) {
+        return false;
+    }
+
+    QDataStream in(databytes);
+    in.setVersion(QDataStream::Qt_4_6);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    readEventData(in, version);
+
+    // Merge any edits stored since the events file was written
+    if (QFile::exists(overlayFile())) {
+        LoadOverlay();
+    }
+
+    // Older versions read fine as they are, EventMigrator rewrites them in the background
+    if (version < events_version) {
+        qDebug() << "Events file" << filename << "is version" << version << "and is waiting to be upgraded";
+    }
+
+    markEventsStored();
+    return true;
+}
+
+bool Session::LoadOverlay()
+{
+    QString filename = overlayFile();
+    QByteArray databytes;
+    quint16 version;
+
+    if (!readEventFile(filename, filetype_overlay, databytes, version)) {
+        qWarning() << "Ignoring unreadable events overlay" << filename;
+        return false;
+    }
+
+    QDataStream in(databytes);
+    in.setVersion(QDataStream::Qt_4_6);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    // Read the overlay channels on their own, then keep whatever they don't replace
+    QHash<ChannelID, QVector<EventList *> > base = eventlist;
+    eventlist.clear();
+
+    readEventData(in, version);
+
+    QSet<ChannelID> removed;
+    qint16 count = 0;
+    ChannelID code;
+    in >> count;
+    for (int i = 0; i < count; ++i) {
+        in >> code;
+        removed.insert(code);
+    }
+
+    s_overlayChannels = QSet<ChannelID>::fromList(eventlist.keys()) + removed;
+
+    for (auto it = base.begin(), end = base.end(); it != end; ++it) {
+        if (s_overlayChannels.contains(it.key())) {
+            qDeleteAll(it.value());
+        } else {
+            eventlist[it.key()] = it.value();
+        }
+    }
+    return true;
+}
+
+bool Session::readEventFile(const QString & filename, quint16 filetype, QByteArray & databytes, quint16 & version)
 {
     quint32 magicnum, machid, sessid;
-    quint16 version, type, crc16, machtype, compmethod;
-    quint8 t8;
+    quint16 type, crc16, machtype, compmethod;
     qint32 datasize;
 
     if (filename.isEmpty()) {
@@ -836,7 +1193,7 @@ bool Session::LoadEvents(QString filename)
     header >> s_first;          //(qint64)
     header >> s_last;           //(qint64)
 
-    if (type != filetype_data) {
+    if (type != filetype) {
         qDebug() << "Wrong File Type in " << filename;
         return false;
     }
@@ -860,37 +1217,44 @@ bool Session::LoadEvents(QString filename)
         header >> crc16;        // CRC16 of Uncompressed Data (quint16)
     }
 
-    QByteArray databytes, temp = file.readAll();
+    QByteArray temp = file.readAll();
     file.close();
 
+    // Overlays are small, so they're always checked
+    bool check = (filetype != filetype_data) || !s_evchecksum_checked;
+
     if (version >= 10) {
         if (compmethod > 0) {
             databytes = qUncompress(temp);
 
-            if (!s_evchecksum_checked) {
+            if (check) {
                 if (databytes.size() != datasize) {
                     qDebug() << "File" << filename << "has returned wrong datasize";
                     return false;
                 }
 
-                quint16 crc = qChecksum(databytes.data(), databytes.size());
+                quint16 crc = CRC16X25(databytes.constData(), databytes.size());
 
                 if (crc != crc16) {
                     qDebug() << "CRC Doesn't match in" << filename;
                     return false;
                 }
 
-                s_evchecksum_checked = true;
+                if (filetype == filetype_data) {
+                    s_evchecksum_checked = true;
+                }
             }
         } else {
             databytes = temp;
         }
     } else { databytes = temp; }
 
-    QDataStream in(databytes);
-    in.setVersion(QDataStream::Qt_4_6);
-    in.setByteOrder(QDataStream::LittleEndian);
+    return true;
+}
 
+void Session::readEventData(QDataStream & in, quint16 version)
+{
+    quint8 t8;
     qint16 mcsize;
     in >> mcsize;   // number of Machine Code lists
 
@@ -962,6 +1326,7 @@ bool Session::LoadEvents(QString filename)
 
         for (int j = 0; j < size2; j++) {
             EventList &evec = *eventlist[code][j];
+            EventBufferPool::instance().reserve(evec.m_data, evec.m_count);
             evec.m_data.resize(evec.m_count);
             EventStoreType *ptr = evec.m_data.data();
 
@@ -975,6 +1340,7 @@ bool Session::LoadEvents(QString filename)
             //                *ptr++=t;
             //            }
             if (evec.hasSecondField()) {
+                EventBufferPool::instance().reserve(evec.m_data2, evec.m_count);
                 evec.m_data2.resize(evec.m_count);
                 ptr = evec.m_data2.data();
 
@@ -987,6 +1353,7 @@ bool Session::LoadEvents(QString filename)
             }
 
             if (evec.type() != EVL_Waveform) {
+                EventBufferPool::instance().reserve(evec.m_time, evec.m_count);
                 evec.m_time.resize(evec.m_count);
                 quint32 *tptr = evec.m_time.data();
 
@@ -999,14 +1366,6 @@ bool Session::LoadEvents(QString filename)
             }
         }
     }
-
-    if (version < events_version) {
-        qDebug() << "Upgrading Events file" << filename << "to version" << events_version;
-        UpdateSummaries();
-        StoreEvents();
-    }
-
-    return true;
 }
 
 void Session::destroyEvent(ChannelID code)
@@ -1015,11 +1374,13 @@ void Session::destroyEvent(ChannelID code)
 
     if (it != eventlist.end()) {
         for (int i = 0; i < it.value().size(); i++) {
+            it.value()[i]->recycle();
             delete it.value()[i];
         }
 
         eventlist.erase(it);
     }
+    s_dirtyChannels.insert(code);
 
     m_gain.erase(m_gain.find(code));
     m_firstchan.erase(m_firstchan.find(code));
@@ -1192,10 +1553,14 @@ void Session::UpdateSummaries()
 
 EventDataType Session::SearchValue(ChannelID code, qint64 time, bool square)
 {
-    qint64 t1, t2, start;
+    return SearchValue(code, time, square, nullptr);
+}
+
+EventDataType Session::SearchValue(ChannelID code, qint64 time, bool square, QHash<EventList *, int> * hints)
+{
+    qint64 t1, t2;
     QHash<ChannelID, QVector<EventList *> >::iterator it;
     it = eventlist.find(code);
-    quint32 *tptr;
     int cnt;
 
     EventDataType a,b,c,d,e;
@@ -1235,36 +1600,31 @@ EventDataType Session::SearchValue(ChannelID code, qint64 time, bool square)
                     return b + ((a-b) * e);
 
                 } else {
-                    start = el->first();
-                    tptr = el->rawTime();
+                    // Start from wherever the last lookup in this list ended up
+                    int j = el->indexAt(time, hints ? hints->value(el, 0) : 0);
+                    if (hints) {
+                        hints->insert(el, qMax(j, 0));
+                    }
+                    j = qMax(j, 0);
+                    if (j >= cnt - 1) {
+                        continue;
+                    }
+
                     // TODO: square plots need fixing
                     if (square) {
-                        for (int j = 0; j < cnt-1; ++j) {
-                            tptr++;
-                            t2 = start + *tptr;
-                            if (t2 > time) {
-                                return el->data(j);
-                            }
-                        }
+                        return el->data(j);
+                    }
+                    t1 = el->time(j);
+                    t2 = el->time(j + 1);
+                    c = EventDataType(t2 - t1);
+                    d = EventDataType(t2 - time);
+                    e = d/c;
+                    a = el->data(j);
+                    b = el->data(j+1);
+                    if (a == b) {
+                        return a;
                     } else {
-                        for (int j = 0; j < cnt-1; ++j) {
-                            tptr++;
-                            t2 = start + *tptr;
-                            if (t2 > time) {
-                                tptr--;
-                                t1 = start + *tptr;
-                                c = EventDataType(t2 - t1);
-                                d = EventDataType(t2 - time);
-                                e = d/c;
-                                a = el->data(j);
-                                b = el->data(j+1);
-                                if (a == b) {
-                                    return a;
-                                } else {
-                                    return b + ((a-b) * e);
-                                }
-                            }
-                        }
+                        return b + ((a-b) * e);
                     }
                 }
             }
@@ -1406,18 +1766,11 @@ EventDataType Session::physMax(ChannelID id)
 
 qint64 Session::first(ChannelID id)
 {
-    qint64 drift = qint64(p_profile->cpap->clockDrift()) * 1000L;
-    qint64 tmp;
+    qint64 drift = clockDrift();
     QHash<ChannelID, quint64>::iterator i = m_firstchan.find(id);
 
     if (i != m_firstchan.end()) {
-        tmp = i.value();
-
-        if (s_machine->type() == MT_CPAP) {
-            tmp += drift;
-        }
-
-        return tmp;
+        return qint64(i.value()) + drift;
     }
 
     QHash<ChannelID, QVector<EventList *> >::iterator j = eventlist.find(id);
@@ -1445,26 +1798,15 @@ qint64 Session::first(ChannelID id)
 
     m_firstchan[id] = min;
 
-    if (s_machine->type() == MT_CPAP) {
-        min += drift;
-    }
-
-    return min;
+    return min + drift;
 }
 qint64 Session::last(ChannelID id)
 {
-    qint64 drift = qint64(p_profile->cpap->clockDrift()) * 1000L;
-    qint64 tmp;
+    qint64 drift = clockDrift();
     QHash<ChannelID, quint64>::iterator i = m_lastchan.find(id);
 
     if (i != m_lastchan.end()) {
-        tmp = i.value();
-
-        if (s_machine->type() == MT_CPAP) {
-            tmp += drift;
-        }
-
-        return tmp;
+        return qint64(i.value()) + drift;
     }
 
     QHash<ChannelID, QVector<EventList *> >::iterator j = eventlist.find(id);
@@ -1493,11 +1835,7 @@ qint64 Session::last(ChannelID id)
 
     m_lastchan[id] = max;
 
-    if (s_machine->type() == MT_CPAP) {
-        max += drift;
-    }
-
-    return max;
+    return max + drift;
 }
 bool Session::channelDataExists(ChannelID id)
 {
@@ -2267,6 +2605,7 @@ EventList *Session::AddEventList(ChannelID code, EventListType et, EventDataType
     EventList *el = new EventList(et, gain, offset, min, max, rate, second_field);
 
     eventlist[code].push_back(el);
+    s_dirtyChannels.insert(code);
     //s_machine->registerChannel(chan);
     return el;
 }
@@ -2308,6 +2647,13 @@ void Session::offsetSession(qint64 offset)
             e->setFirst(e->first() + offset);
             e->setLast(e->last() + offset);
         }
+        s_dirtyChannels.insert(i.key());
+    }
+
+    // The day's cached bounds were worked out from the old times
+    Day * day = p_profile->findSessionDay(this);
+    if (day) {
+        day->invalidate();
     }
 
     qDebug() << "Session now starts" << QDateTime::fromTime_t(s_first /
@@ -2315,24 +2661,24 @@ void Session::offsetSession(qint64 offset)
 
 }
 
-qint64 Session::first()
+qint64 Session::clockDrift()
 {
-    qint64 start = s_first;
-
-    if (s_machine->type() == MT_CPAP) {
-        start += qint64(p_profile->cpap->clockDrift()) * 1000L;
-    }
+    // Only CPAP clocks are adjusted. Graphs and summaries call first() and last() constantly,
+    // so look the preference up again only when a drift has been loaded or changed.
+    int generation = CPAPSettings::driftGeneration();
+    if (s_drift_generation != generation) {
+        s_drift = (s_machine->type() == MT_CPAP) ? qint64(p_profile->cpap->clockDrift()) * 1000L : 0;
+        s_drift_generation = generation;
+    }
+    return s_drift;
+}
 
-    return start;
+qint64 Session::first()
+{
+    return s_first + clockDrift();
 }
 
 qint64 Session::last()
 {
-    qint64 last = s_last;
-
-    if (s_machine->type() == MT_CPAP) {
-        last += qint64(p_profile->cpap->clockDrift()) * 1000L;
-    }
-
-    return last;
+    return s_last + clockDrift();
 }
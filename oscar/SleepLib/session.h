@@ -18,6 +18,7 @@
 
 #include <QDebug>
 #include <QHash>
+#include <QSet>
 #include <QVector>
 
 #include "SleepLib/machine.h"
@@ -81,9 +82,27 @@ class Session
 //    //! \brief Save the Sessions Summary Indexes to the stream
 //    void StoreSummaryData(QDataStream & out) const;
 
-    //! \brief Writes the Sessions EventLists to filename, in SleepLibs custom data format.
+    /*! \brief Writes the Sessions EventLists to filename, in SleepLibs custom data format.
+        If the events were loaded from disk and only a few channels have been edited since,
+        just those channels are written to an overlay file that LoadEvents merges back in. */
     bool StoreEvents();
 
+    //! \brief Folds any events overlay back into the events file
+    bool CompactEvents();
+
+    //! \brief Rewrites the events file in the current format, recalculating the summary to match
+    bool UpgradeEvents();
+
+    //! \brief Returns false if filename is a readable events file from an older version of OSCAR
+    static bool isEventFileCurrent(const QString & filename);
+
+    //! \brief The events file version written by StoreEvents
+    static quint16 eventsVersion();
+
+    //! \brief Writes downsampled min/avg/max rollups of the loaded EventLists for Overview trends.
+    //! Called by StoreEvents whenever the events file or its overlay is rewritten, so they never go stale.
+    bool StoreRollup();
+
     //bool Load(QString path);
 
 //    //! \brief Loads the Sessions Summary Indexes from stream
@@ -92,21 +111,41 @@ class Session
     //! \brief Loads the Sessions Summary Indexes from filename, from SleepLibs custom data format.
     bool LoadSummary();
 
+    //! \brief Drops the cached summary and reads it from disk again, after the file was rewritten elsewhere
+    bool ReloadSummary();
+
     //! \brief Loads the Sessions EventLists from filename, from SleepLibs custom data format.
     bool LoadEvents(QString filename);
 
+    //! \brief Marks a channel whose EventLists were edited in place as needing to be stored
+    void setChannelChanged(ChannelID code);
+
     //! \brief Loads the events for this session when requested (only the summaries are loaded at startup)
     bool OpenEvents();
 
     //! \brief Put the events away until needed again, freeing memory
     void TrashEvents();
 
+    /*! \brief Takes over the EventLists another Session object read from this session's files,
+        unless this one has loaded its own events in the meantime. */
+    bool adoptEvents(Session * other);
+
+    //! \brief Estimated bytes held by the loaded EventLists
+    qint64 eventMemoryUsed();
+
+    //! \brief Estimated bytes held by the summary values, settings and value/time summaries
+    qint64 summaryMemoryUsed();
+
     //! \brief Returns true if session contains an empty duration
     inline bool isEmpty() { return (s_first == s_last); }
 
     //! \brief Search for Event code happening at supplied time (ms since epoch)
     EventDataType SearchValue(ChannelID code, qint64 time, bool square);
 
+    /*! \brief Same as above, but resumes each EventList's search from the index stored for it in hints,
+        and updates it. Used to serve a moving cursor without rescanning from the start of the night. */
+    EventDataType SearchValue(ChannelID code, qint64 time, bool square, QHash<EventList *, int> * hints);
+
     //! \brief Return the sessionID
     inline const SessionID &session() {
         return s_session;
@@ -373,6 +412,10 @@ class Session
     void SetLoneSession(bool b) { s_lonesession = b; }
 
     bool eventsLoaded() { return s_events_loaded; }
+    bool summaryLoaded() const { return s_summary_loaded; }
+
+    //! \brief Number of times this session has been stored, so background work can tell it was saved meanwhile
+    inline int storeCount() const { return s_storecount; }
 
     //! \brief Update this sessions first time if it's less than the current record
     inline void updateFirst(qint64 v) { if (!s_first) { s_first = v; } else if (s_first > v) { s_first = v; } }
@@ -428,6 +471,9 @@ class Session
 
     QString eventFile() const;
 
+    //! \brief File holding channels edited since the events file was written
+    QString overlayFile() const;
+
     //! \brief Returns MachineType for this session
     MachineType type() { return s_machtype; }
 
@@ -445,6 +491,12 @@ protected:
     qint64 s_first;
     //! \brief Time session ends (in ms since epoch)
     qint64 s_last;
+
+    //! \brief Returns the clock drift in ms applied to this session's times, cached until the drift changes
+    qint64 clockDrift();
+    qint64 s_drift;
+    int s_drift_generation;
+
     bool s_changed;
     bool s_lonesession;
     bool s_evchecksum_checked;
@@ -456,8 +508,29 @@ protected:
 
     bool s_summary_loaded;
     bool s_events_loaded;
+    int s_storecount;
     bool s_enabled;
 
+    //! \brief Writes the changed channels to the overlay file
+    bool StoreOverlay(const QSet<ChannelID> & changed);
+    void writeEventData(QDataStream & out, const QList<ChannelID> & codes);
+    bool writeEventFile(const QString & filename, quint16 filetype, const QByteArray & databytes);
+
+    //! \brief Replaces channels loaded from the events file with those in the overlay
+    bool LoadOverlay();
+    bool readEventFile(const QString & filename, quint16 filetype, QByteArray & databytes, quint16 & version);
+    void readEventData(QDataStream & in, quint16 version);
+
+    //! \brief Records the loaded channels as matching what's on disk
+    void markEventsStored();
+
+    //! \brief Channels in the events file plus overlay, as of the last load or store
+    QSet<ChannelID> s_storedChannels;
+    //! \brief Channels added, destroyed or edited since the last load or store
+    QSet<ChannelID> s_dirtyChannels;
+    //! \brief Channels whose current data is held in the overlay file
+    QSet<ChannelID> s_overlayChannels;
+
     // for debugging
     bool destroyed;
     MachineType s_machtype;
@@ -0,0 +1,94 @@
+/* SleepLib Session Day Index Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <algorithm>
+
+#include "sessionindex.h"
+#include "session.h"
+
+void SessionIndex::insert(Session * sess, QDate date)
+{
+    if (sess == nullptr) {
+        return;
+    }
+    if (m_lookup.contains(sess)) {
+        remove(sess);
+    }
+    qint64 start = sess->realFirst();
+
+    m_entries.insert(start, sess);
+    m_lookup.insert(sess, Entry(start, date));
+    if (date.isValid()) {
+        m_byDate.insert(date, sess);
+    }
+}
+
+bool SessionIndex::remove(Session * sess)
+{
+    auto lit = m_lookup.find(sess);
+    if (lit == m_lookup.end()) {
+        return false;
+    }
+    const Entry & e = lit.value();
+
+    for (auto it = m_entries.find(e.start); (it != m_entries.end()) && (it.key() == e.start); ++it) {
+        if (it.value() == sess) {
+            m_entries.erase(it);
+            break;
+        }
+    }
+    if (e.date.isValid()) {
+        m_byDate.remove(e.date, sess);
+    }
+    m_lookup.erase(lit);
+    return true;
+}
+
+void SessionIndex::setDate(Session * sess, QDate date)
+{
+    auto lit = m_lookup.find(sess);
+    if (lit == m_lookup.end()) {
+        return;
+    }
+    Entry & e = lit.value();
+    if (e.date == date) {
+        return;
+    }
+    if (e.date.isValid()) {
+        m_byDate.remove(e.date, sess);
+    }
+    e.date = date;
+    if (date.isValid()) {
+        m_byDate.insert(date, sess);
+    }
+}
+
+QDate SessionIndex::date(Session * sess) const
+{
+    auto lit = m_lookup.constFind(sess);
+    if (lit == m_lookup.constEnd()) {
+        return QDate();
+    }
+    return lit.value().date;
+}
+
+QList<Session *> SessionIndex::sessionsOn(QDate date) const
+{
+    QList<Session *> list = m_byDate.values(date);
+    std::sort(list.begin(), list.end(), [this](Session * a, Session * b) {
+        return m_lookup[a].start < m_lookup[b].start;
+    });
+    return list;
+}
+
+void SessionIndex::clear()
+{
+    m_entries.clear();
+    m_lookup.clear();
+    m_byDate.clear();
+}
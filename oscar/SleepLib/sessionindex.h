@@ -0,0 +1,77 @@
+/* SleepLib Session Day Index Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef SESSIONINDEX_H
+#define SESSIONINDEX_H
+
+#include <QMap>
+#include <QHash>
+#include <QList>
+#include <QDate>
+
+class Session;
+
+/*! \class SessionIndex
+    \brief Which Day each of a Machine's sessions was assigned to, kept in start order.
+
+    Sessions are ordered by their recorded start time, which clock drift adjustments leave
+    alone, so the index never needs rebuilding when the drift setting changes. It lets a
+    session be unlinked from the right Day, and a day's sessions be moved, without
+    searching every Day the machine has.
+    */
+class SessionIndex
+{
+  public:
+    SessionIndex() {}
+
+    //! \brief Adds (or re-adds) sess, assigned to date
+    void insert(Session * sess, QDate date = QDate());
+
+    //! \brief Removes sess from the index, returns false if it was not indexed
+    bool remove(Session * sess);
+
+    //! \brief Updates the day a previously indexed session belongs to
+    void setDate(Session * sess, QDate date);
+
+    //! \brief Returns the Day date sess was assigned to, or an invalid date if not indexed
+    QDate date(Session * sess) const;
+
+    //! \brief Returns true if sess is in this index
+    inline bool contains(Session * sess) const { return m_lookup.contains(sess); }
+
+    //! \brief Returns the sessions assigned to date, in start order
+    QList<Session *> sessionsOn(QDate date) const;
+
+    //! \brief Returns all indexed sessions in start order
+    QList<Session *> sessions() const { return m_entries.values(); }
+
+    inline int size() const { return m_lookup.size(); }
+    inline bool isEmpty() const { return m_lookup.isEmpty(); }
+
+    void clear();
+
+  protected:
+    struct Entry {
+        Entry() : start(0) {}
+        Entry(qint64 start, QDate date) : start(start), date(date) {}
+
+        qint64 start;
+        QDate date;
+    };
+
+    //! \brief Sessions sorted by recorded start time
+    QMultiMap<qint64, Session *> m_entries;
+
+    //! \brief Indexed start time and day of each session
+    QHash<Session *, Entry> m_lookup;
+
+    //! \brief Sessions grouped by the day they were assigned to
+    QMultiHash<QDate, Session *> m_byDate;
+};
+
+#endif // SESSIONINDEX_H
@@ -0,0 +1,156 @@
+/* SleepLib Session Write-Ahead Journal Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QFile>
+#include <QDataStream>
+#include <QMutexLocker>
+#include <QDebug>
+
+#include "sessionjournal.h"
+#include "session.h"
+#include "machine.h"
+#include "common.h"
+#include "crc.h"
+
+const QString SessionJournal::fileName = "Summaries.journal";
+
+const quint16 journal_version = 1;
+
+// Anything claiming to be bigger than this is a torn or corrupt length field
+const quint32 journal_max_record = 1024 * 1024;
+
+SessionJournal::Record SessionJournal::Record::fromSession(Session * sess)
+{
+    Record r;
+    r.id = sess->session();
+    r.first = sess->realFirst();
+    r.last = sess->realLast();
+    r.enabled = sess->enabled();
+    r.summaryOnly = sess->summaryOnly();
+
+    // Loaded events are more up to date than the channel list read from the summary
+    r.channels = sess->eventlist.keys();
+    if (r.channels.isEmpty()) {
+        r.channels = sess->m_availableChannels;
+    }
+    r.settings = sess->settings.keys();
+    return r;
+}
+
+Session * SessionJournal::Record::toSession(Machine * mach) const
+{
+    Session * sess = new Session(mach, id);
+    sess->really_set_first(first);
+    sess->really_set_last(last);
+    sess->setEnabled(enabled);
+    sess->setSummaryOnly(summaryOnly);
+    sess->m_availableChannels = channels;
+    sess->m_availableSettings = settings;
+    return sess;
+}
+
+void SessionJournal::setFileName(const QString & filename)
+{
+    QMutexLocker lock(&m_mutex);
+    m_filename = filename;
+}
+
+bool SessionJournal::append(Session * sess)
+{
+    Record r = Record::fromSession(sess);
+
+    QByteArray payload;
+    QDataStream out(&payload, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_0);
+    out.setByteOrder(QDataStream::LittleEndian);
+    out << (quint32)r.id << r.first << r.last << r.enabled << r.summaryOnly << r.channels << r.settings;
+
+    QMutexLocker lock(&m_mutex);
+
+    QFile file(m_filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        qWarning() << "Could not open session journal" << m_filename << "for writing, error code" << file.error() << file.errorString();
+        return false;
+    }
+
+    QDataStream rec(&file);
+    rec.setVersion(QDataStream::Qt_5_0);
+    rec.setByteOrder(QDataStream::LittleEndian);
+
+    if (file.size() == 0) {
+        rec << (quint32)magic << (quint16)journal_version << (quint16)filetype_journal;
+    }
+    rec << (quint32)payload.size();
+    rec << (quint32)CRC32MPEG2((const unsigned char *)payload.constData(), payload.size());
+    rec.writeRawData(payload.constData(), payload.size());
+
+    // Make sure the record has left our buffers before the import moves on
+    if (!file.flush() || (rec.status() != QDataStream::Ok)) {
+        qWarning() << "Could not append session" << r.id << "to journal" << m_filename;
+        return false;
+    }
+    m_pending++;
+    return true;
+}
+
+QList<SessionJournal::Record> SessionJournal::records() const
+{
+    QList<Record> list;
+    QMutexLocker lock(&m_mutex);
+
+    QFile file(m_filename);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return list;
+    }
+
+    QDataStream in(&file);
+    in.setVersion(QDataStream::Qt_5_0);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 t32, length, crc;
+    quint16 version, type;
+    in >> t32 >> version >> type;
+    if ((in.status() != QDataStream::Ok) || (t32 != magic) || (version != journal_version) || (type != filetype_journal)) {
+        qWarning() << "Unrecognised session journal" << m_filename;
+        return list;
+    }
+
+    while (!in.atEnd()) {
+        in >> length >> crc;
+        if ((in.status() != QDataStream::Ok) || (length > journal_max_record)) {
+            qWarning() << "Session journal" << m_filename << "ends with a torn record";
+            break;
+        }
+        QByteArray payload(int(length), 0);
+        if ((in.readRawData(payload.data(), int(length)) != int(length))
+                || (CRC32MPEG2((const unsigned char *)payload.constData(), payload.size()) != crc)) {
+            qWarning() << "Session journal" << m_filename << "ends with a torn record";
+            break;
+        }
+
+        QDataStream rec(payload);
+        rec.setVersion(QDataStream::Qt_5_0);
+        rec.setByteOrder(QDataStream::LittleEndian);
+
+        Record r;
+        rec >> t32 >> r.first >> r.last >> r.enabled >> r.summaryOnly >> r.channels >> r.settings;
+        r.id = t32;
+        list.append(r);
+    }
+    return list;
+}
+
+bool SessionJournal::clear()
+{
+    QMutexLocker lock(&m_mutex);
+    m_pending = 0;
+    if (!QFile::exists(m_filename)) {
+        return true;
+    }
+    return QFile::remove(m_filename);
+}
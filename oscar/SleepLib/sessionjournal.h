@@ -0,0 +1,79 @@
+/* SleepLib Session Write-Ahead Journal Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QMutex>
+
+#include "SleepLib/machine_common.h"
+
+class Session;
+class Machine;
+
+/*! \class SessionJournal
+    \brief Append-only log of stored sessions not yet committed to a Machine's Summaries.xml.gz
+
+    Rewriting the summary index after every session would make imports quadratic, so each
+    stored session is appended here instead, and the index is committed in one batch by
+    Machine::SaveSummaryCache, which then clears the journal. If OSCAR stops before the commit,
+    Machine::LoadSummary replays the journal on top of the old index, rather than the sessions
+    going missing or the whole summary folder being rescanned.
+
+    Each record carries the same fields as a Summaries.xml entry, prefixed by its length and a
+    CRC, so a record torn by a crash is detected and it and anything after it are ignored.
+    */
+class SessionJournal
+{
+  public:
+    struct Record {
+        Record() : id(0), first(0), last(0), enabled(true), summaryOnly(false) {}
+
+        //! \brief Copies the index fields of sess
+        static Record fromSession(Session * sess);
+
+        //! \brief Creates an unloaded Session for this record, the way Machine::LoadSummary does
+        Session * toSession(Machine * mach) const;
+
+        SessionID id;
+        qint64 first;
+        qint64 last;
+        bool enabled;
+        bool summaryOnly;
+        QList<ChannelID> channels;
+        QList<ChannelID> settings;
+    };
+
+    SessionJournal() : m_pending(0) {}
+
+    //! \brief Sets the file the journal lives in, the Machine updates it as its data path can change
+    void setFileName(const QString & filename);
+
+    //! \brief Appends sess and flushes it to disk. Safe to call from import threads.
+    bool append(Session * sess);
+
+    //! \brief Returns every intact record, in the order written
+    QList<Record> records() const;
+
+    //! \brief Number of records appended since the journal was last cleared by this process
+    int pending() const { return m_pending; }
+
+    //! \brief Discards the journal, once its records are safely in the summary index
+    bool clear();
+
+    static const QString fileName;
+
+  protected:
+    QString m_filename;
+    mutable QMutex m_mutex;
+    int m_pending;
+};
+
+#endif // SESSIONJOURNAL_H
@@ -56,6 +56,12 @@ QString htmlLeftMachineSettings;
 QString htmlLeftSessionInfo;
 QString htmlLeftFooter;
 
+// How long the user has to stay on a day before the slower sidebar sections are built
+const int sidebar_build_delay = 100;
+
+// Room for the sidebars of a few hundred days, pie charts included
+const int sidebar_cache_size = 8 * 1024 * 1024;
+
 extern ChannelID PRS1_PeakFlow;
 
 // This was Sean Stangl's idea.. but I couldn't apply that patch.
@@ -123,6 +129,9 @@ Daily::Daily(QWidget *parent,gGraphView * shared)
     qDebug() << "Creating new Daily object";
     ui->setupUi(this);
 
+    sidebarCache.setMaxCost(sidebar_cache_size);
+    MemoryAccounting::instance().add(this);
+
     ui->JournalNotesBold->setShortcut(QKeySequence::Bold);
     ui->JournalNotesItalic->setShortcut(QKeySequence::Italic);
     ui->JournalNotesUnderline->setShortcut(QKeySequence::Underline);
@@ -135,6 +144,13 @@ Daily::Daily(QWidget *parent,gGraphView * shared)
 
     lastcpapday=nullptr;
 
+    sidebarTimer = new QTimer(this);
+    sidebarTimer->setSingleShot(true);
+    connect(sidebarTimer, SIGNAL(timeout()), this, SLOT(buildSidebar()));
+    connect(&p_profile->calendar, SIGNAL(monthUpdated(int,int)), this, SLOT(calendarMonthUpdated(int,int)));
+    sidebarPieValues = 0;
+    sidebarShowPie = sidebarShowStatistics = false;
+
     setSidebarVisible(true);
 
     layout=new QHBoxLayout();
@@ -518,6 +534,8 @@ Daily::Daily(QWidget *parent,gGraphView * shared)
 
 Daily::~Daily()
 {
+    MemoryAccounting::instance().remove(this);
+
     disconnect(GraphView, SIGNAL(updateCurrentTime(double)), this, SLOT(on_LineCursorUpdate(double)));
     disconnect(GraphView, SIGNAL(updateRange(double,double)), this, SLOT(on_RangeUpdate(double,double)));
     disconnect(GraphView, SIGNAL(GraphsChanged()), this, SLOT(updateGraphCombo()));
@@ -551,6 +569,7 @@ void Daily::doToggleSession(Session * sess)
 {
     sess->setEnabled(!sess->enabled());
 
+    UpdateCalendarDay(previous_date);
     LoadDate(previous_date);
     mainwin->getOverview()->graphView()->dataChanged();
 }
@@ -572,6 +591,7 @@ void Daily::Link_clicked(const QUrl &url)
         sess->setEnabled(!sess->enabled());
 
         // Reload day
+        UpdateCalendarDay(previous_date);
         LoadDate(previous_date);
   //      webView->page()->mainFrame()->setScrollBarValue(Qt::Vertical, webView->page()->mainFrame()->scrollBarMaximum(Qt::Vertical)-i);
     } else  if (code=="toggleoxisession") { // Enable/Disable Oximetry session
@@ -584,6 +604,7 @@ void Daily::Link_clicked(const QUrl &url)
         sess->setEnabled(!sess->enabled());
 
         // Reload day
+        UpdateCalendarDay(previous_date);
         LoadDate(previous_date);
   //      webView->page()->mainFrame()->setScrollBarValue(Qt::Vertical, webView->page()->mainFrame()->scrollBarMaximum(Qt::Vertical)-i);
     } else  if (code=="togglestagesession") { // Enable/Disable Sleep Stage session
@@ -592,6 +613,7 @@ void Daily::Link_clicked(const QUrl &url)
         Session *sess=day->find(sid, MT_SLEEPSTAGE);
         if (!sess) return;
         sess->setEnabled(!sess->enabled());
+        UpdateCalendarDay(previous_date);
         LoadDate(previous_date);
     } else  if (code=="togglepositionsession") { // Enable/Disable Position session
         day=p_profile->GetDay(previous_date,MT_POSITION);
@@ -599,6 +621,7 @@ void Daily::Link_clicked(const QUrl &url)
         Session *sess=day->find(sid, MT_POSITION);
         if (!sess) return;
         sess->setEnabled(!sess->enabled());
+        UpdateCalendarDay(previous_date);
         LoadDate(previous_date);
     } else if (code=="cpap")  {
         day=p_profile->GetDay(previous_date,MT_CPAP);
@@ -639,6 +662,8 @@ void Daily::ReloadGraphs()
 {
 //    qDebug() << "Start ReloadGraphs  Daily object";
 //    sleep(3);
+    // Data or preferences may have changed underneath every cached day
+    invalidateSidebar();
     GraphView->setDay(nullptr);
 
     ui->splitter->setVisible(true);
@@ -692,14 +717,86 @@ void Daily::showSpaceHogs()
     }
 }
 
+// Builds the text format for a calendar cell from its cached metadata
+static QTextCharFormat calendarDayFormat(const CalendarDay & cd)
+{
+    static QTextCharFormat nodata, cpaponly, cpapjour, oxiday, oxicpap, jourday, stageday;
+    static bool initialized = false;
+
+    if (!initialized) {
+        cpaponly.setForeground(QBrush(COLOR_Blue, Qt::SolidPattern));
+        cpaponly.setFontWeight(QFont::Normal);
+        cpapjour.setForeground(QBrush(COLOR_Blue, Qt::SolidPattern));
+        cpapjour.setFontWeight(QFont::Bold);
+//        cpapjour.setFontUnderline(true);
+        oxiday.setForeground(QBrush(COLOR_Red, Qt::SolidPattern));
+        oxiday.setFontWeight(QFont::Normal);
+        oxicpap.setForeground(QBrush(COLOR_Red, Qt::SolidPattern));
+        oxicpap.setFontWeight(QFont::Bold);
+        stageday.setForeground(QBrush(COLOR_Magenta, Qt::SolidPattern));
+        stageday.setFontWeight(QFont::Bold);
+        jourday.setForeground(QBrush(COLOR_DarkYellow, Qt::SolidPattern));
+        jourday.setFontWeight(QFont::Bold);
+        nodata.setForeground(QBrush(COLOR_Black, Qt::SolidPattern));
+        nodata.setFontWeight(QFont::Normal);
+        initialized = true;
+    }
+
+    bool hascpap = cd.has(CF_CPAP);
+    bool hasoxi = cd.has(CF_Oximeter);
+    bool hasjournal = cd.has(CF_Journal);
+    bool hasstage = cd.has(CF_SleepStage);
+    bool haspos = cd.has(CF_Position);
+
+    QTextCharFormat format;
+    if (hascpap) {
+        if (hasoxi) {
+            format = oxicpap;
+        } else if (hasjournal) {
+            format = cpapjour;
+        } else if (hasstage || haspos) {
+            format = stageday;
+        } else {
+            format = cpaponly;
+        }
+        if (cd.hours > 0) {
+            QString tip = QObject::tr("AHI %1, %2 hours").arg(cd.ahi, 0, 'f', 2).arg(cd.hours, 0, 'f', 2);
+            if (!cd.has(CF_Compliant)) {
+                tip += "\n" + QObject::tr("Below compliance hours");
+            }
+            format.setToolTip(tip);
+        }
+    } else if (hasoxi) {
+        format = oxiday;
+    } else if (hasjournal) {
+        format = jourday;
+    } else if (hasstage) {
+        format = oxiday;
+    } else if (haspos) {
+        format = oxiday;
+    } else {
+        format = nodata;
+    }
+    return format;
+}
+
 void Daily::on_calendar_currentPageChanged(int year, int month)
 {
-    QDate d(year,month,1);
-    int dom=d.daysInMonth();
+    const QVector<CalendarDay> & days = p_profile->calendar.month(year, month);
+
+    // Apply the whole month in one go rather than repainting after every cell
+    ui->calendar->setUpdatesEnabled(false);
+    for (int i=0; i < days.size(); i++) {
+        ui->calendar->setDateTextFormat(QDate(year,month,i+1), calendarDayFormat(days.at(i)));
+    }
+    ui->calendar->setHorizontalHeaderFormat(QCalendarWidget::ShortDayNames);
+    ui->calendar->setUpdatesEnabled(true);
+}
 
-    for (int i=1;i<=dom;i++) {
-        d=QDate(year,month,i);
-        this->UpdateCalendarDay(d);
+void Daily::calendarMonthUpdated(int year, int month)
+{
+    if ((ui->calendar->yearShown() == year) && (ui->calendar->monthShown() == month)) {
+        on_calendar_currentPageChanged(year, month);
     }
 }
 
@@ -815,59 +912,11 @@ void Daily::UpdateEventsTree(QTreeWidget *tree,Day *day)
 
 void Daily::UpdateCalendarDay(QDate date)
 {
-    QTextCharFormat nodata;
-    QTextCharFormat cpaponly;
-    QTextCharFormat cpapjour;
-    QTextCharFormat oxiday;
-    QTextCharFormat oxicpap;
-    QTextCharFormat jourday;
-    QTextCharFormat stageday;
-
-    cpaponly.setForeground(QBrush(COLOR_Blue, Qt::SolidPattern));
-    cpaponly.setFontWeight(QFont::Normal);
-    cpapjour.setForeground(QBrush(COLOR_Blue, Qt::SolidPattern));
-    cpapjour.setFontWeight(QFont::Bold);
-//    cpapjour.setFontUnderline(true);
-    oxiday.setForeground(QBrush(COLOR_Red, Qt::SolidPattern));
-    oxiday.setFontWeight(QFont::Normal);
-    oxicpap.setForeground(QBrush(COLOR_Red, Qt::SolidPattern));
-    oxicpap.setFontWeight(QFont::Bold);
-    stageday.setForeground(QBrush(COLOR_Magenta, Qt::SolidPattern));
-    stageday.setFontWeight(QFont::Bold);
-    jourday.setForeground(QBrush(COLOR_DarkYellow, Qt::SolidPattern));
-    jourday.setFontWeight(QFont::Bold);
-    nodata.setForeground(QBrush(COLOR_Black, Qt::SolidPattern));
-    nodata.setFontWeight(QFont::Normal);
-
-    bool hascpap = p_profile->FindDay(date, MT_CPAP)!=nullptr;
-    bool hasoxi = p_profile->FindDay(date, MT_OXIMETER)!=nullptr;
-    bool hasjournal = p_profile->FindDay(date, MT_JOURNAL)!=nullptr;
-    bool hasstage = p_profile->FindDay(date, MT_SLEEPSTAGE)!=nullptr;
-    bool haspos = p_profile->FindDay(date, MT_POSITION)!=nullptr;
-    if (hascpap) {
-        if (hasoxi) {
-            ui->calendar->setDateTextFormat(date, oxicpap);
-        } else if (hasjournal) {
-            ui->calendar->setDateTextFormat(date, cpapjour);
-        } else if (hasstage || haspos) {
-            ui->calendar->setDateTextFormat(date, stageday);
-        } else {
-            ui->calendar->setDateTextFormat(date, cpaponly);
-        }
-    } else if (hasoxi) {
-        ui->calendar->setDateTextFormat(date, oxiday);
-    } else if (hasjournal) {
-        ui->calendar->setDateTextFormat(date, jourday);
-    } else if (hasstage) {
-        ui->calendar->setDateTextFormat(date, oxiday);
-    } else if (haspos) {
-        ui->calendar->setDateTextFormat(date, oxiday);
-    } else {
-        ui->calendar->setDateTextFormat(date, nodata);
-    }
-//    if (hasjournal) {
-//        ui->calendar->setDateTextFormat(date, cpapjour);
-//    }
+    // Something about this date changed, so recompute its cached entry
+    p_profile->calendar.invalidate(date);
+    invalidateSidebar(date);
+
+    ui->calendar->setDateTextFormat(date, calendarDayFormat(p_profile->calendar.day(date)));
     ui->calendar->setHorizontalHeaderFormat(QCalendarWidget::ShortDayNames);
 }
 void Daily::LoadDate(QDate date)
@@ -1515,6 +1564,58 @@ QString Daily::getPieChart (float values, Day * day) {
     return html;
 }
 
+void Daily::invalidateSidebar(QDate date)
+{
+    if (date.isValid()) {
+        sidebarCache.remove(date);
+    } else {
+        sidebarCache.clear();
+    }
+}
+
+void Daily::reportMemory(MemoryReport & report)
+{
+    // The cache's cost is the bytes held, and walking it would reorder it
+    report.add(tr("Daily sidebar"), sidebarCache.totalCost(), sidebarCache.count());
+}
+
+void Daily::showSidebarSections(const SidebarSections & sections)
+{
+    // Otherwise Load has already filled these in with whatever explains their absence
+    if (sidebarShowPie) {
+        htmlLeftPieChart = sections.pieChart;
+    }
+    if (sidebarShowStatistics) {
+        htmlLeftStatistics = sections.statistics;
+    }
+    htmlLeftOximeter = sections.oximeter;
+    htmlLeftMachineSettings = sections.machineSettings;
+    htmlLeftSessionInfo = sections.sessionInfo;
+}
+
+void Daily::buildSidebar()
+{
+    Day * day = p_profile ? p_profile->GetDay(previous_date) : nullptr;
+    if (!day) {
+        return;
+    }
+
+    SidebarSections sections;
+    if (sidebarShowPie) {
+        sections.pieChart = getPieChart(sidebarPieValues, day);
+    }
+    if (sidebarShowStatistics) {
+        sections.statistics = getStatisticsInfo(day);
+    }
+    sections.oximeter = getOximeterInformation(day);
+    sections.machineSettings = getMachineSettings(day);
+    sections.sessionInfo = getSessionInformation(day);
+
+    sidebarCache.insert(previous_date, new SidebarSections(sections), sections.cost());
+    showSidebarSections(sections);
+    webView->setHtml(getLeftSidebar(true));
+}
+
 // honorPieChart true - show pie chart if it is enabled.  False, do not show pie chart
 QString Daily::getLeftSidebar (bool honorPieChart) {
     QString html =   htmlLeftHeader
@@ -1601,6 +1702,9 @@ void Daily::Load(QDate date)
     htmlLeftMachineSettings.clear();
     htmlLeftSessionInfo.clear();
 
+    sidebarTimer->stop();
+    sidebarShowPie = sidebarShowStatistics = false;
+
     htmlLeftHeader = "<html><head>"
     "</head>"
     "<body leftmargin=0 rightmargin=0 topmargin=0 marginwidth=0 marginheight=0>";
@@ -1741,9 +1845,10 @@ void Daily::Load(QDate date)
 
             htmlLeftIndices+="</table><hr/>";
 
-            htmlLeftPieChart = getPieChart((values[CPAP_Obstructive] + values[CPAP_Hypopnea] +
-                                            values[CPAP_ClearAirway] + values[CPAP_Apnea] + values[CPAP_RERA] +
-                                            values[CPAP_FlowLimit] + values[CPAP_SensAwake]), day);
+            sidebarPieValues = values[CPAP_Obstructive] + values[CPAP_Hypopnea] +
+                               values[CPAP_ClearAirway] + values[CPAP_Apnea] + values[CPAP_RERA] +
+                               values[CPAP_FlowLimit] + values[CPAP_SensAwake];
+            sidebarShowPie = true;
 
         } else {  // No hours
             htmlLeftNoHours+="<table cellspacing=0 cellpadding=0 border=0 width='100%'>\n";
@@ -1772,7 +1877,7 @@ void Daily::Load(QDate date)
 
     if ((cpap && !isBrick && (day->hours()>0)) || oxi || posit) {
 
-        htmlLeftStatistics = getStatisticsInfo(day);
+        sidebarShowStatistics = true;
 
     } else {
         if (cpap && day->hours(MT_CPAP)<0.0000001) {
@@ -1788,10 +1893,20 @@ void Daily::Load(QDate date)
         }
 
     }
+    // The pie chart, statistics, settings and session lists are the slow parts of the sidebar,
+    // so they wait until the user stops on a day rather than holding up every step through days
     if (day) {
-        htmlLeftOximeter = getOximeterInformation(day);
-        htmlLeftMachineSettings = getMachineSettings(day);
-        htmlLeftSessionInfo= getSessionInformation(day);
+        SidebarSections * cached = sidebarCache.object(date);
+        if (cached) {
+            showSidebarSections(*cached);
+        } else {
+            if (sidebarShowStatistics) {
+                htmlLeftStatistics = "<table cellspacing=0 cellpadding=0 border=0 width='100%'>\n";
+                htmlLeftStatistics += QString("<tr><td align=center><i>%1</i></td></tr>\n").arg(tr("Calculating statistics..."));
+                htmlLeftStatistics += "</table>\n";
+            }
+            sidebarTimer->start(sidebar_build_delay);
+        }
     }
 
     htmlLeftFooter ="</body></html>";
@@ -1966,6 +2081,7 @@ void Daily::UnitsChanged()
 void Daily::clearLastDay()
 {
     lastcpapday=nullptr;
+    invalidateSidebar();
 }
 
 
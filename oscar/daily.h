@@ -21,8 +21,11 @@
 #include <QScrollBar>
 #include <QTableWidgetItem>
 #include <QTextBrowser>
+#include <QTimer>
+#include <QCache>
 
 #include "SleepLib/profiles.h"
+#include "SleepLib/memoryaccounting.h"
 #include "mainwindow.h"
 #include "Graphs/gSummaryChart.h"
 #include "Graphs/gGraphView.h"
@@ -40,7 +43,7 @@ class MainWindow;
 /*! \class Daily
     \brief OSCAR's Daily view which displays the calendar and all the graphs relative to a selected Day
     */
-class Daily : public QWidget
+class Daily : public QWidget, public MemoryReporter
 {
     Q_OBJECT
 
@@ -57,6 +60,9 @@ public:
     explicit Daily(QWidget *parent, gGraphView *shared);
     ~Daily();
 
+    //! \brief Reports the cached sidebar sections
+    virtual void reportMemory(MemoryReport & report);
+
     /*! \fn ReloadGraphs()
         \brief Reload all graph information from disk and updates the view.
         */
@@ -77,6 +83,11 @@ public:
         */
     void updateLeftSidebar();
 
+    /*! \fn invalidateSidebar(QDate date)
+        \brief Drops the cached left sidebar sections for date, or for every day if date is invalid
+        */
+    void invalidateSidebar(QDate date = QDate());
+
     /*! \fn graphView()
         \returns the main graphView area for the Daily View
         */
@@ -145,6 +156,11 @@ public slots:
 private slots:
     void on_ReloadDay();
 
+    /*! \fn buildSidebar()
+        \brief Fills in the slower left sidebar sections for the current day, once the user stops on it
+        */
+    void buildSidebar();
+
     /*! \fn on_calendar_currentPageChanged(int year, int month);
         \brief Scans through all days for this month, updating the day colors for the calendar object
         \param int year
@@ -152,6 +168,9 @@ private slots:
         */
     void on_calendar_currentPageChanged(int year, int month);
 
+    //! \brief Recolours the calendar if the month it's showing got its CPAP details worked out
+    void calendarMonthUpdated(int year, int month);
+
     /*! \fn on_calendar_selectionChanged();
         \brief Called when the calendar object is clicked. Selects and loads a new date, unloading the previous one.
         */
@@ -321,6 +340,29 @@ private:
     QString getSleepTime(Day *);
     QString getLeftSidebar (bool honorPieChart);
 
+    //! \brief The slower left sidebar sections of a day, kept until something about the day changes
+    struct SidebarSections {
+        QString pieChart;
+        QString statistics;
+        QString oximeter;
+        QString machineSettings;
+        QString sessionInfo;
+
+        //! \brief Bytes held by the html, which the inlined pie chart images make up most of
+        int cost() const {
+            return (pieChart.size() + statistics.size() + oximeter.size() + machineSettings.size()
+                    + sessionInfo.size()) * int(sizeof(QChar));
+        }
+    };
+    void showSidebarSections(const SidebarSections & sections);
+
+    //! \brief The most recently built days, dropped least recently used first once past sidebar_cache_size
+    QCache<QDate, SidebarSections> sidebarCache;
+    QTimer * sidebarTimer;
+    float sidebarPieValues;
+    bool sidebarShowPie;
+    bool sidebarShowStatistics;
+
     QHash<QString, gGraph *> graphlist;
 
     QHash<QString,QPushButton *> GraphToggles;
@@ -54,11 +54,19 @@
 #include "aboutdialog.h"
 #include "newprofile.h"
 #include "exportcsv.h"
+#include "querydialog.h"
+#include "memorydialog.h"
 #include "SleepLib/schema.h"
 #include "Graphs/glcommon.h"
 #include "checkupdates.h"
 #include "SleepLib/calcs.h"
 #include "SleepLib/progressdialog.h"
+#include "SleepLib/integrity.h"
+#include "SleepLib/prewarm.h"
+#include "SleepLib/eventpool.h"
+#include "SleepLib/rollup.h"
+#include "SleepLib/migration.h"
+#include "SleepLib/importcoordinator.h"
 
 #include "reports.h"
 #include "statistics.h"
@@ -147,6 +155,8 @@ void MainWindow::SetupGUI()
 
     overview = nullptr;
     daily = nullptr;
+    prewarmer = nullptr;
+    migrator = nullptr;
     prefdialog = nullptr;
     profileSelector = nullptr;
     welcome = nullptr;
@@ -606,6 +616,16 @@ bool MainWindow::OpenProfile(QString profileName, bool skippassword)
     delete progress;
     qDebug() << "Finished opening Profile";
 
+    EventBufferPool::instance().setBudget(qint64(AppSetting->eventPoolMemory()) * 1048576L);
+
+    // Read the latest nights while the user is still looking at the Welcome page
+    prewarmer = new NightPrewarmer(this);
+    prewarmer->start(AppSetting->prewarmNights(), qint64(AppSetting->prewarmMemory()) * 1048576L);
+
+    // Bring any events files from older versions up to date without holding up Daily
+    migrator = new EventMigrator(this);
+    migrator->start();
+
     if (updateChecker != nullptr)
         updateChecker->showMessage();
 
@@ -617,6 +637,15 @@ void MainWindow::CloseProfile()
     if (updateChecker != nullptr)
         updateChecker->showMessage();
 
+    if (prewarmer) {
+        delete prewarmer;
+        prewarmer = nullptr;
+    }
+    if (migrator) {
+        delete migrator;
+        migrator = nullptr;
+    }
+
     if (daily) {
         daily->Unload();
         daily->clearLastDay(); // otherwise Daily will crash
@@ -631,6 +660,8 @@ void MainWindow::CloseProfile()
         delete overview;
         overview = nullptr;
     }
+    // Rollup tasks hold on to the machines being unloaded
+    RollupLoader::instance().clear();
 
     if (p_profile) {
         p_profile->StoreMachines();
@@ -640,6 +671,7 @@ void MainWindow::CloseProfile()
         p_profile->removeLock();
         p_profile = nullptr;
     }
+    EventBufferPool::instance().clear();
 }
 
 
@@ -697,15 +729,27 @@ void MainWindow::Startup()
 
 int MainWindow::importCPAP(ImportPath import, const QString &message)
 {
-    if (!import.loader) {
-        return 0;
+    QList<ImportResult> results = importCPAP(QList<ImportPath>() << import, message);
+    return results.isEmpty() ? 0 : results.first().sessions;
+}
+
+QList<ImportResult> MainWindow::importCPAP(const QList<ImportPath> & imports, const QString &message)
+{
+    QList<ImportPath> sources;
+    for (const auto & import : imports) {
+        if (import.loader) {
+            sources.append(import);
+        }
+    }
+    if (sources.isEmpty()) {
+        return QList<ImportResult>();
     }
 
     ui->tabWidget->setCurrentWidget(welcome);
     QApplication::processEvents();
     ProgressDialog * progdlg = new ProgressDialog(this);
 
-    QPixmap image = import.loader->getPixmap(import.loader->PeekInfo(import.path).series);
+    QPixmap image = sources.first().loader->getPixmap(sources.first().loader->PeekInfo(sources.first().path).series);
     image = image.scaled(64,64);
     progdlg->setPixmap(image);
 
@@ -715,25 +759,43 @@ int MainWindow::importCPAP(ImportPath import, const QString &message)
     progdlg->open();
     progdlg->setMessage(message);
 
+    // Every source goes through one coordinator, so they share this dialog and run side by side where they can
+    ImportCoordinator coordinator;
+    progdlg->track(&coordinator.progress());
+    connect(progdlg, SIGNAL(abortClicked()), &coordinator, SLOT(abort()));
 
-    connect(import.loader, SIGNAL(updateMessage(QString)), progdlg, SLOT(setMessage(QString)));
-    connect(import.loader, SIGNAL(setProgressMax(int)), progdlg, SLOT(setProgressMax(int)));
-    connect(import.loader, SIGNAL(setProgressValue(int)), progdlg, SLOT(setProgressValue(int)));
-    connect(progdlg, SIGNAL(abortClicked()), import.loader, SLOT(abortImport()));
+    // Both work through the sessions the import is adding to, so they wait until it is done
+    if (prewarmer) {
+        prewarmer->cancel();
+    }
+    if (migrator) {
+        migrator->cancel();
+    }
 
-    int c = import.loader->Open(import.path);
+    QList<ImportResult> results = coordinator.run(sources);
+    progdlg->track(nullptr);
 
-    if (c > 0) {
-        Notify(tr("Imported %1 CPAP session(s) from\n\n%2").arg(c).arg(import.path), tr("Import Success"));
-    } else if (c == 0) {
-        Notify(tr("Already up to date with CPAP data at\n\n%1").arg(import.path), tr("Up to date"));
-    } else {
-        Notify(tr("Couldn't find any valid Machine Data at\n\n%1").arg(import.path),tr("Import Problem"));
+    if (prewarmer) {
+        prewarmer->start(AppSetting->prewarmNights(), qint64(AppSetting->prewarmMemory()) * 1048576L);
+    }
+    if (migrator) {
+        migrator->start();
     }
-    disconnect(progdlg, SIGNAL(abortClicked()), import.loader, SLOT(abortImport()));
-    disconnect(import.loader, SIGNAL(setProgressMax(int)), progdlg, SLOT(setProgressMax(int)));
-    disconnect(import.loader, SIGNAL(setProgressValue(int)), progdlg, SLOT(setProgressValue(int)));
-    disconnect(import.loader, SIGNAL(updateMessage(QString)), progdlg, SLOT(setMessage(QString)));
+
+    QStringList imported, uptodate, problems;
+    for (const auto & result : results) {
+        if (result.sessions > 0) {
+            imported.append(tr("Imported %1 CPAP session(s) from\n\n%2").arg(result.sessions).arg(result.path));
+        } else if (result.sessions == 0) {
+            uptodate.append(tr("Already up to date with CPAP data at\n\n%1").arg(result.path));
+        } else {
+            problems.append(tr("Couldn't find any valid Machine Data at\n\n%1").arg(result.path));
+        }
+    }
+    QString title = !imported.isEmpty() ? tr("Import Success") : (!problems.isEmpty() ? tr("Import Problem") : tr("Up to date"));
+    Notify((imported + uptodate + problems).join("\n\n"), title);
+
+    disconnect(progdlg, SIGNAL(abortClicked()), &coordinator, SLOT(abort()));
 
     progdlg->close();
 
@@ -743,7 +805,7 @@ int MainWindow::importCPAP(ImportPath import, const QString &message)
         ui->tabWidget->setCurrentIndex(AppSetting->openTabAfterImport());
     }
 
-    return c;
+    return results;
 }
 
 void MainWindow::finishCPAPImport()
@@ -762,7 +824,7 @@ void MainWindow::finishCPAPImport()
     profileSelector->updateProfileList();
 
     if (welcome)
-        welcome->refreshPage();
+        welcome->refreshPage(true);
 
     if (overview) { overview->ReloadGraphs(); }
     if (daily) {
@@ -786,8 +848,10 @@ void MainWindow::importCPAPBackups()
 
     if (paths.size() > 0) {
         int c=0;
-        Q_FOREACH(ImportPath path, paths) {
-            c+=importCPAP(path, tr("Please wait, importing from backup folder(s)..."));
+        for (const auto & result : importCPAP(paths, tr("Please wait, importing from backup folder(s)..."))) {
+            if (result.sessions > 0) {
+                c += result.sessions;
+            }
         }
         if (c>0) {
             finishCPAPImport();
@@ -1131,24 +1195,15 @@ void MainWindow::importCPAPDataCards(const QList<ImportPath> & datacards)
 {
     bool newdata = false;
 
-    int c = -1;
-    for (int i = 0; i < datacards.size(); i++) {
-        QString dir = datacards[i].path;
-        MachineLoader * loader = datacards[i].loader;
-        if (!loader) continue;
-
-        if (!dir.isEmpty()) {
-            c = importCPAP(datacards[i], tr("Importing Data"));
-            qDebug() << "Finished Importing data" << c;
-
-            if (c >= 0) {
-                QDir d(dir.section("/",0,-1));
-                (*p_profile)[STR_PREF_LastCPAPPath] = d.absolutePath();
-            }
+    const QList<ImportResult> results = importCPAP(datacards, tr("Importing Data"));
+    for (const auto & result : results) {
+        if (result.sessions >= 0) {
+            QDir d(result.path.section("/",0,-1));
+            (*p_profile)[STR_PREF_LastCPAPPath] = d.absolutePath();
+        }
 
-            if (c > 0) {
-                newdata = true;
-            }
+        if (result.sessions > 0) {
+            newdata = true;
         }
     }
 
@@ -1381,7 +1436,7 @@ void MainWindow::on_oximetryButton_clicked()
         oxiimp.exec();
         PopulatePurgeMenu();
         if (overview) overview->ReloadGraphs();
-        if (welcome) welcome->refreshPage();
+        if (welcome) welcome->refreshPage(true);
     }
 }
 
@@ -1857,7 +1912,7 @@ void MainWindow::on_actionPurge_Current_Day_triggered()
     if (overview)
         overview->ReloadGraphs();
     if (welcome)
-        welcome->refreshPage();
+        welcome->refreshPage(true);
     GenerateStatistics();
 }
 
@@ -1927,7 +1982,7 @@ void MainWindow::on_actionRebuildCPAP(QAction *action)
         daily->ReloadGraphs();
     }
     if (welcome)
-        welcome->refreshPage();
+        welcome->refreshPage(true);
     PopulatePurgeMenu();
     GenerateStatistics();
     p_profile->StoreMachines();
@@ -1986,6 +2041,7 @@ void MainWindow::purgeMachine(Machine * mach)
 {
     // detect backups
     daily->Unload(daily->getDate());
+    RollupLoader::instance().clear();
 
     // Technicially the above won't sessions under short session limit.. Using Purge to clean up the rest.
     if (mach->Purge(3478216)) {
@@ -2040,7 +2096,7 @@ void MainWindow::purgeMachine(Machine * mach)
             daily->ReloadGraphs();
         }
         if (welcome) 
-            welcome->refreshPage();
+            welcome->refreshPage(true);
 
         //GenerateStatistics();
         return;
@@ -2057,7 +2113,7 @@ void MainWindow::purgeMachine(Machine * mach)
         daily->ReloadGraphs();
     }
     if (welcome)
-        welcome->refreshPage();
+        welcome->refreshPage(true);
 
     QApplication::processEvents();
 }
@@ -2240,6 +2296,8 @@ void MainWindow::doReprocessEvents()
         }
     }
     progress.close();
+    p_profile->calendar.clear();
+    QFile::remove(LatestNights::fileName());
 
     welcome = new Welcome(ui->tabWidget);
     ui->tabWidget->insertTab(1, welcome, tr("Welcome"));
@@ -2279,7 +2337,7 @@ void MainWindow::on_actionImport_ZEO_Data_triggered()
             qDebug() << "Imported" << c << "ZEO sessions";
             PopulatePurgeMenu();
             if (overview) overview->ReloadGraphs();
-            if (welcome) welcome->refreshPage();
+            if (welcome) welcome->refreshPage(true);
         } else if (c == 0) {
             Notify(tr("Already up to date with ZEO data at\n\n%1").arg(filename), tr("Up to date"));
         } else {
@@ -2310,7 +2368,7 @@ void MainWindow::on_actionImport_Dreem_Data_triggered()
             qDebug() << "Imported" << c << "Dreem sessions";
             PopulatePurgeMenu();
             if (overview) overview->ReloadGraphs();
-            if (welcome) welcome->refreshPage();
+            if (welcome) welcome->refreshPage(true);
         } else if (c == 0) {
             Notify(tr("Already up to date with Dreem data at\n\n%1").arg(filename), tr("Up to date"));
         } else {
@@ -2436,7 +2494,7 @@ void MainWindow::on_actionImport_Somnopose_Data_triggered()
         }
         PopulatePurgeMenu();
         if (overview) overview->ReloadGraphs();
-        if (welcome) welcome->refreshPage();
+        if (welcome) welcome->refreshPage(true);
         daily->LoadDate(daily->getDate());
     }
 
@@ -2471,7 +2529,7 @@ void MainWindow::on_actionImport_Viatom_Data_triggered()
             Notify(tr("Imported %1 oximetry session(s) from\n\n%2").arg(c).arg(filename), tr("Import Success"));
             PopulatePurgeMenu();
             if (overview) overview->ReloadGraphs();
-            if (welcome) welcome->refreshPage();
+            if (welcome) welcome->refreshPage(true);
         } else if (c == 0) {
             Notify(tr("Already up to date with oximetry data at\n\n%1").arg(filename), tr("Up to date"));
         } else {
@@ -2603,7 +2661,7 @@ void MainWindow::on_actionPurgeCurrentDaysOximetry_triggered()
             daily->ReloadGraphs();
         }
         if (overview) overview->ReloadGraphs();
-        if (welcome) welcome->refreshPage();
+        if (welcome) welcome->refreshPage(true);
     } else {
         QMessageBox::information(this, STR_MessageBox_Information,
             tr("Select the day with valid oximetry data in daily view first."),QMessageBox::Ok);
@@ -2884,6 +2942,70 @@ void MainWindow::on_actionSystem_Information_triggered()
     QMessageBox::information(nullptr, tr("OSCAR Information"), text);
 }
 
+void MainWindow::on_actionCheck_Data_Integrity_triggered()
+{
+    if (!p_profile) return;
+
+    ProgressDialog progress(this);
+    progress.setMessage(tr("Checking data files..."));
+    QPixmap icon = QPixmap(":/icons/logo-md.png").scaled(64,64);
+    progress.setPixmap(icon);
+    progress.open();
+
+    int checked = 0;
+    QStringList problems;
+    for (Machine * mach : p_profile->GetMachines()) {
+        progress.setMessage(tr("Checking %1 %2 data files...").arg(mach->brand()).arg(mach->model()));
+        ProgressTracker::pumpEvents();
+
+        IntegrityScanner scanner(mach);
+        scanner.scan(true, &progress);
+        checked += scanner.filesChecked();
+        problems += scanner.report();
+    }
+    progress.close();
+
+    if (problems.isEmpty()) {
+        QMessageBox::information(this, STR_MessageBox_Information, tr("All %1 data files checked are intact.").arg(checked));
+        return;
+    }
+
+    // Every problem is in the log, keep the message box to a readable size
+    const int shown = 20;
+    QString text = tr("%1 of %2 data files have problems:").arg(problems.size()).arg(checked) + "<br/><br/>";
+    for (const auto & line : problems.mid(0, shown)) {
+        text += line.toHtmlEscaped() + "<br/>";
+    }
+    if (problems.size() > shown) {
+        text += tr("...and %1 more, see the debug log for the full list.").arg(problems.size() - shown);
+    }
+    QMessageBox::warning(this, STR_MessageBox_Warning, text);
+}
+
+void MainWindow::on_actionMemory_Usage_triggered()
+{
+    MemoryDialog * dialog = new MemoryDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    dialog->show();
+}
+
+void MainWindow::on_actionSearch_Nights_triggered()
+{
+    if (!p_profile) {
+        return;
+    }
+    QueryDialog * dialog = new QueryDialog(this);
+    dialog->setAttribute(Qt::WA_DeleteOnClose);
+    connect(dialog, SIGNAL(dateSelected(QDate)), this, SLOT(onQueryDateSelected(QDate)));
+    dialog->show();
+}
+
+void MainWindow::onQueryDateSelected(QDate date)
+{
+    JumpDaily();
+    daily->LoadDate(date);
+}
+
 void MainWindow::on_profilesButton_clicked()
 {
     ui->tabWidget->setCurrentWidget(profileSelector);
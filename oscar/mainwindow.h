@@ -27,6 +27,7 @@
 #include "preferencesdialog.h"
 
 extern Profile *profile;
+struct ImportResult;
 QString getCPAPPixmap(QString mach_class);
 
 namespace Ui {
@@ -78,6 +79,8 @@ extern QStatusBar *qstatusbar;
 class Daily;
 class Report;
 class Overview;
+class NightPrewarmer;
+class EventMigrator;
 
 
 /*! \class MainWindow
@@ -164,6 +167,9 @@ class MainWindow : public QMainWindow
     void setStatsHTML(QString html);
 
     int importCPAP(ImportPath import, const QString &message);
+
+    //! \brief Imports every source at once behind a single progress dialog, returning a result for each
+    QList<ImportResult> importCPAP(const QList<ImportPath> & imports, const QString &message);
     void finishCPAPImport();
 
     void startImportDialog() { on_action_Import_Data_triggered(); }
@@ -352,6 +358,17 @@ class MainWindow : public QMainWindow
 
     void on_actionSystem_Information_triggered();
 
+    //! \brief Validates every summary and events file of the current profile and lists any problems
+    void on_actionCheck_Data_Integrity_triggered();
+
+    //! \brief Shows how much memory each kind of data and cache is holding
+    void on_actionMemory_Usage_triggered();
+
+    void on_actionSearch_Nights_triggered();
+
+    //! \brief Shows the night picked in the Search Nights dialog
+    void onQueryDateSelected(QDate date);
+
     void on_profilesButton_clicked();
 
     void reloadProfile();
@@ -381,6 +398,8 @@ private:
     Overview *overview;
     ProfileSelector *profileSelector;
     Welcome * welcome;
+    NightPrewarmer * prewarmer;
+    EventMigrator * migrator;
 #ifndef helpless
     Help * help;
 #endif
@@ -0,0 +1,98 @@
+/* Memory Usage Dialog Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QHeaderView>
+#include <QLocale>
+
+#include "memorydialog.h"
+#include "SleepLib/memoryaccounting.h"
+
+// How often the figures are refreshed while the dialog is open, in milliseconds
+const int memory_refresh_interval = 2000;
+
+static QString formatBytes(qint64 bytes)
+{
+    QLocale locale;
+    if (bytes >= 1048576L) {
+        return QObject::tr("%1 MB").arg(locale.toString(double(bytes) / 1048576.0, 'f', 1));
+    }
+    return QObject::tr("%1 KB").arg(locale.toString(double(bytes) / 1024.0, 'f', 1));
+}
+
+MemoryDialog::MemoryDialog(QWidget * parent)
+    :QDialog(parent)
+{
+    setWindowTitle(tr("Memory Usage"));
+    setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
+
+    usage = new QTreeWidget(this);
+    usage->setColumnCount(3);
+    usage->setHeaderLabels(QStringList() << tr("Category") << tr("Items") << tr("Memory"));
+    usage->setRootIsDecorated(false);
+    usage->header()->setSectionResizeMode(0, QHeaderView::Stretch);
+
+    totalMsg = new QLabel(this);
+    logButton = new QPushButton(tr("Write to Log"), this);
+    logButton->setToolTip(tr("Adds these figures to the debug log, to include with a bug report"));
+    closeButton = new QPushButton(tr("Close"), this);
+
+    QHBoxLayout * buttons = new QHBoxLayout;
+    buttons->addWidget(totalMsg, 1);
+    buttons->addWidget(logButton);
+    buttons->addWidget(closeButton);
+
+    QVBoxLayout * vlayout = new QVBoxLayout;
+    vlayout->addWidget(new QLabel(tr("Estimated memory held by OSCAR's data and caches."), this));
+    vlayout->addWidget(usage, 1);
+    vlayout->addLayout(buttons);
+    setLayout(vlayout);
+    resize(480, 320);
+
+    connect(logButton, SIGNAL(clicked()), this, SLOT(onLogClicked()));
+    connect(closeButton, SIGNAL(clicked()), this, SLOT(close()));
+    connect(&refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+
+    refresh();
+    refreshTimer.start(memory_refresh_interval);
+}
+
+MemoryDialog::~MemoryDialog()
+{
+    refreshTimer.stop();
+}
+
+void MemoryDialog::refresh()
+{
+    MemoryReport report = MemoryAccounting::instance().report();
+    const QList<MemoryUsage> & list = report.usage();
+
+    // Update the rows in place, so the selection and scroll position survive a refresh
+    while (usage->topLevelItemCount() > list.size()) {
+        delete usage->takeTopLevelItem(usage->topLevelItemCount() - 1);
+    }
+    for (int i = 0; i < list.size(); ++i) {
+        QTreeWidgetItem * item = usage->topLevelItem(i);
+        if (!item) {
+            item = new QTreeWidgetItem(usage);
+            item->setTextAlignment(1, Qt::AlignRight | Qt::AlignVCenter);
+            item->setTextAlignment(2, Qt::AlignRight | Qt::AlignVCenter);
+        }
+        const MemoryUsage & entry = list.at(i);
+        item->setText(0, entry.category);
+        item->setText(1, QLocale().toString(entry.items));
+        item->setText(2, formatBytes(entry.bytes));
+    }
+    totalMsg->setText(tr("Total: %1").arg(formatBytes(report.totalBytes())));
+}
+
+void MemoryDialog::onLogClicked()
+{
+    MemoryAccounting::instance().dump();
+}
@@ -0,0 +1,40 @@
+/* Memory Usage Dialog Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef MEMORYDIALOG_H
+#define MEMORYDIALOG_H
+
+#include <QDialog>
+#include <QLabel>
+#include <QPushButton>
+#include <QTimer>
+#include <QTreeWidget>
+
+/*! \class MemoryDialog
+    \brief Shows the estimated memory held by each category reporting to MemoryAccounting, refreshed while open
+    */
+class MemoryDialog:public QDialog
+{
+    Q_OBJECT
+  public:
+    explicit MemoryDialog(QWidget * parent);
+    virtual ~MemoryDialog();
+
+  protected slots:
+    void refresh();
+    void onLogClicked();
+
+  protected:
+    QTreeWidget * usage;
+    QLabel * totalMsg;
+    QPushButton * logButton;
+    QPushButton * closeButton;
+    QTimer refreshTimer;
+};
+
+#endif // MEMORYDIALOG_H
@@ -253,8 +253,10 @@ SOURCES += \
     cprogressbar.cpp \
     daily.cpp \
     exportcsv.cpp \
+    querydialog.cpp \
     main.cpp \
     mainwindow.cpp \
+    memorydialog.cpp \
     newprofile.cpp \
     overview.cpp \
     preferencesdialog.cpp \
@@ -264,6 +266,7 @@ SOURCES += \
     version.cpp \
     Graphs/gFlagsLine.cpp \
     Graphs/gFooBar.cpp \
+    Graphs/gFrameScheduler.cpp \
     Graphs/gGraph.cpp \
     Graphs/gGraphView.cpp \
     Graphs/glcommon.cpp \
@@ -277,15 +280,29 @@ SOURCES += \
     Graphs/gYAxis.cpp \
     Graphs/layer.cpp \
     SleepLib/calcs.cpp \
+    SleepLib/calendarcache.cpp \
     SleepLib/common.cpp \
+    SleepLib/crc.cpp \
     SleepLib/day.cpp \
     SleepLib/event.cpp \
+    SleepLib/eventpool.cpp \
+    SleepLib/gzipdevice.cpp \
+    SleepLib/importcoordinator.cpp \
+    SleepLib/integrity.cpp \
     SleepLib/machine.cpp \
     SleepLib/machine_loader.cpp \
+    SleepLib/memoryaccounting.cpp \
+    SleepLib/migration.cpp \
     SleepLib/preferences.cpp \
+    SleepLib/prewarm.cpp \
     SleepLib/profiles.cpp \
+    SleepLib/progresstracker.cpp \
+    SleepLib/query.cpp \
+    SleepLib/rollup.cpp \
     SleepLib/schema.cpp \
     SleepLib/session.cpp \
+    SleepLib/sessionindex.cpp \
+    SleepLib/sessionjournal.cpp \
     SleepLib/loader_plugins/cms50_loader.cpp \
     SleepLib/loader_plugins/dreem_loader.cpp \
     SleepLib/loader_plugins/icon_loader.cpp \
@@ -309,12 +326,15 @@ SOURCES += \
     SleepLib/loader_plugins/md300w1_loader.cpp \
     Graphs/gSessionTimesChart.cpp \
     Graphs/gPressureChart.cpp \
+    Graphs/gRollupChart.cpp \
     logger.cpp \
     SleepLib/machine_common.cpp \
     SleepLib/loader_plugins/weinmann_loader.cpp \
     Graphs/gdailysummary.cpp \
     Graphs/MinutesAtPressure.cpp \
     SleepLib/journal.cpp \
+    SleepLib/latestnights.cpp \
+    SleepLib/localtime.cpp \
     SleepLib/progressdialog.cpp \
     SleepLib/loader_plugins/cms50f37_loader.cpp \
     profileselector.cpp \
@@ -332,7 +352,9 @@ HEADERS  += \
     cprogressbar.h \
     daily.h \
     exportcsv.h \
+    querydialog.h \
     mainwindow.h \
+    memorydialog.h \
     newprofile.h \
     overview.h \
     preferencesdialog.h \
@@ -343,6 +365,7 @@ HEADERS  += \
     VERSION \
     Graphs/gFlagsLine.h \
     Graphs/gFooBar.h \
+    Graphs/gFrameScheduler.h \
     Graphs/gGraph.h \
     Graphs/gGraphView.h \
     Graphs/glcommon.h \
@@ -356,16 +379,30 @@ HEADERS  += \
     Graphs/gYAxis.h \
     Graphs/layer.h \
     SleepLib/calcs.h \
+    SleepLib/calendarcache.h \
     SleepLib/common.h \
+    SleepLib/crc.h \
     SleepLib/day.h \
     SleepLib/event.h \
+    SleepLib/eventpool.h \
+    SleepLib/gzipdevice.h \
+    SleepLib/importcoordinator.h \
+    SleepLib/integrity.h \
     SleepLib/machine.h \
     SleepLib/machine_common.h \
     SleepLib/machine_loader.h \
+    SleepLib/memoryaccounting.h \
+    SleepLib/migration.h \
     SleepLib/preferences.h \
+    SleepLib/prewarm.h \
     SleepLib/profiles.h \
+    SleepLib/progresstracker.h \
+    SleepLib/query.h \
+    SleepLib/rollup.h \
     SleepLib/schema.h \
     SleepLib/session.h \
+    SleepLib/sessionindex.h \
+    SleepLib/sessionjournal.h \
     SleepLib/loader_plugins/cms50_loader.h \
     SleepLib/loader_plugins/dreem_loader.h \
     SleepLib/loader_plugins/icon_loader.h \
@@ -389,11 +426,14 @@ HEADERS  += \
     SleepLib/loader_plugins/md300w1_loader.h \
     Graphs/gSessionTimesChart.h \
     Graphs/gPressureChart.h \
+    Graphs/gRollupChart.h \
     logger.h \
     SleepLib/loader_plugins/weinmann_loader.h \
     Graphs/gdailysummary.h \
     Graphs/MinutesAtPressure.h \
     SleepLib/journal.h \
+    SleepLib/latestnights.h \
+    SleepLib/localtime.h \
     SleepLib/progressdialog.h \
     SleepLib/loader_plugins/cms50f37_loader.h \
     profileselector.h \
@@ -529,7 +569,15 @@ test {
     QT -= gui
     CONFIG += console debug
     CONFIG -= app_bundle
-    !win32 {  # add memory checking on Linux and macOS test builds
+    # Add "CONFIG+=benchmark" as well to time the QBENCHMARKs in an optimized build without memory checking.
+    # It stays a debug build with optimization added, as a release build defines QT_NO_DEBUG (after this
+    # file is read, so it can't be removed here) and the tests' Q_ASSERTs would all quietly pass.
+    benchmark {
+        QMAKE_CFLAGS_DEBUG += -O2
+        QMAKE_CXXFLAGS_DEBUG += -O2
+        DEFINES += OSCAR_BENCHMARK
+    }
+    !win32:!benchmark {  # add memory checking on Linux and macOS test builds
         QMAKE_CFLAGS += -Werror -fsanitize=address -fno-omit-frame-pointer -fno-common -fsanitize-address-use-after-scope
         lessThan(QT_MAJOR_VERSION,5)|lessThan(QT_MINOR_VERSION,9) {
             QMAKE_CFLAGS -= -fsanitize-address-use-after-scope
@@ -542,9 +590,16 @@ test {
     }
 
     SOURCES += \
+        tests/crctests.cpp \
+        tests/gziptests.cpp \
+        tests/localtimetests.cpp \
+        tests/profilegenerator.cpp \
+        tests/profilegeneratortests.cpp \
         tests/prs1tests.cpp \
+        tests/regressiongate.cpp \
         tests/resmedtests.cpp \
         tests/sessiontests.cpp \
+        tests/sleeplibbenchmarks.cpp \
         tests/versiontests.cpp \
         tests/viatomtests.cpp \
         tests/deviceconnectiontests.cpp \
@@ -553,9 +608,16 @@ test {
 
     HEADERS += \
         tests/AutoTest.h \
+        tests/crctests.h \
+        tests/gziptests.h \
+        tests/localtimetests.h \
+        tests/profilegenerator.h \
+        tests/profilegeneratortests.h \
         tests/prs1tests.h \
+        tests/regressiongate.h \
         tests/resmedtests.h \
         tests/sessiontests.h \
+        tests/sleeplibbenchmarks.h \
         tests/versiontests.h \
         tests/viatomtests.h \
         tests/deviceconnectiontests.h \
@@ -25,6 +25,7 @@
 #include "Graphs/gLineChart.h"
 #include "Graphs/gYAxis.h"
 #include "Graphs/gPressureChart.h"
+#include "Graphs/gRollupChart.h"
 #include "cprogressbar.h"
 
 #include "mainwindow.h"
@@ -67,6 +68,7 @@ Overview::Overview(QWidget *parent, gGraphView *shared) :
     // Connect the signals to update which days have CPAP data when the month is changed
     connect(ui->dateStart->calendarWidget(), SIGNAL(currentPageChanged(int, int)), this, SLOT(dateStart_currentPageChanged(int, int)));
     connect(ui->dateEnd->calendarWidget(), SIGNAL(currentPageChanged(int, int)), this, SLOT(dateEnd_currentPageChanged(int, int)));
+    connect(&p_profile->calendar, SIGNAL(monthUpdated(int,int)), this, SLOT(calendarMonthUpdated(int,int)));
 
     QVBoxLayout *framelayout = new QVBoxLayout;
     ui->graphArea->setLayout(framelayout);
@@ -95,6 +97,9 @@ Overview::Overview(QWidget *parent, gGraphView *shared) :
 
     GraphView->setEmptyText(STR_Empty_NoData);
 
+    // Trend charts get their rollups in the background, and repaint as they arrive
+    connect(&RollupLoader::instance(), SIGNAL(rollupsLoaded()), GraphView, SLOT(redraw()));
+
     // Create the custom scrollbar and attach to GraphView
     scrollbar = new MyScrollBar(ui->graphArea);
     scrollbar->setOrientation(Qt::Vertical);
@@ -226,7 +231,11 @@ void Overview::CreateAllGraphs() {
                 sc->addCalc(code, ST_SPH, schema::channel[code].defaultColor());
                 G->AddLayer(sc);
             } else if (chan->type() == schema::WAVEFORM) {
-                G->AddLayer(new gSummaryChart(code, chan->machtype()));
+                if (AppSetting->overviewLinechartMode() == OLC_Trend) {
+                    G->AddLayer(new gRollupChart(code, chan->machtype()));
+                } else {
+                    G->AddLayer(new gSummaryChart(code, chan->machtype()));
+                }
             } else if (chan->type() == schema::UNKNOWN) {
                 gSummaryChart * sc = new gSummaryChart(chan->code(), MT_CPAP);
                 sc->addCalc(code, ST_CPH, schema::channel[code].defaultColor());
@@ -327,6 +336,8 @@ void Overview::on_RangeUpdate(double minx, double /* maxx */)
 
 void Overview::ReloadGraphs()
 {
+    // Sessions may have been replaced, so their rollups need reading again
+    RollupLoader::instance().clear();
     GraphView->setDay(nullptr);
     updateCube();
 
@@ -384,54 +395,61 @@ void Overview::RedrawGraphs()
     GraphView->redraw();
 }
 
-void Overview::UpdateCalendarDay(QDateEdit *dateedit, QDate date)
+void Overview::UpdateCalendarDay(QCalendarWidget *calendar, QDate date, const CalendarDay & cd)
 {
-    QCalendarWidget *calendar = dateedit->calendarWidget();
-    QTextCharFormat bold;
-    QTextCharFormat cpapcol;
-    QTextCharFormat normal;
-    QTextCharFormat oxiday;
-    bold.setFontWeight(QFont::Bold);
-    cpapcol.setForeground(QBrush(Qt::blue, Qt::SolidPattern));
-    cpapcol.setFontWeight(QFont::Bold);
-    oxiday.setForeground(QBrush(Qt::red, Qt::SolidPattern));
-    oxiday.setFontWeight(QFont::Bold);
-    bool hascpap = p_profile->FindDay(date, MT_CPAP) != nullptr;
-    bool hasoxi = p_profile->FindDay(date, MT_OXIMETER) != nullptr;
-    //bool hasjournal=p_profile->GetDay(date,MT_JOURNAL)!=nullptr;
-
-    if (hascpap) {
-        if (hasoxi) {
+    static QTextCharFormat bold, cpapcol, normal, oxiday;
+    static bool initialized = false;
+    if (!initialized) {
+        bold.setFontWeight(QFont::Bold);
+        cpapcol.setForeground(QBrush(Qt::blue, Qt::SolidPattern));
+        cpapcol.setFontWeight(QFont::Bold);
+        oxiday.setForeground(QBrush(Qt::red, Qt::SolidPattern));
+        oxiday.setFontWeight(QFont::Bold);
+        initialized = true;
+    }
+
+    if (cd.has(CF_CPAP)) {
+        if (cd.has(CF_Oximeter)) {
             calendar->setDateTextFormat(date, oxiday);
         } else {
             calendar->setDateTextFormat(date, cpapcol);
         }
-    } else if (p_profile->GetDay(date)) {
+    } else if (cd.has(CF_Any)) {
         calendar->setDateTextFormat(date, bold);
     } else {
         calendar->setDateTextFormat(date, normal);
     }
+}
+
+void Overview::UpdateCalendarMonth(QDateEdit *dateedit, int year, int month)
+{
+    QCalendarWidget *calendar = dateedit->calendarWidget();
+    const QVector<CalendarDay> & days = p_profile->calendar.month(year, month);
 
+    calendar->setUpdatesEnabled(false);
+    for (int i = 0; i < days.size(); i++) {
+        UpdateCalendarDay(calendar, QDate(year, month, i + 1), days.at(i));
+    }
     calendar->setHorizontalHeaderFormat(QCalendarWidget::ShortDayNames);
+    calendar->setUpdatesEnabled(true);
 }
+
 void Overview::dateStart_currentPageChanged(int year, int month)
 {
-    QDate d(year, month, 1);
-    int dom = d.daysInMonth();
-
-    for (int i = 1; i <= dom; i++) {
-        d = QDate(year, month, i);
-        UpdateCalendarDay(ui->dateStart, d);
-    }
+    UpdateCalendarMonth(ui->dateStart, year, month);
 }
 void Overview::dateEnd_currentPageChanged(int year, int month)
 {
-    QDate d(year, month, 1);
-    int dom = d.daysInMonth();
+    UpdateCalendarMonth(ui->dateEnd, year, month);
+}
 
-    for (int i = 1; i <= dom; i++) {
-        d = QDate(year, month, i);
-        UpdateCalendarDay(ui->dateEnd, d);
+void Overview::calendarMonthUpdated(int year, int month)
+{
+    for (QDateEdit * dateedit : { ui->dateStart, ui->dateEnd }) {
+        QCalendarWidget * calendar = dateedit->calendarWidget();
+        if ((calendar->yearShown() == year) && (calendar->monthShown() == month)) {
+            UpdateCalendarMonth(dateedit, year, month);
+        }
     }
 }
 
@@ -105,6 +105,9 @@ class Overview : public QWidget
     //! \brief Updates the calendar highlighting when changing to a new month
     void dateEnd_currentPageChanged(int year, int month);
 
+    //! \brief Recolours whichever calendars are showing a month that got its CPAP details worked out
+    void calendarMonthUpdated(int year, int month);
+
     //void on_printDailyButton_clicked();
 
     void on_rangeCombo_activated(int index);
@@ -129,8 +132,11 @@ class Overview : public QWidget
     QIcon *icon_off;
     MyLabel *dateLabel;
 
-    //! \brief Updates the calendar highlighting for the calendar object for this date.
-    void UpdateCalendarDay(QDateEdit *calendar, QDate date);
+    //! \brief Updates the calendar highlighting for this date from its cached calendar metadata.
+    void UpdateCalendarDay(QCalendarWidget *calendar, QDate date, const CalendarDay & cd);
+
+    //! \brief Updates the calendar highlighting for a whole month page of dateedit.
+    void UpdateCalendarMonth(QDateEdit *dateedit, int year, int month);
     void updateCube();
 
     Day *day; // dummy in this case
@@ -259,6 +259,8 @@ PreferencesDialog::PreferencesDialog(QWidget *parent, Profile *_profile) :
     ui->dontAskWhenSavingScreenshotsCheckbox->setChecked(AppSetting->dontAskWhenSavingScreenshots());
     ui->cacheSessionData->setChecked(AppSetting->cacheSessions());
     ui->preloadSummaries->setChecked(profile->session->preloadSummaries());
+    ui->prewarmNights->setValue(AppSetting->prewarmNights());
+    ui->prewarmMemory->setValue(AppSetting->prewarmMemory());
     ui->animationsAndTransitionsCheckbox->setChecked(AppSetting->animations());
     ui->complianceCheckBox->setChecked(profile->cpap->showComplianceInfo());
     ui->complianceHours->setValue(profile->cpap->complianceHours());
@@ -740,6 +742,11 @@ bool PreferencesDialog::Save()
         needs_reload = true;
     }
 
+    if ((AppSetting->overviewLinechartMode() == OLC_Trend) != (ui->overviewLinecharts->currentIndex() == OLC_Trend)) {
+        // Waveform graphs in Overview need to be recreated
+        needs_reload = true;
+    }
+
     if (AppSetting->userEventPieChart() != ui->showUserFlagsInPie->isChecked()) {
         // lazy.. fix me
         needs_reload = true;
@@ -850,12 +857,19 @@ bool PreferencesDialog::Save()
 
     AppSetting->setCacheSessions(ui->cacheSessionData->isChecked());
     profile->session->setPreloadSummaries(ui->preloadSummaries->isChecked());
+    AppSetting->setPrewarmNights(ui->prewarmNights->value());
+    AppSetting->setPrewarmMemory(ui->prewarmMemory->value());
     AppSetting->setAnimations(ui->animationsAndTransitionsCheckbox->isChecked());
 
     profile->cpap->setShowLeakRedline(ui->showLeakRedline->isChecked());
     profile->cpap->setLeakRedline(ui->leakRedlineSpinbox->value());
 
     profile->cpap->setShowComplianceInfo(ui->complianceCheckBox->isChecked());
+    if ((profile->cpap->complianceHours() != ui->complianceHours->value()) ||
+        (profile->general->calculateRDI() != (ui->eventIndexCombo->currentIndex() == 1))) {
+        // The calendar colouring goes by these
+        profile->calendar.clear();
+    }
     profile->cpap->setComplianceHours(ui->complianceHours->value());
 
     if (ui->graphHeight->value() != AppSetting->graphHeight()) {
@@ -0,0 +1,126 @@
+/* Cross-night Query Dialog Implementation
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QHBoxLayout>
+#include <QVBoxLayout>
+#include <QFormLayout>
+
+#include "querydialog.h"
+#include "SleepLib/profiles.h"
+
+QueryDialog::QueryDialog(QWidget * parent)
+    :QDialog(parent)
+{
+    setWindowTitle(tr("Search Nights"));
+    setWindowFlags(windowFlags() & ~Qt::WindowContextHelpButtonHint);
+
+    queryEdit = new QLineEdit(this);
+    queryEdit->setPlaceholderText("cph(ClearAirway) > 5 while Pressure > 12 and hours > 4");
+    queryEdit->setToolTip(tr("Conditions joined by \"and\". Functions: cnt, cph, sph, sum, avg, wavg, "
+                             "min, max, median, p90, p95, hours.\n"
+                             "Add \"while Channel > value\" to only count events happening while "
+                             "another channel meets a condition."));
+
+    QDate first = p_profile ? p_profile->FirstDay() : QDate::currentDate();
+    QDate last = p_profile ? p_profile->LastDay() : QDate::currentDate();
+    startDate = new QDateEdit(first, this);
+    endDate = new QDateEdit(last, this);
+    startDate->setCalendarPopup(true);
+    endDate->setCalendarPopup(true);
+
+    searchButton = new QPushButton(tr("Search"), this);
+    searchButton->setDefault(true);
+
+    progress = new QProgressBar(this);
+    statusMsg = new QLabel(this);
+    results = new QListWidget(this);
+
+    QHBoxLayout * range = new QHBoxLayout;
+    range->addWidget(startDate);
+    range->addWidget(new QLabel(tr("to"), this));
+    range->addWidget(endDate);
+    range->addStretch(1);
+    range->addWidget(searchButton);
+
+    QFormLayout * form = new QFormLayout;
+    form->addRow(tr("Query"), queryEdit);
+    form->addRow(tr("Dates"), range);
+
+    QVBoxLayout * vlayout = new QVBoxLayout;
+    vlayout->addLayout(form);
+    vlayout->addWidget(progress);
+    vlayout->addWidget(statusMsg);
+    vlayout->addWidget(results, 1);
+    setLayout(vlayout);
+    resize(560, 420);
+
+    connect(searchButton, SIGNAL(clicked()), this, SLOT(onSearchClicked()));
+    connect(queryEdit, SIGNAL(returnPressed()), this, SLOT(onSearchClicked()));
+    connect(results, SIGNAL(itemActivated(QListWidgetItem*)), this, SLOT(onItemActivated(QListWidgetItem*)));
+    connect(&engine, SIGNAL(dayMatched(QDate,QString)), this, SLOT(onDayMatched(QDate,QString)));
+    connect(&engine, SIGNAL(progress(int,int)), this, SLOT(onProgress(int,int)));
+    connect(&engine, SIGNAL(finished(int)), this, SLOT(onFinished(int)));
+}
+
+QueryDialog::~QueryDialog()
+{
+    disconnect(&engine, nullptr, this, nullptr);
+    engine.cancel();
+}
+
+void QueryDialog::onSearchClicked()
+{
+    if (engine.isRunning()) {
+        engine.cancel();
+        return;
+    }
+
+    DayQuery query;
+    QString error;
+    if (!query.parse(queryEdit->text(), &error)) {
+        statusMsg->setText(error);
+        return;
+    }
+
+    results->clear();
+    progress->setValue(0);
+    statusMsg->setText(tr("Searching..."));
+    searchButton->setText(tr("Stop"));
+    engine.start(query, startDate->date(), endDate->date());
+}
+
+void QueryDialog::onDayMatched(QDate date, QString description)
+{
+    QListWidgetItem * item = new QListWidgetItem(date.toString(Qt::SystemLocaleShortDate) + "  " + description);
+    item->setData(Qt::UserRole, date);
+
+    // Results arrive out of order from the worker threads, keep the list in date order
+    int row = results->count();
+    while ((row > 0) && (results->item(row - 1)->data(Qt::UserRole).toDate() > date)) {
+        --row;
+    }
+    results->insertItem(row, item);
+}
+
+void QueryDialog::onProgress(int done, int total)
+{
+    progress->setMaximum(qMax(total, 1));
+    progress->setValue(done);
+}
+
+void QueryDialog::onFinished(int matches)
+{
+    progress->setValue(progress->maximum());
+    statusMsg->setText(tr("%1 matching nights").arg(matches));
+    searchButton->setText(tr("Search"));
+}
+
+void QueryDialog::onItemActivated(QListWidgetItem * item)
+{
+    emit dateSelected(item->data(Qt::UserRole).toDate());
+}
@@ -0,0 +1,55 @@
+/* Cross-night Query Dialog Header
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef QUERYDIALOG_H
+#define QUERYDIALOG_H
+
+#include <QDialog>
+#include <QDateEdit>
+#include <QLineEdit>
+#include <QLabel>
+#include <QListWidget>
+#include <QProgressBar>
+#include <QPushButton>
+
+#include "SleepLib/query.h"
+
+/*! \class QueryDialog
+    \brief Lets the user search every night of the profile with a DayQuery expression
+    */
+class QueryDialog:public QDialog
+{
+    Q_OBJECT
+  public:
+    explicit QueryDialog(QWidget * parent);
+    virtual ~QueryDialog();
+
+  signals:
+    //! \brief Sent when a result is double clicked
+    void dateSelected(QDate date);
+
+  protected slots:
+    void onSearchClicked();
+    void onDayMatched(QDate date, QString description);
+    void onProgress(int done, int total);
+    void onFinished(int matches);
+    void onItemActivated(QListWidgetItem * item);
+
+  protected:
+    QLineEdit * queryEdit;
+    QDateEdit * startDate;
+    QDateEdit * endDate;
+    QPushButton * searchButton;
+    QProgressBar * progress;
+    QLabel * statusMsg;
+    QListWidget * results;
+
+    QueryEngine engine;
+};
+
+#endif // QUERYDIALOG_H
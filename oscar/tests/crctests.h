@@ -0,0 +1,38 @@
+/* CRC Unit Tests and Benchmarks
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef CRCTESTS_H
+#define CRCTESTS_H
+
+#include "AutoTest.h"
+
+class CRCTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testSingleBytes();
+    void testAllPairs();
+    void testLengthsAndAlignments();
+    void testChaining();
+    void testKnownValues();
+    void benchmarkCRC16_data();
+    void benchmarkCRC16();
+    void benchmarkCRC32wchar_data();
+    void benchmarkCRC32wchar();
+    void benchmarkChecksum_data();
+    void benchmarkChecksum();
+
+private:
+    QByteArray m_data;
+};
+
+DECLARE_TEST(CRCTests)
+
+#endif // CRCTESTS_H
@@ -8,6 +8,7 @@
 
 #include "dreemtests.h"
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 #define TESTDATA_PATH "./testdata/"
 
@@ -56,6 +57,7 @@ static void parseAndEmitSessionYaml(const QString & path)
 
 void DreemTests::testSessionsToYaml()
 {
+    RegressionGate gate("dreem");
     static const QString root_path = TESTDATA_PATH "dreem/input/";
 
     QDir root(root_path);
@@ -70,6 +72,7 @@ void DreemTests::testSessionsToYaml()
             parseAndEmitSessionYaml(fi.canonicalFilePath());
         }
     }
+    gate.finish();
 }
 
 
@@ -0,0 +1,260 @@
+/* Gzip Unit Tests and Benchmarks
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QBuffer>
+#include <QDataStream>
+#include <QFile>
+#include <QTemporaryDir>
+#include <QtMath>
+
+#ifdef _MSC_VER
+#include <QtZlib/zlib.h>
+#else
+#include <zlib.h>
+#endif
+
+#include "gziptests.h"
+#include "../SleepLib/common.h"
+#include "../SleepLib/gzipdevice.h"
+#include "../SleepLib/machine_loader.h"
+
+// The gzip functions as they were before GzipDevice, kept here to benchmark against
+
+static quint32 legacyCRC32(const char * data, quint32 length)
+{
+  quint32 crc32 = 0xffffffff;
+
+  for (quint32 idx=0; idx<length; idx++) {
+    quint32 i = (data[idx]) ^ ((crc32) & 0x000000ff);
+    for(int j=8; j > 0; j--) {
+        if (i & 1) {
+            i = (i >> 1) ^ 0xedb88320;
+        } else {
+            i >>= 1;
+        }
+    }
+    crc32 = ((crc32) >> 8) ^ i;
+  }
+  return ~crc32;
+}
+
+static QByteArray legacyCompress(const QByteArray& data)
+{
+    QByteArray compressedData = qCompress(data);
+    compressedData.remove(0, 6);
+    compressedData.chop(4);
+
+    QByteArray header;
+    QDataStream ds1(&header, QIODevice::WriteOnly);
+    ds1 << quint16(0x1f8b)
+        << quint16(0x0800)
+        << quint16(0x0000)
+        << quint16(0x0000)
+        << quint16(0x000b);
+
+    QByteArray footer;
+    QDataStream ds2(&footer, QIODevice::WriteOnly);
+    ds2.setByteOrder(QDataStream::LittleEndian);
+    ds2 << legacyCRC32(data.constData(), data.size())
+        << quint32(data.size());
+
+    return header + compressedData + footer;
+}
+
+static QByteArray legacyUncompress(const QByteArray & data)
+{
+    QByteArray result;
+    static const int CHUNK_SIZE = 1048576;
+    QByteArray out(CHUNK_SIZE, Qt::Uninitialized);
+
+    z_stream strm;
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+    strm.avail_in = data.size();
+    strm.next_in = (Bytef*)(data.data());
+
+    if (inflateInit2(&strm, 15 +  32) != Z_OK) {
+        return QByteArray();
+    }
+    int ret;
+    do {
+        strm.avail_out = CHUNK_SIZE;
+        strm.next_out = (Bytef*)(out.data());
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if ((ret == Z_STREAM_ERROR) || (ret == Z_NEED_DICT) || (ret == Z_DATA_ERROR) || (ret == Z_MEM_ERROR)) {
+            inflateEnd(&strm);
+            return QByteArray();
+        }
+        result.append(out.constData(), CHUNK_SIZE - strm.avail_out);
+    } while (strm.avail_out == 0);
+
+    inflateEnd(&strm);
+    return result;
+}
+
+void GzipTests::initTestCase()
+{
+    // Something shaped like an EDF waveform: 16 bit samples of a noisy sine, about 4MB
+    const int samples = 2 * 1024 * 1024;
+    m_sample.resize(samples * 2);
+    qint16 * ptr = (qint16 *)m_sample.data();
+    quint32 seed = 12345;
+    for (int i = 0; i < samples; ++i) {
+        seed = seed * 1103515245 + 12345;
+        ptr[i] = qint16(1000 * qSin(i / 40.0) + ((seed >> 16) & 0x3f));
+    }
+}
+
+void GzipTests::testRoundTrip()
+{
+    QByteArray empty;
+    Q_ASSERT(gUncompress(gCompress(empty)).isEmpty());
+
+    QByteArray small("OSCAR");
+    Q_ASSERT(gUncompress(gCompress(small)) == small);
+
+    QByteArray packed = gCompress(m_sample);
+    Q_ASSERT(packed.size() > 18);
+    Q_ASSERT(quint8(packed.at(0)) == 0x1f && quint8(packed.at(1)) == 0x8b);
+    Q_ASSERT(gUncompress(packed) == m_sample);
+
+    // Highly compressible input has a tiny compressed size relative to the output
+    QByteArray zeros(8 * 1024 * 1024, '\0');
+    Q_ASSERT(gUncompress(gCompress(zeros)) == zeros);
+}
+
+void GzipTests::testLegacyCompatibility()
+{
+    QByteArray chunk = m_sample.left(300000);
+
+    // Files written by older versions must still read back, and vice versa
+    Q_ASSERT(gUncompress(legacyCompress(chunk)) == chunk);
+    Q_ASSERT(legacyUncompress(gCompress(chunk)) == chunk);
+
+    // zlib's CRC32 must agree with the old bit-at-a-time version
+    Q_ASSERT(quint32(crc32(0L, (const Bytef *)chunk.constData(), chunk.size())) == legacyCRC32(chunk.constData(), chunk.size()));
+}
+
+void GzipTests::testStreaming()
+{
+    QByteArray packed;
+    {
+        QBuffer buffer(&packed);
+        GzipDevice gz(&buffer);
+        bool opened = gz.open(QIODevice::WriteOnly);
+        Q_ASSERT(opened);
+        // Odd sized writes to cross the internal buffer boundaries
+        for (int pos = 0; pos < m_sample.size(); pos += 77777) {
+            int len = qMin(77777, m_sample.size() - pos);
+            qint64 written = gz.write(m_sample.constData() + pos, len);
+            Q_ASSERT(written == len);
+        }
+        gz.close();
+    }
+    Q_ASSERT(gUncompress(packed) == m_sample);
+
+    QBuffer buffer(&packed);
+    buffer.open(QIODevice::ReadOnly);
+    qint64 trailer = GzipDevice::trailerSize(&buffer);
+    Q_ASSERT(trailer == m_sample.size());
+    Q_ASSERT(buffer.pos() == 0);
+
+    GzipDevice gz(&buffer);
+    bool opened = gz.open(QIODevice::ReadOnly);
+    Q_ASSERT(opened);
+    QByteArray head = gz.read(256);
+    Q_ASSERT(head == m_sample.left(256));
+    QByteArray rest = gz.readAll();
+    Q_ASSERT(gz.atEnd());
+    Q_ASSERT(head + rest == m_sample);
+    gz.close();
+}
+
+void GzipTests::testTruncated()
+{
+    QByteArray packed = gCompress(m_sample);
+    QByteArray truncated = packed.left(packed.size() / 2);
+
+    // A truncated stream gives back what could be decoded, without crashing
+    QByteArray partial = gUncompress(truncated);
+    Q_ASSERT(partial.size() > 0 && partial.size() < m_sample.size());
+    Q_ASSERT(partial == m_sample.left(partial.size()));
+
+    QBuffer buffer(&truncated);
+    GzipDevice gz(&buffer);
+    bool opened = gz.open(QIODevice::ReadOnly);
+    Q_ASSERT(opened);
+    QByteArray decoded = gz.readAll();
+    Q_ASSERT(decoded == partial);
+
+    // Reads after the good data report the error rather than a clean end of stream
+    char ch;
+    qint64 got = gz.read(&ch, 1);
+    Q_ASSERT(got == -1);
+    gz.close();
+
+    // Uncompressing to a file fails, without leaving a short file behind
+    QTemporaryDir dir;
+    Q_ASSERT(dir.isValid());
+    QString infile = dir.path() + "/truncated.edf.gz";
+    QString outfile = dir.path() + "/truncated.edf";
+    QFile file(infile);
+    opened = file.open(QFile::WriteOnly);
+    Q_ASSERT(opened);
+    file.write(truncated);
+    file.close();
+    bool uncompressed = uncompressFile(infile, outfile);
+    Q_ASSERT(!uncompressed);
+    Q_ASSERT(!QFile::exists(outfile));
+
+    // A trailer claiming far more than was packed only presizes a multiple of the input
+    Q_ASSERT(GzipDevice::presize(qint64(truncated.size()) * 1000, truncated.size()) <= qint64(truncated.size()) * 16);
+    Q_ASSERT(GzipDevice::presize(qint64(truncated.size()) * 2000, truncated.size()) == 0);
+}
+
+void GzipTests::benchmarkCompress_data()
+{
+    QTest::addColumn<bool>("legacy");
+    QTest::newRow("legacy") << true;
+    QTest::newRow("stream") << false;
+}
+
+void GzipTests::benchmarkCompress()
+{
+    QFETCH(bool, legacy);
+    QByteArray result;
+
+    if (legacy) {
+        QBENCHMARK { result = legacyCompress(m_sample); }
+    } else {
+        QBENCHMARK { result = gCompress(m_sample); }
+    }
+    Q_ASSERT(!result.isEmpty());
+}
+
+void GzipTests::benchmarkUncompress_data()
+{
+    QTest::addColumn<bool>("legacy");
+    QTest::newRow("legacy") << true;
+    QTest::newRow("stream") << false;
+}
+
+void GzipTests::benchmarkUncompress()
+{
+    QFETCH(bool, legacy);
+    QByteArray packed = gCompress(m_sample);
+    QByteArray result;
+
+    if (legacy) {
+        QBENCHMARK { result = legacyUncompress(packed); }
+    } else {
+        QBENCHMARK { result = gUncompress(packed); }
+    }
+    Q_ASSERT(result == m_sample);
+}
@@ -0,0 +1,35 @@
+/* Gzip Unit Tests and Benchmarks
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef GZIPTESTS_H
+#define GZIPTESTS_H
+
+#include "AutoTest.h"
+
+class GzipTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testRoundTrip();
+    void testLegacyCompatibility();
+    void testStreaming();
+    void testTruncated();
+    void benchmarkCompress_data();
+    void benchmarkCompress();
+    void benchmarkUncompress_data();
+    void benchmarkUncompress();
+
+private:
+    QByteArray m_sample;
+};
+
+DECLARE_TEST(GzipTests)
+
+#endif // GZIPTESTS_H
@@ -0,0 +1,86 @@
+/* Local Time Conversion Unit Tests
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QDateTime>
+#include <QTimeZone>
+
+#include "localtimetests.h"
+#include "../SleepLib/localtime.h"
+
+void LocalTimeTests::testZones_data()
+{
+    QTest::addColumn<QByteArray>("zone");
+    QTest::newRow("system") << QByteArray();
+    QTest::newRow("New York") << QByteArray("America/New_York");
+    QTest::newRow("Sydney") << QByteArray("Australia/Sydney");
+    QTest::newRow("Lord Howe") << QByteArray("Australia/Lord_Howe");
+    QTest::newRow("UTC") << QByteArray("UTC");
+}
+
+void LocalTimeTests::testZones()
+{
+    QFETCH(QByteArray, zone);
+    QTimeZone tz = zone.isEmpty() ? QTimeZone::systemTimeZone() : QTimeZone(zone);
+    if (!tz.isValid()) {
+        QSKIP("Time zone not available");
+    }
+    LocalTime table(tz);
+
+    // Every 17 minutes across 2019 and 2020, which hits both sides of every transition
+    qint64 from = QDateTime(QDate(2019, 1, 1), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+    qint64 to = QDateTime(QDate(2021, 1, 1), QTime(0, 0), Qt::UTC).toMSecsSinceEpoch();
+    for (qint64 t = from; t < to; t += 17 * 60000L) {
+        QDateTime dt = QDateTime::fromMSecsSinceEpoch(t, tz);
+        QCOMPARE(table.offsetAt(t), dt.offsetFromUtc() * 1000);
+        QCOMPARE(table.date(t), dt.date());
+        QCOMPARE(table.time(t), dt.time());
+
+        // Round trip, except for the repeated hour when clocks go back
+        qint64 local = table.toLocal(t);
+        qint64 utc = table.toUtc(local);
+        QVERIFY((utc == t) || (table.toLocal(utc) == local));
+    }
+}
+
+void LocalTimeTests::testFixedOffset()
+{
+    LocalTime table(-5 * 3600);
+    QCOMPARE(table.transitions(), 0);
+
+    QTimeZone tz(-5 * 3600);
+    QDate date(2020, 7, 4);
+    QTime time(23, 30, 15);
+    QCOMPARE(table.toUtc(date, time), QDateTime(date, time, tz).toMSecsSinceEpoch());
+    QCOMPARE(table.date(table.toUtc(date, time)), date);
+    QCOMPARE(table.time(table.toUtc(date, time)), time);
+}
+
+void LocalTimeTests::testParsing()
+{
+    QCOMPARE(LocalTime::parseDate("20200229_013000_BRP.edf"), QDate(2020, 2, 29));
+    QCOMPARE(LocalTime::parseTime("20200229_013000_BRP.edf", 9), QTime(1, 30, 0));
+    QVERIFY(!LocalTime::parseDate("20190229").isValid());
+    QVERIFY(!LocalTime::parseDate("2020022").isValid());
+    QVERIFY(!LocalTime::parseDate("2020x229").isValid());
+    QVERIFY(!LocalTime::parseTime("246000").isValid());
+    QCOMPARE(LocalTime::parseDigits("ab0123", 2, 4), 123);
+    QCOMPARE(LocalTime::parseDigits("0123", 2, 4), -1);
+}
+
+void LocalTimeTests::testFormatClock()
+{
+    QString str;
+    LocalTime::formatClock(str, 7, 5);
+    QCOMPARE(str, QString("07:05"));
+    LocalTime::formatClock(str, 23, 59, 1);
+    QCOMPARE(str, QString("23:59:01"));
+    LocalTime::formatClock(str, 0, 0, 9, 45);
+    QCOMPARE(str, QString("00:00:09:045"));
+    LocalTime::formatClock(str, 12, 30);
+    QCOMPARE(str, QString("12:30"));
+}
@@ -0,0 +1,28 @@
+/* Local Time Conversion Unit Tests
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef LOCALTIMETESTS_H
+#define LOCALTIMETESTS_H
+
+#include "AutoTest.h"
+
+class LocalTimeTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void testZones_data();
+    void testZones();
+    void testFixedOffset();
+    void testParsing();
+    void testFormatClock();
+};
+
+DECLARE_TEST(LocalTimeTests)
+
+#endif // LOCALTIMETESTS_H
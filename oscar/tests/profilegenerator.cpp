@@ -0,0 +1,305 @@
+/* Synthetic Profile Generator
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <cmath>
+#include <QDateTime>
+#include <QDir>
+#include <QSettings>
+#include <QStandardPaths>
+#include <QVector>
+#include <QDebug>
+
+#include "profilegenerator.h"
+#include "../SleepLib/profiles.h"
+#include "../SleepLib/machine.h"
+#include "../SleepLib/session.h"
+#include "../SleepLib/loader_plugins/resmed_loader.h"
+#include "../SleepLib/loader_plugins/viatom_loader.h"
+
+// Each CPAP machine is used for this many nights before the next one takes over
+const int machine_rotation_days = 91;
+
+ProfileGenerator::Options::Options()
+    : firstNight(2019, 1, 1), nights(365), cpapMachines(1), oximetry(false),
+      flowRate(25), pressureRate(25), dataRate(0.5), oximetryRate(1),
+      eventsPerHour(4), flagsPerHour(1),
+      maxFragments(3), maxGapMinutes(30), skipChance(0.05),
+      seed(1)
+{
+}
+
+static bool s_appDataRedirected = false;
+static QVariant s_appData;
+
+Profile * ProfileGenerator::createProfile(const QString & path, const QString & username)
+{
+    if (!s_appDataRedirected) {
+        QStandardPaths::setTestMode(true);
+        s_appData = QSettings().value("Settings/AppData");
+        s_appDataRedirected = true;
+    }
+    QSettings().setValue("Settings/AppData", QDir(path).absolutePath());
+    QDir(path + "Profiles/" + username).removeRecursively();
+
+    Profile * profile = new Profile(path, false);
+    profile->user->setUserName(username);
+    return profile;
+}
+
+void ProfileGenerator::restoreAppData()
+{
+    if (!s_appDataRedirected) {
+        return;
+    }
+    QSettings settings;
+    if (s_appData.isValid()) {
+        settings.setValue("Settings/AppData", s_appData);
+    } else {
+        settings.remove("Settings/AppData");
+    }
+    s_appDataRedirected = false;
+}
+
+ProfileGenerator::ProfileGenerator(Profile * profile, const Options & options)
+    : m_profile(profile), m_options(options), m_oximeter(nullptr)
+{
+}
+
+double ProfileGenerator::uniform(double lo, double hi)
+{
+    return lo + (hi - lo) * (double(m_random()) / 4294967296.0);
+}
+
+bool ProfileGenerator::generate()
+{
+    m_random.seed(m_options.seed);
+    m_stats = Stats();
+    m_machines.clear();
+    m_oximeter = nullptr;
+
+    for (int i = 0; i < qMax(1, m_options.cpapMachines); ++i) {
+        m_machines.append(createMachine(MT_CPAP, i));
+    }
+    if (m_options.oximetry) {
+        m_oximeter = createMachine(MT_OXIMETER, 0);
+    }
+
+    for (int i = 0; i < m_options.nights; ++i) {
+        if (!generateNight(m_options.firstNight.addDays(i))) {
+            return false;
+        }
+    }
+
+    for (auto & mach : m_machines) {
+        mach->SaveSummaryCache();
+    }
+    if (m_oximeter) {
+        m_oximeter->SaveSummaryCache();
+    }
+    m_profile->StoreMachines();
+
+    qDebug() << "Generated" << m_stats.nights << "nights," << m_stats.sessions << "sessions,"
+             << m_stats.samples << "samples and" << m_stats.events << "events";
+    return true;
+}
+
+Machine * ProfileGenerator::createMachine(MachineType type, int index)
+{
+    // Stamp the machines with the end of the generated range rather than now, so runs are reproducible
+    QDateTime imported(m_options.firstNight.addDays(m_options.nights), QTime(0, 0));
+
+    MachineInfo info;
+    if (type == MT_OXIMETER) {
+        info = MachineInfo(MT_OXIMETER, 0, viatom_class_name, QObject::tr("Viatom"), QObject::tr("Synthetic"),
+                           QString(), QString("SYNOXI%1").arg(index), QString(), imported, viatom_data_version);
+    } else {
+        info = MachineInfo(MT_CPAP, 0, resmed_class_name, STR_MACH_ResMed, QObject::tr("Synthetic AirSense"),
+                           QString("37%1").arg(index, 3, 10, QChar('0')), QString("SYN%1").arg(index, 8, 10, QChar('0')),
+                           QObject::tr("AirSense 10"), imported, resmed_data_version);
+    }
+    return m_profile->CreateMachine(info);
+}
+
+bool ProfileGenerator::generateNight(QDate date)
+{
+    if (uniform(0, 1) < m_options.skipChance) {
+        return true;
+    }
+    m_stats.nights++;
+
+    int idx = (m_options.firstNight.daysTo(date) / machine_rotation_days) % m_machines.size();
+    Machine * mach = m_machines.at(idx);
+
+    // Bedtime somewhere between 9:30pm and 12:30am, sleeping 4 to 9 hours
+    qint64 bedtime = QDateTime(date, QTime(21, 30)).toMSecsSinceEpoch() + qint64(uniform(0, 3 * 3600)) * 1000L;
+    qint64 remaining = qint64(uniform(4 * 3600, 9 * 3600)) * 1000L;
+
+    int fragments = 1 + int(uniform(0, qMax(1, m_options.maxFragments)));
+    qint64 time = bedtime;
+
+    for (int f = 0; f < fragments; ++f) {
+        qint64 length = remaining;
+        if (f < fragments - 1) {
+            length = qint64(remaining / (fragments - f) * uniform(0.6, 1.4));
+            length -= length % 1000;
+        }
+        remaining -= length;
+
+        if (!save(createCPAPSession(mach, time, time + length))) {
+            return false;
+        }
+        time += length;
+
+        if (f < fragments - 1) {
+            time += qint64(uniform(1, qMax(2, m_options.maxGapMinutes))) * 60000L;
+        }
+    }
+
+    if (m_oximeter && !save(createOximetrySession(m_oximeter, bedtime, time))) {
+        return false;
+    }
+    return true;
+}
+
+Session * ProfileGenerator::createCPAPSession(Machine * mach, qint64 start, qint64 end)
+{
+    Session * sess = new Session(mach, SessionID(start / 1000L));
+    sess->really_set_first(start);
+    sess->really_set_last(end);
+
+    sess->settings[CPAP_Mode] = (int)MODE_APAP;
+    sess->settings[CPAP_PressureMin] = 6.0;
+    sess->settings[CPAP_PressureMax] = 14.0;
+
+    double eph = m_options.eventsPerHour;
+    addEvents(sess, CPAP_Obstructive, start, end, eph * 0.3, 10, 40);
+    addEvents(sess, CPAP_Hypopnea, start, end, eph * 0.5, 10, 30);
+    addEvents(sess, CPAP_ClearAirway, start, end, eph * 0.2, 10, 20);
+    addEvents(sess, CPAP_RERA, start, end, m_options.flagsPerHour, 5, 15);
+
+    addFlow(sess, start, end, m_options.flowRate);
+    addRandomWalk(sess, CPAP_MaskPressure, start, end, m_options.pressureRate, 0.02F, 5.5F, 14.5F, 0.02F);
+
+    double rate = m_options.dataRate;
+    addRandomWalk(sess, CPAP_Pressure, start, end, rate, 0.02F, 6, 14, 0.2F);
+    addRandomWalk(sess, CPAP_Leak, start, end, rate, 0.02F, 0, 40, 1);
+    addRandomWalk(sess, CPAP_RespRate, start, end, rate, 0.2F, 10, 20, 0.4F);
+    addRandomWalk(sess, CPAP_TidalVolume, start, end, rate, 1, 300, 700, 20);
+    addRandomWalk(sess, CPAP_MinuteVent, start, end, rate, 0.125F, 4, 10, 0.2F);
+    addRandomWalk(sess, CPAP_Snore, start, end, rate, 0.2F, 0, 2, 0.1F);
+
+    sess->UpdateSummaries();
+    return sess;
+}
+
+Session * ProfileGenerator::createOximetrySession(Machine * mach, qint64 start, qint64 end)
+{
+    Session * sess = new Session(mach, SessionID(start / 1000L));
+    sess->really_set_first(start);
+    sess->really_set_last(end);
+
+    addRandomWalk(sess, OXI_SPO2, start, end, m_options.oximetryRate, 1, 88, 99, 0.5F);
+    addRandomWalk(sess, OXI_Pulse, start, end, m_options.oximetryRate, 1, 50, 90, 1);
+
+    sess->UpdateSummaries();
+    return sess;
+}
+
+void ProfileGenerator::addEvents(Session * sess, ChannelID code, qint64 start, qint64 end,
+                                 double perHour, int minDuration, int maxDuration)
+{
+    if (perHour <= 0) {
+        return;
+    }
+    EventList * el = nullptr;
+
+    // Exponential gaps give a Poisson process, so events cluster and spread out like real ones do
+    double mean = 3600000.0 / perHour;
+    for (qint64 t = start - qint64(mean * std::log(1.0 - uniform(0, 1))); t < end;
+         t -= qint64(mean * std::log(1.0 - uniform(0, 1)))) {
+        if (el == nullptr) {
+            el = sess->AddEventList(code, EVL_Event);
+        }
+        el->AddEvent(t - (t % 1000), EventStoreType(uniform(minDuration, maxDuration + 1)));
+        m_stats.events++;
+    }
+}
+
+void ProfileGenerator::addFlow(Session * sess, qint64 start, qint64 end, double rate)
+{
+    qint64 count = qint64((end - start) * rate / 1000.0);
+    if ((rate <= 0) || (count < 2)) {
+        return;
+    }
+    const EventDataType gain = 0.02F;
+
+    QVector<qint16> buffer(int(count));
+    double period = 4.0, amplitude = 30.0, phase = 0;
+    for (int i = 0; i < buffer.size(); ++i) {
+        // Drift the breath shape a little at the start of each breath
+        if (phase >= 2 * M_PI) {
+            phase -= 2 * M_PI;
+            period = qBound(3.0, period + uniform(-0.2, 0.2), 6.0);
+            amplitude = qBound(15.0, amplitude + uniform(-2, 2), 45.0);
+        }
+        double value = amplitude * std::sin(phase) + uniform(-1, 1);
+        buffer[i] = qint16(value / gain);
+        phase += 2 * M_PI / (period * rate);
+    }
+
+    EventList * el = sess->AddEventList(CPAP_FlowRate, EVL_Waveform, gain, 0, 0, 0, 1000.0 / rate);
+    el->AddWaveform(start, buffer.data(), buffer.size(), end - start);
+    m_stats.samples += count;
+}
+
+void ProfileGenerator::addRandomWalk(Session * sess, ChannelID code, qint64 start, qint64 end, double rate,
+                                     EventDataType gain, EventDataType lo, EventDataType hi, EventDataType step)
+{
+    qint64 count = qint64((end - start) * rate / 1000.0);
+    if ((rate <= 0) || (count < 2)) {
+        return;
+    }
+
+    QVector<qint16> buffer(int(count));
+    double value = uniform(lo, hi);
+    for (int i = 0; i < buffer.size(); ++i) {
+        value += uniform(-step, step);
+        // Reflect off the bounds rather than clamping, so the walk doesn't stick to them
+        if (value < lo) {
+            value = 2 * lo - value;
+        } else if (value > hi) {
+            value = 2 * hi - value;
+        }
+        buffer[i] = qint16(std::lround(value / gain));
+    }
+
+    EventList * el = sess->AddEventList(code, EVL_Waveform, gain, 0, 0, 0, 1000.0 / rate);
+    el->AddWaveform(start, buffer.data(), buffer.size(), end - start);
+    m_stats.samples += count;
+}
+
+bool ProfileGenerator::save(Session * sess)
+{
+    Machine * mach = sess->machine();
+
+    if (!sess->Store(mach->getDataPath())) {
+        qWarning() << "Failed to store generated session" << sess->session();
+        delete sess;
+        return false;
+    }
+    sess->TrashEvents();
+
+    if (!mach->AddSession(sess)) {
+        // Rejected by the profile's import settings, eg ignoring older sessions, which isn't an error here
+        qDebug() << "Generated session" << sess->session() << "was not added";
+        delete sess;
+        return true;
+    }
+    m_stats.sessions++;
+    return true;
+}
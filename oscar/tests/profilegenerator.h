@@ -0,0 +1,119 @@
+/* Synthetic Profile Generator
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef PROFILEGENERATOR_H
+#define PROFILEGENERATOR_H
+
+#include <random>
+#include <QDate>
+#include <QList>
+#include <QString>
+
+#include "../SleepLib/machine_common.h"
+
+class Profile;
+class Machine;
+class Session;
+
+/*! \class ProfileGenerator
+    \brief Fills a profile with realistic looking synthetic CPAP and oximetry data
+
+    Sessions are built in memory, stored through Session::Store exactly as a loader would
+    store them, added to their Machine and then have their events trashed, so memory use
+    stays flat no matter how many years are generated. The summary cache and machine
+    list are written when generate() finishes.
+
+    The same seed always produces the same data, so the resulting profiles can be used to
+    compare startup, Overview, Statistics and export timings between builds.
+    */
+class ProfileGenerator
+{
+  public:
+    struct Options {
+        Options();
+
+        QDate firstNight;           //!< Date of the first night generated
+        int nights;                 //!< Number of consecutive nights
+        int cpapMachines;           //!< Machines share the nights, each one taking over in turn
+        bool oximetry;              //!< Also generate an oximeter session for every night used
+
+        double flowRate;            //!< Flow rate waveform sample rate, in Hz
+        double pressureRate;        //!< Mask pressure waveform sample rate, in Hz (0 to skip)
+        double dataRate;            //!< Pressure, leak, respiratory rate etc. sample rate, in Hz
+        double oximetryRate;        //!< SpO2 and pulse sample rate, in Hz
+
+        double eventsPerHour;       //!< Average respiratory events per hour, split across OA, H and CA
+        double flagsPerHour;        //!< Average RERA flags per hour
+
+        int maxFragments;           //!< Most mask-on sessions a night is split into
+        int maxGapMinutes;          //!< Longest mask-off gap between fragments
+        double skipChance;          //!< Chance (0..1) that a night has no usage at all
+
+        quint32 seed;
+    };
+
+    struct Stats {
+        Stats() : nights(0), sessions(0), samples(0), events(0) {}
+        int nights;
+        int sessions;
+        qint64 samples;
+        qint64 events;
+    };
+
+    ProfileGenerator(Profile * profile, const Options & options = Options());
+
+    //! \brief Generates every night, then saves summaries and machine records. Returns false on a store failure.
+    bool generate();
+
+    /*! \brief Creates an unopened profile for username, with its machine data stored under path.
+        Machine data paths are built from the app data folder rather than the profile, so this
+        points the app data folder at path (under QStandardPaths test mode) until restoreAppData().
+        Any data previously generated there for username is removed first. */
+    static Profile * createProfile(const QString & path, const QString & username);
+
+    //! \brief Puts back the app data folder replaced by createProfile()
+    static void restoreAppData();
+
+    const Stats & stats() const { return m_stats; }
+    const QList<Machine *> & machines() const { return m_machines; }
+
+  protected:
+    Machine * createMachine(MachineType type, int index);
+
+    //! \brief Builds all sessions for the night starting on date
+    bool generateNight(QDate date);
+
+    Session * createCPAPSession(Machine * mach, qint64 start, qint64 end);
+    Session * createOximetrySession(Machine * mach, qint64 start, qint64 end);
+
+    //! \brief Adds flags for code between start and end, perHour on average, each holding a duration in seconds
+    void addEvents(Session * sess, ChannelID code, qint64 start, qint64 end,
+                   double perHour, int minDuration, int maxDuration);
+
+    //! \brief Adds a flow rate waveform at rate Hz made of breaths with a slowly drifting period and size
+    void addFlow(Session * sess, qint64 start, qint64 end, double rate);
+
+    //! \brief Adds a waveform at rate Hz, with values from a bounded random walk between lo and hi
+    void addRandomWalk(Session * sess, ChannelID code, qint64 start, qint64 end, double rate,
+                       EventDataType gain, EventDataType lo, EventDataType hi, EventDataType step);
+
+    //! \brief Stores sess, hands it to its machine and frees its events
+    bool save(Session * sess);
+
+    //! \brief Uniform random number in [lo, hi), computed by hand so every platform gets the same sequence
+    double uniform(double lo, double hi);
+
+    Profile * m_profile;
+    Options m_options;
+    Stats m_stats;
+    QList<Machine *> m_machines;
+    Machine * m_oximeter;
+    std::mt19937 m_random;
+};
+
+#endif // PROFILEGENERATOR_H
@@ -0,0 +1,243 @@
+/* Synthetic Profile Generator Tests
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QFile>
+#include <QFileInfo>
+
+#include "profilegeneratortests.h"
+#include "profilegenerator.h"
+#include "../SleepLib/profiles.h"
+#include "../SleepLib/machine.h"
+#include "../SleepLib/session.h"
+#include "../SleepLib/day.h"
+#include "../SleepLib/schema.h"
+#include "../SleepLib/integrity.h"
+#include "../SleepLib/calcs.h"
+
+#define TESTDATA_PATH "./testdata/"
+
+void ProfileGeneratorTests::initTestCase(void)
+{
+    p_pref = new Preferences("Preferences");
+    schema::init();
+}
+
+void ProfileGeneratorTests::cleanupTestCase(void)
+{
+    delete p_profile;
+    p_profile = nullptr;
+    delete p_pref;
+    p_pref = nullptr;
+    ProfileGenerator::restoreAppData();
+}
+
+
+// ====================================================================================================
+
+void ProfileGeneratorTests::testGenerate()
+{
+    delete p_profile;
+    p_profile = ProfileGenerator::createProfile(TESTDATA_PATH "synthetic/", "Generated");
+
+    ProfileGenerator::Options options;
+    options.nights = 21;
+    options.cpapMachines = 2;
+    options.oximetry = true;
+    options.flowRate = 5;
+    options.pressureRate = 0;
+    options.seed = 42;
+
+    ProfileGenerator generator(p_profile, options);
+    QVERIFY(generator.generate());
+
+    const ProfileGenerator::Stats & stats = generator.stats();
+    QVERIFY(stats.nights > 0);
+    QVERIFY(stats.events > 0);
+
+    // One oximetry session per night, plus at least one CPAP session
+    QVERIFY(stats.sessions >= stats.nights * 2);
+    int sessions = 0;
+    for (auto & mach : p_profile->GetMachines()) {
+        sessions += mach->sessionlist.size();
+        QVERIFY(QFile::exists(mach->getDataPath() + "Summaries.xml.gz"));
+    }
+    QCOMPARE(sessions, stats.sessions);
+    QCOMPARE(p_profile->daylist.size(), stats.nights);
+
+    // Two machines over 21 nights means the second one is never reached
+    QCOMPARE(generator.machines().size(), 2);
+    QVERIFY(!generator.machines().at(0)->sessionlist.isEmpty());
+    QVERIFY(generator.machines().at(1)->sessionlist.isEmpty());
+
+    // Events were trashed after saving, so this reads back what was stored
+    Session * sess = generator.machines().at(0)->sessionlist.begin().value();
+    QVERIFY(!sess->eventsLoaded());
+    QVERIFY(sess->OpenEvents());
+    QVERIFY(sess->eventlist.contains(CPAP_FlowRate));
+    QVERIFY(!sess->eventlist.contains(CPAP_MaskPressure));
+    EventList * flow = sess->eventlist[CPAP_FlowRate].at(0);
+    QCOMPARE(qint64(flow->count()), (sess->realLast() - sess->realFirst()) * 5 / 1000);
+    QCOMPARE(flow->first(), sess->realFirst());
+    sess->TrashEvents();
+}
+
+// Uses the profile generated by testGenerate
+void ProfileGeneratorTests::testEventOverlay()
+{
+    Machine * mach = p_profile->GetMachines(MT_CPAP).at(0);
+    Session * sess = mach->sessionlist.begin().value();
+    QVERIFY(sess->OpenEvents());
+    QVERIFY(!QFile::exists(sess->overlayFile()));
+    int channels = sess->eventlist.size() + 1;
+    if (sess->eventlist.contains(CPAP_RERA)) {
+        channels--;
+    }
+    qint64 size = QFileInfo(sess->eventFile()).size();
+
+    // A small edit goes to the overlay and leaves the events file alone
+    sess->destroyEvent(CPAP_RERA);
+    EventList * flags = sess->AddEventList(CPAP_UserFlag1, EVL_Event);
+    flags->AddEvent(sess->realFirst() + 60000, 10);
+    QVERIFY(sess->StoreEvents());
+    QVERIFY(QFile::exists(sess->overlayFile()));
+    QCOMPARE(QFileInfo(sess->eventFile()).size(), size);
+    QVERIFY(QFileInfo(sess->overlayFile()).size() < size);
+    sess->TrashEvents();
+
+    // Reading it back merges the overlay over the events file
+    QVERIFY(sess->OpenEvents());
+    QCOMPARE(sess->eventlist.size(), channels);
+    QVERIFY(!sess->eventlist.contains(CPAP_RERA));
+    QVERIFY(sess->eventlist.contains(CPAP_UserFlag1));
+    QCOMPARE(sess->eventlist[CPAP_UserFlag1].at(0)->count(), quint32(1));
+    QVERIFY(sess->eventlist.contains(CPAP_FlowRate));
+    sess->TrashEvents();
+
+    // Compaction folds the overlay back in
+    QVERIFY(sess->CompactEvents());
+    QVERIFY(!QFile::exists(sess->overlayFile()));
+    QVERIFY(!sess->eventsLoaded());
+    QVERIFY(sess->OpenEvents());
+    QCOMPARE(sess->eventlist.size(), channels);
+    QVERIFY(!sess->eventlist.contains(CPAP_RERA));
+    QVERIFY(sess->eventlist.contains(CPAP_UserFlag1));
+    sess->TrashEvents();
+}
+
+// Uses the profile generated by testGenerate
+void ProfileGeneratorTests::testRecalculatedChannels()
+{
+    Machine * mach = p_profile->GetMachines(MT_CPAP).at(0);
+    Session * sess = mach->sessionlist.begin().value();
+
+    // Drop the AHI graph, and fold that back into the events file
+    QVERIFY(sess->OpenEvents());
+    sess->destroyEvent(CPAP_AHI);
+    sess->destroyEvent(CPAP_RDI);
+    QVERIFY(sess->StoreEvents());
+    sess->TrashEvents();
+    QVERIFY(sess->CompactEvents());
+    QVERIFY(!QFile::exists(sess->overlayFile()));
+
+    // Recalculating it for a session read from disk has to be stored, not skipped as unchanged
+    QVERIFY(sess->OpenEvents());
+    QVERIFY(!sess->eventlist.contains(CPAP_AHI));
+    calcAHIGraph(sess);
+    QVERIFY(sess->eventlist.contains(CPAP_AHI));
+    QVERIFY(sess->StoreEvents());
+    QVERIFY(QFile::exists(sess->overlayFile()));
+    sess->TrashEvents();
+
+    QVERIFY(sess->OpenEvents());
+    QVERIFY(sess->eventlist.contains(CPAP_AHI));
+    sess->TrashEvents();
+}
+
+// Also uses the profile generated by testGenerate
+void ProfileGeneratorTests::testIntegrity()
+{
+    Machine * mach = p_profile->GetMachines(MT_CPAP).at(0);
+    IntegrityScanner clean(mach);
+    clean.scan(true);
+    QVERIFY(clean.filesChecked() > mach->sessionlist.size());
+    QVERIFY2(clean.issues().isEmpty(), qPrintable(clean.report().join("\n")));
+
+    // Flip a byte in the middle of one events file, and leave a copy of it with no summary
+    Session * sess = mach->sessionlist.begin().value();
+    QString orphan = mach->getEventsPath() + "00000001.001";
+    QVERIFY(QFile::copy(sess->eventFile(), orphan));
+
+    QFile file(sess->eventFile());
+    QVERIFY(file.open(QIODevice::ReadWrite));
+    QByteArray data = file.readAll();
+    data[data.size() / 2] = char(data.at(data.size() / 2) ^ 0x55);
+    file.seek(0);
+    file.write(data);
+    file.close();
+
+    IntegrityScanner scanner(mach);
+    scanner.scan(true);
+    QCOMPARE(scanner.issues().size(), 2);
+    for (const auto & issue : scanner.issues()) {
+        if (issue.kind == IntegrityIssue::Corrupt) {
+            QCOMPARE(issue.filename, sess->eventFile());
+        } else {
+            QCOMPARE(issue.kind, IntegrityIssue::Orphaned);
+            QCOMPARE(issue.filename, orphan);
+        }
+    }
+    QVERIFY(QFile::remove(orphan));
+}
+
+// Loaders remove a session from its Day and delete it when replacing summary-only data, so the
+// machine's session index has to let go of it too before its replacement is added.
+void ProfileGeneratorTests::testRemoveSession()
+{
+    Machine * mach = p_profile->GetMachines(MT_CPAP).at(0);
+    Session * sess = mach->sessionIndex().sessions().last();
+    QDate date = mach->sessionIndex().date(sess);
+    Day * day = p_profile->GetDay(date, MT_CPAP);
+    QVERIFY(day != nullptr);
+
+    SessionID id = sess->session();
+    qint64 first = sess->first();
+    qint64 last = sess->last();
+    QVERIFY(day->removeSession(sess));
+    QVERIFY(!mach->sessionIndex().contains(sess));
+    QVERIFY(!mach->sessionlist.contains(id));
+    delete sess;
+
+    Session * replacement = new Session(mach, id);
+    replacement->really_set_first(first);
+    replacement->really_set_last(last);
+    QVERIFY(mach->AddSession(replacement));
+    QCOMPARE(mach->sessionIndex().date(replacement), date);
+    QCOMPARE(mach->sessionIndex().sessionsOn(date).count(replacement), 1);
+}
+
+// Set OSCAR_SYNTHETIC_NIGHTS to fill testdata/synthetic/Profiles/Synthetic with that many
+// nights at full sample rates, for timing startup, Overview, Statistics and export at scale.
+void ProfileGeneratorTests::testGenerateLarge()
+{
+    int nights = qgetenv("OSCAR_SYNTHETIC_NIGHTS").toInt();
+    if (nights <= 0) {
+        QSKIP("OSCAR_SYNTHETIC_NIGHTS not set");
+    }
+
+    delete p_profile;
+    p_profile = ProfileGenerator::createProfile(TESTDATA_PATH "synthetic/", "Synthetic");
+
+    ProfileGenerator::Options options;
+    options.firstNight = QDate::currentDate().addDays(-nights);
+    options.nights = nights;
+    options.cpapMachines = qMax(1, nights / 730);
+    options.oximetry = true;
+
+    ProfileGenerator generator(p_profile, options);
+    QVERIFY(generator.generate());
+}
@@ -0,0 +1,31 @@
+/* Synthetic Profile Generator Tests
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef PROFILEGENERATORTESTS_H
+#define PROFILEGENERATORTESTS_H
+
+#include "AutoTest.h"
+
+class ProfileGeneratorTests : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void testGenerate();
+    void testEventOverlay();
+    void testRecalculatedChannels();
+    void testIntegrity();
+    void testRemoveSession();
+    void testGenerateLarge();
+    void cleanupTestCase();
+};
+
+DECLARE_TEST(ProfileGeneratorTests)
+
+#endif // PROFILEGENERATORTESTS_H
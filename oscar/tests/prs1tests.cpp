@@ -8,6 +8,7 @@
 
 #include "prs1tests.h"
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 #define TESTDATA_PATH "./testdata/"
 
@@ -16,6 +17,9 @@ static void iterateTestCards(const QString & root, void (*action)(const QString
 static QString prs1OutputPath(const QString & inpath, const QString & serial, const QString & basename, const QString & suffix);
 static QString prs1OutputPath(const QString & inpath, const QString & serial, int session, const QString & suffix);
 
+// Event chunks from every test card, keyed by family and version, for benchmarkParseEvents
+static QMap<QString, QList<PRS1DataChunk *>> s_eventChunks;
+
 void PRS1Tests::initTestCase(void)
 {
     p_profile = new Profile(TESTDATA_PATH "profile/", false);
@@ -27,6 +31,11 @@ void PRS1Tests::initTestCase(void)
 
 void PRS1Tests::cleanupTestCase(void)
 {
+    for (auto & chunks : s_eventChunks) {
+        qDeleteAll(chunks);
+    }
+    s_eventChunks.clear();
+
     delete p_profile;
     p_profile = nullptr;
 }
@@ -118,7 +127,9 @@ void parseAndEmitSessionYaml(const QString & path)
 
 void PRS1Tests::testSessionsToYaml()
 {
+    RegressionGate gate("prs1");
     iterateTestCards(TESTDATA_PATH "prs1/input/", parseAndEmitSessionYaml);
+    gate.finish();
 }
 
 
@@ -366,6 +377,64 @@ void PRS1Tests::testChunksToYaml()
 }
 
 
+// ====================================================================================================
+
+void collectEventChunks(const QString & path)
+{
+    QStringList paths;
+    QString propertyfile;
+    s_loader->FindSessionDirsAndProperties(path, paths, propertyfile);
+
+    Machine *m = s_loader->CreateMachineFromProperties(propertyfile);
+    if (m == nullptr) {
+        return;
+    }
+
+    for (auto & p : paths) {
+        QDir dir(p);
+        for (auto & fi : dir.entryInfoList(QStringList() << "*.002", QDir::Files, QDir::Name)) {
+            QList<PRS1DataChunk *> chunks = s_loader->ParseFile(fi.canonicalFilePath());
+            for (auto & chunk : chunks) {
+                s_eventChunks[QString("F%1V%2").arg(chunk->family).arg(chunk->familyVersion)] += chunk;
+            }
+        }
+    }
+
+    p_profile->removeMachine(m);
+    delete m;
+}
+
+void PRS1Tests::benchmarkParseEvents_data()
+{
+    if (s_eventChunks.isEmpty()) {
+        iterateTestCards(TESTDATA_PATH "prs1/input/", collectEventChunks);
+    }
+    if (s_eventChunks.isEmpty()) {
+        QSKIP("No PRS1 event data in the test cards");
+    }
+
+    QTest::addColumn<QString>("format");
+    for (auto & format : s_eventChunks.keys()) {
+        QTest::newRow(format.toLatin1().constData()) << format;
+    }
+}
+
+// Times the event parser for each family and version against the same chunks as testChunksToYaml
+void PRS1Tests::benchmarkParseEvents()
+{
+    QFETCH(QString, format);
+    const QList<PRS1DataChunk *> & chunks = s_eventChunks[format];
+    qDebug().noquote() << format << chunks.size() << "chunks";
+
+    QBENCHMARK {
+        for (auto & chunk : chunks) {
+            chunk->ParseEvents();
+            _PRS1ClearParsedEvents(chunk);
+        }
+    }
+}
+
+
 // ====================================================================================================
 
 QString prs1OutputPath(const QString & inpath, const QString & serial, int session, const QString & suffix)
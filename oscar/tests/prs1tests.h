@@ -21,6 +21,8 @@ private slots:
     void testMachineSupport();
     void testChunksToYaml();
     void testSessionsToYaml();
+    void benchmarkParseEvents_data();
+    void benchmarkParseEvents();
     // void test2();
     void cleanupTestCase();
 };
@@ -0,0 +1,253 @@
+/* Golden Output and Performance Regression Gate
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QtTest>
+
+#include "regressiongate.h"
+#include "../SleepLib/session.h"
+
+#define TESTDATA_PATH "./testdata/"
+
+// Differences smaller than this are scheduling noise, not regressions
+static const qint64 TIMING_NOISE_MS = 5;
+
+RegressionGate * RegressionGate::s_active = nullptr;
+
+RegressionGate::RegressionGate(const QString & loader)
+    : m_loader(loader), m_finished(false)
+{
+    m_outputRoot = QDir::cleanPath(TESTDATA_PATH + loader + "/output") + "/";
+    m_expectedRoot = QDir::cleanPath(TESTDATA_PATH + loader + "/expected") + "/";
+
+    bool ok;
+    m_threshold = QString::fromLocal8Bit(qgetenv("OSCAR_PERF_THRESHOLD")).toDouble(&ok);
+    if (!ok || (m_threshold <= 0)) {
+        m_threshold = 0.25;
+    }
+    // Wall clock times are only steady enough to fail on in the optimised benchmark build
+    QByteArray gate = qgetenv("OSCAR_PERF_GATE");
+#ifdef OSCAR_BENCHMARK
+    m_enforceTiming = (gate != "0");
+#else
+    m_enforceTiming = (gate == "1");
+#endif
+    m_recording = (qgetenv("OSCAR_GATE_RECORD") == "1");
+
+    if (!loadBaseline()) {
+        qDebug() << "No performance baseline for" << loader << "yet";
+    }
+
+    Q_ASSERT(s_active == nullptr);
+    s_active = this;
+    m_timer.start();
+}
+
+RegressionGate::~RegressionGate()
+{
+    if (!m_finished) {
+        qWarning() << "RegressionGate for" << m_loader << "destroyed without finish()";
+    }
+    if (s_active == this) {
+        s_active = nullptr;
+    }
+}
+
+void RegressionGate::recordOutput(const QString & filepath, Session * session)
+{
+    if (s_active) {
+        s_active->record(filepath, session);
+    }
+}
+
+QString RegressionGate::fixtureName(const QString & filepath) const
+{
+    QString path = QDir::cleanPath(filepath);
+    int idx = path.indexOf(m_outputRoot);
+    if (idx >= 0) {
+        return path.mid(idx + m_outputRoot.size());
+    }
+    return QFileInfo(path).fileName();
+}
+
+qint64 RegressionGate::footprint(EventList * el)
+{
+    // Sizes rather than capacities, as pooled buffers can be handed out larger than asked for
+    return el->getData().size() * qint64(sizeof(EventStoreType))
+         + el->getData2().size() * qint64(sizeof(EventStoreType))
+         + el->getTime().size() * qint64(sizeof(quint32));
+}
+
+qint64 RegressionGate::footprint(Session * session)
+{
+    qint64 bytes = 0;
+    for (auto it = session->eventlist.begin(); it != session->eventlist.end(); ++it) {
+        for (EventList * el : it.value()) {
+            bytes += footprint(el);
+        }
+    }
+    return bytes;
+}
+
+qint64 RegressionGate::reserved(EventList * el)
+{
+    return el->getData().capacity() * qint64(sizeof(EventStoreType))
+         + el->getData2().capacity() * qint64(sizeof(EventStoreType))
+         + el->getTime().capacity() * qint64(sizeof(quint32));
+}
+
+qint64 RegressionGate::reserved(Session * session)
+{
+    qint64 bytes = 0;
+    for (auto it = session->eventlist.begin(); it != session->eventlist.end(); ++it) {
+        for (EventList * el : it.value()) {
+            bytes += reserved(el);
+        }
+    }
+    return bytes;
+}
+
+void RegressionGate::record(const QString & filepath, Session * session)
+{
+    QString fixture = fixtureName(filepath);
+
+    Measurement & m = m_current[fixture];
+    m.msecs += m_timer.elapsed();
+    m.bytes += footprint(session);
+
+    QFile expected(m_expectedRoot + fixture);
+    if (!expected.open(QFile::ReadOnly)) {
+        m_missing.append(fixture);
+    } else {
+        QFile actual(filepath);
+        if (!actual.open(QFile::ReadOnly)) {
+            m_diffs.append(fixture + ": output could not be read back");
+        } else {
+            // Report the first differing line, which is usually enough to see what moved
+            int line = 1;
+            while (!expected.atEnd() || !actual.atEnd()) {
+                QByteArray e = expected.readLine();
+                QByteArray a = actual.readLine();
+                if (e != a) {
+                    m_diffs.append(QString("%1:%2: expected \"%3\", got \"%4\"")
+                                   .arg(fixture).arg(line)
+                                   .arg(QString(e.trimmed())).arg(QString(a.trimmed())));
+                    break;
+                }
+                line++;
+            }
+        }
+    }
+
+    // Comparison time isn't part of the next fixture
+    m_timer.restart();
+}
+
+bool RegressionGate::loadBaseline()
+{
+    QFile file(TESTDATA_PATH + m_loader + "/baseline.tsv");
+    if (!file.open(QFile::ReadOnly | QFile::Text)) {
+        return false;
+    }
+    QTextStream in(&file);
+    while (!in.atEnd()) {
+        QStringList fields = in.readLine().split('\t');
+        if ((fields.size() < 3) || fields[0].startsWith('#')) {
+            continue;
+        }
+        Measurement & m = m_baseline[fields[0]];
+        m.msecs = fields[1].toLongLong();
+        m.bytes = fields[2].toLongLong();
+    }
+    return true;
+}
+
+bool RegressionGate::saveBaseline() const
+{
+    QDir().mkpath(m_outputRoot);
+    QFile file(m_outputRoot + "baseline.tsv");
+    if (!file.open(QFile::WriteOnly | QFile::Truncate | QFile::Text)) {
+        return false;
+    }
+    QTextStream out(&file);
+    out << "# fixture\tmsecs\tbytes" << endl;
+    for (auto it = m_current.constBegin(); it != m_current.constEnd(); ++it) {
+        out << it.key() << "\t" << it.value().msecs << "\t" << it.value().bytes << endl;
+    }
+    return true;
+}
+
+void RegressionGate::finish()
+{
+    m_finished = true;
+    if (s_active == this) {
+        s_active = nullptr;
+    }
+
+    Measurement total, baseTotal;
+    QStringList unmeasured;
+    for (auto it = m_current.constBegin(); it != m_current.constEnd(); ++it) {
+        const Measurement & cur = it.value();
+        total.msecs += cur.msecs;
+        total.bytes += cur.bytes;
+
+        auto bit = m_baseline.constFind(it.key());
+        if (bit == m_baseline.constEnd()) {
+            unmeasured.append(it.key());
+            continue;
+        }
+        const Measurement & base = bit.value();
+        baseTotal.msecs += base.msecs;
+        baseTotal.bytes += base.bytes;
+
+        if ((cur.msecs > base.msecs * (1.0 + m_threshold)) && ((cur.msecs - base.msecs) > TIMING_NOISE_MS)) {
+            m_slower.append(QString("%1: %2 ms, baseline %3 ms").arg(it.key()).arg(cur.msecs).arg(base.msecs));
+        }
+        if (cur.bytes > base.bytes) {
+            m_regressions.append(QString("%1: EventList storage grew to %2 bytes, baseline %3 bytes").arg(it.key()).arg(cur.bytes).arg(base.bytes));
+        }
+    }
+
+    if (!saveBaseline()) {
+        qWarning() << "Could not write" << m_outputRoot + "baseline.tsv";
+    }
+
+    qDebug().noquote() << QString("%1: %2 fixtures in %3 ms (baseline %4 ms), %5 bytes of EventList storage")
+                          .arg(m_loader).arg(m_current.size()).arg(total.msecs).arg(baseTotal.msecs).arg(total.bytes);
+    for (const QString & fixture : m_missing) {
+        qWarning().noquote() << "MISSING expected output" << fixture;
+    }
+    for (const QString & fixture : unmeasured) {
+        qWarning().noquote() << "MISSING baseline" << fixture;
+    }
+    for (const QString & diff : m_diffs) {
+        qWarning().noquote() << "DIFF" << diff;
+    }
+    for (const QString & reg : m_regressions) {
+        qWarning().noquote() << "REGRESSION" << reg;
+    }
+    for (const QString & reg : m_slower) {
+        qWarning().noquote() << (m_enforceTiming ? "REGRESSION" : "SLOWER") << reg;
+    }
+
+    if (m_current.isEmpty()) {
+        QSKIP(qPrintable(QString("No %1 test data under %2, so there is nothing to compare").arg(m_loader).arg(TESTDATA_PATH)));
+    }
+    if (!m_recording) {
+        QString hint = QString("run with OSCAR_GATE_RECORD=1 and promote %1").arg(m_outputRoot);
+        QVERIFY2(m_missing.isEmpty(), qPrintable(QString("%1 %2 fixtures have no expected output, %3").arg(m_missing.size()).arg(m_loader).arg(hint)));
+        QVERIFY2(unmeasured.isEmpty(), qPrintable(QString("%1 %2 fixtures have no baseline, %3").arg(unmeasured.size()).arg(m_loader).arg(hint)));
+    }
+    QVERIFY2(m_diffs.isEmpty(), qPrintable(QString("%1 output differences in %2").arg(m_diffs.size()).arg(m_loader)));
+    QVERIFY2(m_regressions.isEmpty(), qPrintable(QString("%1 storage regressions in %2").arg(m_regressions.size()).arg(m_loader)));
+    if (m_enforceTiming) {
+        QVERIFY2(m_slower.isEmpty(), qPrintable(QString("%1 timing regressions in %2").arg(m_slower.size()).arg(m_loader)));
+    }
+}
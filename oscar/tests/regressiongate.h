@@ -0,0 +1,93 @@
+/* Golden Output and Performance Regression Gate
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef REGRESSIONGATE_H
+#define REGRESSIONGATE_H
+
+#include <QString>
+#include <QStringList>
+#include <QMap>
+#include <QElapsedTimer>
+
+class Session;
+class EventList;
+
+/*! \class RegressionGate
+    \brief Checks loader test output against golden files and recorded performance baselines
+
+    While a gate is active, every file written by SessionToYaml is compared byte for byte with
+    the matching file under testdata/LOADER/expected/, and the time taken to produce it (since
+    the previous output) and the EventList storage it holds are measured.
+
+    Measurements are compared with testdata/LOADER/baseline.tsv. A fixture fails when its output
+    differs or it holds more EventList samples than before. Being slower than its baseline by more
+    than the threshold (OSCAR_PERF_THRESHOLD, a fraction, 0.25 by default) is always reported, but
+    only fails the benchmark build, or any build with OSCAR_PERF_GATE=1, as debug builds with memory
+    checking are too noisy to time. OSCAR_PERF_GATE=0 turns it off in the benchmark build too.
+    Timings within a few milliseconds of the baseline are treated as noise.
+
+    A fixture with no golden file or baseline fails, unless OSCAR_GATE_RECORD=1 is set. The current
+    measurements are always written to testdata/LOADER/output/baseline.tsv, so recording a new
+    loader means copying that and the output files into place. Without any test data at all the
+    test is skipped rather than passed.
+    */
+class RegressionGate
+{
+  public:
+    //! \brief Activates a gate for loader, eg "prs1", which reads testdata/prs1/baseline.tsv
+    RegressionGate(const QString & loader);
+    ~RegressionGate();
+
+    //! \brief Called by SessionToYaml once filepath has been written for session
+    static void recordOutput(const QString & filepath, Session * session);
+
+    //! \brief Writes the new baseline, reports, and fails the current test on any regression
+    void finish();
+
+    //! \brief Bytes used by the samples of el, or of all of session's EventLists
+    static qint64 footprint(EventList * el);
+    static qint64 footprint(Session * session);
+
+    //! \brief Bytes reserved by the storage of el or session, which depends on the event buffer pool's state
+    static qint64 reserved(EventList * el);
+    static qint64 reserved(Session * session);
+
+  protected:
+    struct Measurement {
+        Measurement() : msecs(0), bytes(0) {}
+        qint64 msecs;
+        qint64 bytes;
+    };
+
+    void record(const QString & filepath, Session * session);
+    QString fixtureName(const QString & filepath) const;
+    bool loadBaseline();
+    bool saveBaseline() const;
+
+    QString m_loader;
+    QString m_outputRoot;
+    QString m_expectedRoot;
+
+    QMap<QString, Measurement> m_baseline;
+    QMap<QString, Measurement> m_current;
+
+    QStringList m_diffs;
+    QStringList m_regressions;
+    QStringList m_slower;
+    QStringList m_missing;
+
+    QElapsedTimer m_timer;
+    double m_threshold;
+    bool m_enforceTiming;
+    bool m_recording;
+    bool m_finished;
+
+    static RegressionGate * s_active;
+};
+
+#endif // REGRESSIONGATE_H
@@ -8,6 +8,7 @@
 
 #include "resmedtests.h"
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 #define TESTDATA_PATH "./testdata/"
 
@@ -62,7 +63,9 @@ static void parseAndEmitSessionYaml(const QString & path)
 
 void ResmedTests::testSessionsToYaml()
 {
+    RegressionGate gate("resmed");
     iterateTestCards(TESTDATA_PATH "resmed/input/", parseAndEmitSessionYaml);
+    gate.finish();
 }
 
 
@@ -8,6 +8,7 @@
 
 #include <QFile>
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 static QString ts(qint64 msecs)
 {
@@ -344,4 +345,6 @@ void SessionToYaml(QString filepath, Session* session, bool ok)
         }
     }
     file.close();
+
+    RegressionGate::recordOutput(filepath, session);
 }
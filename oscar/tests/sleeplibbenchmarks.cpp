@@ -0,0 +1,290 @@
+/* SleepLib Core Benchmarks
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QVector>
+
+#include "sleeplibbenchmarks.h"
+#include "profilegenerator.h"
+#include "regressiongate.h"
+#include "../SleepLib/profiles.h"
+#include "../SleepLib/machine.h"
+#include "../SleepLib/session.h"
+#include "../SleepLib/day.h"
+#include "../SleepLib/calcs.h"
+#include "../SleepLib/schema.h"
+
+#define TESTDATA_PATH "./testdata/"
+
+// Fixed timestamp so the synthetic lists are the same size every run
+const qint64 bench_start = 1577836800000L;  // 2020-01-01 UTC
+
+// Number of lookups made per iteration by the range and search benchmarks
+const int bench_lookups = 1000;
+
+/*! \class OpMeter
+    \brief Reports the cost of a single operation, alongside QBENCHMARK's time per iteration
+
+    Created just before a QBENCHMARK block, it times every iteration of the block and prints the
+    average nanoseconds and bytes for each operation counted by add(). Bytes are the EventList
+    storage the operation leaves reserved, which is what dominates OSCAR's memory use.
+    */
+class OpMeter
+{
+  public:
+    OpMeter() : m_ops(0), m_bytes(0) { m_timer.start(); }
+    ~OpMeter() {
+        if (m_ops <= 0) {
+            return;
+        }
+        QString name = QTest::currentTestFunction();
+        if (QTest::currentDataTag()) {
+            name += QString(":") + QTest::currentDataTag();
+        }
+        qDebug().noquote() << QString("%1: %2 ns/op, %3 bytes/op over %4 ops").arg(name)
+                              .arg(double(m_timer.nsecsElapsed()) / m_ops, 0, 'f', 1)
+                              .arg(m_bytes / m_ops).arg(m_ops);
+    }
+
+    inline void add(qint64 ops, qint64 bytes = 0) { m_ops += ops; m_bytes += bytes; }
+
+  protected:
+    QElapsedTimer m_timer;
+    qint64 m_ops;
+    qint64 m_bytes;
+};
+
+void SleepLibBenchmarks::initTestCase(void)
+{
+    p_pref = new Preferences("Preferences");
+    schema::init();
+
+    p_profile = ProfileGenerator::createProfile(TESTDATA_PATH "synthetic/", "Benchmark");
+
+    // Two weeks of single session nights at full sample rates
+    ProfileGenerator::Options options;
+    options.nights = 14;
+    options.maxFragments = 1;
+    options.skipChance = 0;
+    options.seed = 85;
+
+    ProfileGenerator generator(p_profile, options);
+    QVERIFY(generator.generate());
+
+    m_first = options.firstNight;
+    m_last = options.firstNight.addDays(options.nights - 1);
+    m_day = p_profile->GetDay(m_first, MT_CPAP);
+    QVERIFY(m_day != nullptr);
+    QCOMPARE(m_day->size(), 1);
+
+    m_session = m_day->sessions.at(0);
+    QVERIFY(m_session->OpenEvents());
+    qDebug() << "Benchmark session" << m_session->session() << "covers" << m_session->hours() << "hours";
+}
+
+void SleepLibBenchmarks::cleanupTestCase(void)
+{
+    delete p_profile;
+    p_profile = nullptr;
+    delete p_pref;
+    p_pref = nullptr;
+    ProfileGenerator::restoreAppData();
+}
+
+
+// ====================================================================================================
+
+void SleepLibBenchmarks::benchmarkAddEvent_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::newRow("1k") << 1000;
+    QTest::newRow("100k") << 100000;
+}
+
+void SleepLibBenchmarks::benchmarkAddEvent()
+{
+    QFETCH(int, count);
+
+    OpMeter meter;
+    QBENCHMARK {
+        EventList el(EVL_Event);
+        for (int i = 0; i < count; ++i) {
+            el.AddEvent(bench_start + i * 1000L, EventStoreType(i & 0x7fff));
+        }
+        meter.add(count, RegressionGate::reserved(&el));
+    }
+}
+
+void SleepLibBenchmarks::benchmarkAddWaveform_data()
+{
+    QTest::addColumn<int>("chunk");
+    QTest::newRow("whole night") << 720000;
+    QTest::newRow("minutes") << 1500;
+    QTest::newRow("seconds") << 25;
+}
+
+// 8 hours of 25Hz samples, added in chunks of different sizes. Ops are samples.
+void SleepLibBenchmarks::benchmarkAddWaveform()
+{
+    QFETCH(int, chunk);
+    const int samples = 720000;
+    const double rate = 40;
+
+    QVector<qint16> buffer(samples);
+    for (int i = 0; i < samples; ++i) {
+        buffer[i] = qint16(i % 1000);
+    }
+
+    OpMeter meter;
+    QBENCHMARK {
+        EventList el(EVL_Waveform, 0.02F, 0, 0, 0, rate);
+        for (int i = 0; i < samples; i += chunk) {
+            el.AddWaveform(bench_start + qint64(i * rate), buffer.data() + i, chunk, qint64(chunk * rate));
+        }
+        meter.add(samples, RegressionGate::reserved(&el));
+    }
+}
+
+// Bytes are the size of the written events file
+void SleepLibBenchmarks::benchmarkStoreEvents()
+{
+    OpMeter meter;
+    QBENCHMARK {
+        QVERIFY(m_session->StoreEvents());
+        meter.add(1, QFileInfo(m_session->eventFile()).size());
+    }
+}
+
+void SleepLibBenchmarks::benchmarkLoadEvents()
+{
+    OpMeter meter;
+    QBENCHMARK {
+        m_session->TrashEvents();
+        QVERIFY(m_session->LoadEvents(m_session->eventFile()));
+        meter.add(1, RegressionGate::reserved(m_session));
+    }
+    QVERIFY(m_session->OpenEvents());
+}
+
+void SleepLibBenchmarks::benchmarkRangeCount()
+{
+    qint64 span = m_session->realLast() - m_session->realFirst() - 3600000L;
+
+    OpMeter meter;
+    QBENCHMARK {
+        for (int i = 0; i < bench_lookups; ++i) {
+            qint64 start = m_session->realFirst() + span * i / bench_lookups;
+            m_session->rangeCount(CPAP_Obstructive, start, start + 3600000L);
+        }
+        meter.add(bench_lookups);
+    }
+}
+
+void SleepLibBenchmarks::benchmarkRangeSum()
+{
+    qint64 span = m_session->realLast() - m_session->realFirst() - 3600000L;
+
+    OpMeter meter;
+    QBENCHMARK {
+        for (int i = 0; i < bench_lookups; ++i) {
+            qint64 start = m_session->realFirst() + span * i / bench_lookups;
+            m_session->rangeSum(CPAP_Pressure, start, start + 3600000L);
+        }
+        meter.add(bench_lookups);
+    }
+}
+
+void SleepLibBenchmarks::benchmarkSearchValue_data()
+{
+    QTest::addColumn<ChannelID>("code");
+    QTest::newRow("flow 25Hz") << CPAP_FlowRate;
+    QTest::newRow("pressure 0.5Hz") << CPAP_Pressure;
+}
+
+void SleepLibBenchmarks::benchmarkSearchValue()
+{
+    QFETCH(ChannelID, code);
+    qint64 span = m_session->realLast() - m_session->realFirst();
+
+    OpMeter meter;
+    QBENCHMARK {
+        for (int i = 0; i < bench_lookups; ++i) {
+            m_session->SearchValue(code, m_session->realFirst() + span * i / bench_lookups, true);
+        }
+        meter.add(bench_lookups);
+    }
+}
+
+// A mouse sweeping across a night, with several graphs reading the same channels at each position
+void SleepLibBenchmarks::benchmarkCursorSweep()
+{
+    const QList<ChannelID> codes = { CPAP_FlowRate, CPAP_Pressure, CPAP_Leak, CPAP_RespRate, CPAP_Hypopnea };
+    qint64 span = m_session->last() - m_session->first();
+
+    OpMeter meter;
+    QBENCHMARK {
+        for (int i = 0; i < bench_lookups; ++i) {
+            qint64 time = m_session->first() + span * i / bench_lookups;
+            for (int graph = 0; graph < 3; ++graph) {
+                for (ChannelID code : codes) {
+                    m_day->lookupValue(code, time, false);
+                }
+            }
+        }
+        meter.add(bench_lookups);
+    }
+}
+
+void SleepLibBenchmarks::benchmarkDayPercentile()
+{
+    OpMeter meter;
+    QBENCHMARK {
+        m_day->percentile(CPAP_Pressure, 0.95F);
+        meter.add(1);
+    }
+}
+
+void SleepLibBenchmarks::benchmarkProfilePercentile()
+{
+    OpMeter meter;
+    QBENCHMARK {
+        p_profile->calcPercentile(CPAP_Pressure, 0.95F, MT_CPAP, m_first, m_last);
+        meter.add(1);
+    }
+}
+
+void SleepLibBenchmarks::benchmarkAHIGraph()
+{
+    OpMeter meter;
+    QBENCHMARK {
+        calcAHIGraph(m_session);
+        meter.add(1);
+    }
+}
+
+// Ops are flow samples. Runs last, as it replaces the session's respiratory waveforms.
+void SleepLibBenchmarks::benchmarkFlowParser()
+{
+    QVERIFY(m_session->eventlist.contains(CPAP_FlowRate));
+    EventList * flow = m_session->eventlist[CPAP_FlowRate].at(0);
+
+    FlowParser parser;
+    OpMeter meter;
+    QBENCHMARK {
+        parser.openFlow(m_session, flow);
+        parser.calc(true, true, true, true, true);
+        meter.add(flow->count());
+
+        m_session->destroyEvent(CPAP_RespRate);
+        m_session->destroyEvent(CPAP_TidalVolume);
+        m_session->destroyEvent(CPAP_MinuteVent);
+        m_session->destroyEvent(CPAP_Ti);
+        m_session->destroyEvent(CPAP_Te);
+    }
+}
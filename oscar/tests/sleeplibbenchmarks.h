@@ -0,0 +1,51 @@
+/* SleepLib Core Benchmarks
+ *
+ * Copyright (c) 2020 The OSCAR Team
+ *
+ * This file is subject to the terms and conditions of the GNU General Public
+ * License. See the file COPYING in the main directory of the source code
+ * for more details. */
+
+#ifndef SLEEPLIBBENCHMARKS_H
+#define SLEEPLIBBENCHMARKS_H
+
+#include <QDate>
+
+#include "AutoTest.h"
+
+class Session;
+class Day;
+
+class SleepLibBenchmarks : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void benchmarkAddEvent_data();
+    void benchmarkAddEvent();
+    void benchmarkAddWaveform_data();
+    void benchmarkAddWaveform();
+    void benchmarkStoreEvents();
+    void benchmarkLoadEvents();
+    void benchmarkRangeCount();
+    void benchmarkRangeSum();
+    void benchmarkSearchValue_data();
+    void benchmarkSearchValue();
+    void benchmarkCursorSweep();
+    void benchmarkDayPercentile();
+    void benchmarkProfilePercentile();
+    void benchmarkAHIGraph();
+    void benchmarkFlowParser();
+    void cleanupTestCase();
+
+private:
+    Session * m_session;
+    Day * m_day;
+    QDate m_first;
+    QDate m_last;
+};
+
+DECLARE_TEST(SleepLibBenchmarks)
+
+#endif // SLEEPLIBBENCHMARKS_H
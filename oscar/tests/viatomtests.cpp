@@ -8,6 +8,7 @@
 
 #include "viatomtests.h"
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 #define TESTDATA_PATH "./testdata/"
 
@@ -46,6 +47,7 @@ static void parseAndEmitSessionYaml(const QString & path)
 
 void ViatomTests::testSessionsToYaml()
 {
+    RegressionGate gate("viatom");
     static const QString root_path = TESTDATA_PATH "viatom/input/";
 
     QDir root(root_path);
@@ -60,6 +62,7 @@ void ViatomTests::testSessionsToYaml()
             parseAndEmitSessionYaml(fi.canonicalFilePath());
         }
     }
+    gate.finish();
 }
 
 
@@ -8,6 +8,7 @@
 
 #include "zeotests.h"
 #include "sessiontests.h"
+#include "regressiongate.h"
 
 #define TESTDATA_PATH "./testdata/"
 
@@ -56,6 +57,7 @@ static void parseAndEmitSessionYaml(const QString & path)
 
 void ZeoTests::testSessionsToYaml()
 {
+    RegressionGate gate("zeo");
     static const QString root_path = TESTDATA_PATH "zeo/input/";
 
     QDir root(root_path);
@@ -70,6 +72,7 @@ void ZeoTests::testSessionsToYaml()
             parseAndEmitSessionYaml(fi.canonicalFilePath());
         }
     }
+    gate.finish();
 }
 
 
@@ -7,6 +7,7 @@
  * License. See the file COPYING in the main directory of Source Code. */
 
 #include <cmath>
+#include <QFile>
 
 #include "welcome.h"
 #include "ui_welcome.h"
@@ -22,6 +23,7 @@ Welcome::Welcome(QWidget *parent) :
     ui->setupUi(this);
     pixmap.load(":/icons/mask.png");
 
+    connect(&calculator, SIGNAL(calculated()), this, SLOT(updateLatestNights()));
 
     refreshPage();
 }
@@ -31,7 +33,7 @@ Welcome::~Welcome()
     delete ui;
 }
 
-void Welcome::refreshPage()
+void Welcome::refreshPage(bool recalculate)
 {
     bool b;
 
@@ -82,10 +84,49 @@ void Welcome::refreshPage()
 
     mainwin->EnableTabs(b);
 
+    if (recalculate) {
+        latest.clear();
+        QFile::remove(LatestNights::fileName());
+    } else if (!latest.isValid()) {
+        latest.load(LatestNights::fileName());
+    }
+
+    if (!latest.matches(p_profile)) {
+        // Paint what we have now, and fill in the figures once they've been worked out
+        latest.clear();
+        calculator.start(p_profile);
+    }
+
     ui->cpapInfo->setHtml(GenerateCPAPHTML());
     ui->oxiInfo->setHtml(GenerateOxiHTML());
 }
 
+void Welcome::showEvent(QShowEvent * event)
+{
+    QWidget::showEvent(event);
+
+    // Sessions may have been toggled in Daily since the figures were worked out
+    if (p_profile && latest.isValid() && !latest.matches(p_profile)) {
+        refreshPage();
+    }
+}
+
+void Welcome::updateLatestNights()
+{
+    if (!p_profile) {
+        return;
+    }
+    if (!calculator.result().matches(p_profile)) {
+        // Sessions changed while the figures were being worked out
+        calculator.start(p_profile);
+        return;
+    }
+    latest = calculator.result();
+    latest.save(LatestNights::fileName());
+
+    ui->cpapInfo->setHtml(GenerateCPAPHTML());
+}
+
 void Welcome::on_dailyButton_clicked()
 {
 
@@ -113,10 +154,6 @@ void Welcome::on_importButton_clicked()
 }
 
 
-extern EventDataType calcAHI(QDate start, QDate end);
-extern EventDataType calcFL(QDate start, QDate end);
-
-
 QString Welcome::GenerateCPAPHTML()
 {
     auto cpap_machines = p_profile->GetMachines(MT_CPAP);
@@ -155,25 +192,20 @@ QString Welcome::GenerateCPAPHTML()
     "</head>"
     "<body leftmargin=5 topmargin=10 rightmargin=5 bottommargin=5 vertical-align=center align=center>";
 
-    Machine * cpap = nullptr;
     if (!havecpapdata && !haveoximeterdata) {
         html += "<p>" + tr("It would be a good idea to check File->Preferences first,") + "<br />" +
                         tr("as there are some options that affect import.")+"</p>" +
         "<p>" + tr("Note that some preferences are forced when a ResMed machine is detected") + "</p>" +
         "<p>" + tr("First import can take a few minutes.") + "</p>";
+    } else if (!latest.isValid()) {
+        html += "<p>" + tr("Calculating your latest statistics...") + "</p>";
     } else {
-        QDate date = p_profile->LastDay(MT_CPAP);
-        Day *day = p_profile->GetDay(date, MT_CPAP);
+        QDate date = latest.cpapDate;
 
-        if (havecpapdata && day) {
-            cpap = day->machine(MT_CPAP);
-        }
-        if (day && (cpap != nullptr)) {
-            QString cpapimage = cpap->getPixmapPath();
+        if (havecpapdata && latest.hasCPAP) {
+            ui->cpapIcon->setPixmap(QPixmap(latest.pixmapPath));
 
-            ui->cpapIcon->setPixmap(QPixmap(cpapimage));
-
-            html+= "<b>"+tr("The last time you used your %1...").arg(cpap->brand()+" "+cpap->model())+"</b><br/>";
+            html+= "<b>"+tr("The last time you used your %1...").arg(latest.machineName)+"</b><br/>";
 
             int daysto = date.daysTo(QDate::currentDate());
             QString daystring;
@@ -183,7 +215,7 @@ QString Welcome::GenerateCPAPHTML()
 
             html += tr("was %1 (on %2)").arg(daystring).arg(date.toString(Qt::SystemLocaleLongDate)) + "<br/>";
 
-            EventDataType hours = day->hours(MT_CPAP);
+            EventDataType hours = latest.hours;
             html += "<br/>";
 
             int seconds = int(hours * 3600.0) % 60;
@@ -191,19 +223,15 @@ QString Welcome::GenerateCPAPHTML()
             int hour = hours;
             QString timestr = tr("%1 hours, %2 minutes and %3 seconds").arg(hour).arg(minutes).arg(seconds);
 
-            const EventDataType compliance_min = p_profile->cpap->m_complianceHours; // 4.0;
+            const EventDataType compliance_min = latest.complianceHours; // 4.0;
             if (hours > compliance_min) html += tr("Your machine was on for %1.").arg(timestr)+"<br/>";
             else html += tr("<font color = red>You only had the mask on for %1.</font>").arg(timestr)+"<br/>";
 
 
-            int averagedays = 7; // how many days to look back
-
-            QDate starttime = date.addDays(-averagedays);
-            QDate endtime = date.addDays(-1);
-
+            int averagedays = LatestNights::averageDays; // how many days to look back
 
-            EventDataType ahi = (day->count(CPAP_Obstructive) + day->count(CPAP_Hypopnea) + day->count(CPAP_ClearAirway) + day->count(CPAP_Apnea)) / hours;
-            EventDataType ahidays = calcAHI(starttime, endtime);
+            EventDataType ahi = latest.ahi;
+            EventDataType ahidays = latest.ahiAverage;
 
             const QString under = tr("under");
             const QString over = tr("over");
@@ -226,82 +254,45 @@ QString Welcome::GenerateCPAPHTML()
 
             html += "<br/>";
 
-            CPAPMode cpapmode = (CPAPMode)(int)day->settings_max(CPAP_Mode);
-            ChannelID pressChanID = day->getPressureChannelID();     // Get channel id for pressure that we should report
-            double perc= p_profile->general->prefCalcPercentile();
-
-            // When CPAP_PressureSet and CPAP_IPAPSet have data (used for percentiles, etc.)
-            // CPAP_Pressure and CPAP_IPAP are their corresponding settings channels.
-            ChannelID pressSettingChanID;
-            if (pressChanID == CPAP_PressureSet) {
-                pressSettingChanID = CPAP_Pressure;
-            } else if (pressChanID == CPAP_IPAPSet) {
-                pressSettingChanID = CPAP_IPAP;
-            } else {
-                pressSettingChanID = pressChanID;
-            }
-
-            ChannelID epapDataChanID = CPAP_EPAP;
-            if (day->channelHasData(CPAP_EPAPSet)) {
-                epapDataChanID = CPAP_EPAPSet;
-            }
+            CPAPMode cpapmode = (CPAPMode)latest.mode;
+            double perc = latest.percentile;
 
-            if (pressChanID == NoChannel) {
-                qWarning() << "Unable to find pressure channel for welcome summary!";
-            }
             if (cpapmode == MODE_CPAP) {
-                pressSettingChanID = CPAP_Pressure;  // DreamStation ventilators report EPAP/IPAP data, but the setting is Pressure
-                EventDataType pressure = day->settings_max(pressSettingChanID);
-                qDebug() << pressSettingChanID << pressure;
                 html += tr("Your CPAP machine used a constant %1 %2 of air")
-                        .arg(pressure)
-                        .arg(schema::channel[pressChanID].units());
+                        .arg(latest.pressure)
+                        .arg(latest.pressureUnits);
             } else if (cpapmode == MODE_APAP) {
-                EventDataType pressure = day->percentile(pressChanID, perc/100.0);
                 html += tr("Your pressure was under %1 %2 for %3% of the time.")
-                        .arg(pressure)
-                        .arg(schema::channel[pressChanID].units())
+                        .arg(latest.pressure)
+                        .arg(latest.pressureUnits)
                         .arg(perc);
             } else if (cpapmode == MODE_BILEVEL_FIXED) {
-//                pressSettingChanID = CPAP_IPAP;
-//                EventDataType ipap = day->settings_max(pressSettingChanID);
-//                EventDataType epap = day->settings_min(CPAP_EPAP);
                 html += tr("Your machine used a constant %1-%2 %3 of air.")
-                        .arg(day->validPressure(day->settings_min(CPAP_EPAP)))
-                        .arg(day->validPressure(day->settings_max(CPAP_IPAP)))
-                        .arg(schema::channel[CPAP_IPAP].units());
+                        .arg(Day::validPressure(latest.epap))
+                        .arg(Day::validPressure(latest.pressure))
+                        .arg(latest.pressureUnits);
             } else if (cpapmode == MODE_BILEVEL_AUTO_FIXED_PS) {
-                EventDataType ipap = day->percentile(pressChanID, perc/100.0);
-                EventDataType epap = day->percentile(epapDataChanID, perc/100.0);
                 html += tr("Your machine was under %1-%2 %3 for %4% of the time.")
-                        .arg(epap)
-                        .arg(ipap)
-                        .arg(schema::channel[pressChanID].units())
+                        .arg(latest.epap)
+                        .arg(latest.pressure)
+                        .arg(latest.pressureUnits)
                         .arg(perc);
             } else if (cpapmode == MODE_ASV || cpapmode == MODE_AVAPS){
-                EventDataType ipap = day->percentile(pressChanID, perc/100.0);
-                EventDataType epap = qRound(day->settings_wavg(CPAP_EPAP));
                 html += tr("Your EPAP pressure fixed at %1 %2.")
-                        .arg(epap)
-                        .arg(schema::channel[epapDataChanID].units())+"<br/>";
+                        .arg(latest.epap)
+                        .arg(latest.epapUnits)+"<br/>";
                 html += tr("Your IPAP pressure was under %1 %2 for %3% of the time.")
-                        .arg(ipap)
-                        .arg(schema::channel[pressChanID].units())
+                        .arg(latest.pressure)
+                        .arg(latest.pressureUnits)
                         .arg(perc);
             } else if (cpapmode == MODE_ASV_VARIABLE_EPAP || cpapmode == MODE_BILEVEL_AUTO_VARIABLE_PS){
-                EventDataType ipap = day->percentile(pressChanID, perc/100.0);
-                EventDataType epap = day->percentile(epapDataChanID, perc/100.0);
-
-                html += tr("Your EPAP pressure was under %1 %2 for %3% of the time.").arg(epap).arg(schema::channel[epapDataChanID].units()).arg(perc)+"<br/>";
-                html += tr("Your IPAP pressure was under %1 %2 for %3% of the time.").arg(ipap).arg(schema::channel[pressChanID].units()).arg(perc);
+                html += tr("Your EPAP pressure was under %1 %2 for %3% of the time.").arg(latest.epap).arg(latest.epapUnits).arg(perc)+"<br/>";
+                html += tr("Your IPAP pressure was under %1 %2 for %3% of the time.").arg(latest.pressure).arg(latest.pressureUnits).arg(perc);
             }
             html += "<br/>";
 
-            //EventDataType lat = day->timeAboveThreshold(CPAP_Leak, p_profile->cpap->leakRedline())/ 60.0;
-            //EventDataType leaks = 1.0/hours * lat;
-
-            EventDataType leak = day->wavg(CPAP_Leak);
-            EventDataType leakdays = p_profile->calcWavg(CPAP_Leak, MT_CPAP, starttime, endtime);
+            EventDataType leak = latest.leak;
+            EventDataType leakdays = latest.leakAverage;
 
             if ((leak < leakdays) && ((leakdays - leak) >= 0.1)) {
                 comp = under;
@@ -313,7 +304,7 @@ QString Welcome::GenerateCPAPHTML()
                 comp = equal;
             }
 
-            html += tr("Your average leaks were %1 %2, which is %3 your %4 day average of %5.").arg(leak,0,'f',2).arg(schema::channel[CPAP_Leak].units()).arg(comp).arg(averagedays).arg(leakdays,0,'f',2);
+            html += tr("Your average leaks were %1 %2, which is %3 your %4 day average of %5.").arg(leak,0,'f',2).arg(latest.leakUnits).arg(comp).arg(averagedays).arg(leakdays,0,'f',2);
 
             html += "<br/>";
 
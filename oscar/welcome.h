@@ -10,6 +10,8 @@
 
 #include <QWidget>
 
+#include "SleepLib/latestnights.h"
+
 namespace Ui {
 class Welcome;
 }
@@ -22,7 +24,8 @@ public:
     explicit Welcome(QWidget *parent = 0);
     ~Welcome();
 
-    void refreshPage();
+    //! \brief Refreshes the page, recalculate discards the cached figures after data changes
+    void refreshPage(bool recalculate = false);
 
 private slots:
     void on_dailyButton_clicked();
@@ -35,9 +38,17 @@ private slots:
 
     void on_importButton_clicked();
 
+    void updateLatestNights();
+
+protected:
+    virtual void showEvent(QShowEvent * event);
+
 private:
     QString GenerateCPAPHTML();
     QString GenerateOxiHTML();
+
+    LatestNights latest;
+    LatestNightsCalculator calculator;
     QPixmap pixmap;
     Ui::Welcome *ui;
 };
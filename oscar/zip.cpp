@@ -84,15 +84,14 @@ bool ZipFile::AddFiles(FileQueue & queue, ProgressDialog* progress)
         progress->addAbortButton();
         progress->setWindowModality(Qt::ApplicationModal);
         progress->open();
-        connect(this, SIGNAL(setProgressMax(int)), progress, SLOT(setProgressMax(int)));
-        connect(this, SIGNAL(setProgressValue(int)), progress, SLOT(setProgressValue(int)));
+        progress->track(&m_tracker);
         connect(progress, SIGNAL(abortClicked()), this, SLOT(abort()));
     }
 
-    // Always emit, since the caller may have configured and connected a progress dialog manually.
-    emit setProgressValue(m_progress/PROGRESS_SCALE);
-    emit setProgressMax((queue.byteCount() + queue.dirCount())/PROGRESS_SCALE);
-    QCoreApplication::processEvents();
+    // Always update, since the caller may be showing progress() some other way.
+    m_tracker.setValue(m_progress/PROGRESS_SCALE);
+    m_tracker.setMax((queue.byteCount() + queue.dirCount())/PROGRESS_SCALE);
+    ProgressTracker::pumpEvents();
 
     for (auto & entry : queue.files()) {
         ok = AddFile(entry.path, entry.name);
@@ -103,8 +102,7 @@ bool ZipFile::AddFiles(FileQueue & queue, ProgressDialog* progress)
     
     if (progress) {
         disconnect(progress, SIGNAL(abortClicked()), this, SLOT(abort()));
-        disconnect(this, SIGNAL(setProgressMax(int)), progress, SLOT(setProgressMax(int)));
-        disconnect(this, SIGNAL(setProgressValue(int)), progress, SLOT(setProgressValue(int)));
+        progress->track(nullptr);
         progress->close();
         progress->deleteLater();
     }
@@ -154,8 +152,8 @@ bool ZipFile::AddFile(const QString & path, const QString & name)
 
     bool ok = zip_add(m_ctx, archive_name, data, fi.lastModified());
 
-    emit setProgressValue(m_progress/PROGRESS_SCALE);
-    QCoreApplication::processEvents();
+    m_tracker.setValue(m_progress/PROGRESS_SCALE);
+    ProgressTracker::pumpEvents();
     
     return ok;
 }
@@ -222,7 +220,7 @@ bool FileQueue::AddFile(const QString & path, const QString & prefix)
     }
     Entry entry = { canonicalPath, archive_name };
     m_files.append(entry);
-    QCoreApplication::processEvents();
+    ProgressTracker::pumpEvents();
     return true;
 }
 
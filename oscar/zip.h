@@ -12,6 +12,8 @@
 #include <QDir>
 #include <QFile>
 
+#include "SleepLib/progresstracker.h"
+
 class ProgressDialog;
 
 class ZipFile : public QObject
@@ -31,18 +33,18 @@ public:
     
     bool aborted() const { return m_abort; }
 
+    //! \brief Progress in KiB, for callers showing their own progress display
+    ProgressTracker & progress() { return m_tracker; }
+
 public slots:
     void abort() { m_abort = true; }
 
-signals:
-    void setProgressMax(int max);
-    void setProgressValue(int val);
-
 protected:
     void* m_ctx;
     QFile m_file;
     bool m_abort;
     quint64 m_progress;
+    ProgressTracker m_tracker;
 };
 
 